@@ -0,0 +1,126 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "app/rest/chunked_buffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+namespace firebase {
+namespace rest {
+
+// Smallest slab allocated, large enough that most small JSON responses fit in
+// a single slab.
+static const size_t kMinSlabSize = 4 * 1024;
+// Largest slab allocated when the expected size is unknown. Slabs grow
+// geometrically up to this size to limit the number of allocations.
+static const size_t kMaxSlabSize = 1024 * 1024;
+
+ChunkedBuffer::ChunkedBuffer() : size_(0), reserved_(0) {}
+
+ChunkedBuffer::ChunkedBuffer(ChunkedBuffer&& rhs)
+    : slabs_(std::move(rhs.slabs_)),
+      size_(rhs.size_),
+      reserved_(rhs.reserved_) {
+  rhs.slabs_.clear();
+  rhs.size_ = 0;
+  rhs.reserved_ = 0;
+}
+
+ChunkedBuffer& ChunkedBuffer::operator=(ChunkedBuffer&& rhs) {
+  if (this != &rhs) {
+    slabs_ = std::move(rhs.slabs_);
+    size_ = rhs.size_;
+    reserved_ = rhs.reserved_;
+    rhs.slabs_.clear();
+    rhs.size_ = 0;
+    rhs.reserved_ = 0;
+  }
+  return *this;
+}
+
+void ChunkedBuffer::Reserve(size_t size) { reserved_ = size; }
+
+void ChunkedBuffer::Append(const char* data, size_t length) {
+  while (length) {
+    Slab* slab = slabs_.empty() ? nullptr : &slabs_.back();
+    if (!slab || slab->size == slab->capacity) {
+      size_t capacity;
+      if (reserved_ > size_) {
+        // Allocate the remaining expected data plus the null terminator added
+        // by Flatten().
+        capacity = (std::max)(reserved_ - size_, length) + 1;
+      } else {
+        capacity = slab ? (std::min)(slab->capacity * 2, kMaxSlabSize)
+                        : kMinSlabSize;
+        capacity = (std::max)(capacity, length);
+      }
+      slab = AddSlab(capacity);
+    }
+    size_t bytes_to_copy = (std::min)(length, slab->capacity - slab->size);
+    memcpy(slab->data.get() + slab->size, data, bytes_to_copy);
+    slab->size += bytes_to_copy;
+    size_ += bytes_to_copy;
+    data += bytes_to_copy;
+    length -= bytes_to_copy;
+  }
+}
+
+void ChunkedBuffer::Clear() {
+  slabs_.clear();
+  size_ = 0;
+  reserved_ = 0;
+}
+
+void ChunkedBuffer::GetSegment(size_t index, const char** data,
+                               size_t* size) const {
+  assert(index < slabs_.size());
+  *data = slabs_[index].data.get();
+  *size = slabs_[index].size;
+}
+
+const char* ChunkedBuffer::Flatten() {
+  if (slabs_.empty()) return "";
+  if (slabs_.size() == 1 && slabs_[0].size < slabs_[0].capacity) {
+    // Already contiguous with room for the terminator.
+    slabs_[0].data[slabs_[0].size] = '\0';
+    return slabs_[0].data.get();
+  }
+  Slab merged;
+  merged.capacity = size_ + 1;
+  merged.data.reset(new char[merged.capacity]);
+  for (const Slab& slab : slabs_) {
+    memcpy(merged.data.get() + merged.size, slab.data.get(), slab.size);
+    merged.size += slab.size;
+  }
+  merged.data[merged.size] = '\0';
+  slabs_.clear();
+  slabs_.push_back(std::move(merged));
+  return slabs_[0].data.get();
+}
+
+ChunkedBuffer::Slab* ChunkedBuffer::AddSlab(size_t capacity) {
+  Slab slab;
+  slab.capacity = capacity;
+  slab.data.reset(new char[capacity]);
+  slabs_.push_back(std::move(slab));
+  return &slabs_.back();
+}
+
+}  // namespace rest
+}  // namespace firebase
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIREBASE_APP_REST_CHUNKED_BUFFER_H_
+#define FIREBASE_APP_REST_CHUNKED_BUFFER_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace firebase {
+namespace rest {
+
+// A byte buffer stored as a list of large slabs. Appending never moves data
+// that has already been stored, and the data is only made contiguous when
+// Flatten() is called, at which point the slabs are merged into a single slab
+// so the data is never held twice.
+class ChunkedBuffer {
+ public:
+  ChunkedBuffer();
+
+  // Note: remove if support for Visual Studio <2015 is no longer needed.
+  ChunkedBuffer(ChunkedBuffer&& rhs);
+  ChunkedBuffer& operator=(ChunkedBuffer&& rhs);
+
+  // Hint the total number of bytes that will be stored, so that the next slab
+  // can hold all remaining data and Flatten() does not need to copy.
+  void Reserve(size_t size);
+
+  // Copy data to the end of the buffer.
+  void Append(const char* data, size_t length);
+
+  // Remove all data and release memory.
+  void Clear();
+
+  // Total number of bytes stored.
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Scatter-gather access to the stored data. Segments are in order and are
+  // never empty.
+  size_t segment_count() const { return slabs_.size(); }
+  void GetSegment(size_t index, const char** data, size_t* size) const;
+
+  // Get the data as a single null terminated buffer. The buffer remains valid
+  // until the next call to Append(), Reserve() or Clear().
+  const char* Flatten();
+
+ private:
+  struct Slab {
+    Slab() : capacity(0), size(0) {}
+    std::unique_ptr<char[]> data;
+    size_t capacity;
+    size_t size;
+  };
+
+  // Add a slab with at least the specified capacity.
+  Slab* AddSlab(size_t capacity);
+
+  std::vector<Slab> slabs_;
+  // Total number of bytes stored in slabs_.
+  size_t size_;
+  // Number of bytes expected to be appended, 0 if unknown.
+  size_t reserved_;
+};
+
+}  // namespace rest
+}  // namespace firebase
+
+#endif  // FIREBASE_APP_REST_CHUNKED_BUFFER_H_
@@ -59,6 +59,11 @@ class Request : public Transfer {
     options_.header.emplace(name, value);
   }
 
+  // Sets the HTTP protocol version to use for the request.
+  virtual void set_http_version(HttpVersion http_version) {
+    options_.http_version = http_version;
+  }
+
   // Sets verbose to true to display more verbose info for debug.
   virtual void set_verbose(bool verbose) { options_.verbose = verbose; }
 
@@ -23,6 +23,18 @@
 namespace firebase {
 namespace rest {
 
+// HTTP protocol version to request.
+enum HttpVersion {
+  // Use the transport's default, see rest::ConnectionPoolOptions.
+  kHttpVersionDefault = 0,
+  // Always use HTTP/1.1.
+  kHttpVersion1_1,
+  // Use HTTP/2 for HTTPS requests when the server supports it, multiplexing
+  // concurrent requests to the same host over one connection. Falls back to
+  // HTTP/1.1 if HTTP/2 is not negotiated.
+  kHttpVersion2,
+};
+
 // The request options for making each HTTP/REST request. See the usage in
 // transport_interface.h. The actual HTTP transporter could be either library
 // Curl or a test mock.
@@ -31,6 +43,8 @@ struct RequestOptions {
       : method("GET"),
         stream_post_fields(false),
         timeout_ms(300000),  // Same timeout used by Chromium.
+        reuse_connection(true),
+        http_version(kHttpVersionDefault),
         verbose(false) {}
 
   // The URL to use in the request.
@@ -47,6 +61,12 @@ struct RequestOptions {
   std::map<std::string, std::string> header;
   // The maximum time in milliseconds to allow the request and response.
   int64_t timeout_ms;
+  // Whether the request may use a cached connection to the host and leave its
+  // connection open for later requests. Set to false to force a fresh
+  // connection that is closed when the request completes.
+  bool reuse_connection;
+  // HTTP protocol version to use for the request.
+  HttpVersion http_version;
 
   // Set true to make the library display more verbose info to help debug. Does
   // not really affect the connection.
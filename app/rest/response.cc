@@ -16,6 +16,7 @@
 
 #include "app/rest/response.h"
 
+#include <cstdlib>
 #include <string>
 
 #include "app/rest/util.h"
@@ -24,6 +25,10 @@
 namespace firebase {
 namespace rest {
 
+// Largest Content-Length used to preallocate the body. Larger bodies are still
+// accepted but are allocated as data arrives.
+static const size_t kMaxBodyReserve = 64 * 1024 * 1024;  // 64 MB
+
 Response::Response()
     : status_(0),
       header_completed_(false),
@@ -42,7 +47,8 @@ bool Response::ProcessHeader(const char* buffer, size_t length) {
       header_completed_ = true;
     } else {
       // Scan status code and ignore version as well as reason-phrase strings.
-      sscanf(header.c_str(), "HTTP/%*d.%*d %d %*s\r\n", &status_);
+      // The version has no minor number from HTTP/2 on, e.g. "HTTP/2 200".
+      sscanf(header.c_str(), "HTTP/%*s %d", &status_);
     }
   } else {
     // A header line with key and value, separated by colon.
@@ -53,23 +59,38 @@ bool Response::ProcessHeader(const char* buffer, size_t length) {
     header_.emplace(key, value);
 
     // Below we update this response object by each header.
+    const std::string upper_key = util::ToUpper(key);
     // Update fetch_time_ from Date.
-    if (key == util::kDate) {
+    if (upper_key == util::kDateUpperCase) {
       fetch_time_ = curl_getdate(value.c_str(), nullptr /* unused */);
+    } else if (upper_key == util::kContentLengthUpperCase) {
+      // Allocate the body up front so it does not need to be copied to make
+      // it contiguous.
+      unsigned long long content_length =  // NOLINT
+          strtoull(value.c_str(), nullptr, 10);
+      if (content_length > 0 && content_length <= kMaxBodyReserve) {
+        body_.Reserve(static_cast<size_t>(content_length));
+      }
     }
   }
   return true;
 }
 
 bool Response::ProcessBody(const char* buffer, size_t length) {
-  // Since buffer may NOT neccessarily end with \0, pass in length in the init.
-  std::string body(buffer, length);
-  body_.push_back(body);
+  // Since buffer may NOT neccessarily end with \0, pass in length.
+  body_.Append(buffer, length);
   return true;
 }
 
 const char* Response::GetHeader(const char* name) {
   auto iter = header_.find(name);
+  if (iter == header_.end()) {
+    // Field names are case-insensitive, e.g. HTTP/2 sends them in lowercase.
+    std::string upper_name = util::ToUpper(name);
+    for (iter = header_.begin(); iter != header_.end(); ++iter) {
+      if (util::ToUpper(iter->first) == upper_name) break;
+    }
+  }
   if (iter == header_.end()) {
     return nullptr;
   } else {
@@ -77,28 +98,11 @@ const char* Response::GetHeader(const char* name) {
   }
 }
 
-const char* Response::GetBody() const {
-  // If already concatenated before, return it.
-  if (!body_cache_.empty()) {
-    return body_cache_.c_str();
-  }
-  // Compute the length of message body.
-  size_t length = 0;
-  for (const std::string& body : body_) {
-    length += body.length();
-  }
-  // Concatenate the message body.
-  body_cache_.reserve(length);
-  for (const std::string& body : body_) {
-    body_cache_ += body;
-  }
-  return body_cache_.c_str();
-}
+const char* Response::GetBody() const { return body_.Flatten(); }
 
 void Response::GetBody(const char** data, size_t* size) const {
-  GetBody();
-  *data = body_cache_.data();
-  *size = body_cache_.length();
+  *data = body_.Flatten();
+  *size = body_.size();
 }
 
 }  // namespace rest
@@ -24,6 +24,7 @@
 #include <utility>
 #include <vector>
 
+#include "app/rest/chunked_buffer.h"
 #include "app/rest/transfer_interface.h"
 #include "app/rest/util.h"
 
@@ -49,8 +50,7 @@ class Response : public Transfer {
         sdk_error_code_(std::move(rhs.sdk_error_code_)),      // NOLINT
         fetch_time_(std::move(rhs.fetch_time_)),              // NOLINT
         header_(std::move(rhs.header_)),
-        body_(std::move(rhs.body_)),
-        body_cache_(std::move(rhs.body_cache_)) {}
+        body_(std::move(rhs.body_)) {}
 
   // Process headers. Return false when it fails and will interrupt the request.
   virtual bool ProcessHeader(const char* buffer, size_t length);
@@ -100,6 +100,10 @@ class Response : public Transfer {
   // Get the body. Use for binary body.
   virtual void GetBody(const char** data, size_t* size) const;
 
+  // Get the body without making it contiguous, use GetSegment() to iterate
+  // over the pieces of the body.
+  const ChunkedBuffer& body() const { return body_; }
+
  private:
   // The status code of the response.
   int status_;
@@ -113,9 +117,9 @@ class Response : public Transfer {
   std::time_t fetch_time_;
   // Stores key-value pairs in header.
   std::map<std::string, std::string> header_;
-  // Stores body in pieces and as a whole.
-  std::vector<std::string> body_;
-  mutable std::string body_cache_;
+  // Stores the body. This is made contiguous in place the first time the
+  // body is requested with GetBody().
+  mutable ChunkedBuffer body_;
 };
 
 }  // namespace rest
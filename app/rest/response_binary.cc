@@ -16,7 +16,6 @@
 
 #include "app/rest/response_binary.h"
 
-#include <memory>
 #include <string>
 
 #include "app/rest/zlibwrapper.h"
@@ -55,15 +54,17 @@ std::string ResponseBinary::Gunzip(const char* input_data,
              result_length);
     return std::string();
   }
-  std::unique_ptr<char[]> result(new char[result_length]);
+  // Uncompress directly into the result rather than an intermediate buffer.
+  std::string result(result_length, '\0');
   int err = zlib_.Uncompress(
-      reinterpret_cast<unsigned char*>(result.get()), &result_length,
+      reinterpret_cast<unsigned char*>(&result[0]), &result_length,
       reinterpret_cast<const unsigned char*>(input_data), input_size);
   if (err != Z_OK) {
     LogError("gunzip error: %d", err);
     return std::string();
   }
-  return std::string(result.get(), result_length);
+  result.resize(result_length);
+  return result;
 }
 
 }  // namespace rest
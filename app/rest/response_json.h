@@ -19,9 +19,11 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "app/rest/response.h"
 #include "app/src/assert.h"
+#include "app/src/include/firebase/internal/mutex.h"
 #include "app/src/log.h"
 #include "flatbuffers/idl.h"
 #include "flatbuffers/stl_emulation.h"
@@ -29,6 +31,61 @@
 namespace firebase {
 namespace rest {
 
+// Pool of FlatBuffer parsers that have already compiled the schema for
+// FbsType. Compiling a schema is much more expensive than parsing a typical
+// response so parsers are shared by all responses of the same type, rather
+// than compiling the schema again for every response.
+template <typename FbsType>
+class SchemaParserPool {
+ public:
+  // Get a parser with the schema compiled and an empty builder. The schema is
+  // only compiled if there are no idle parsers in the pool.
+  static flatbuffers::unique_ptr<flatbuffers::Parser> Acquire(
+      const char* schema) {
+    {
+      MutexLock lock(*mutex());
+      std::vector<flatbuffers::Parser*>& parsers = idle_parsers();
+      if (!parsers.empty()) {
+        flatbuffers::unique_ptr<flatbuffers::Parser> parser(parsers.back());
+        parsers.pop_back();
+        return parser;
+      }
+    }
+    flatbuffers::IDLOptions fbs_options;
+    fbs_options.skip_unexpected_fields_in_json = true;
+    flatbuffers::unique_ptr<flatbuffers::Parser> parser(
+        new flatbuffers::Parser(fbs_options));
+    bool parse_status = parser->Parse(schema);
+    FIREBASE_ASSERT_MESSAGE(parse_status, parser->error_.c_str());
+    return parser;
+  }
+
+  // Return a parser to the pool. The parser's buffer is released so that large
+  // responses do not pin memory while the parser is idle.
+  static void Release(flatbuffers::unique_ptr<flatbuffers::Parser> parser) {
+    parser->builder_.Reset();
+    MutexLock lock(*mutex());
+    std::vector<flatbuffers::Parser*>& parsers = idle_parsers();
+    if (parsers.size() < kMaxIdleParsers) parsers.push_back(parser.release());
+  }
+
+ private:
+  // Maximum number of idle parsers retained for each FbsType.
+  static const size_t kMaxIdleParsers = 4;
+
+  // These are intentionally leaked to avoid destruction order issues with
+  // responses that are destroyed during static destruction.
+  static Mutex* mutex() {
+    static Mutex* mutex = new Mutex();
+    return mutex;
+  }
+  static std::vector<flatbuffers::Parser*>& idle_parsers() {
+    static std::vector<flatbuffers::Parser*>* parsers =
+        new std::vector<flatbuffers::Parser*>();
+    return *parsers;
+  }
+};
+
 // HTTP/REST response with Content-Type: application/json. FbsType is FlatBuffer
 // type that contains the application data. Before the conversion between JSON
 // and FlexBuffers are supported, we need to specify FlatBuffers type here.
@@ -37,15 +94,10 @@ namespace rest {
 template <typename FbsType, typename FbsTypeT>
 class ResponseJson : public Response {
  public:
-  // Constructs from a FlatBuffer schema, which should match FbsType.
-  explicit ResponseJson(const char* schema) {
-    flatbuffers::IDLOptions fbs_options;
-    fbs_options.skip_unexpected_fields_in_json = true;
-    parser_.reset(new flatbuffers::Parser(fbs_options));
-
-    bool parse_status = parser_->Parse(schema);
-    FIREBASE_ASSERT_MESSAGE(parse_status, parser_->error_.c_str());
-  }
+  // Constructs from a FlatBuffer schema, which should match FbsType. The
+  // compiled schema is shared with all other responses of the same FbsType.
+  explicit ResponseJson(const char* schema)
+      : parser_(SchemaParserPool<FbsType>::Acquire(schema)) {}
 
   // Constructs from a FlatBuffer schema, which should match FbsType.
   explicit ResponseJson(const unsigned char* schema)
@@ -62,11 +114,16 @@ class ResponseJson : public Response {
         parser_(std::move(rhs.parser_)),
         application_data_(std::move(rhs.application_data_)) {}
 
+  ~ResponseJson() override {
+    if (parser_) SchemaParserPool<FbsType>::Release(std::move(parser_));
+  }
+
   // When transmission is completed, we parse the response JSON string.
   void MarkCompleted() override {
     // Body could be empty if request failed. Deal this case first since
     // flatbuffer parser does not allow empty input.
-    if (strlen(GetBody()) == 0) {
+    const char* body = GetBody();
+    if (body[0] == '\0') {
       application_data_.reset(new FbsTypeT());
       Response::MarkCompleted();
       return;
@@ -74,10 +131,16 @@ class ResponseJson : public Response {
 
     // Parse and verify JSON string in body. FlatBuffer parser does not support
     // online parsing. So we only parse the body when we get everything.
-    bool parse_status = parser_->Parse(GetBody());
+    // The parser may have been used by a previous response so clear the
+    // builder, the parser rejects more than one JSON object per buffer.
+    parser_->builder_.Clear();
+    bool parse_status = parser_->Parse(body);
     if (!parse_status) {
       LogError("flatbuffers::Parser::Parse() failed: %s",
                parser_->error_.c_str());
+      // The parser could be left in an inconsistent state so do not return it
+      // to the pool.
+      parser_.reset();
       application_data_.reset(new FbsTypeT());
       Response::MarkCompleted();
       return;
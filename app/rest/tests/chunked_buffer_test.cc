@@ -0,0 +1,113 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "app/rest/chunked_buffer.h"
+
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace rest {
+
+// Concatenate all segments of a buffer.
+std::string SegmentsToString(const ChunkedBuffer& buffer) {
+  std::string result;
+  for (size_t i = 0; i < buffer.segment_count(); ++i) {
+    const char* data;
+    size_t size;
+    buffer.GetSegment(i, &data, &size);
+    EXPECT_GT(size, 0u);
+    result.append(data, size);
+  }
+  return result;
+}
+
+TEST(ChunkedBufferTest, Empty) {
+  ChunkedBuffer buffer;
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(0u, buffer.size());
+  EXPECT_EQ(0u, buffer.segment_count());
+  EXPECT_STREQ("", buffer.Flatten());
+}
+
+TEST(ChunkedBufferTest, AppendSmall) {
+  ChunkedBuffer buffer;
+  buffer.Append("hello ", 6);
+  buffer.Append("world", 5);
+  EXPECT_EQ(11u, buffer.size());
+  EXPECT_EQ(1u, buffer.segment_count());
+  EXPECT_EQ("hello world", SegmentsToString(buffer));
+  EXPECT_STREQ("hello world", buffer.Flatten());
+}
+
+TEST(ChunkedBufferTest, AppendLargeSpansSegments) {
+  ChunkedBuffer buffer;
+  std::string expected;
+  std::string chunk(1000, 'a');
+  for (int i = 0; i < 100; ++i) {
+    chunk[0] = static_cast<char>('a' + i % 26);
+    buffer.Append(chunk.data(), chunk.size());
+    expected += chunk;
+  }
+  EXPECT_EQ(expected.size(), buffer.size());
+  EXPECT_GT(buffer.segment_count(), 1u);
+  EXPECT_EQ(expected, SegmentsToString(buffer));
+  // Flattening merges the segments.
+  EXPECT_EQ(expected, std::string(buffer.Flatten()));
+  EXPECT_EQ(1u, buffer.segment_count());
+  EXPECT_EQ(expected, SegmentsToString(buffer));
+}
+
+TEST(ChunkedBufferTest, ReserveKeepsDataContiguous) {
+  ChunkedBuffer buffer;
+  std::string expected(100000, 'x');
+  buffer.Reserve(expected.size());
+  for (size_t offset = 0; offset < expected.size(); offset += 1000) {
+    buffer.Append(expected.data() + offset, 1000);
+  }
+  EXPECT_EQ(1u, buffer.segment_count());
+  const char* data;
+  size_t size;
+  buffer.GetSegment(0, &data, &size);
+  // Flatten should not need to copy.
+  EXPECT_EQ(data, buffer.Flatten());
+  EXPECT_EQ(expected, std::string(buffer.Flatten()));
+}
+
+TEST(ChunkedBufferTest, AppendAfterFlatten) {
+  ChunkedBuffer buffer;
+  buffer.Append("abc", 3);
+  EXPECT_STREQ("abc", buffer.Flatten());
+  buffer.Append("def", 3);
+  EXPECT_STREQ("abcdef", buffer.Flatten());
+}
+
+TEST(ChunkedBufferTest, MoveAndClear) {
+  ChunkedBuffer buffer;
+  buffer.Append("abc", 3);
+  ChunkedBuffer moved(std::move(buffer));
+  EXPECT_TRUE(buffer.empty());  // NOLINT
+  EXPECT_STREQ("abc", moved.Flatten());
+  moved.Clear();
+  EXPECT_TRUE(moved.empty());
+  EXPECT_EQ(0u, moved.segment_count());
+}
+
+}  // namespace rest
+}  // namespace firebase
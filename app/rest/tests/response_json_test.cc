@@ -128,5 +128,33 @@ TEST(ResponseJsonTest, NonStandardJsonResponse) {
   EXPECT_EQ(123, response.number());
 }
 
+// Test that responses sharing a pooled schema parser each parse their own
+// body, including after a response fails to parse.
+TEST(ResponseJsonTest, ReuseSchemaParser) {
+  {
+    ResponseSample response;
+    const char body[] = "{ \"token\": \"first\", \"number\": 1 }";
+    response.ProcessBody(body, sizeof(body));
+    response.MarkCompleted();
+    EXPECT_EQ("first", response.token());
+    EXPECT_EQ(1, response.number());
+  }
+  {
+    ResponseSample response;
+    const char body[] = "{ \"token\": ";
+    response.ProcessBody(body, sizeof(body));
+    response.MarkCompleted();
+    EXPECT_TRUE(response.token().empty());
+  }
+  {
+    ResponseSample response;
+    const char body[] = "{ \"token\": \"second\", \"number\": 2 }";
+    response.ProcessBody(body, sizeof(body));
+    response.MarkCompleted();
+    EXPECT_EQ("second", response.token());
+    EXPECT_EQ(2, response.number());
+  }
+}
+
 }  // namespace rest
 }  // namespace firebase
@@ -17,6 +17,7 @@
 #include "app/rest/response.h"
 
 #include <cstring>
+#include <string>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -49,6 +50,30 @@ TEST(ResponseTest, ProcessStatusLine) {
   EXPECT_EQ(302, response.status());
 }
 
+TEST(ResponseTest, ProcessHttp2StatusLine) {
+  Response response;
+  // HTTP/2 status lines have no minor version.
+  ProcessHeader("HTTP/2 200\r\n", &response);
+  EXPECT_EQ(200, response.status());
+
+  ProcessHeader("HTTP/2 404\r\n", &response);
+  EXPECT_EQ(404, response.status());
+}
+
+TEST(ResponseTest, ProcessHttp2Header) {
+  Response response;
+  // HTTP/2 sends header names in lowercase.
+  ProcessHeader("HTTP/2 200\r\n", &response);
+  ProcessHeader("content-type: application/json\r\n", &response);
+  ProcessHeader("date: Wed, 05 Jul 2017 15:55:19 GMT\r\n", &response);
+  ProcessHeader("\r\n", &response);
+  response.MarkCompleted();
+  EXPECT_EQ(200, response.status());
+  EXPECT_TRUE(response.header_completed());
+  EXPECT_STREQ("application/json", response.GetHeader("Content-Type"));
+  EXPECT_EQ(1499270119, response.fetch_time());
+}
+
 TEST(ResponseTest, ProcessHeaderEnding) {
   Response response;
   EXPECT_FALSE(response.header_completed());
@@ -98,5 +123,29 @@ TEST(ResponseTest, ProcessDateHeaderMissing) {
   EXPECT_LT(1499270119, response.fetch_time());
 }
 
+TEST(ResponseTest, ProcessBodyWithContentLength) {
+  Response response;
+  const std::string body(100000, 'b');
+  ProcessHeader("content-length: 100000\r\n", &response);
+  for (size_t offset = 0; offset < body.size(); offset += 1000) {
+    response.ProcessBody(body.data() + offset, 1000);
+  }
+  // The body was preallocated so it is stored in a single segment.
+  EXPECT_EQ(1u, response.body().segment_count());
+  const char* data;
+  size_t size;
+  response.GetBody(&data, &size);
+  EXPECT_EQ(body, std::string(data, size));
+  EXPECT_EQ(data, response.GetBody());
+}
+
+TEST(ResponseTest, ProcessBodyInPieces) {
+  Response response;
+  response.ProcessBody("{\"a\":", 5);
+  response.ProcessBody("1}", 2);
+  EXPECT_EQ(7u, response.body().size());
+  EXPECT_STREQ("{\"a\":1}", response.GetBody());
+}
+
 }  // namespace rest
 }  // namespace firebase
@@ -21,13 +21,18 @@
 
 #include <cstdint>
 #include <cstdio>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "app/rest/request.h"
 #include "app/rest/response.h"
+#include "app/rest/transport_curl_for_testing.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "net/http2/server/lib/public/httpserver2.h"
@@ -39,8 +44,16 @@ namespace rest {
 
 const char* kServerVersion = "HTTP server for test";
 
+// Requests to this path are not answered until the test replies to them.
+const char kBlockedPath[] = "/blocked";
+HTTPServerRequest* g_blocked_request = nullptr;
+absl::Notification* g_blocked_request_received = nullptr;
+
 void UriHandler(HTTPServerRequest* request) {
-  if (request->http_method() == "GET") {
+  if (request->uri() == kBlockedPath) {
+    g_blocked_request = request;
+    g_blocked_request_received->Notify();
+  } else if (request->http_method() == "GET") {
     request->output()->WriteString("test");
     request->Reply();
     LOG(INFO) << "Sent response for GET";
@@ -177,5 +190,137 @@ TEST_F(TransportCurlTest, TestHttpPost) {
   EXPECT_STREQ("{'a':'a','b':'b'}", response.GetBody());
 }
 
+TEST_F(TransportCurlTest, TestConnectionPool) {
+  ConnectionPoolOptions options;
+  options.max_idle_handles = 1;
+  options.max_connections_per_host = 1;
+  SetConnectionPoolOptions(options);
+  const std::string& url =
+      absl::StrFormat("http://localhost:%d", TransportCurlTest::port_);
+  // Requests that reuse pooled handles and connections as well as requests
+  // that force a fresh connection should all succeed.
+  for (int i = 0; i < 4; ++i) {
+    Request request;
+    request.set_url(url.c_str());
+    request.options().reuse_connection = (i % 2) == 0;
+    TestResponse response;
+    TransportCurl curl;
+    curl.Perform(request, &response);
+    response.Wait();
+    EXPECT_EQ(200, response.status());
+    EXPECT_STREQ("test", response.GetBody());
+  }
+  SetConnectionPoolOptions(ConnectionPoolOptions());
+}
+
+// Issue many concurrent requests, as callable functions do, with HTTP/2
+// multiplexing requested. The local server does not use TLS so this also
+// verifies the fallback to HTTP/1.1 when HTTP/2 is not negotiated.
+TEST_F(TransportCurlTest, TestConcurrentHttp2Requests) {
+  const int kNumberOfRequests = 128;
+  ConnectionPoolOptions options;
+  options.max_concurrent_streams = 32;
+  options.http2_by_default = true;
+  SetConnectionPoolOptions(options);
+  const std::string& url =
+      absl::StrFormat("http://localhost:%d", TransportCurlTest::port_);
+  std::vector<std::unique_ptr<Request>> requests;
+  std::vector<std::unique_ptr<TestResponse>> responses;
+  std::vector<std::unique_ptr<TransportCurl>> transports;
+  absl::Time start = absl::Now();
+  for (int i = 0; i < kNumberOfRequests; ++i) {
+    requests.emplace_back(new Request());
+    requests.back()->set_url(url.c_str());
+    requests.back()->set_method("POST");
+    requests.back()->add_header("Content-Type", "application/json");
+    requests.back()->set_post_fields("{\"data\":{}}");
+    responses.emplace_back(new TestResponse());
+    transports.emplace_back(new TransportCurl());
+    transports.back()->set_is_async(true);
+    transports.back()->Perform(*requests.back(), responses.back().get());
+  }
+  for (int i = 0; i < kNumberOfRequests; ++i) {
+    responses[i]->Wait();
+    EXPECT_EQ(200, responses[i]->status());
+    EXPECT_STREQ("{\"data\":{}}", responses[i]->GetBody());
+  }
+  absl::Duration elapsed = absl::Now() - start;
+  LOG(INFO) << kNumberOfRequests << " concurrent requests completed in "
+            << elapsed << " ("
+            << kNumberOfRequests / absl::ToDoubleSeconds(elapsed)
+            << " requests/s)";
+  transports.clear();
+  SetConnectionPoolOptions(ConnectionPoolOptions());
+}
+
+// Sequential requests against a local server should complete as soon as the
+// response arrives rather than waiting for a polling interval. Functions,
+// Storage and Remote Config each issue requests back to back this way.
+TEST_F(TransportCurlTest, TestSequentialRequestsDoNotWaitForPollInterval) {
+  const int kNumberOfRequests = 50;
+  const std::string& url =
+      absl::StrFormat("http://localhost:%d", TransportCurlTest::port_);
+  int poll_timeout_count = GetPollTimeoutCount();
+  TransportCurl curl;
+  for (int i = 0; i < kNumberOfRequests; ++i) {
+    Request request;
+    request.set_url(url.c_str());
+    TestResponse response;
+    curl.Perform(request, &response);
+    response.Wait();
+    EXPECT_EQ(200, response.status());
+  }
+  // Every wait of the transfer thread ended because of transfer activity,
+  // never because the thread fell back to polling.
+  EXPECT_EQ(poll_timeout_count, GetPollTimeoutCount());
+}
+
+// A request scheduled while the transfer thread waits on another request
+// that the server has not answered should start right away, rather than when
+// the thread's poll interval of one second elapses.
+TEST_F(TransportCurlTest, TestRequestStartsWhileAnotherIsBlocked) {
+  const std::string& url =
+      absl::StrFormat("http://localhost:%d", TransportCurlTest::port_);
+  const std::string& blocked_url = url + kBlockedPath;
+  absl::Notification blocked_request_received;
+  g_blocked_request_received = &blocked_request_received;
+
+  Request blocked_request;
+  blocked_request.set_url(blocked_url.c_str());
+  TestResponse blocked_response;
+  TransportCurl blocked_curl;
+  blocked_curl.set_is_async(true);
+  blocked_curl.Perform(blocked_request, &blocked_response);
+  ASSERT_TRUE(blocked_request_received.WaitForNotificationWithTimeout(
+      kTimeoutSeconds));
+  // Let the transfer thread go back to waiting for activity on the blocked
+  // request.
+  absl::SleepFor(absl::Milliseconds(100));
+
+  int poll_timeout_count = GetPollTimeoutCount();
+  absl::Time start = absl::Now();
+  Request request;
+  request.set_url(url.c_str());
+  TestResponse response;
+  TransportCurl curl;
+  curl.set_is_async(true);
+  curl.Perform(request, &response);
+  response.Wait();
+  absl::Duration elapsed = absl::Now() - start;
+  EXPECT_EQ(200, response.status());
+  EXPECT_STREQ("test", response.GetBody());
+  EXPECT_FALSE(blocked_response.header_completed());
+  EXPECT_LT(elapsed, absl::Milliseconds(500));
+  EXPECT_EQ(poll_timeout_count, GetPollTimeoutCount());
+
+  // Answer the blocked request so its transfer completes.
+  g_blocked_request->output()->WriteString("test");
+  g_blocked_request->Reply();
+  blocked_response.Wait();
+  EXPECT_EQ(200, blocked_response.status());
+  g_blocked_request = nullptr;
+  g_blocked_request_received = nullptr;
+}
+
 }  // namespace rest
 }  // namespace firebase
@@ -19,23 +19,20 @@
 #include <cassert>
 #include <deque>
 #include <map>
+#include <vector>
 
 #include "app/rest/controller_curl.h"
+#include "app/rest/transport_curl_for_testing.h"
 #include "app/rest/util.h"
 #include "app/src/assert.h"
 #include "app/src/include/firebase/internal/mutex.h"
 #include "app/src/include/firebase/internal/platform.h"
+#include "app/src/log.h"
 #include "app/src/semaphore.h"
 #include "app/src/thread.h"
 #include "app/src/util.h"
 #include "curl/curl.h"
 
-#if FIREBASE_PLATFORM_WINDOWS
-#include "Winsock2.h"
-#else
-#include <sys/select.h>
-#endif  // FIREBASE_PLATFORM_WINDOWS
-
 namespace firebase {
 namespace rest {
 
@@ -165,7 +162,9 @@ class BackgroundTransportCurl {
                           TransportCurl* transport_curl,
                           CompleteFunction complete, void* complete_data);
   ~BackgroundTransportCurl();
-  bool PerformBackground(Request* request);
+  // Configure the transfer and add it to the multi handle. If http2_by_default
+  // is set, requests that do not specify a HTTP version use HTTP/2.
+  bool PerformBackground(Request* request, bool http2_by_default);
 
   CURL* curl() const { return curl_; }
   Response* response() const { return response_; }
@@ -209,15 +208,64 @@ class BackgroundTransportCurl {
   bool timed_out_;
 };
 
+// Pool of reusable easy handles that all share a DNS cache, TLS session cache
+// and connection cache so that consecutive requests to the same host can skip
+// name resolution and the TLS handshake.
+class CurlHandlePool {
+ public:
+  explicit CurlHandlePool(int max_idle_handles);
+  ~CurlHandlePool();
+
+  // Get an easy handle attached to the shared caches.
+  CURL* Acquire();
+  // Reset the handle and return it to the pool, or destroy it if the pool is
+  // full. The handle must not be part of a multi handle.
+  void Release(CURL* curl);
+
+  void set_max_idle_handles(int max_idle_handles);
+
+ private:
+  // Lock callbacks for the share object. Handles are attached and detached on
+  // application threads while transfers run on the curl thread.
+  static void LockShare(CURL* handle, curl_lock_data data,
+                        curl_lock_access access, void* userptr);
+  static void UnlockShare(CURL* handle, curl_lock_data data, void* userptr);
+
+  // Guards idle_handles_ and max_idle_handles_.
+  Mutex mutex_;
+  std::vector<CURL*> idle_handles_;
+  int max_idle_handles_;
+  // Caches shared by all handles created by this pool.
+  CURLSH* share_;
+  // Guards each type of data in share_.
+  Mutex share_mutexes_[CURL_LOCK_DATA_LAST];
+};
+
 // The data common to both threads. This is used to communicate when the
 // background thread should shut down, and when new requests have come in.
 class CurlThread {
  public:
-  CurlThread();
+  explicit CurlThread(const ConnectionPoolOptions& pool_options);
   // Shut down the request processing thread.
   ~CurlThread();
 
-  // Schedule an action on the ProcessRequests thread.
+  // Get an easy handle from the pool.
+  CURL* AcquireHandle() { return handle_pool_.Acquire(); }
+  // Return an easy handle to the pool.
+  void ReleaseHandle(CURL* curl) { handle_pool_.Release(curl); }
+
+  // Update the connection pool limits.
+  void SetConnectionPoolOptions(const ConnectionPoolOptions& options);
+
+  // Number of times the thread stopped waiting for transfer activity only
+  // because kMaxPollIntervalMilliseconds elapsed.
+  int poll_timeout_count() {
+    MutexLock lock(mutex_);
+    return poll_timeout_count_;
+  }
+
+  // Schedule an action on the ProcessRequests thread, waking the thread if it
+  // is waiting for transfer activity.
   void ScheduleAction(const TransportCurlActionData& action_data);
 
   // Cancel a request or flush scheduled matching requests.
@@ -241,6 +289,10 @@ class CurlThread {
   // Cancel all outstanding requests.
   void CancelAllTransfers();
 
+  // Apply connection limits to the multi handle if they have changed.
+  // Must be called from the ProcessRequests thread.
+  void ApplyConnectionPoolOptions();
+
   Mutex* mutex() { return &mutex_; }
 
   // Process requests from action_data_ the see the function definition for the
@@ -252,6 +304,11 @@ class CurlThread {
 
  private:
   flatbuffers::unique_ptr<Thread> background_thread_;
+  // Multi handle used to run all transfers. This is created before the
+  // background thread starts so that ScheduleAction() can always wake it.
+  CURLM* curl_multi_;
+  // Easy handles used by TransportCurl instances.
+  CurlHandlePool handle_pool_;
   // Guards mutation of action_data_queue_, responses_ and
   // controller_ pointers in BackgroundTransportCurl instances.
   Mutex mutex_;
@@ -263,12 +320,33 @@ class CurlThread {
   // Transports for in progress requests for each response.  This allows all
   // requests to be canceled when this object is cleaned up.
   std::map<Response*, BackgroundTransportCurl*> transport_by_response_;
-  // Polling interval while requests are in progress.
-  static const int64_t kPollIntervalMilliseconds;
+  // Connection limits to apply to curl_multi_, guarded by mutex_.
+  ConnectionPoolOptions pool_options_;
+  // Whether pool_options_ has changed since it was applied to curl_multi_.
+  bool pool_options_changed_;
+  // Copy of pool_options_.http2_by_default only accessed by the
+  // ProcessRequests thread.
+  bool http2_by_default_;
+  // Whether curl_multi_wakeup() was called since the thread last waited,
+  // guarded by mutex_.
+  bool wakeup_requested_;
+  // See poll_timeout_count(), guarded by mutex_.
+  int poll_timeout_count_;
+  // Maximum time to wait for socket activity while requests are in progress.
+  // curl_multi_poll() returns as soon as data arrives or an action is
+  // scheduled so this only bounds how stale controller progress can get.
+  static const int kMaxPollIntervalMilliseconds;
 };
 
 namespace {
 
+// Whether libcurl was built with HTTP/2 support.
+bool CurlSupportsHttp2() {
+  static const bool supports_http2 =
+      (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2) != 0;
+  return supports_http2;
+}
+
 // Called when curl has received the header from the server.
 size_t CurlHeaderCallback(char* buffer, size_t size, size_t nitems,
                           void* userdata) {
@@ -314,6 +392,9 @@ int g_initialize_count = 0;
 // Mutex for Curl initialization.
 Mutex* g_initialize_mutex = new Mutex();
 
+// Connection pool limits used when the background thread is started.
+ConnectionPoolOptions* g_connection_pool_options = nullptr;
+
 }  // namespace
 
 void InitTransportCurl() {
@@ -327,7 +408,9 @@ void InitTransportCurl() {
 
     // Kick off background thread.
     assert(!g_curl_thread);
-    g_curl_thread = new CurlThread();
+    g_curl_thread = new CurlThread(g_connection_pool_options
+                                       ? *g_connection_pool_options
+                                       : ConnectionPoolOptions());
   }
   g_initialize_count++;
 }
@@ -346,6 +429,98 @@ void CleanupTransportCurl() {
   }
 }
 
+void SetConnectionPoolOptions(const ConnectionPoolOptions& options) {
+  MutexLock lock(*g_initialize_mutex);
+  if (!g_connection_pool_options) {
+    g_connection_pool_options = new ConnectionPoolOptions();
+  }
+  *g_connection_pool_options = options;
+  if (g_curl_thread) g_curl_thread->SetConnectionPoolOptions(options);
+}
+
+int GetPollTimeoutCount() {
+  MutexLock lock(*g_initialize_mutex);
+  return g_curl_thread ? g_curl_thread->poll_timeout_count() : 0;
+}
+
+CurlHandlePool::CurlHandlePool(int max_idle_handles)
+    : max_idle_handles_(max_idle_handles) {
+  share_ = curl_share_init();
+  FIREBASE_ASSERT_MESSAGE(share_ != nullptr,
+                          "curl share handle failed to initialize");
+  curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, LockShare);
+  curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, UnlockShare);
+  curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+}
+
+CurlHandlePool::~CurlHandlePool() {
+  {
+    MutexLock lock(mutex_);
+    for (CURL* curl : idle_handles_) util::DestroyCurlPtr(curl);
+    idle_handles_.clear();
+  }
+  // If a TransportCurl outlives the curl thread its handle is still attached
+  // to the share, in which case the share is intentionally leaked so that the
+  // handle can safely detach from it later.
+  if (curl_share_cleanup(share_) != CURLSHE_OK) {
+    LogWarning("Leaking curl share handle, it is still in use.");
+  }
+  share_ = nullptr;
+}
+
+CURL* CurlHandlePool::Acquire() {
+  CURL* curl = nullptr;
+  {
+    MutexLock lock(mutex_);
+    if (!idle_handles_.empty()) {
+      curl = idle_handles_.back();
+      idle_handles_.pop_back();
+    }
+  }
+  if (!curl) curl = static_cast<CURL*>(util::CreateCurlPtr());
+  if (curl) curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+  return curl;
+}
+
+void CurlHandlePool::Release(CURL* curl) {
+  // Resetting the handle clears all options but keeps the shared caches.
+  curl_easy_reset(curl);
+  {
+    MutexLock lock(mutex_);
+    if (static_cast<int>(idle_handles_.size()) < max_idle_handles_) {
+      idle_handles_.push_back(curl);
+      return;
+    }
+  }
+  util::DestroyCurlPtr(curl);
+}
+
+void CurlHandlePool::set_max_idle_handles(int max_idle_handles) {
+  std::vector<CURL*> handles_to_destroy;
+  {
+    MutexLock lock(mutex_);
+    max_idle_handles_ = max_idle_handles;
+    while (static_cast<int>(idle_handles_.size()) > max_idle_handles_) {
+      handles_to_destroy.push_back(idle_handles_.back());
+      idle_handles_.pop_back();
+    }
+  }
+  for (CURL* curl : handles_to_destroy) util::DestroyCurlPtr(curl);
+}
+
+void CurlHandlePool::LockShare(CURL* handle, curl_lock_data data,
+                               curl_lock_access access, void* userptr) {
+  static_cast<CurlHandlePool*>(userptr)->share_mutexes_[data].Acquire();
+}
+
+void CurlHandlePool::UnlockShare(CURL* handle, curl_lock_data data,
+                                 void* userptr) {
+  static_cast<CurlHandlePool*>(userptr)->share_mutexes_[data].Release();
+}
+
 BackgroundTransportCurl::BackgroundTransportCurl(
     CURLM* curl_multi, CURL* curl, Request* request, Response* response,
     Mutex* controller_mutex, ControllerCurl* controller,
@@ -438,7 +613,8 @@ void BackgroundTransportCurl::CheckOk(CURLcode code, const char* msg) {
   }
 }
 
-bool BackgroundTransportCurl::PerformBackground(Request* request) {
+bool BackgroundTransportCurl::PerformBackground(Request* request,
+                                                bool http2_by_default) {
   RequestOptions& options = request->options();
   CheckOk(curl_easy_setopt(curl_, CURLOPT_ERRORBUFFER, err_buf_),
           "set error buffer");
@@ -474,9 +650,31 @@ bool BackgroundTransportCurl::PerformBackground(Request* request) {
   CheckOk(curl_easy_setopt(curl_, CURLOPT_TIMEOUT_MS, options.timeout_ms),
           "set http timeout milliseconds");
 
+  // Allow the connection to be taken from, and returned to, the shared cache.
+  long fresh_connection = options.reuse_connection ? 0L : 1L;  // NOLINT
+  CheckOk(curl_easy_setopt(curl_, CURLOPT_FRESH_CONNECT, fresh_connection),
+          "set fresh connection");
+  CheckOk(curl_easy_setopt(curl_, CURLOPT_FORBID_REUSE, fresh_connection),
+          "set forbid connection reuse");
+
   // curl library is using http2 as default, so need to specify this.
-  CheckOk(curl_easy_setopt(curl_, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1),
-          "set http version to http1");
+  bool use_http2 = options.http_version == kHttpVersion2 ||
+                   (options.http_version == kHttpVersionDefault &&
+                    http2_by_default);
+  if (use_http2 && CurlSupportsHttp2()) {
+    // Only negotiate HTTP/2 over TLS, otherwise fall back to HTTP/1.1.
+    CheckOk(curl_easy_setopt(curl_, CURLOPT_HTTP_VERSION,
+                             CURL_HTTP_VERSION_2TLS),
+            "set http version to http2");
+    // Wait for an existing connection to confirm whether it can multiplex
+    // rather than opening a new connection for each concurrent request.
+    CheckOk(curl_easy_setopt(curl_, CURLOPT_PIPEWAIT, 1L), "set pipe wait");
+  } else {
+    CheckOk(
+        curl_easy_setopt(curl_, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1),
+        "set http version to http1");
+    CheckOk(curl_easy_setopt(curl_, CURLOPT_PIPEWAIT, 0L), "set pipe wait");
+  }
 
   // SDK error in initialization stage is not recoverable.
   FIREBASE_ASSERT(err_code_ == CURLE_OK);
@@ -584,19 +782,39 @@ bool BackgroundTransportCurl::PerformBackground(Request* request) {
 
 TransportCurl::TransportCurl()
     : is_async_(false), running_transfers_(0), running_transfers_semaphore_(0) {
-  curl_ = util::CreateCurlPtr();
+  {
+    // Hold the lock so the thread and its handle pool are not deleted by
+    // CleanupTransportCurl() while the handle is taken from the pool.
+    MutexLock lock(*g_initialize_mutex);
+    curl_ = g_curl_thread ? g_curl_thread->AcquireHandle()
+                          : util::CreateCurlPtr();
+  }
   assert(curl_ != nullptr);  // Failed to get curl pointer.  Something is wrong.
 }
 
 TransportCurl::~TransportCurl() {
   WaitForAllTransfersToComplete();
-  util::DestroyCurlPtr(curl_);
+  MutexLock lock(*g_initialize_mutex);
+  if (g_curl_thread) {
+    g_curl_thread->ReleaseHandle(reinterpret_cast<CURL*>(curl_));
+  } else {
+    util::DestroyCurlPtr(curl_);
+  }
 }
 
-// Default polling interval while requests are in progress.
-const int64_t CurlThread::kPollIntervalMilliseconds = 33;  // ~30Hz
-
-CurlThread::CurlThread() : action_data_signal_(0) {
+const int CurlThread::kMaxPollIntervalMilliseconds = 1000;
+
+CurlThread::CurlThread(const ConnectionPoolOptions& pool_options)
+    : handle_pool_(pool_options.max_idle_handles),
+      action_data_signal_(0),
+      pool_options_(pool_options),
+      pool_options_changed_(true),
+      http2_by_default_(false),
+      wakeup_requested_(false),
+      poll_timeout_count_(0) {
+  curl_multi_ = curl_multi_init();
+  FIREBASE_ASSERT_MESSAGE(curl_multi_ != nullptr,
+                          "curl multi handle failed to initialize");
   // Normally we would use make_new() here, but this is not a std::unique_ptr
   // and make_new() isn't supported by all targets we build for
   // NOLINTNEXTLINE
@@ -607,12 +825,50 @@ CurlThread::~CurlThread() {
   CancelAllTransfers();
   ScheduleAction(TransportCurlActionData::Quit());
   background_thread_->Join();
+  // Clean up multi handle after the thread has finished all transfers.
+  curl_multi_cleanup(curl_multi_);
+  curl_multi_ = nullptr;
 }
 
 void CurlThread::ScheduleAction(const TransportCurlActionData& action_data) {
   MutexLock lock(mutex_);
   action_data_queue_.push_back(action_data);
   action_data_signal_.Post();
+  // Interrupt curl_multi_poll() so the action is handled immediately.
+  wakeup_requested_ = true;
+  curl_multi_wakeup(curl_multi_);
+}
+
+void CurlThread::SetConnectionPoolOptions(
+    const ConnectionPoolOptions& options) {
+  handle_pool_.set_max_idle_handles(options.max_idle_handles);
+  MutexLock lock(mutex_);
+  pool_options_ = options;
+  pool_options_changed_ = true;
+  wakeup_requested_ = true;
+  curl_multi_wakeup(curl_multi_);
+}
+
+void CurlThread::ApplyConnectionPoolOptions() {
+  ConnectionPoolOptions options;
+  {
+    MutexLock lock(mutex_);
+    if (!pool_options_changed_) return;
+    options = pool_options_;
+    pool_options_changed_ = false;
+  }
+  curl_multi_setopt(curl_multi_, CURLMOPT_MAXCONNECTS,
+                    static_cast<long>(options.max_idle_connections));  // NOLINT
+  curl_multi_setopt(
+      curl_multi_, CURLMOPT_MAX_HOST_CONNECTIONS,
+      static_cast<long>(options.max_connections_per_host));  // NOLINT
+  // Multiplex HTTP/2 transfers to the same host over a single connection.
+  curl_multi_setopt(curl_multi_, CURLMOPT_PIPELINING,
+                    static_cast<long>(CURLPIPE_MULTIPLEX));  // NOLINT
+  curl_multi_setopt(
+      curl_multi_, CURLMOPT_MAX_CONCURRENT_STREAMS,
+      static_cast<long>(options.max_concurrent_streams));  // NOLINT
+  http2_by_default_ = options.http2_by_default;
 }
 
 int CurlThread::CancelRequest(TransportCurl* transport_curl, Response* response,
@@ -710,64 +966,56 @@ void CurlThread::CancelAllTransfers() {
 }
 
 // The libcurl multi interface, which allows for multiple asynchronous
-// transfers, requires polling to determine when transfers are complete so
-// that the response may be marked completed. The polling and callbacks occur
-// in this thread which is started when InitTransportCurl is called.
+// transfers, is driven from this thread which is started when
+// InitTransportCurl is called. While transfers are in progress the thread
+// sleeps in curl_multi_poll() until socket activity, a curl timeout or
+// ScheduleAction() wakes it, so responses are completed as soon as data
+// arrives rather than on a fixed polling interval.
 void CurlThread::ProcessRequests() {
-  // Set up multi handle.
-  CURLM* curl_multi = curl_multi_init();
-  FIREBASE_ASSERT_MESSAGE(curl_multi != nullptr,
-                          "curl multi handle failed to initialize");
+  CURLM* curl_multi = curl_multi_;
 
   int previous_running_handles = 0;
   int expected_running_handles = 0;
   bool quit = false;
   // This will not quit until all transfers either complete or are canceled.
   while (!(quit && expected_running_handles == 0)) {
-    int64_t polling_interval = kPollIntervalMilliseconds;
+    int64_t wait_for_milliseconds = 0;
     if (quit || previous_running_handles != expected_running_handles) {
       // If we're quitting or the number of transfers has changed, don't wait.
-      polling_interval = 0;
+      wait_for_milliseconds = 0;
     } else if (expected_running_handles == 0) {
-      // If no transfers are active wait indefinitely.
-      polling_interval = -1;
+      // If no transfers are active wait indefinitely for the next action.
+      wait_for_milliseconds = -1;
     } else {
       // Curl defines the timeout argument as a long which can be a different
       // size per platform so we disable the lint warning about this.
       long timeout_ms = 0;  // NOLINT
-      CURLMcode curl_code = curl_multi_timeout(curl_multi, &timeout_ms);
-      if (curl_code == CURLM_OK) {
-        if (timeout_ms < 0) timeout_ms = kPollIntervalMilliseconds;
-
-        // Convert timeout in milliseconds to timeval.
-        struct timeval timeout;
-        timeout.tv_sec = timeout_ms / 1000;
-        timeout.tv_usec = (timeout_ms % 1000) * 1000;
-
-        // Wait for curl's file descriptors to signal that data is available.
-        fd_set fdread;
-        fd_set fdwrite;
-        fd_set fdexcep;
-        int maxfd = -1;
-        FD_ZERO(&fdread);
-        FD_ZERO(&fdwrite);
-        FD_ZERO(&fdexcep);
-        curl_code =
-            curl_multi_fdset(curl_multi, &fdread, &fdwrite, &fdexcep, &maxfd);
-        if (curl_code == CURLM_OK && maxfd != -1) {
-          polling_interval = 0;
-          // TODO(smiles): This should probably also be woken up when items are
-          // added to the queue.  If a long delay occurs due to exponential
-          // backoff this will hang other transfers for the delay period.
-          select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout);
+      bool max_poll_interval = false;
+      if (curl_multi_timeout(curl_multi, &timeout_ms) != CURLM_OK ||
+          timeout_ms < 0 || timeout_ms > kMaxPollIntervalMilliseconds) {
+        timeout_ms = kMaxPollIntervalMilliseconds;
+        max_poll_interval = true;
+      }
+      // Wait for curl's sockets to signal that data is available or for
+      // ScheduleAction() to interrupt the wait via curl_multi_wakeup().
+      if (timeout_ms > 0) {
+        int active_fds = 0;
+        curl_multi_poll(curl_multi, nullptr, 0, static_cast<int>(timeout_ms),
+                        &active_fds);
+        MutexLock lock(mutex_);
+        if (max_poll_interval && active_fds == 0 && !wakeup_requested_) {
+          poll_timeout_count_++;
         }
+        wakeup_requested_ = false;
       }
     }
 
+    ApplyConnectionPoolOptions();
+
     // Consume new transfer requests.
     TransportCurlActionData action_data;
-    while (GetNextAction(&action_data, polling_interval)) {
-      polling_interval = 0;
+    while (GetNextAction(&action_data, wait_for_milliseconds)) {
+      wait_for_milliseconds = 0;
       // Act on the data.
       switch (action_data.action) {
         case kRequestedActionPerform: {
@@ -785,7 +1033,8 @@ void CurlThread::ProcessRequests() {
                 this);
           }
           AddTransfer(transport);
-          if (transport->PerformBackground(action_data.request)) {
+          if (transport->PerformBackground(action_data.request,
+                                           http2_by_default_)) {
             expected_running_handles++;
           } else {
             delete transport;
@@ -915,9 +1164,6 @@ void CurlThread::ProcessRequests() {
     }
     previous_running_handles = expected_running_handles;
   }
-
-  // Clean up multi handle before returning.
-  curl_multi_cleanup(curl_multi);
 }
 
 void CurlThread::ProcessRequests(void* thread) {
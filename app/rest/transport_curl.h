@@ -36,6 +36,36 @@ void InitTransportCurl();
 // resources. This should be called once for every call to InitTransportCurl.
 void CleanupTransportCurl();
 
+// Limits for the pool of curl handles and connections shared by every
+// TransportCurl instance.
+struct ConnectionPoolOptions {
+  ConnectionPoolOptions()
+      : max_idle_handles(16),
+        max_idle_connections(32),
+        max_connections_per_host(0),
+        max_concurrent_streams(100),
+        http2_by_default(false) {}
+
+  // Maximum number of unused easy handles to keep for reuse.
+  int max_idle_handles;
+  // Maximum number of idle connections kept open in the connection cache.
+  int max_idle_connections;
+  // Maximum number of simultaneous connections to a single host, 0 means
+  // unlimited. Transfers above this limit are queued until a connection is
+  // available.
+  int max_connections_per_host;
+  // Maximum number of concurrent HTTP/2 streams multiplexed over a single
+  // connection.
+  int max_concurrent_streams;
+  // Whether requests using kHttpVersionDefault should use HTTP/2.
+  bool http2_by_default;
+};
+
+// Configure the connection pool. This can be called at any time, if transfers
+// are in progress the new limits are applied by the transfer thread before it
+// starts any new transfers.
+void SetConnectionPoolOptions(const ConnectionPoolOptions& options);
+
 // Implement the transport layer, based on curl library.
 class TransportCurl : public Transport {
  public:
@@ -87,7 +117,8 @@ class TransportCurl : public Transport {
   // Wait for all requests associated with this transport to complete.
   void WaitForAllTransfersToComplete();
 
-  // The Curl handle. This class owns the handle.
+  // The Curl handle. This class owns the handle while it is alive and returns
+  // it to the shared pool on destruction.
   void* curl_;
 
   // Whether this request should be made asynchronously.
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIREBASE_APP_REST_TRANSPORT_CURL_FOR_TESTING_H_
+#define FIREBASE_APP_REST_TRANSPORT_CURL_FOR_TESTING_H_
+
+// Hooks into the curl transfer thread used only by tests.
+
+namespace firebase {
+namespace rest {
+
+// Returns the number of times the transfer thread stopped waiting for transfer
+// activity only because its maximum poll interval elapsed, rather than
+// because of socket activity, a curl timer or a newly scheduled request.
+// Transfers are driven by activity, so this stays at zero while requests
+// complete promptly.
+int GetPollTimeoutCount();
+
+}  // namespace rest
+}  // namespace firebase
+
+#endif  // FIREBASE_APP_REST_TRANSPORT_CURL_FOR_TESTING_H_
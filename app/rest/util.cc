@@ -40,6 +40,8 @@ const char kApplicationJson[] = "application/json";
 const char kApplicationWwwFormUrlencoded[] =
     "application/x-www-form-urlencoded";
 const char kDate[] = "Date";
+const char kContentLengthUpperCase[] = "CONTENT-LENGTH";
+const char kDateUpperCase[] = "DATE";
 const char kCrLf[] = "\r\n";
 const char kGet[] = "GET";
 const char kPost[] = "POST";
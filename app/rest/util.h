@@ -36,6 +36,10 @@ extern const char kContentType[];
 extern const char kApplicationJson[];
 extern const char kApplicationWwwFormUrlencoded[];
 extern const char kDate[];
+// Header names are case insensitive, and HTTP/2 sends them in lowercase, so
+// these are compared against the upper case form of each header name.
+extern const char kContentLengthUpperCase[];
+extern const char kDateUpperCase[];
 // The CRLF literal.
 extern const char kCrLf[];
 // String literals for a few common HTTP methods.
@@ -47,12 +51,14 @@ enum HttpStatusCode {
   HttpInvalid = 0,
   HttpSuccess = 200,
   HttpNoContent = 204,
+  HttpPartialContent = 206,
   HttpBadRequest = 400,
   HttpPaymentRequired = 402,
   HttpUnauthorized = 401,
   HttpForbidden = 403,
   HttpNotFound = 404,
-  HttpRequestTimeout = 408
+  HttpRequestTimeout = 408,
+  HttpRangeNotSatisfiable = 416
 };
 
 // Initialize utilities.  This must be called before any functions that
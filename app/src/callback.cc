@@ -16,44 +16,43 @@
 
 #include "app/src/callback.h"
 
-#include <list>
+#include <algorithm>
+#include <vector>
 
-#include "app/memory/shared_ptr.h"
 #include "app/src/include/firebase/internal/mutex.h"
 #include "app/src/log.h"
 #include "app/src/semaphore.h"
 #include "app/src/thread.h"
+#include "app/src/time.h"
 
 namespace firebase {
 namespace callback {
 
-class CallbackEntry;
-
-class CallbackQueue : public std::list<SharedPtr<CallbackEntry>> {
- public:
-  CallbackQueue() {}
-  ~CallbackQueue() {}
-
-  // Get the mutex that controls access to this queue.
-  Mutex* mutex() { return &mutex_; }
-
- private:
-  Mutex mutex_;
-};
+// Maximum number of entries kept for reuse by a dispatcher.
+static const size_t kMaxFreeEntries = 256;
 
 // Entry within the callback queue.
 class CallbackEntry {
  public:
-  // Construct a entry with a reference to the specified callback object.
-  // callback_mutex_ is used to enforce a critical section for callback
-  // execution and destruction.
-  CallbackEntry(Callback* callback, Mutex* callback_mutex)
-      : callback_(callback), mutex_(callback_mutex), executing_(false) {}
+  // Construct an empty entry.  callback_mutex_ is used to enforce a critical
+  // section for callback execution and destruction.
+  explicit CallbackEntry(Mutex* callback_mutex)
+      : callback_(nullptr),
+        mutex_(callback_mutex),
+        executing_(false),
+        queued_timestamp_(0) {}
 
   // Destroy the callback.  This blocks if the callback is currently
   // executing.
   ~CallbackEntry() { DisableCallback(); }
 
+  // Associate the entry with a callback, which must not have a callback.
+  void Reset(Callback* callback, uint64_t queued_timestamp) {
+    MutexLock lock(*mutex_);
+    callback_ = callback;
+    queued_timestamp_ = queued_timestamp;
+  }
+
   // Execute the callback associated with this entry.
   // Returns true if a callback was associated with this entry and was executed,
   // false otherwise.
@@ -92,6 +91,9 @@ class CallbackEntry {
     return true;
   }
 
+  // Time the entry was added to the queue.
+  uint64_t queued_timestamp() const { return queued_timestamp_; }
+
  private:
   // Callback to call from PollCallbacks().
   Callback* callback_;
@@ -99,15 +101,20 @@ class CallbackEntry {
   Mutex* mutex_;
   // A flag set to true when callback_ is about to be called.
   bool executing_;
+  // Time the entry was added to the queue.
+  uint64_t queued_timestamp_;
 };
 
-// Dispatches a queue of callbacks.
+// Dispatches a queue of callbacks.  Entries are recycled and the queue is
+// swapped out as a whole by DispatchCallbacks(), so adding and dispatching a
+// callback only allocates the Callback itself and the queue mutex is taken
+// once per batch rather than once per callback.
 class CallbackDispatcher {
  public:
   CallbackDispatcher() {}
 
   ~CallbackDispatcher() {
-    MutexLock lock(*queue_.mutex());
+    MutexLock lock(mutex_);
     // Destroy all callbacks in this dispatcher's queue.
     size_t remaining_callbacks = queue_.size();
     if (remaining_callbacks) {
@@ -115,18 +122,28 @@ class CallbackDispatcher {
                  remaining_callbacks);
     }
     while (!queue_.empty()) {
-      queue_.back().reset();
+      delete queue_.back();
       queue_.pop_back();
     }
+    for (CallbackEntry* entry : free_entries_) delete entry;
   }
 
   // Add a callback to the dispatch queue returning a reference
   // to the entry which can be optionally be removed prior to dispatch.
   void* AddCallback(Callback* callback) {
-    auto entry = MakeShared<CallbackEntry>(callback, &execution_mutex_);
-    MutexLock lock(*queue_.mutex());
+    uint64_t timestamp = internal::GetTimestamp();
+    MutexLock lock(mutex_);
+    CallbackEntry* entry;
+    if (free_entries_.empty()) {
+      entry = new CallbackEntry(&execution_mutex_);
+    } else {
+      entry = free_entries_.back();
+      free_entries_.pop_back();
+    }
+    entry->Reset(callback, timestamp);
     queue_.push_back(entry);
-    return entry.get();
+    stats_.queued_count++;
+    return entry;
   }
 
   // Remove the callback reference from the specified entry.
@@ -135,47 +152,111 @@ class CallbackDispatcher {
   // NOTE: This does not remove the callback from the execution queue.
   // The queue is flushed on a call to DispatchCallbacks().
   bool DisableCallback(void* callback_reference) {
-    MutexLock lock(*queue_.mutex());
+    MutexLock lock(mutex_);
     CallbackEntry* callback_entry =
         static_cast<CallbackEntry*>(callback_reference);
     return callback_entry->DisableCallback();
   }
 
   // Dispatch queued callbacks returning the number of callbacks that were
-  // dispatched and removed from the queue.
+  // dispatched and removed from the queue.  Callbacks added while dispatching
+  // are dispatched by the same call.
   int DispatchCallbacks() {
     int dispatched = 0;
-    Mutex* queue_mutex = queue_.mutex();
-    queue_mutex->Acquire();
-    while (!queue_.empty()) {
-      // Make a copy of the SharedPtr in case FlushCallbacks() is called
-      // currently.
-      SharedPtr<CallbackEntry> callback_entry = queue_.front();
-      queue_.pop_front();
-      queue_mutex->Release();
-      callback_entry->Execute();
-      dispatched++;
-      queue_mutex->Acquire();
-      callback_entry.reset();
+    uint64_t run = 0;
+    uint64_t max_latency = 0;
+    std::vector<CallbackEntry*> batch;
+    while (true) {
+      {
+        MutexLock lock(mutex_);
+        if (!batch.empty()) {
+          FinishBatch(&batch, run, max_latency);
+          run = 0;
+          max_latency = 0;
+        }
+        if (queue_.empty()) {
+          // Keep the larger storage for the queue.
+          if (batch.capacity() > queue_.capacity()) batch.swap(queue_);
+          break;
+        }
+        // Take the whole queue, leaving the previous batch's storage behind.
+        batch.swap(queue_);
+        in_flight_batches_.push_back(&batch);
+        if (batch.size() > stats_.max_batch_size) {
+          stats_.max_batch_size = batch.size();
+        }
+      }
+      for (CallbackEntry* entry : batch) {
+        uint64_t latency =
+            internal::GetTimestamp() - entry->queued_timestamp();
+        if (entry->Execute()) {
+          run++;
+          if (latency > max_latency) max_latency = latency;
+        }
+        dispatched++;
+      }
     }
-    queue_mutex->Release();
     return dispatched;
   }
 
-  // Flush pending callbacks from the queue without executing them.
+  // Flush pending callbacks from the queue without executing them.  Callbacks
+  // in batches being dispatched by another thread are removed too, but are
+  // counted as dispatched rather than flushed.
   int FlushCallbacks() {
-    int flushed = 0;
-    MutexLock lock(*queue_.mutex());
-    while (!queue_.empty()) {
-      queue_.front().reset();
-      queue_.pop_front();
-      flushed++;
+    MutexLock lock(mutex_);
+    int flushed = static_cast<int>(queue_.size());
+    for (CallbackEntry* entry : queue_) FreeEntry(entry);
+    queue_.clear();
+    for (std::vector<CallbackEntry*>* batch : in_flight_batches_) {
+      for (CallbackEntry* entry : *batch) entry->DisableCallback();
     }
     return flushed;
   }
 
+  // Get a snapshot of the dispatch statistics.
+  DispatchStats GetStats() {
+    MutexLock lock(mutex_);
+    DispatchStats stats = stats_;
+    stats.pending_count = queue_.size();
+    return stats;
+  }
+
  private:
-  CallbackQueue queue_;
+  // Recycle the entries of a dispatched batch and update statistics.
+  // mutex_ must be held.
+  void FinishBatch(std::vector<CallbackEntry*>* batch, uint64_t run,
+                   uint64_t max_latency) {
+    for (CallbackEntry* entry : *batch) FreeEntry(entry);
+    batch->clear();
+    in_flight_batches_.erase(std::find(in_flight_batches_.begin(),
+                                       in_flight_batches_.end(), batch));
+    stats_.run_count += run;
+    if (max_latency > stats_.max_latency_ms) {
+      stats_.max_latency_ms = max_latency;
+    }
+  }
+
+  // Delete the entry's callback and keep the entry for reuse.  mutex_ must be
+  // held.
+  void FreeEntry(CallbackEntry* entry) {
+    entry->DisableCallback();
+    if (free_entries_.size() < kMaxFreeEntries) {
+      free_entries_.push_back(entry);
+    } else {
+      delete entry;
+    }
+  }
+
+  // Mutex that controls access to queue_, in_flight_batches_, free_entries_
+  // and stats_.
+  Mutex mutex_;
+  // Entries waiting to be dispatched, in order.
+  std::vector<CallbackEntry*> queue_;
+  // Batches taken off the queue by DispatchCallbacks() that are still running.
+  std::vector<std::vector<CallbackEntry*>*> in_flight_batches_;
+  // Entries that are no longer queued, kept for reuse.
+  std::vector<CallbackEntry*> free_entries_;
+  DispatchStats stats_;
   // Mutex that is held for the duration of each callback.  This prevents the
   // destruction of a callback until execution is complete.
   Mutex execution_mutex_;
@@ -333,6 +414,12 @@ void PollCallbacks() {
   }
 }
 
+DispatchStats GetDispatchStats() {
+  MutexLock lock(*g_callback_mutex);
+  return g_callback_dispatcher ? g_callback_dispatcher->GetStats()
+                               : DispatchStats();
+}
+
 }  // namespace callback
 // NOLINTNEXTLINE - allow namespace overridden
 }  // namespace firebase
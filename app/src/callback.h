@@ -30,6 +30,8 @@
 /// of callbacks so that they can be handled in the desired context, as opposed
 /// to the threads created to handle them internally.
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace firebase {
@@ -391,6 +393,33 @@ void RemoveCallback(void* callback_reference);
 /// NOTE: This must be always be called on the same thread.
 void PollCallbacks();
 
+/// Statistics of the callback queue, used to find out whether callbacks wait
+/// too long for PollCallbacks().  Counts start when the callback system is
+/// initialized.
+struct DispatchStats {
+  DispatchStats()
+      : queued_count(0),
+        run_count(0),
+        pending_count(0),
+        max_batch_size(0),
+        max_latency_ms(0) {}
+
+  /// Number of callbacks added to the queue.
+  uint64_t queued_count;
+  /// Number of callbacks run by PollCallbacks(), excluding removed ones.
+  uint64_t run_count;
+  /// Number of callbacks currently waiting in the queue.
+  size_t pending_count;
+  /// Largest number of callbacks taken off the queue at once.
+  size_t max_batch_size;
+  /// Longest time between adding a callback and starting to run it.
+  uint64_t max_latency_ms;
+};
+
+/// Get a snapshot of the callback queue statistics, all zero if the callback
+/// system is not initialized.
+DispatchStats GetDispatchStats();
+
 }  // namespace callback
 // NOLINTNEXTLINE - allow namespace overridden
 }  // namespace firebase
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <new>
 #include <string>
 
 #include "app/src/assert.h"
@@ -44,7 +45,12 @@ static_assert(sizeof(FutureBase) == sizeof(Future<int>),
               "Future should not introduce virtual functions or data members.");
 
 typedef void DataDeleteFn(void* data_to_delete);
-typedef std::pair<FutureHandleId, FutureBackingData*> BackingPair;
+
+// Initial number of buckets in the backing table. Must be a power of two.
+static const size_t kMinBackingTableCapacity = 16;
+
+// Number of backings allocated at once when no storage can be reused.
+static const size_t kBackingsPerSlab = 32;
 
 // NOLINTNEXTLINE
 const FutureHandle ReferenceCountedFutureImpl::kInvalidHandle(
@@ -338,34 +344,137 @@ ReferenceCountedFutureImpl::~ReferenceCountedFutureImpl() {
   cleanup_.CleanupAll();
   cleanup_handles_.CleanupAll();
 
-  // TODO(jsanmiya): Change this to use unique_ptr so deletion is automatic.
-  while (!backings_.empty()) {
-    auto it = backings_.begin();
+  FutureHandleId id;
+  while (FutureBackingData* backing = backings_.RemoveAny(&id)) {
     LogWarning(
         "Future with handle %d still exists though its backing API"
         " 0x%X is being deleted. Please call Future::Release() before"
         " deleting the backing API.",
-        it->first, static_cast<int>(reinterpret_cast<uintptr_t>(this)));
+        id, static_cast<int>(reinterpret_cast<uintptr_t>(this)));
+    DeleteBacking(backing);
+  }
+
+  for (void* slab : backing_slabs_) {
+    ::operator delete(slab);
+  }
+}
+
+ReferenceCountedFutureImpl::BackingTable::BackingTable() : size_(0) {}
+
+size_t ReferenceCountedFutureImpl::BackingTable::Probe(
+    FutureHandleId id) const {
+  const size_t mask = entries_.size() - 1;
+  size_t index = static_cast<size_t>(id) & mask;
+  while (entries_[index].backing != nullptr && entries_[index].id != id) {
+    index = (index + 1) & mask;
+  }
+  return index;
+}
+
+FutureBackingData* ReferenceCountedFutureImpl::BackingTable::Find(
+    FutureHandleId id) const {
+  if (size_ == 0) return nullptr;
+  return entries_[Probe(id)].backing;
+}
+
+void ReferenceCountedFutureImpl::BackingTable::Insert(
+    FutureHandleId id, FutureBackingData* backing) {
+  FIREBASE_ASSERT(backing != nullptr);
+  // Keep the load factor at or below 1/2 so probe sequences stay short.
+  if ((size_ + 1) * 2 > entries_.size()) {
+    Rehash(entries_.empty() ? kMinBackingTableCapacity : entries_.size() * 2);
+  }
+  Entry& entry = entries_[Probe(id)];
+  FIREBASE_ASSERT(entry.backing == nullptr);
+  entry.id = id;
+  entry.backing = backing;
+  size_++;
+}
+
+FutureBackingData* ReferenceCountedFutureImpl::BackingTable::Remove(
+    FutureHandleId id) {
+  if (size_ == 0) return nullptr;
+  size_t index = Probe(id);
+  FutureBackingData* backing = entries_[index].backing;
+  if (backing != nullptr) EraseAt(index);
+  return backing;
+}
+
+FutureBackingData* ReferenceCountedFutureImpl::BackingTable::RemoveAny(
+    FutureHandleId* id) {
+  if (size_ == 0) return nullptr;
+  for (size_t index = 0; index < entries_.size(); ++index) {
+    FutureBackingData* backing = entries_[index].backing;
+    if (backing != nullptr) {
+      *id = entries_[index].id;
+      EraseAt(index);
+      return backing;
+    }
+  }
+  return nullptr;
+}
+
+void ReferenceCountedFutureImpl::BackingTable::Rehash(size_t capacity) {
+  std::vector<Entry> old_entries;
+  old_entries.swap(entries_);
+  entries_.assign(capacity, Entry{kInvalidFutureHandle, nullptr});
+  for (const Entry& entry : old_entries) {
+    if (entry.backing != nullptr) entries_[Probe(entry.id)] = entry;
+  }
+}
+
+void ReferenceCountedFutureImpl::BackingTable::EraseAt(size_t index) {
+  const size_t mask = entries_.size() - 1;
+  size_t hole = index;
+  size_t next = (hole + 1) & mask;
+  while (entries_[next].backing != nullptr) {
+    // Move the entry into the hole if the hole lies on its probe sequence,
+    // i.e. between its home bucket and its current bucket.
+    size_t home = static_cast<size_t>(entries_[next].id) & mask;
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      entries_[hole] = entries_[next];
+      hole = next;
+    }
+    next = (next + 1) & mask;
+  }
+  entries_[hole].backing = nullptr;
+  entries_[hole].id = kInvalidFutureHandle;
+  size_--;
+}
 
-    FutureBackingData* backing = it->second;
-    backings_.erase(it);
-    delete backing;
+FutureBackingData* ReferenceCountedFutureImpl::NewBacking(
+    void* data, void (*delete_data_fn)(void* data_to_delete)) {
+  if (free_backings_.empty()) {
+    char* slab = static_cast<char*>(
+        ::operator new(sizeof(FutureBackingData) * kBackingsPerSlab));
+    backing_slabs_.push_back(slab);
+    for (size_t i = kBackingsPerSlab; i > 0; --i) {
+      free_backings_.push_back(slab + (i - 1) * sizeof(FutureBackingData));
+    }
   }
+  void* storage = free_backings_.back();
+  free_backings_.pop_back();
+  return new (storage) FutureBackingData(data, delete_data_fn);
+}
+
+void ReferenceCountedFutureImpl::DeleteBacking(FutureBackingData* backing) {
+  backing->~FutureBackingData();
+  free_backings_.push_back(backing);
 }
 
 FutureHandle ReferenceCountedFutureImpl::AllocInternal(
     int fn_idx, void* data, void (*delete_data_fn)(void* data_to_delete)) {
+  MutexLock lock(mutex_);
   // Backings get deleted in ReleaseFuture() and ~ReferenceCountedFutureImpl().
-  FutureBackingData* backing = new FutureBackingData(data, delete_data_fn);
+  FutureBackingData* backing = NewBacking(data, delete_data_fn);
 
-  // Allocate a unique handle and insert the new backing into the map.
+  // Allocate a unique handle and insert the new backing into the table.
   // Note that it's theoretically possible to have a handle collision if we
   // allocate four billion more handles before releasing one. We ignore this
   // possibility.
-  MutexLock lock(mutex_);
   const FutureHandleId id = AllocHandleId();
   FIREBASE_FUTURE_TRACE("API: Allocated handle id %d", id);
-  backings_.insert(BackingPair(id, backing));
+  backings_.Insert(id, backing);
   const FutureHandle handle(id, this);
 
   // Update the most recent Future for this function.
@@ -493,13 +602,12 @@ void ReferenceCountedFutureImpl::ReleaseFuture(const FutureHandle& handle) {
   // it, too. However it might be possible during the deallocate phase when
   // FutureBase and FutureHandle and FutureProxyManager are still having
   // dependencies.
-  auto it = backings_.find(handle.id());
-  if (it == backings_.end()) {
+  FutureBackingData* backing = backings_.Find(handle.id());
+  if (backing == nullptr) {
     return;
   }
 
   // Decrement the reference count.
-  FutureBackingData* backing = it->second;
   FIREBASE_ASSERT(backing->reference_count > 0);
   backing->reference_count--;
 
@@ -508,8 +616,8 @@ void ReferenceCountedFutureImpl::ReleaseFuture(const FutureHandle& handle) {
 
   // If asynchronous call is no longer referenced, delete the backing struct.
   if (backing->reference_count == 0) {
-    backings_.erase(it);
-    delete backing;
+    backings_.Remove(handle.id());
+    DeleteBacking(backing);
     backing = nullptr;
   }
 }
@@ -548,8 +656,7 @@ const void* ReferenceCountedFutureImpl::GetFutureResult(
 FutureBackingData* ReferenceCountedFutureImpl::BackingFromHandle(
     FutureHandleId id) {
   MutexLock lock(mutex_);
-  auto it = backings_.find(id);
-  return it == backings_.end() ? nullptr : it->second;
+  return backings_.Find(id);
 }
 
 detail::CompletionCallbackHandle
@@ -704,10 +811,12 @@ ReferenceCountedFutureImpl::AddCompletionCallbackLambda(
 bool ReferenceCountedFutureImpl::IsSafeToDelete() const {
   MutexLock lock(mutex_);
   // Check if any Futures we have are still pending.
-  for (auto i = backings_.begin(); i != backings_.end(); ++i) {
-    // If any Future is still pending, not safe to delete.
-    if (i->second->status == kFutureStatusPending) return false;
-  }
+  bool pending = false;
+  backings_.ForEach([&pending](const FutureBackingData* backing) {
+    if (backing->status == kFutureStatusPending) pending = true;
+  });
+  // If any Future is still pending, not safe to delete.
+  if (pending) return false;
 
   if (is_running_callback_) {
     return false;
@@ -726,10 +835,10 @@ bool ReferenceCountedFutureImpl::IsReferencedExternally() const {
 
   int total_references = 0;
   int internal_references = 0;
-  for (auto i = backings_.begin(); i != backings_.end(); ++i) {
-    // Count the total number of references to all valid Futures.
-    total_references += i->second->reference_count;
-  }
+  // Count the total number of references to all valid Futures.
+  backings_.ForEach([&total_references](const FutureBackingData* backing) {
+    total_references += backing->reference_count;
+  });
   for (int i = 0; i < last_results_.size(); i++) {
     if (last_results_[i].status() != kFutureStatusInvalid) {
       // If the status is not invalid, this entry is using up a reference.
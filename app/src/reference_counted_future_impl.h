@@ -17,8 +17,8 @@
 #ifndef FIREBASE_APP_SRC_REFERENCE_COUNTED_FUTURE_IMPL_H_
 #define FIREBASE_APP_SRC_REFERENCE_COUNTED_FUTURE_IMPL_H_
 
+#include <cstddef>
 #include <functional>
-#include <map>
 #include <vector>
 
 #include "app/src/assert.h"
@@ -448,6 +448,72 @@ class ReferenceCountedFutureImpl : public detail::FutureApiInterface {
   }
   FutureBackingData* BackingFromHandle(FutureHandleId id);
 
+  /// Hash table of backing data indexed by FutureHandleId.
+  ///
+  /// Handles are allocated sequentially, so they are stored in an open
+  /// addressing table indexed directly by the low bits of the handle. Live
+  /// handles are usually recent and therefore land in distinct buckets, so a
+  /// lookup is typically a single probe and insertion never allocates unless
+  /// the table grows.
+  class BackingTable {
+   public:
+    BackingTable();
+
+    /// Return the backing for `id`, or nullptr if there is none.
+    FutureBackingData* Find(FutureHandleId id) const;
+
+    /// Add a backing for an `id` not already in the table.
+    void Insert(FutureHandleId id, FutureBackingData* backing);
+
+    /// Remove the backing for `id` from the table and return it, or return
+    /// nullptr if there is none.
+    FutureBackingData* Remove(FutureHandleId id);
+
+    /// Remove an arbitrary backing from the table, storing its handle in
+    /// `id`. Returns nullptr if the table is empty.
+    FutureBackingData* RemoveAny(FutureHandleId* id);
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    /// Call `fn` with every backing in the table.
+    template <typename F>
+    void ForEach(const F& fn) const {
+      for (const Entry& entry : entries_) {
+        if (entry.backing != nullptr) fn(entry.backing);
+      }
+    }
+
+   private:
+    struct Entry {
+      FutureHandleId id;
+      FutureBackingData* backing;
+    };
+
+    /// Index of the bucket where `id` is stored, or where it would be
+    /// inserted.
+    size_t Probe(FutureHandleId id) const;
+
+    /// Resize the table to `capacity` buckets, which must be a power of two.
+    void Rehash(size_t capacity);
+
+    /// Remove the entry at `index`, shifting back entries that were displaced
+    /// by it so that no tombstones are needed.
+    void EraseAt(size_t index);
+
+    std::vector<Entry> entries_;
+    size_t size_;
+  };
+
+  /// Construct a backing in storage recycled from a previously deleted backing
+  /// if available. Must be called with mutex_ held.
+  FutureBackingData* NewBacking(void* data,
+                                void (*delete_data_fn)(void* data_to_delete));
+
+  /// Destroy a backing and keep its storage for reuse. Must be called with
+  /// mutex_ held.
+  void DeleteBacking(FutureBackingData* backing);
+
   /// Allocate backing data for a Future and assign it a unique handle,
   /// which is returned. The most recent Future for `fn_idx` is updated to
   /// be this newly created Future.
@@ -562,8 +628,15 @@ class ReferenceCountedFutureImpl : public detail::FutureApiInterface {
   /// Indexed by the FutureHandle, which is a unique integer used by the
   /// Future to access the backing data. The backing data is deleted once no
   /// more Futures reference it.
-  // TODO(jsanmiya): Use unordered_map when available (i.e. when not stlport).
-  std::map<FutureHandleId, FutureBackingData*> backings_;
+  BackingTable backings_;
+
+  /// Storage of deleted backings, reused by NewBacking(). Storage is allocated
+  /// in slabs of several backings so that allocating a Future rarely reaches
+  /// the heap.
+  std::vector<void*> free_backings_;
+
+  /// Slabs allocated for backings, freed on destruction.
+  std::vector<void*> backing_slabs_;
 
   /// A unique int that is incremented by one after every call to @ref Alloc.
   FutureHandleId next_future_handle_;
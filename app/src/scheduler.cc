@@ -16,13 +16,303 @@
 
 #include "app/src/scheduler.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 #include "app/src/time.h"
 
 namespace firebase {
 namespace scheduler {
 
+namespace {
+
+// The timer wheel has 4 levels of 256 slots.  A slot in level 0 covers one
+// millisecond and each level covers 256 times the range of the level below, so
+// the wheel covers 2^32 ms (~49 days).  Requests further away are kept in an
+// overflow list.
+const int kWheelLevels = 4;
+const int kWheelSlotBits = 8;
+const size_t kWheelSlots = static_cast<size_t>(1) << kWheelSlotBits;
+const uint64_t kWheelSlotMask = kWheelSlots - 1;
+const size_t kWheelWordBits = 64;
+const size_t kWheelWordsPerLevel = kWheelSlots / kWheelWordBits;
+
+// Maximum number of requests kept for reuse.
+const size_t kMaxFreeRequests = 1024;
+
+int CountTrailingZeros(uint64_t value) {
+  assert(value);
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(value);
+#else
+  int count = 0;
+  while (!(value & 1)) {
+    value >>= 1;
+    ++count;
+  }
+  return count;
+#endif
+}
+
+}  // namespace
+
+// Intrusive doubly linked list of requests.
+struct Scheduler::TimerList {
+  TimerList() : head(nullptr), tail(nullptr) {}
+
+  RequestData* head;
+  RequestData* tail;
+};
+
+// Hierarchical timer wheel.  Requests are kept in intrusive lists so adding or
+// removing one is O(1).  Requests in a higher level are moved to a lower level
+// when the current time reaches the range of their slot.  Due requests are
+// moved to a ready list ordered by due timestamp and request id, matching the
+// order of the priority queue.
+class Scheduler::TimerWheel {
+ public:
+  explicit TimerWheel(uint64_t current)
+      : current_tick_(current), size_(0) {
+    memset(occupied_, 0, sizeof(occupied_));
+  }
+
+  // Number of requests in the wheel.
+  size_t size() const { return size_; }
+
+  // Add a request using its due timestamp.
+  void Insert(RequestData* request) {
+    Place(request);
+    ++size_;
+  }
+
+  // Remove a request that is in the wheel.
+  void Remove(RequestData* request) {
+    assert(request->list);
+    Unlink(request);
+    --size_;
+  }
+
+  // Remove all requests and append them to requests.
+  void RemoveAll(std::vector<RequestData*>* requests) {
+    for (size_t i = 0; i < kWheelLevels * kWheelSlots; ++i) {
+      PopAll(&slots_[i], requests);
+    }
+    PopAll(&overflow_, requests);
+    PopAll(&ready_, requests);
+    size_ = 0;
+  }
+
+  // Remove and return the next request due at or before current, or nullptr
+  // if there is none.
+  RequestData* PopDue(uint64_t current) {
+    if (!ready_.head) Advance(current);
+    RequestData* request = ready_.head;
+    if (request) Remove(request);
+    return request;
+  }
+
+  // Get the earliest time a request may be due.  This can be earlier than the
+  // actual due time of requests that are still in a higher level, in which case
+  // the caller will find nothing due and should call this again.  Returns
+  // false if the wheel is empty.
+  bool NextDueTimestamp(uint64_t* timestamp) const {
+    if (ready_.head) {
+      *timestamp = ready_.head->due_timestamp;
+      return true;
+    }
+    for (int level = 0; level < kWheelLevels; ++level) {
+      int shift = kWheelSlotBits * level;
+      size_t index = (current_tick_ >> shift) & kWheelSlotMask;
+      // Slots of the current index of higher levels have already been moved
+      // down.
+      size_t slot = NextOccupiedSlot(level, level == 0 ? index : index + 1);
+      if (slot < kWheelSlots) {
+        int level_shift = shift + kWheelSlotBits;
+        *timestamp = ((current_tick_ >> level_shift) << level_shift) +
+                     (static_cast<uint64_t>(slot) << shift);
+        return true;
+      }
+    }
+    if (overflow_.head) {
+      int shift = kWheelSlotBits * kWheelLevels;
+      *timestamp = ((current_tick_ >> shift) + 1) << shift;
+      return true;
+    }
+    return false;
+  }
+
+ private:
+  // Add a request to the list matching its due timestamp.
+  void Place(RequestData* request) {
+    uint64_t due = request->due_timestamp;
+    if (due < current_tick_) {
+      InsertReady(request);
+      return;
+    }
+    // The level is the highest slot index that differs from the current tick,
+    // so each slot is always ahead of the current index in its level.
+    uint64_t diff = due ^ current_tick_;
+    for (int level = 0; level < kWheelLevels; ++level) {
+      int shift = kWheelSlotBits * level;
+      if ((diff >> (shift + kWheelSlotBits)) == 0) {
+        size_t slot = (due >> shift) & kWheelSlotMask;
+        PushBack(&slots_[level * kWheelSlots + slot], request);
+        return;
+      }
+    }
+    PushBack(&overflow_, request);
+  }
+
+  // Insert a request that is already due into the ready list, keeping it
+  // ordered by due timestamp and request id.  Requests are usually scheduled
+  // in that order, so search from the tail.
+  void InsertReady(RequestData* request) {
+    RequestData* prev = ready_.tail;
+    while (prev && RequestDataPtrComparer()(prev, request)) {
+      prev = prev->prev;
+    }
+    RequestData* next = prev ? prev->next : ready_.head;
+    request->prev = prev;
+    request->next = next;
+    request->list = &ready_;
+    (prev ? prev->next : ready_.head) = request;
+    (next ? next->prev : ready_.tail) = request;
+  }
+
+  // Move the current tick forward to current, stopping at the first slot with
+  // due requests, which are moved to the ready list.
+  void Advance(uint64_t current) {
+    if (size_ == 0) {
+      if (current_tick_ <= current) current_tick_ = current + 1;
+      return;
+    }
+    while (!ready_.head && current_tick_ <= current) {
+      size_t index = current_tick_ & kWheelSlotMask;
+      uint64_t block_start = current_tick_ - index;
+      size_t slot = NextOccupiedSlot(0, index);
+      if (slot < kWheelSlots && block_start + slot <= current) {
+        current_tick_ = block_start + slot + 1;
+        MoveSlotToReady(slot);
+      } else if (block_start + kWheelSlots <= current) {
+        current_tick_ = block_start + kWheelSlots;
+      } else {
+        current_tick_ = current + 1;
+      }
+      if ((current_tick_ & kWheelSlotMask) == 0) Cascade();
+    }
+  }
+
+  // Move the requests of a level 0 slot, which are all due at the same time,
+  // to the ready list in request id order.  Requests moved down from higher
+  // levels may have been added after requests scheduled later.
+  void MoveSlotToReady(size_t slot) {
+    scratch_.clear();
+    PopAll(&slots_[slot], &scratch_);
+    if (scratch_.size() > 1) {
+      std::sort(scratch_.begin(), scratch_.end(),
+                [](const RequestData* lhs, const RequestData* rhs) {
+                  return lhs->id < rhs->id;
+                });
+    }
+    for (RequestData* request : scratch_) PushBack(&ready_, request);
+  }
+
+  // Called when the current tick enters a new level 0 range.  Move the
+  // requests of every level whose range starts at the current tick down to
+  // lower levels, highest level first.
+  void Cascade() {
+    int level = 1;
+    while (level < kWheelLevels &&
+           ((current_tick_ >> (kWheelSlotBits * level)) & kWheelSlotMask) ==
+               0) {
+      ++level;
+    }
+    if (level == kWheelLevels) {
+      Replace(&overflow_);
+      --level;
+    }
+    for (; level > 0; --level) {
+      size_t slot =
+          (current_tick_ >> (kWheelSlotBits * level)) & kWheelSlotMask;
+      Replace(&slots_[level * kWheelSlots + slot]);
+    }
+  }
+
+  // Place all requests in a list again using the current tick.
+  void Replace(TimerList* list) {
+    scratch_.clear();
+    PopAll(list, &scratch_);
+    for (RequestData* request : scratch_) Place(request);
+  }
+
+  void PushBack(TimerList* list, RequestData* request) {
+    request->prev = list->tail;
+    request->next = nullptr;
+    request->list = list;
+    (list->tail ? list->tail->next : list->head) = request;
+    list->tail = request;
+    int index = SlotIndex(list);
+    if (index >= 0) {
+      occupied_[index / kWheelWordBits] |= static_cast<uint64_t>(1)
+                                           << (index % kWheelWordBits);
+    }
+  }
+
+  void Unlink(RequestData* request) {
+    TimerList* list = request->list;
+    (request->prev ? request->prev->next : list->head) = request->next;
+    (request->next ? request->next->prev : list->tail) = request->prev;
+    request->prev = nullptr;
+    request->next = nullptr;
+    request->list = nullptr;
+    int index = SlotIndex(list);
+    if (index >= 0 && !list->head) {
+      occupied_[index / kWheelWordBits] &=
+          ~(static_cast<uint64_t>(1) << (index % kWheelWordBits));
+    }
+  }
+
+  void PopAll(TimerList* list, std::vector<RequestData*>* requests) {
+    while (list->head) {
+      RequestData* request = list->head;
+      Unlink(request);
+      requests->push_back(request);
+    }
+  }
+
+  // Index of the list in slots_, or -1 if it is not a slot.
+  int SlotIndex(const TimerList* list) const {
+    if (list == &overflow_ || list == &ready_) return -1;
+    return static_cast<int>(list - slots_);
+  }
+
+  // Find the first occupied slot of a level at or after the given slot.
+  // Returns kWheelSlots if there is none.
+  size_t NextOccupiedSlot(int level, size_t from) const {
+    for (size_t word = from / kWheelWordBits; word < kWheelWordsPerLevel;
+         ++word) {
+      uint64_t bits = occupied_[level * kWheelWordsPerLevel + word];
+      if (word == from / kWheelWordBits) {
+        bits &= ~static_cast<uint64_t>(0) << (from % kWheelWordBits);
+      }
+      if (bits) return word * kWheelWordBits + CountTrailingZeros(bits);
+    }
+    return kWheelSlots;
+  }
+
+  TimerList slots_[kWheelLevels * kWheelSlots];
+  // One bit per slot, set when the slot is not empty.
+  uint64_t occupied_[kWheelLevels * kWheelWordsPerLevel];
+  TimerList overflow_;
+  // Due requests ordered by due timestamp and request id.
+  TimerList ready_;
+  // All ticks before this one have been processed.
+  uint64_t current_tick_;
+  size_t size_;
+  std::vector<RequestData*> scratch_;
+};
+
 bool RequestHandle::Cancel() {
   assert(status_);
 
@@ -36,6 +326,9 @@ bool RequestHandle::Cancel() {
   }
 
   status_->cancelled = true;
+  if (status_->scheduler) {
+    status_->scheduler->RemoveCancelledRequest(status_.get());
+  }
   return true;
 }
 
@@ -51,23 +344,56 @@ bool RequestHandle::IsTriggered() const {
   return status_->triggered;
 }
 
-Scheduler::RequestData::RequestData(RequestId id, callback::Callback* cb,
-                                    ScheduleTimeMs delay, ScheduleTimeMs repeat)
-    : id(id),
-      cb(cb),
-      delay_ms(delay),
-      repeat_ms(repeat),
+Scheduler::RequestData::RequestData()
+    : id(0),
+      cb(nullptr),
+      delay_ms(0),
+      repeat_ms(0),
       due_timestamp(0),
-      status(new RequestStatusBlock(repeat > 0)) {}
+      prev(nullptr),
+      next(nullptr),
+      list(nullptr) {}
+
+Scheduler::Scheduler() : Scheduler(kBackendPriorityQueue) {}
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(Backend backend)
     : thread_(nullptr),
       next_request_id_(0),
       terminating_(false),
+      timer_wheel_(backend == kBackendTimerWheel
+                       ? new TimerWheel(internal::GetTimestamp())
+                       : nullptr),
       request_mutex_(Mutex::kModeRecursive),
       sleep_sem_(0) {}
 
-Scheduler::~Scheduler() { CancelAllAndShutdownWorkerThread(); }
+Scheduler::~Scheduler() {
+  CancelAllAndShutdownWorkerThread();
+
+  std::vector<RequestData*> requests;
+  {
+    MutexLock lock(request_mutex_);
+    while (!request_queue_.empty()) {
+      requests.push_back(request_queue_.top());
+      request_queue_.pop();
+    }
+    if (timer_wheel_) timer_wheel_->RemoveAll(&requests);
+    for (RequestData* request : requests) request->status->request = nullptr;
+  }
+
+  // Handles can still be cancelled from other threads, which locks the status
+  // block before this scheduler, so detach them without holding
+  // request_mutex_.
+  for (RequestData* request : requests) {
+    {
+      MutexLock lock(request->status->mutex);
+      request->status->scheduler = nullptr;
+    }
+    delete request->cb;
+    delete request;
+  }
+  for (RequestData* request : free_requests_) delete request;
+  delete timer_wheel_;
+}
 
 void Scheduler::CancelAllAndShutdownWorkerThread() {
   {
@@ -87,6 +413,13 @@ void Scheduler::CancelAllAndShutdownWorkerThread() {
   }
 }
 
+SchedulerStats Scheduler::GetStats() {
+  MutexLock lock(request_mutex_);
+  SchedulerStats stats = stats_;
+  stats.queue_depth = QueueSize();
+  return stats;
+}
+
 RequestHandle Scheduler::Schedule(callback::Callback* callback,
                                   ScheduleTimeMs delay /* = 0 */,
                                   ScheduleTimeMs repeat /* = 0 */) {
@@ -98,12 +431,12 @@ RequestHandle Scheduler::Schedule(callback::Callback* callback,
     thread_ = new Thread(WorkerThreadRoutine, this);
   }
 
-  RequestDataPtr request(
-      new RequestData(++next_request_id_, callback, delay, repeat));
+  RequestData* request =
+      NewRequest(++next_request_id_, callback, delay, repeat);
 
   RequestHandle handler(request->status);
 
-  AddToQueue(Move(request), internal::GetTimestamp(), delay);
+  AddToQueue(request, internal::GetTimestamp(), delay);
 
   // Increase semaphore count by one for unfinished request
   sleep_sem_.Post();
@@ -119,6 +452,56 @@ RequestHandle Scheduler::Schedule(const std::function<void(void)>& callback,
 }
 #endif
 
+Scheduler::RequestData* Scheduler::NewRequest(RequestId id,
+                                              callback::Callback* cb,
+                                              ScheduleTimeMs delay,
+                                              ScheduleTimeMs repeat) {
+  RequestData* request;
+  if (free_requests_.empty()) {
+    request = new RequestData();
+  } else {
+    request = free_requests_.back();
+    free_requests_.pop_back();
+  }
+  request->id = id;
+  request->cb = cb;
+  request->delay_ms = delay;
+  request->repeat_ms = repeat;
+  request->due_timestamp = 0;
+  request->status = SharedPtr<RequestStatusBlock>(
+      new RequestStatusBlock(repeat > 0));
+  // Only the timer wheel can remove a request as soon as it is cancelled.
+  if (timer_wheel_) request->status->scheduler = this;
+  return request;
+}
+
+void Scheduler::FreeRequest(RequestData* request) {
+  delete request->cb;
+  request->cb = nullptr;
+  request->status.reset();
+  if (free_requests_.size() < kMaxFreeRequests) {
+    free_requests_.push_back(request);
+  } else {
+    delete request;
+  }
+}
+
+size_t Scheduler::QueueSize() const {
+  return timer_wheel_ ? timer_wheel_->size() : request_queue_.size();
+}
+
+void Scheduler::RemoveCancelledRequest(RequestStatusBlock* status) {
+  MutexLock lock(request_mutex_);
+  RequestData* request = static_cast<RequestData*>(status->request);
+  // The request is not queued if the worker thread is about to trigger it.
+  if (!request) return;
+  assert(timer_wheel_);
+  status->request = nullptr;
+  status->scheduler = nullptr;
+  timer_wheel_->Remove(request);
+  FreeRequest(request);
+}
+
 void Scheduler::WorkerThreadRoutine(void* data) {
   Scheduler* scheduler = static_cast<Scheduler*>(data);
   assert(scheduler);
@@ -127,20 +510,12 @@ void Scheduler::WorkerThreadRoutine(void* data) {
     uint64_t current = internal::GetTimestamp();
 
     uint64_t sleep_time = 0;
-    RequestDataPtr request;
+    RequestData* request;
 
     // Check if the top request in the queue is due.
     {
       MutexLock lock(scheduler->request_mutex_);
-      if (!scheduler->request_queue_.empty()) {
-        auto due = scheduler->request_queue_.top()->due_timestamp;
-        if (due <= current) {
-          request = Move(scheduler->request_queue_.top());
-          scheduler->request_queue_.pop();
-        } else {
-          sleep_time = due - current;
-        }
-      }
+      request = scheduler->PopDueRequest(current, &sleep_time);
     }
 
     // If there is no request to process now, there can be 2 cases
@@ -166,24 +541,72 @@ void Scheduler::WorkerThreadRoutine(void* data) {
 
     // If the top request is due, trigger the callback.  If the repeat interval
     // is non-zero, move it back to queue.
-    if (request && scheduler->TriggerCallback(request)) {
+    if (request) {
+      uint64_t start = internal::GetTimestamp();
+      bool repeat_request = scheduler->TriggerCallback(request);
+      uint64_t run_time = internal::GetTimestamp() - start;
+
       MutexLock lock(scheduler->request_mutex_);
-      ScheduleTimeMs repeat = request->repeat_ms;
-      scheduler->AddToQueue(Move(request), current, repeat);
+      scheduler->stats_.total_run_time_ms += run_time;
+      if (repeat_request) {
+        scheduler->AddToQueue(request, current, request->repeat_ms);
+      } else {
+        scheduler->FreeRequest(request);
+      }
     }
   }
 }
 
-void Scheduler::AddToQueue(RequestDataPtr request, uint64_t current,
+Scheduler::RequestData* Scheduler::PopDueRequest(uint64_t current,
+                                                 uint64_t* sleep_time) {
+  RequestData* request = nullptr;
+  uint64_t due = 0;
+  if (timer_wheel_) {
+    request = timer_wheel_->PopDue(current);
+    if (request) {
+      due = request->due_timestamp;
+      request->status->request = nullptr;
+    } else if (timer_wheel_->NextDueTimestamp(&due)) {
+      *sleep_time = due > current ? due - current : 1;
+    }
+  } else if (!request_queue_.empty()) {
+    due = request_queue_.top()->due_timestamp;
+    if (due <= current) {
+      request = request_queue_.top();
+      request_queue_.pop();
+    } else {
+      *sleep_time = due - current;
+    }
+  }
+
+  if (request) {
+    stats_.triggered_count++;
+    uint64_t latency = current > due ? current - due : 0;
+    stats_.total_latency_ms += latency;
+    if (latency > stats_.max_latency_ms) stats_.max_latency_ms = latency;
+  }
+  return request;
+}
+
+void Scheduler::AddToQueue(RequestData* request, uint64_t current,
                            ScheduleTimeMs after) {
   // Calculate the future timestamp
   request->due_timestamp = current + after;
 
-  // Push the request to the priority queue
-  request_queue_.push(Move(request));
+  // Push the request to the queue
+  if (timer_wheel_) {
+    timer_wheel_->Insert(request);
+    request->status->request = request;
+  } else {
+    request_queue_.push(request);
+  }
+  size_t queue_size = QueueSize();
+  if (queue_size > stats_.max_queue_depth) {
+    stats_.max_queue_depth = queue_size;
+  }
 }
 
-bool Scheduler::TriggerCallback(const RequestDataPtr& request) {
+bool Scheduler::TriggerCallback(RequestData* request) {
   MutexLock lock(request->status->mutex);
   if (request->cb && !request->status->cancelled) {
     request->cb->Run();
@@ -195,6 +618,8 @@ bool Scheduler::TriggerCallback(const RequestDataPtr& request) {
     }
   }
 
+  // The request is about to be freed so cancelling it must not look it up.
+  request->status->scheduler = nullptr;
   return false;
 }
 
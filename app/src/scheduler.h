@@ -18,6 +18,7 @@
 #define FIREBASE_APP_SRC_SCHEDULER_H_
 
 #include <queue>
+#include <vector>
 
 #include "app/memory/shared_ptr.h"
 #include "app/src/callback.h"
@@ -31,6 +32,8 @@ namespace scheduler {
 
 typedef uint64_t ScheduleTimeMs;
 
+class Scheduler;
+
 // RequestStatusBlock contains the status of a request.  References to this
 // block are shared by the queued request and the request handle.  The contents
 // of this structure are potentially modified from different thread, hence
@@ -40,9 +43,11 @@ struct RequestStatusBlock {
       : mutex(Mutex::kModeNonRecursive),
         cancelled(false),
         triggered(false),
-        repeat(repeat) {}
+        repeat(repeat),
+        scheduler(nullptr),
+        request(nullptr) {}
 
-  // Guard both "cancelled" and "triggered"
+  // Guard "cancelled", "triggered" and "scheduler"
   Mutex mutex;
 
   // Whether the callback is properly cancelled
@@ -53,6 +58,43 @@ struct RequestStatusBlock {
 
   // Whether this callback will repeat itself again after first trigger.
   const bool repeat;
+
+  // Scheduler that removes the request from its queue as soon as it is
+  // cancelled, or nullptr if the request is only dropped once it is due.
+  Scheduler* scheduler;
+
+  // The queued request owned by "scheduler".  Guarded by the scheduler's
+  // mutex rather than "mutex".
+  void* request;
+};
+
+// Statistics about the requests processed by a Scheduler, used to find out
+// whether its worker thread is a bottleneck.
+struct SchedulerStats {
+  SchedulerStats()
+      : queue_depth(0),
+        max_queue_depth(0),
+        triggered_count(0),
+        total_latency_ms(0),
+        max_latency_ms(0),
+        total_run_time_ms(0) {}
+
+  // Number of requests currently in the queue, including those not due yet.
+  size_t queue_depth;
+
+  // Highest number of requests ever in the queue.
+  size_t max_queue_depth;
+
+  // Number of due requests taken off the queue so far, including cancelled
+  // ones. Each repeat counts separately.
+  uint64_t triggered_count;
+
+  // Sum and maximum of the time callbacks waited to run after they were due.
+  uint64_t total_latency_ms;
+  uint64_t max_latency_ms;
+
+  // Total time spent running callbacks.
+  uint64_t total_run_time_ms;
 };
 
 // The handle used to check the status of a scheduled task or to cancel it.
@@ -88,7 +130,19 @@ class RequestHandle {
 // All the public functions are safe to be called from different thread
 class Scheduler {
  public:
+  // Data structure used to order the scheduled requests.
+  enum Backend {
+    // Binary heap.  Cancelled requests stay queued until they are due.
+    kBackendPriorityQueue,
+    // Hierarchical timer wheel with millisecond ticks.  Scheduling and
+    // cancelling are O(1) and cancelled requests are removed immediately,
+    // which suits many short timers that are usually cancelled, such as
+    // network timeouts.
+    kBackendTimerWheel,
+  };
+
   Scheduler();
+  explicit Scheduler(Backend backend);
 
   // When a scheduler is deleted, all the future callback will be discarded.
   // The scheduler does not guarentee to trigger any callback scheduled before
@@ -123,18 +177,26 @@ class Scheduler {
   // Cancel all scheduled callbacks and shut down the worker thread.
   void CancelAllAndShutdownWorkerThread();
 
+  // Get a snapshot of the statistics of this scheduler.
+  SchedulerStats GetStats();
+
  private:
+  friend class RequestHandle;
+
+  class TimerWheel;
+  struct TimerList;
+
   typedef uint64_t RequestId;
-  // The request data for all scheduled callback.
+  // The request data for all scheduled callback.  Requests are recycled
+  // through free_requests_ so they also serve as intrusive timer wheel nodes.
   struct RequestData {
-    explicit RequestData(RequestId id, callback::Callback* cb,
-                         ScheduleTimeMs delay, ScheduleTimeMs repeat);
+    RequestData();
 
     // Unique id per scheduler.
     RequestId id;
 
-    // The callback to be triggered.
-    SharedPtr<callback::Callback> cb;
+    // The callback to be triggered.  Owned by the request.
+    callback::Callback* cb;
 
     // Delay to trigger in milliseconds
     ScheduleTimeMs delay_ms;
@@ -147,13 +209,12 @@ class Scheduler {
 
     // Status block shared with handlers
     SharedPtr<RequestStatusBlock> status;
-  };
 
-  // SharedPtr of request data.  Ideally this should be UniquePtr and there
-  // should only have one copy of it in request_queue_ .  However, STLPort queue
-  // uses copy instead of move() while reordering heap element, and UniquePtr is
-  // not copyable.  Therefore, use SharedPtr here.
-  typedef SharedPtr<RequestData> RequestDataPtr;
+    // Links of the timer wheel list this request is in, if any.
+    RequestData* prev;
+    RequestData* next;
+    TimerList* list;
+  };
 
   // Comparer struct for priority_queue.  If the operator return true, lhs will
   // output later than rhs, due to the implementation of std::priority_queue.
@@ -162,8 +223,7 @@ class Scheduler {
   // If multiple requests have the same due timestamp, it would be sorted based
   // on request id, i.e. creation time.
   struct RequestDataPtrComparer {
-    bool operator()(const RequestDataPtr& lhs,
-                    const RequestDataPtr& rhs) const {
+    bool operator()(const RequestData* lhs, const RequestData* rhs) const {
       return lhs->due_timestamp > rhs->due_timestamp ||
              (lhs->due_timestamp == rhs->due_timestamp && lhs->id > rhs->id);
     }
@@ -180,12 +240,22 @@ class Scheduler {
   bool terminating_;
 
   // Priority queue for all scheduled callback, ordered by due timestamp and
-  // request id
-  std::priority_queue<RequestDataPtr, std::vector<RequestDataPtr>,
+  // request id.  Only used by kBackendPriorityQueue.
+  std::priority_queue<RequestData*, std::vector<RequestData*>,
                       RequestDataPtrComparer>
       request_queue_;
 
-  // Mutex to guard next_request_id_, terminating_ and request_queue_
+  // Timer wheel for all scheduled callback.  Only used by kBackendTimerWheel.
+  TimerWheel* timer_wheel_;
+
+  // Requests that are no longer queued, kept for reuse.
+  std::vector<RequestData*> free_requests_;
+
+  // Statistics reported by GetStats().
+  SchedulerStats stats_;
+
+  // Mutex to guard next_request_id_, terminating_, request_queue_,
+  // timer_wheel_, free_requests_ and stats_
   Mutex request_mutex_;
 
   // A semaphore with its count equivalent to the number of unfinished
@@ -194,18 +264,37 @@ class Scheduler {
   // or when the scheduler is terminating.
   Semaphore sleep_sem_;
 
+  // Get a request from free_requests_ or allocate a new one.
+  RequestData* NewRequest(RequestId id, callback::Callback* cb,
+                          ScheduleTimeMs delay, ScheduleTimeMs repeat);
+
+  // Delete the callback of a request that is no longer queued and keep the
+  // request for reuse.
+  void FreeRequest(RequestData* request);
+
+  // Number of queued requests.
+  size_t QueueSize() const;
+
+  // Remove a cancelled request from the timer wheel.  Called by
+  // RequestHandle::Cancel() with the status mutex held.
+  void RemoveCancelledRequest(RequestStatusBlock* status);
+
   // Everything below runs on worker thread
   // The main worker thread routine
   static void WorkerThreadRoutine(void* data);
 
+  // Pop the next request due at or before current.  If there is none, returns
+  // nullptr and sets sleep_time to how long the worker can sleep, or 0 to
+  // sleep until the next request is scheduled.
+  RequestData* PopDueRequest(uint64_t current, uint64_t* sleep_time);
+
   // Move the request to the priority queue that will be triggered in given
   // milliseconds since now
-  void AddToQueue(RequestDataPtr request, uint64_t current,
-                  ScheduleTimeMs after);
+  void AddToQueue(RequestData* request, uint64_t current, ScheduleTimeMs after);
 
   // Trigger the callback.  Return true if this callback repeats and is not
   // cancelled yet.
-  bool TriggerCallback(const RequestDataPtr& request);
+  bool TriggerCallback(RequestData* request);
 };
 
 }  // namespace scheduler
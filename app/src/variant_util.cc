@@ -16,7 +16,12 @@
 
 #include "app/src/variant_util.h"
 
-#include <sstream>
+#include <cctype>
+#include <clocale>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
 
 #include "app/src/assert.h"
 #include "app/src/log.h"
@@ -30,59 +35,129 @@
 namespace firebase {
 namespace util {
 
-// Forward declarations for stringstream variations of the *ToJson functions
-// since these aren't made available in the header. These return true on success
-// and false on failure. Failure is a result of using binary blobs in the
-// variant, or using types that cannot be coerced to a string as a key in a map.
-static bool VariantToJson(const Variant& variant, bool prettyPrint,
-                          const std::string& indent, std::stringstream* ss);
+// Forward declarations for the appending variations of the *ToJson functions
+// since these aren't made available in the header. These return true on
+// success and false on failure. Failure is a result of using binary blobs in
+// the variant, or using types that cannot be coerced to a string as a key in a
+// map.
+static bool VariantToJson(const Variant& variant, bool prettyPrint, int depth,
+                          std::string* output);
 static bool StdMapToJson(const std::map<Variant, Variant>& map,
-                         bool prettyPrint, const std::string& indent,
-                         std::stringstream* ss);
+                         bool prettyPrint, int depth, std::string* output);
 static bool StdVectorToJson(const std::vector<Variant>& vector,
-                            bool prettyPrint, const std::string& indent,
-                            std::stringstream* ss);
+                            bool prettyPrint, int depth, std::string* output);
 
-static bool VariantToJson(const Variant& variant, bool prettyPrint,
-                          const std::string& indent, std::stringstream* ss) {
+// Append a newline followed by the indentation for the given depth.
+static void AppendNewLineAndIndent(int depth, std::string* output) {
+  output->push_back('\n');
+  output->append(static_cast<size_t>(depth) * 2, ' ');
+}
+
+static void AppendInt64(int64_t value, std::string* output) {
+  // Large enough for the 20 digits and sign of any int64.
+  char buffer[24];
+  char* end = buffer + sizeof(buffer);
+  char* position = end;
+  uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value)
+                                 : static_cast<uint64_t>(value);
+  do {
+    *--position = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude);
+  if (value < 0) *--position = '-';
+  output->append(position, end - position);
+}
+
+// snprintf() and strtod() use the decimal point of the current locale, which
+// is not "." in many locales, while JSON numbers always use ".".
+static const char* LocaleDecimalPoint() {
+  const char* decimal_point = localeconv()->decimal_point;
+  return decimal_point && *decimal_point ? decimal_point : ".";
+}
+
+static void AppendDouble(double value, std::string* output) {
+  // Use the shortest representation that round-trips. Most values round-trip
+  // with 15 significant digits, IEEE 754 binary64 needs at most 17.
+  char buffer[32];
+  int length = 0;
+  for (int precision = 15; precision <= 17; ++precision) {
+    length = snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+    if (precision == 17 || strtod(buffer, nullptr) == value) break;
+  }
+  const char* decimal_point = LocaleDecimalPoint();
+  const char* position = strstr(buffer, decimal_point);
+  if (position && strcmp(decimal_point, ".") != 0) {
+    size_t prefix_length = position - buffer;
+    size_t point_length = strlen(decimal_point);
+    output->append(buffer, prefix_length);
+    output->push_back('.');
+    output->append(position + point_length,
+                   length - prefix_length - point_length);
+  } else {
+    output->append(buffer, length);
+  }
+}
+
+static void AppendJsonString(const char* str, size_t length,
+                             std::string* output) {
+  // Most strings don't need escaping so copy them directly.
+  bool needs_escape = false;
+  for (size_t i = 0; i < length; ++i) {
+    unsigned char c = static_cast<unsigned char>(str[i]);
+    if (c < 0x20 || c >= 0x7F || c == '"' || c == '\\' || c == '/') {
+      needs_escape = true;
+      break;
+    }
+  }
+  if (needs_escape) {
+    flatbuffers::EscapeString(str, length, output, true, false);
+  } else {
+    output->reserve(output->size() + length + 2);
+    output->push_back('"');
+    output->append(str, length);
+    output->push_back('"');
+  }
+}
+
+static void AppendJsonString(const Variant& variant, std::string* output) {
+  const char* str = variant.string_value();
+  size_t len = variant.is_mutable_string() ? variant.mutable_string().size()
+                                           : strlen(str);
+  AppendJsonString(str, len, output);
+}
+
+static bool VariantToJson(const Variant& variant, bool prettyPrint, int depth,
+                          std::string* output) {
   switch (variant.type()) {
     case Variant::kTypeNull: {
-      *ss << "null";
+      output->append("null");
       break;
     }
     case Variant::kTypeInt64: {
-      *ss << variant.int64_value();
+      AppendInt64(variant.int64_value(), output);
       break;
     }
     case Variant::kTypeDouble: {
-      // IEEE 754 double-precision binary floating-point format: binary64 — The
-      // 53-bit significand precision gives from 15 to 17 significant decimal
-      // digits Default 32-bit only keeps 7 digit precision
-      *ss << std::setprecision(17) << variant.double_value();
+      AppendDouble(variant.double_value(), output);
       break;
     }
     case Variant::kTypeBool: {
-      *ss << (variant.bool_value() ? "true" : "false");
+      output->append(variant.bool_value() ? "true" : "false");
       break;
     }
     case Variant::kTypeStaticString:
     case Variant::kTypeMutableString: {
-      std::string escaped_string;
-      const char* str = variant.string_value();
-      size_t len = variant.is_mutable_string() ? variant.mutable_string().size()
-                                               : strlen(str);
-      flatbuffers::EscapeString(str, len, &escaped_string, true, false);
-      *ss << escaped_string;
+      AppendJsonString(variant, output);
       break;
     }
     case Variant::kTypeVector: {
-      if (!StdVectorToJson(variant.vector(), prettyPrint, indent, ss)) {
+      if (!StdVectorToJson(variant.vector(), prettyPrint, depth, output)) {
         return false;
       }
       break;
     }
     case Variant::kTypeMap: {
-      if (!StdMapToJson(variant.map(), prettyPrint, indent, ss)) {
+      if (!StdMapToJson(variant.map(), prettyPrint, depth, output)) {
         return false;
       }
       break;
@@ -97,13 +172,11 @@ static bool VariantToJson(const Variant& variant, bool prettyPrint,
 }
 
 static bool StdMapToJson(const std::map<Variant, Variant>& map,
-                         bool prettyPrint, const std::string& indent,
-                         std::stringstream* ss) {
-  *ss << '{';
-  std::string nextIndent = indent + "  ";
+                         bool prettyPrint, int depth, std::string* output) {
+  output->push_back('{');
   for (auto iter = map.begin(); iter != map.end();) {
     if (prettyPrint) {
-      *ss << '\n' << nextIndent;
+      AppendNewLineAndIndent(depth + 1, output);
     }
     // JSON only supports string keys, return false if the key is not a type
     // that can be coerced to a string.
@@ -112,47 +185,47 @@ static bool StdMapToJson(const std::map<Variant, Variant>& map,
           "Variants of non-fundamental types may not be used as map keys.");
       return false;
     }
-    if (!VariantToJson(iter->first.AsString(), prettyPrint, nextIndent, ss)) {
-      return false;
+    if (iter->first.is_string()) {
+      AppendJsonString(iter->first, output);
+    } else {
+      AppendJsonString(iter->first.AsString(), output);
     }
-    *ss << ':';
+    output->push_back(':');
     if (prettyPrint) {
-      *ss << ' ';
+      output->push_back(' ');
     }
-    if (!VariantToJson(iter->second, prettyPrint, nextIndent, ss)) {
+    if (!VariantToJson(iter->second, prettyPrint, depth + 1, output)) {
       return false;
     }
     if (++iter != map.end()) {
-      *ss << ',';
+      output->push_back(',');
     }
   }
   if (prettyPrint) {
-    *ss << '\n' << indent;
+    AppendNewLineAndIndent(depth, output);
   }
-  *ss << '}';
+  output->push_back('}');
   return true;
 }
 
 static bool StdVectorToJson(const std::vector<Variant>& vector,
-                            bool prettyPrint, const std::string& indent,
-                            std::stringstream* ss) {
-  *ss << '[';
-  std::string nextIndent = indent + "  ";
+                            bool prettyPrint, int depth, std::string* output) {
+  output->push_back('[');
   for (auto iter = vector.begin(); iter != vector.end();) {
     if (prettyPrint) {
-      *ss << '\n' << nextIndent;
+      AppendNewLineAndIndent(depth + 1, output);
     }
-    if (!VariantToJson(*iter, prettyPrint, nextIndent, ss)) {
+    if (!VariantToJson(*iter, prettyPrint, depth + 1, output)) {
       return false;
     }
     if (++iter != vector.end()) {
-      *ss << ',';
+      output->push_back(',');
     }
   }
   if (prettyPrint) {
-    *ss << '\n' << indent;
+    AppendNewLineAndIndent(depth, output);
   }
-  *ss << ']';
+  output->push_back(']');
   return true;
 }
 
@@ -161,29 +234,38 @@ std::string VariantToJson(const Variant& variant) {
 }
 
 std::string VariantToJson(const Variant& variant, bool prettyPrint) {
-  std::stringstream ss;
-  if (!VariantToJson(variant, prettyPrint, "", &ss)) {
+  std::string json;
+  if (!VariantToJson(variant, prettyPrint, 0, &json)) {
     return "";
   }
-  return ss.str();
+  return json;
+}
+
+bool AppendVariantToJson(const Variant& variant, std::string* output) {
+  size_t original_size = output->size();
+  if (!VariantToJson(variant, false, 0, output)) {
+    output->resize(original_size);
+    return false;
+  }
+  return true;
 }
 
 // Converts an std::map<Variant, Variant> to Json
 std::string StdMapToJson(const std::map<Variant, Variant>& map) {
-  std::stringstream ss;
-  if (!StdMapToJson(map, false, "", &ss)) {
+  std::string json;
+  if (!StdMapToJson(map, false, 0, &json)) {
     return "";
   }
-  return ss.str();
+  return json;
 }
 
 // Converts an std::vector<Variant> to Json
 std::string StdVectorToJson(const std::vector<Variant>& vector) {
-  std::stringstream ss;
-  if (!StdVectorToJson(vector, false, "", &ss)) {
+  std::string json;
+  if (!StdVectorToJson(vector, false, 0, &json)) {
     return "";
   }
-  return ss.str();
+  return json;
 }
 
 Variant FlexbufferVectorToVariant(const flexbuffers::Vector& vector) {
@@ -251,15 +333,325 @@ Variant FlexbufferToVariant(const flexbuffers::Reference& ref) {
   return Variant::Null();
 }
 
+namespace {
+
+// Converts JSON directly into a Variant in a single pass, without building an
+// intermediate FlexBuffer. In addition to standard JSON this accepts the
+// relaxed syntax the FlatBuffers parser accepted: single quoted strings,
+// unquoted identifier keys and trailing commas.
+class JsonVariantParser {
+ public:
+  JsonVariantParser(const char* json, size_t length)
+      : position_(json), end_(json + length) {}
+
+  // Parse the entire input, returning false if it is not valid JSON.
+  bool Parse(Variant* value) {
+    SkipWhitespace();
+    if (!ParseValue(value, 0)) return false;
+    SkipWhitespace();
+    return position_ == end_;
+  }
+
+ private:
+  // Guards against stack exhaustion on deeply nested input.
+  static const int kMaxDepth = 512;
+
+  bool AtEnd() const { return position_ == end_; }
+
+  void SkipWhitespace() {
+    while (!AtEnd() && (*position_ == ' ' || *position_ == '\n' ||
+                        *position_ == '\r' || *position_ == '\t')) {
+      ++position_;
+    }
+  }
+
+  // Consume the character c, skipping preceding whitespace.
+  bool Consume(char c) {
+    SkipWhitespace();
+    if (AtEnd() || *position_ != c) return false;
+    ++position_;
+    return true;
+  }
+
+  bool ParseValue(Variant* value, int depth) {
+    if (AtEnd() || depth > kMaxDepth) return false;
+    switch (*position_) {
+      case '{':
+        return ParseObject(value, depth + 1);
+      case '[':
+        return ParseArray(value, depth + 1);
+      case '"':
+      case '\'':
+        if (!ParseString(&scratch_)) return false;
+        value->set_mutable_string(scratch_);
+        return true;
+      case 't':
+        if (!ConsumeLiteral("true")) return false;
+        value->set_bool_value(true);
+        return true;
+      case 'f':
+        if (!ConsumeLiteral("false")) return false;
+        value->set_bool_value(false);
+        return true;
+      case 'n':
+        if (!ConsumeLiteral("null")) return false;
+        value->set_null();
+        return true;
+      default:
+        return ParseNumber(value);
+    }
+  }
+
+  bool ParseObject(Variant* value, int depth) {
+    ++position_;  // '{'
+    *value = Variant::EmptyMap();
+    std::map<Variant, Variant>& map = value->map();
+    for (;;) {
+      SkipWhitespace();
+      if (AtEnd()) return false;
+      if (*position_ == '}') break;
+      if (!ParseKey(&scratch_) || !Consume(':')) return false;
+      SkipWhitespace();
+      // Keys are usually sorted so hint insertion at the end of the map. If
+      // the key is duplicated the last value wins.
+      auto it = map.emplace_hint(map.end(), Variant(scratch_), Variant());
+      if (!ParseValue(&it->second, depth)) return false;
+      SkipWhitespace();
+      if (AtEnd()) return false;
+      if (*position_ == ',') {
+        ++position_;
+      } else if (*position_ != '}') {
+        return false;
+      }
+    }
+    ++position_;  // '}'
+    return true;
+  }
+
+  bool ParseArray(Variant* value, int depth) {
+    ++position_;  // '['
+    *value = Variant::EmptyVector();
+    std::vector<Variant>& vector = value->vector();
+    for (;;) {
+      SkipWhitespace();
+      if (AtEnd()) return false;
+      if (*position_ == ']') break;
+      vector.emplace_back();
+      if (!ParseValue(&vector.back(), depth)) return false;
+      SkipWhitespace();
+      if (AtEnd()) return false;
+      if (*position_ == ',') {
+        ++position_;
+      } else if (*position_ != ']') {
+        return false;
+      }
+    }
+    ++position_;  // ']'
+    return true;
+  }
+
+  // Parse a quoted string or unquoted identifier used as an object key.
+  bool ParseKey(std::string* key) {
+    if (*position_ == '"' || *position_ == '\'') return ParseString(key);
+    const char* start = position_;
+    while (!AtEnd() && (isalnum(static_cast<unsigned char>(*position_)) ||
+                        *position_ == '_')) {
+      ++position_;
+    }
+    if (position_ == start) return false;
+    key->assign(start, position_ - start);
+    return true;
+  }
+
+  bool ParseString(std::string* str) {
+    char quote = *position_++;
+    str->clear();
+    for (;;) {
+      // Copy runs of unescaped characters in one go.
+      const char* start = position_;
+      while (!AtEnd() && *position_ != quote && *position_ != '\\') {
+        ++position_;
+      }
+      str->append(start, position_ - start);
+      if (AtEnd()) return false;
+      if (*position_ == quote) {
+        ++position_;
+        return true;
+      }
+      // Escape sequence.
+      ++position_;
+      if (AtEnd()) return false;
+      char escaped = *position_++;
+      switch (escaped) {
+        case '"':
+        case '\'':
+        case '\\':
+        case '/':
+          str->push_back(escaped);
+          break;
+        case 'b':
+          str->push_back('\b');
+          break;
+        case 'f':
+          str->push_back('\f');
+          break;
+        case 'n':
+          str->push_back('\n');
+          break;
+        case 'r':
+          str->push_back('\r');
+          break;
+        case 't':
+          str->push_back('\t');
+          break;
+        case 'u': {
+          uint32_t code_point;
+          if (!ParseHex4(&code_point)) return false;
+          // Combine UTF-16 surrogate pairs.
+          if (code_point >= 0xD800 && code_point <= 0xDBFF &&
+              end_ - position_ >= 6 && position_[0] == '\\' &&
+              position_[1] == 'u') {
+            const char* low_start = position_;
+            position_ += 2;
+            uint32_t low;
+            if (ParseHex4(&low) && low >= 0xDC00 && low <= 0xDFFF) {
+              code_point = 0x10000 + ((code_point - 0xD800) << 10) +
+                           (low - 0xDC00);
+            } else {
+              position_ = low_start;
+            }
+          }
+          AppendUtf8(code_point, str);
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+  }
+
+  bool ParseHex4(uint32_t* value) {
+    if (end_ - position_ < 4) return false;
+    *value = 0;
+    for (int i = 0; i < 4; ++i) {
+      char c = *position_++;
+      *value <<= 4;
+      if (c >= '0' && c <= '9') {
+        *value |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        *value |= c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        *value |= c - 'A' + 10;
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void AppendUtf8(uint32_t code_point, std::string* str) {
+    if (code_point < 0x80) {
+      str->push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+      str->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+      str->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+      str->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+      str->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+      str->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+      str->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+      str->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+      str->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+      str->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+  }
+
+  bool ConsumeLiteral(const char* literal) {
+    size_t length = strlen(literal);
+    if (static_cast<size_t>(end_ - position_) < length ||
+        memcmp(position_, literal, length) != 0) {
+      return false;
+    }
+    position_ += length;
+    return true;
+  }
+
+  // Parse a number as an int64 if it is an integer that fits, otherwise as a
+  // double.
+  bool ParseNumber(Variant* value) {
+    const char* start = position_;
+    bool negative = false;
+    if (*position_ == '-' || *position_ == '+') {
+      negative = *position_ == '-';
+      ++position_;
+    }
+    const char* digits_start = position_;
+    uint64_t magnitude = 0;
+    bool overflow = false;
+    while (!AtEnd() && *position_ >= '0' && *position_ <= '9') {
+      uint64_t digit = static_cast<uint64_t>(*position_ - '0');
+      if (magnitude > (UINT64_MAX - digit) / 10) overflow = true;
+      magnitude = magnitude * 10 + digit;
+      ++position_;
+    }
+    if (position_ == digits_start) return false;
+    bool is_integer = true;
+    if (!AtEnd() && *position_ == '.') {
+      is_integer = false;
+      ++position_;
+      while (!AtEnd() && *position_ >= '0' && *position_ <= '9') ++position_;
+    }
+    if (!AtEnd() && (*position_ == 'e' || *position_ == 'E')) {
+      is_integer = false;
+      ++position_;
+      if (!AtEnd() && (*position_ == '-' || *position_ == '+')) ++position_;
+      const char* exponent_start = position_;
+      while (!AtEnd() && *position_ >= '0' && *position_ <= '9') ++position_;
+      if (position_ == exponent_start) return false;
+    }
+    const uint64_t kMaxNegative =
+        static_cast<uint64_t>(INT64_MAX) + 1;  // Magnitude of INT64_MIN.
+    if (is_integer && !overflow &&
+        magnitude <= (negative ? kMaxNegative : INT64_MAX)) {
+      value->set_int64_value(
+          negative ? static_cast<int64_t>(0 - magnitude)
+                   : static_cast<int64_t>(magnitude));
+      return true;
+    }
+    // strtod() requires a null terminated string, using the decimal point of
+    // the current locale.
+    scratch_.assign(start, position_ - start);
+    const char* decimal_point = LocaleDecimalPoint();
+    if (strcmp(decimal_point, ".") != 0) {
+      size_t point = scratch_.find('.');
+      if (point != std::string::npos) {
+        scratch_.replace(point, 1, decimal_point);
+      }
+    }
+    value->set_double_value(strtod(scratch_.c_str(), nullptr));
+    return true;
+  }
+
+  const char* position_;
+  const char* end_;
+  // Reused for keys, strings and numbers to avoid allocating per token.
+  std::string scratch_;
+};
+
+}  // namespace
+
 Variant JsonToVariant(const char* json) {
-  flatbuffers::Parser parser;
-  flexbuffers::Builder builder;
-  if (!json || !parser.ParseFlexBuffer(json, nullptr, &builder)) {
-    return Variant::Null();
-  }
-  const std::vector<uint8_t>& buffer = builder.GetBuffer();
-  flexbuffers::Reference root = flexbuffers::GetRoot(buffer);
-  return FlexbufferToVariant(root);
+  if (!json) return Variant::Null();
+  return JsonToVariant(json, strlen(json));
+}
+
+Variant JsonToVariant(const char* json, size_t length) {
+  if (!json) return Variant::Null();
+  Variant result;
+  JsonVariantParser parser(json, length);
+  if (!parser.Parse(&result)) return Variant::Null();
+  return result;
 }
 
 bool VariantToFlexbuffer(const Variant& variant, flexbuffers::Builder* fbb) {
@@ -25,13 +25,23 @@
 namespace firebase {
 namespace util {
 
-// Convert from a JSON string to a Variant.
+// Convert from a JSON string to a Variant. Returns a null Variant if the
+// string is not valid JSON.
 Variant JsonToVariant(const char* json);
 
+// Convert from a JSON string of the specified length, which does not need to be
+// null terminated, to a Variant.
+Variant JsonToVariant(const char* json, size_t length);
+
 // Converts a Variant to a JSON string.
 std::string VariantToJson(const Variant& variant);
 std::string VariantToJson(const Variant& variant, bool prettyPrint);
 
+// Appends the JSON representation of a Variant to output, so the caller can
+// reuse the same buffer for many messages. Returns false, leaving output
+// unchanged, if the Variant can't be represented as JSON.
+bool AppendVariantToJson(const Variant& variant, std::string* output);
+
 // Converts an std::map<Variant, Variant> to Json
 std::string StdMapToJson(const std::map<Variant, Variant>& map);
 
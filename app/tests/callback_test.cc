@@ -18,6 +18,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "app/memory/unique_ptr.h"
 #include "app/src/include/firebase/internal/mutex.h"
@@ -459,4 +460,88 @@ TEST_F(CallbackTest, CallbackDeadlockTest) {
     EXPECT_THAT(callback::IsInitialized(), Eq(false));
   }
 }
+
+// Callbacks added by a callback are run by the same PollCallbacks() call.
+TEST_F(CallbackTest, AddCallbackDuringDispatch) {
+  callback::AddCallback(new callback::CallbackVoid([]() {
+    callback::AddCallback(new callback::CallbackVoid(CountCallbackVoid));
+  }));
+  callback::PollCallbacks();
+  EXPECT_THAT(callback_void_count_, Eq(1));
+  EXPECT_THAT(callback::IsInitialized(), Eq(false));
+}
+
+TEST_F(CallbackTest, DispatchStats) {
+  callback::DispatchStats stats = callback::GetDispatchStats();
+  EXPECT_THAT(stats.queued_count, Eq(0u));
+
+  callback::Initialize();
+  callback::AddCallback(new callback::CallbackVoid(CountCallbackVoid));
+  void* removed =
+      callback::AddCallback(new callback::CallbackVoid(CountCallbackVoid));
+  callback::AddCallback(new callback::CallbackVoid(CountCallbackVoid));
+  callback::RemoveCallback(removed);
+  stats = callback::GetDispatchStats();
+  EXPECT_THAT(stats.queued_count, Eq(3u));
+  EXPECT_THAT(stats.pending_count, Eq(3u));
+  EXPECT_THAT(stats.run_count, Eq(0u));
+
+  callback::PollCallbacks();
+  stats = callback::GetDispatchStats();
+  EXPECT_THAT(stats.queued_count, Eq(3u));
+  EXPECT_THAT(stats.pending_count, Eq(0u));
+  EXPECT_THAT(stats.run_count, Eq(2u));
+  EXPECT_THAT(stats.max_batch_size, Eq(3u));
+  EXPECT_THAT(callback_void_count_, Eq(2));
+  callback::Terminate(false);
+  EXPECT_THAT(callback::IsInitialized(), Eq(false));
+}
+
+// Add callbacks from several threads while polling, like a game loop.
+TEST_F(CallbackTest, DispatchThroughput) {
+  const int kThreads = 4;
+  const int kCallbacksPerThread = 250000;
+  struct Counter {
+    Counter() : count(0) {}
+    Mutex mutex;
+    int count;
+  } counter;
+
+  callback::Initialize();
+  uint64_t start = internal::GetTimestamp();
+  std::vector<Thread*> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.push_back(new Thread(
+        [](void* arg) {
+          for (int j = 0; j < kCallbacksPerThread; ++j) {
+            callback::AddCallback(new callback::CallbackValue1<Counter*>(
+                static_cast<Counter*>(arg), [](Counter* counter) {
+                  MutexLock lock(counter->mutex);
+                  counter->count++;
+                }));
+          }
+        },
+        &counter));
+  }
+  int total = kThreads * kCallbacksPerThread;
+  while (true) {
+    callback::PollCallbacks();
+    MutexLock lock(counter.mutex);
+    if (counter.count == total) break;
+  }
+  uint64_t elapsed = internal::GetTimestamp() - start;
+  for (Thread* thread : threads) {
+    thread->Join();
+    delete thread;
+  }
+  callback::DispatchStats stats = callback::GetDispatchStats();
+  printf("Dispatched %d callbacks in %dms (max batch %d, max latency %dms)\n",
+         total, static_cast<int>(elapsed),
+         static_cast<int>(stats.max_batch_size),
+         static_cast<int>(stats.max_latency_ms));
+  EXPECT_THAT(stats.run_count, Eq(static_cast<uint64_t>(total)));
+  callback::Terminate(false);
+  EXPECT_THAT(callback::IsInitialized(), Eq(false));
+}
+
 }  // namespace firebase
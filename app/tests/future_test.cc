@@ -1557,6 +1557,83 @@ TEST_F(FutureTest, MemoryStressTest) {
   }
 }
 
+// Keep many futures alive while others are released out of order, so that
+// handles are looked up after their neighbors in the backing table have been
+// removed.
+TEST_F(FutureTest, TestManyInterleavedFutures) {
+  const int kNumFutures = 1000;
+  std::vector<SafeFutureHandle<int>> handles;
+  std::vector<FutureHandleId> ids;
+  std::vector<Future<int>> futures;
+  for (int i = 0; i < kNumFutures; ++i) {
+    handles.push_back(future_impl_.SafeAlloc<int>());
+    ids.push_back(handles.back().get().id());
+    futures.push_back(MakeFuture(&future_impl_, handles.back()));
+  }
+  // Drop every third future along with its handle, then complete the
+  // remaining ones.
+  for (int i = 0; i < kNumFutures; i += 3) {
+    futures[i].Release();
+    handles[i] = SafeFutureHandle<int>();
+    EXPECT_FALSE(future_impl_.ValidFuture(ids[i]));
+  }
+  for (int i = 0; i < kNumFutures; ++i) {
+    if (i % 3 != 0) future_impl_.CompleteWithResult(handles[i], 0, i);
+  }
+  for (int i = 0; i < kNumFutures; ++i) {
+    if (i % 3 == 0) {
+      EXPECT_FALSE(future_impl_.ValidFuture(ids[i]));
+    } else {
+      EXPECT_THAT(futures[i].status(), Eq(kFutureStatusComplete));
+      EXPECT_THAT(*futures[i].result(), Eq(i));
+    }
+  }
+}
+
+// Measure the throughput of allocating, completing and releasing futures from
+// several threads sharing the same API.
+TEST_F(FutureTest, TestAllocCompleteReleaseThroughput) {
+  const int kIterationsPerThread = 20000;
+  const int kMaxThreads = 16;
+  struct Context {
+    ReferenceCountedFutureImpl* impl;
+    int completed;
+  };
+  for (int num_threads = 1; num_threads <= kMaxThreads; num_threads *= 2) {
+    ReferenceCountedFutureImpl impl(0);
+    std::vector<Context> contexts(num_threads, Context{&impl, 0});
+    std::vector<Thread*> threads;
+    uint64_t start = internal::GetTimestamp();
+    for (int i = 0; i < num_threads; ++i) {
+      threads.push_back(new Thread(
+          [](void* context_void) {
+            Context* context = static_cast<Context*>(context_void);
+            for (int j = 0; j < kIterationsPerThread; ++j) {
+              SafeFutureHandle<int> handle = context->impl->SafeAlloc<int>();
+              Future<int> future = MakeFuture(context->impl, handle);
+              context->impl->CompleteWithResult(handle, 0, j);
+              if (future.status() == kFutureStatusComplete &&
+                  *future.result() == j) {
+                context->completed++;
+              }
+            }
+          },
+          &contexts[i]));
+    }
+    for (Thread* thread : threads) {
+      thread->Join();
+      delete thread;
+    }
+    uint64_t elapsed_ms = internal::GetTimestamp() - start;
+    for (const Context& context : contexts) {
+      EXPECT_THAT(context.completed, Eq(kIterationsPerThread));
+    }
+    EXPECT_FALSE(impl.IsReferencedExternally());
+    printf("%d thread(s): %d futures in %dms\n", num_threads,
+           num_threads * kIterationsPerThread, static_cast<int>(elapsed_ms));
+  }
+}
+
 }  // namespace testing
 }  // namespace detail
 }  // namespace firebase
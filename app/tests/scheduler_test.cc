@@ -27,9 +27,9 @@ namespace scheduler {
 
 using ::testing::Eq;
 
-class SchedulerTest : public ::testing::Test {
+class SchedulerTest : public ::testing::TestWithParam<Scheduler::Backend> {
  protected:
-  SchedulerTest() {}
+  SchedulerTest() : scheduler_(GetParam()) {}
 
   void SetUp() override {
     atomic_count_.store(0);
@@ -85,7 +85,7 @@ int SchedulerTest::repeat_countdown_ = 0;
 // 10000 seems to be a good number to surface racing condition.
 const int kThreadTestIteration = 10000;
 
-TEST_F(SchedulerTest, Basic) {
+TEST_P(SchedulerTest, Basic) {
   scheduler_.Schedule(new callback::CallbackVoid(SemaphorePost1));
   EXPECT_TRUE(callback_sem1_.TimedWait(1000));
 
@@ -94,7 +94,7 @@ TEST_F(SchedulerTest, Basic) {
 }
 
 #ifdef FIREBASE_USE_STD_FUNCTION
-TEST_F(SchedulerTest, BasicStdFunction) {
+TEST_P(SchedulerTest, BasicStdFunction) {
   std::function<void(void)> func = [this]() { callback_sem1_.Post(); };
 
   scheduler_.Schedule(func);
@@ -105,7 +105,7 @@ TEST_F(SchedulerTest, BasicStdFunction) {
 }
 #endif
 
-TEST_F(SchedulerTest, TriggerOrderNoDelay) {
+TEST_P(SchedulerTest, TriggerOrderNoDelay) {
   std::vector<int> expected;
   for (int i = 0; i < kThreadTestIteration; ++i) {
     scheduler_.Schedule(new callback::CallbackValue1<int>(i, AddValueInOrder));
@@ -118,7 +118,7 @@ TEST_F(SchedulerTest, TriggerOrderNoDelay) {
   EXPECT_THAT(ordered_value_, Eq(expected));
 }
 
-TEST_F(SchedulerTest, TriggerOrderSameDelay) {
+TEST_P(SchedulerTest, TriggerOrderSameDelay) {
   std::vector<int> expected;
   for (int i = 0; i < kThreadTestIteration; ++i) {
     scheduler_.Schedule(new callback::CallbackValue1<int>(i, AddValueInOrder),
@@ -132,7 +132,7 @@ TEST_F(SchedulerTest, TriggerOrderSameDelay) {
   EXPECT_THAT(ordered_value_, Eq(expected));
 }
 
-TEST_F(SchedulerTest, TriggerOrderDifferentDelay) {
+TEST_P(SchedulerTest, TriggerOrderDifferentDelay) {
   std::vector<int> expected;
   for (int i = 0; i < 1000; ++i) {
     scheduler_.Schedule(new callback::CallbackValue1<int>(i, AddValueInOrder),
@@ -147,7 +147,7 @@ TEST_F(SchedulerTest, TriggerOrderDifferentDelay) {
   EXPECT_THAT(ordered_value_, Eq(expected));
 }
 
-TEST_F(SchedulerTest, ExecuteDuringCallback) {
+TEST_P(SchedulerTest, ExecuteDuringCallback) {
   scheduler_.Schedule(new callback::CallbackValue1<Scheduler*>(
       &scheduler_, [](Scheduler* scheduler) {
         callback_sem1_.Post();
@@ -159,7 +159,7 @@ TEST_F(SchedulerTest, ExecuteDuringCallback) {
   EXPECT_TRUE(callback_sem2_.TimedWait(1000));
 }
 
-TEST_F(SchedulerTest, ScheduleDuringCallback1) {
+TEST_P(SchedulerTest, ScheduleDuringCallback1) {
   scheduler_.Schedule(
       new callback::CallbackValue1<Scheduler*>(
           &scheduler_,
@@ -177,7 +177,7 @@ TEST_F(SchedulerTest, ScheduleDuringCallback1) {
   EXPECT_TRUE(callback_sem2_.TimedWait(1000));
 }
 
-TEST_F(SchedulerTest, ScheduleDuringCallback100) {
+TEST_P(SchedulerTest, ScheduleDuringCallback100) {
   scheduler_.Schedule(
       new callback::CallbackValue1<Scheduler*>(
           &scheduler_,
@@ -195,7 +195,7 @@ TEST_F(SchedulerTest, ScheduleDuringCallback100) {
   EXPECT_TRUE(callback_sem2_.TimedWait(1000));
 }
 
-TEST_F(SchedulerTest, RecursiveCallbackNoInterval) {
+TEST_P(SchedulerTest, RecursiveCallbackNoInterval) {
   repeat_period_ms_ = 0;
   repeat_countdown_ = 1000;
   scheduler_.Schedule(
@@ -207,7 +207,7 @@ TEST_F(SchedulerTest, RecursiveCallbackNoInterval) {
   }
 }
 
-TEST_F(SchedulerTest, RecursiveCallbackWithInterval) {
+TEST_P(SchedulerTest, RecursiveCallbackWithInterval) {
   repeat_period_ms_ = 10;
   repeat_countdown_ = 5;
   scheduler_.Schedule(
@@ -219,7 +219,7 @@ TEST_F(SchedulerTest, RecursiveCallbackWithInterval) {
   }
 }
 
-TEST_F(SchedulerTest, RepeatCallbackNoDelay) {
+TEST_P(SchedulerTest, RepeatCallbackNoDelay) {
   scheduler_.Schedule(new callback::CallbackVoid(SemaphorePost1), 0, 1);
 
   // Wait for it to repeat 100 times
@@ -228,7 +228,7 @@ TEST_F(SchedulerTest, RepeatCallbackNoDelay) {
   }
 }
 
-TEST_F(SchedulerTest, RepeatCallbackWithDelay) {
+TEST_P(SchedulerTest, RepeatCallbackWithDelay) {
   int delay = 100;
   scheduler_.Schedule(new callback::CallbackVoid(SemaphorePost1), delay, 1);
 
@@ -249,10 +249,10 @@ TEST_F(SchedulerTest, RepeatCallbackWithDelay) {
   }
 }
 
-TEST_F(SchedulerTest, CancelImmediateCallback) {
-  auto test_func = [](int delay) {
+TEST_P(SchedulerTest, CancelImmediateCallback) {
+  auto test_func = [this](int delay) {
     // Use standalone scheduler and counter
-    Scheduler scheduler;
+    Scheduler scheduler(GetParam());
     compat::Atomic<int> count(0);
     int success_cancel = 0;
     for (int i = 0; i < kThreadTestIteration; ++i) {
@@ -288,10 +288,10 @@ TEST_F(SchedulerTest, CancelImmediateCallback) {
 }
 
 // This test can take around 5s ~ 30s depending on the platform
-TEST_F(SchedulerTest, CancelRepeatCallback) {
-  auto test_func = [](int delay, int repeat, int wait_repeat) {
+TEST_P(SchedulerTest, CancelRepeatCallback) {
+  auto test_func = [this](int delay, int repeat, int wait_repeat) {
     // Use standalone scheduler and counter for iterations
-    Scheduler scheduler;
+    Scheduler scheduler(GetParam());
     compat::Atomic<int> count(0);
     while (callback_sem1_.TryWait()) {
     }
@@ -336,8 +336,8 @@ TEST_F(SchedulerTest, CancelRepeatCallback) {
   }
 }
 
-TEST_F(SchedulerTest, CancelAll) {
-  Scheduler scheduler;
+TEST_P(SchedulerTest, CancelAll) {
+  Scheduler scheduler(GetParam());
   for (int i = 0; i < kThreadTestIteration; ++i) {
     scheduler.Schedule(new callback::CallbackVoid(AddCount));
   }
@@ -348,9 +348,9 @@ TEST_F(SchedulerTest, CancelAll) {
          trigger_rate);
 }
 
-TEST_F(SchedulerTest, DeleteScheduler) {
+TEST_P(SchedulerTest, DeleteScheduler) {
   for (int i = 0; i < kThreadTestIteration; ++i) {
-    Scheduler scheduler;
+    Scheduler scheduler(GetParam());
     scheduler.Schedule(new callback::CallbackVoid(AddCount));
   }
 
@@ -360,5 +360,98 @@ TEST_F(SchedulerTest, DeleteScheduler) {
          trigger_rate);
 }
 
+TEST_P(SchedulerTest, Stats) {
+  Scheduler scheduler(GetParam());
+  SchedulerStats stats = scheduler.GetStats();
+  EXPECT_THAT(stats.queue_depth, Eq(0u));
+  EXPECT_THAT(stats.triggered_count, Eq(0u));
+
+  // Queue a request far in the future behind a few immediate ones.
+  RequestHandle handle = scheduler.Schedule(
+      new callback::CallbackVoid(SemaphorePost1), 100000);
+  for (int i = 0; i < 3; ++i) {
+    scheduler.Schedule(new callback::CallbackVoid(AddCount));
+  }
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(callback_sem1_.TimedWait(1000));
+  }
+
+  stats = scheduler.GetStats();
+  EXPECT_THAT(stats.queue_depth, Eq(1u));
+  EXPECT_GE(stats.max_queue_depth, 2u);
+  EXPECT_THAT(stats.triggered_count, Eq(3u));
+  EXPECT_LE(stats.max_latency_ms, stats.total_latency_ms);
+  EXPECT_TRUE(handle.Cancel());
+}
+
+TEST_P(SchedulerTest, TriggerOrderAcrossLevels) {
+  // Delays past 256ms and 65536ms are stored in higher timer wheel levels and
+  // moved down as they come due.
+  const int kDelays[] = {300, 5, 260, 300, 0, 256, 255};
+  const int kExpected[] = {4, 1, 6, 5, 2, 0, 3};
+  const int kCount = sizeof(kDelays) / sizeof(kDelays[0]);
+  for (int i = 0; i < kCount; ++i) {
+    scheduler_.Schedule(new callback::CallbackValue1<int>(i, AddValueInOrder),
+                        kDelays[i]);
+  }
+  RequestHandle far = scheduler_.Schedule(
+      new callback::CallbackValue1<int>(-1, AddValueInOrder), 100000);
+
+  for (int i = 0; i < kCount; ++i) {
+    EXPECT_TRUE(callback_sem1_.TimedWait(2000));
+  }
+  EXPECT_THAT(ordered_value_,
+              Eq(std::vector<int>(kExpected, kExpected + kCount)));
+  EXPECT_TRUE(far.Cancel());
+}
+
+TEST_P(SchedulerTest, CancelledRequestsLeaveQueue) {
+  Scheduler scheduler(GetParam());
+  std::vector<RequestHandle> handles;
+  for (int i = 0; i < 100; ++i) {
+    handles.push_back(scheduler.Schedule(
+        new callback::CallbackVoid(AddCount), 100000 + i));
+  }
+  EXPECT_THAT(scheduler.GetStats().queue_depth, Eq(100u));
+  for (RequestHandle& handle : handles) {
+    EXPECT_TRUE(handle.Cancel());
+    EXPECT_FALSE(handle.Cancel());
+    EXPECT_TRUE(handle.IsCancelled());
+  }
+  // Only the timer wheel drops cancelled requests before they are due.
+  if (GetParam() == Scheduler::kBackendTimerWheel) {
+    EXPECT_THAT(scheduler.GetStats().queue_depth, Eq(0u));
+  }
+  EXPECT_THAT(atomic_count_.load(), Eq(0));
+}
+
+// Schedule and cancel many short timers, like request timeouts that are
+// cancelled when the response arrives.
+TEST_P(SchedulerTest, ScheduleCancelThroughput) {
+  const int kIterations = 1000000;
+  const int kOutstanding = 1000;
+  Scheduler scheduler(GetParam());
+  std::vector<RequestHandle> handles(kOutstanding);
+  uint64_t start = internal::GetTimestamp();
+  for (int i = 0; i < kIterations; ++i) {
+    RequestHandle& handle = handles[i % kOutstanding];
+    if (handle.IsValid()) handle.Cancel();
+    handle = scheduler.Schedule(new callback::CallbackVoid(AddCount),
+                                1000 + i % 5000);
+  }
+  for (RequestHandle& handle : handles) handle.Cancel();
+  uint64_t elapsed = internal::GetTimestamp() - start;
+  printf("[%s] Scheduled and cancelled %d requests in %dms (max queue %d)\n",
+         GetParam() == Scheduler::kBackendTimerWheel ? "TimerWheel"
+                                                      : "PriorityQueue",
+         kIterations, static_cast<int>(elapsed),
+         static_cast<int>(scheduler.GetStats().max_queue_depth));
+  EXPECT_THAT(atomic_count_.load(), Eq(0));
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, SchedulerTest,
+                         ::testing::Values(Scheduler::kBackendPriorityQueue,
+                                           Scheduler::kBackendTimerWheel));
+
 }  // namespace scheduler
 }  // namespace firebase
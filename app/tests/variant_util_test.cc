@@ -16,11 +16,16 @@
 
 #include "app/src/variant_util.h"
 
+#include <chrono>
+#include <clocale>
 #include <cstring>
+#include <string>
 #include <vector>
 
 #include "app/src/include/firebase/variant.h"
+#include "app/src/log.h"
 #include "app/tests/flexbuffer_matcher.h"
+#include "flatbuffers/idl.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "testing/json_util.h"
@@ -128,6 +133,131 @@ TEST(UtilDesktopTest, JsonToVariantMap) {
               Eq(nested_map));
 }
 
+TEST(UtilDesktopTest, JsonToVariantEscapedString) {
+  EXPECT_THAT(JsonToVariant("\"a\\\"b\\\\c\\/d\\ne\""),
+              Eq(Variant("a\"b\\c/d\ne")));
+  EXPECT_THAT(JsonToVariant("\"\\u3053\\u3093\""), Eq(Variant("こん")));
+  // Surrogate pairs are combined into a single UTF-8 code point.
+  EXPECT_THAT(JsonToVariant("\"\\ud83d\\ude00\""),
+              Eq(Variant("\xF0\x9F\x98\x80")));
+}
+
+TEST(UtilDesktopTest, JsonToVariantLength) {
+  const char json[] = "{\"a\":[1,2]}trailing data";
+  EXPECT_THAT(JsonToVariant(json, strlen("{\"a\":[1,2]}")),
+              Eq(JsonToVariant("{\"a\":[1,2]}")));
+}
+
+TEST(UtilDesktopTest, JsonToVariantLargeNumbers) {
+  EXPECT_THAT(JsonToVariant("9223372036854775807"),
+              Eq(Variant(int64_t(9223372036854775807LL))));
+  EXPECT_THAT(JsonToVariant("-9223372036854775808"),
+              Eq(Variant(int64_t(-9223372036854775807LL - 1))));
+  // Integers that do not fit in an int64 are converted to doubles.
+  EXPECT_THAT(JsonToVariant("18446744073709551616"),
+              Eq(Variant(18446744073709551616.0)));
+  EXPECT_THAT(JsonToVariant("1e3"), Eq(Variant(1000.0)));
+}
+
+TEST(UtilDesktopTest, JsonToVariantRelaxedSyntax) {
+  std::map<Variant, Variant> map{
+      std::make_pair("a", 1),
+      std::make_pair("b", "c"),
+  };
+  EXPECT_THAT(JsonToVariant("{a: 1, 'b': 'c',}"), Eq(Variant(map)));
+}
+
+TEST(UtilDesktopTest, JsonToVariantInvalid) {
+  EXPECT_THAT(JsonToVariant(nullptr), Eq(Variant::Null()));
+  EXPECT_THAT(JsonToVariant(""), Eq(Variant::Null()));
+  EXPECT_THAT(JsonToVariant("[1, 2"), Eq(Variant::Null()));
+  EXPECT_THAT(JsonToVariant("{\"a\" 1}"), Eq(Variant::Null()));
+  EXPECT_THAT(JsonToVariant("\"unterminated"), Eq(Variant::Null()));
+  EXPECT_THAT(JsonToVariant("1 2"), Eq(Variant::Null()));
+  EXPECT_THAT(JsonToVariant(std::string(10000, '[').c_str()),
+              Eq(Variant::Null()));
+}
+
+// Runs tests with LC_NUMERIC set to a locale using a comma as the decimal
+// point, as in much of Europe. JSON numbers always use a period.
+class UtilDesktopCommaLocaleTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    previous_locale_ = setlocale(LC_NUMERIC, nullptr);
+    for (const char* name : {"de_DE.UTF-8", "de_DE.utf8", "de_DE",
+                             "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR", "German"}) {
+      if (setlocale(LC_NUMERIC, name) &&
+          strcmp(localeconv()->decimal_point, ",") == 0) {
+        return;
+      }
+    }
+    setlocale(LC_NUMERIC, previous_locale_.c_str());
+    GTEST_SKIP() << "No locale using a comma as the decimal point";
+  }
+
+  void TearDown() override {
+    setlocale(LC_NUMERIC, previous_locale_.c_str());
+  }
+
+ private:
+  std::string previous_locale_;
+};
+
+TEST_F(UtilDesktopCommaLocaleTest, JsonToVariantDouble) {
+  EXPECT_THAT(JsonToVariant("1.5"), Eq(Variant(1.5)));
+  EXPECT_THAT(JsonToVariant("-0.25e2"), Eq(Variant(-25.0)));
+  EXPECT_THAT(JsonToVariant("[0.5,{\"a\":2.75}]"),
+              Eq(Variant(std::vector<Variant>{
+                  0.5, Variant(std::map<Variant, Variant>{{"a", 2.75}})})));
+}
+
+// Compare the single pass parser with parsing via a FlexBuffer on a payload
+// similar to a Realtime Database data update message.
+TEST(UtilDesktopTest, JsonToVariantMatchesFlexbufferPath) {
+  std::string json =
+      "{\"t\":\"d\",\"d\":{\"b\":{\"p\":\"chat/messages\",\"d\":{";
+  for (int i = 0; i < 500; ++i) {
+    if (i) json += ",";
+    json += "\"-Mkey" + std::to_string(i) +
+            "\":{\"author\":\"user" + std::to_string(i % 7) +
+            "\",\"text\":\"Hello \\\"world\\\" " + std::to_string(i) +
+            "\",\"timestamp\":" + std::to_string(1600000000000LL + i) +
+            ",\"score\":" + std::to_string(i) + ".5,\"read\":" +
+            (i % 2 ? "true" : "false") + "}";
+  }
+  json += "}},\"a\":\"d\"}}";
+
+  const auto flexbuffer_to_variant = [](const std::string& json) {
+    flatbuffers::Parser parser;
+    flexbuffers::Builder builder;
+    EXPECT_TRUE(parser.ParseFlexBuffer(json.c_str(), nullptr, &builder));
+    return firebase::util::FlexbufferToVariant(
+        flexbuffers::GetRoot(builder.GetBuffer()));
+  };
+  Variant expected = flexbuffer_to_variant(json);
+  EXPECT_THAT(JsonToVariant(json.c_str()), Eq(expected));
+
+  const int kIterations = 100;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; ++i) flexbuffer_to_variant(json);
+  auto flexbuffer_time = std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; ++i) JsonToVariant(json.c_str());
+  auto direct_time = std::chrono::steady_clock::now() - start;
+  firebase::LogInfo(
+      "JsonToVariant %d bytes: via FlexBuffer %lld us, direct %lld us",
+      static_cast<int>(json.size()),
+      static_cast<long long>(  // NOLINT
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              flexbuffer_time)
+              .count() /
+          kIterations),
+      static_cast<long long>(  // NOLINT
+          std::chrono::duration_cast<std::chrono::microseconds>(direct_time)
+              .count() /
+          kIterations));
+}
+
 TEST(UtilDesktopTest, VariantToJsonNull) {
   EXPECT_THAT(VariantToJson(Variant::Null()), EqualsJson("null"));
 }
@@ -148,6 +278,36 @@ TEST(UtilDesktopTest, VariantToJsonDouble) {
   EXPECT_THAT(VariantToJson(Variant(-100.0)), EqualsJson("-100"));
 }
 
+TEST(UtilDesktopTest, VariantToJsonDoubleRoundTrip) {
+  // Doubles use the shortest representation that parses to the same value.
+  EXPECT_THAT(VariantToJson(Variant(0.1)), StrEq("0.1"));
+  EXPECT_THAT(VariantToJson(Variant(1.0 / 3.0)), StrEq("0.3333333333333333"));
+  EXPECT_THAT(VariantToJson(Variant(1e300)), StrEq("1e+300"));
+  EXPECT_THAT(JsonToVariant(VariantToJson(Variant(1.0 / 3.0)).c_str()),
+              Eq(Variant(1.0 / 3.0)));
+}
+
+TEST_F(UtilDesktopCommaLocaleTest, VariantToJsonDouble) {
+  EXPECT_THAT(VariantToJson(Variant(1.5)), StrEq("1.5"));
+  EXPECT_THAT(VariantToJson(Variant(-0.1)), StrEq("-0.1"));
+  EXPECT_THAT(VariantToJson(Variant(1.0 / 3.0)), StrEq("0.3333333333333333"));
+  EXPECT_THAT(VariantToJson(Variant(std::vector<Variant>{0.5, 2.25})),
+              StrEq("[0.5,2.25]"));
+  EXPECT_THAT(JsonToVariant(VariantToJson(Variant(1.0 / 3.0)).c_str()),
+              Eq(Variant(1.0 / 3.0)));
+}
+
+TEST(UtilDesktopTest, AppendVariantToJson) {
+  std::string buffer = "prefix:";
+  EXPECT_TRUE(firebase::util::AppendVariantToJson(
+      Variant(std::vector<Variant>{1, "a"}), &buffer));
+  EXPECT_THAT(buffer, StrEq("prefix:[1,\"a\"]"));
+  // On failure the buffer is left unchanged.
+  EXPECT_FALSE(firebase::util::AppendVariantToJson(
+      Variant::FromMutableBlob("abc", 3), &buffer));
+  EXPECT_THAT(buffer, StrEq("prefix:[1,\"a\"]"));
+}
+
 TEST(UtilDesktopTest, VariantToJsonBool) {
   EXPECT_THAT(VariantToJson(Variant::True()), EqualsJson("true"));
   EXPECT_THAT(VariantToJson(Variant::False()), EqualsJson("false"));
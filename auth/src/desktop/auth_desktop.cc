@@ -14,6 +14,8 @@
 
 #include "auth/src/desktop/auth_desktop.h"
 
+#include <algorithm>
+#include <ctime>
 #include <memory>
 #include <string>
 #include <utility>
@@ -838,11 +840,7 @@ void IdTokenRefreshThread::Initialize(AuthData* auth_data) {
             // ensures that we won't mess with the LastResult for the
             // user-facing one.
 
-            uint64_t ms_since_last_refresh =
-                internal::GetTimestampEpoch() -
-                refresh_thread->token_refresh_listener_.GetTokenTimestamp();
-
-            if (ms_since_last_refresh >= kMsPerTokenRefresh) {
+            if (refresh_thread->MsUntilRefresh() <= 0) {
               Future<std::string> future =
                   refresh_thread->auth->auth_data_->current_user
                       .GetTokenInternal(true, kInternalFn_GetTokenForRefresher);
@@ -875,15 +873,17 @@ void IdTokenRefreshThread::Initialize(AuthData* auth_data) {
                 if (refresh_thread->ref_count_ <= 0) break;
               }
 
-              ms_since_last_refresh =
-                  internal::GetTimestampEpoch() -
-                  refresh_thread->token_refresh_listener_.GetTokenTimestamp();
+              // Wait at least kMsMinTokenRefreshInterval, so a failed refresh
+              // is not retried immediately.
+              int64_t wait_ms =
+                  std::max(refresh_thread->MsUntilRefresh(),
+                           static_cast<int64_t>(kMsMinTokenRefreshInterval));
 
               // If the timed-wait returns true, then it means we were
               // interrupted early - either it's time to shut down, or we
               // got a new token and should restart the clock.
               if (!refresh_thread->wakeup_sem_.TimedWait(
-                      kMsPerTokenRefresh - ms_since_last_refresh)) {
+                      static_cast<int>(wait_ms))) {
                 break;
               }
             }
@@ -902,6 +902,27 @@ void IdTokenRefreshThread::Initialize(AuthData* auth_data) {
       this);
 }
 
+int64_t IdTokenRefreshThread::MsUntilRefresh() {
+  int64_t ms_until_refresh =
+      kMsPerTokenRefresh -
+      static_cast<int64_t>(internal::GetTimestampEpoch() -
+                           token_refresh_listener_.GetTokenTimestamp());
+  // Refresh earlier if the token expires sooner, e.g. a token loaded from
+  // disk at startup.
+  UserView::TryRead(auth->auth_data_, [&](const UserView::Reader& user) {
+    if (user->id_token.empty() || user->access_token_expiration_date <= 0) {
+      return;
+    }
+    int64_t ms_until_stale =
+        (static_cast<int64_t>(user->access_token_expiration_date) -
+         static_cast<int64_t>(std::time(nullptr)) -
+         kMinutesTokenRefreshBeforeExpiry * internal::kSecondsPerMinute) *
+        internal::kMillisecondsPerSecond;
+    ms_until_refresh = std::min(ms_until_refresh, ms_until_stale);
+  });
+  return ms_until_refresh;
+}
+
 // Only called by the system, when it's time to shut down the thread.
 // Should only be used by the Auth object, on destruction.
 void IdTokenRefreshThread::Destroy() {
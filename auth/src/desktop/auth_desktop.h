@@ -16,6 +16,8 @@
 #define FIREBASE_AUTH_SRC_DESKTOP_AUTH_DESKTOP_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "app/rest/request.h"
 #include "app/src/scheduler.h"
@@ -23,6 +25,7 @@
 #include "app/src/thread.h"
 #include "app/src/time.h"
 #include "auth/src/data.h"
+#include "auth/src/desktop/promise.h"
 #include "auth/src/desktop/user_desktop.h"
 #include "auth/src/include/firebase/auth.h"
 #include "auth/src/include/firebase/auth/credential.h"
@@ -84,6 +87,12 @@ class IdTokenRefreshThread {
   }
 
  private:
+  friend class UserDesktopTest;
+
+  // Returns how long until the token should be refreshed: kMsPerTokenRefresh
+  // after the last refresh, or earlier if the token expires before that.
+  int64_t MsUntilRefresh();
+
   int ref_count_;
   bool is_shutting_down_;
 
@@ -181,6 +190,12 @@ struct AuthImpl {
   // Serializes all REST call from this object.
   scheduler::Scheduler scheduler_;
 
+  // Promises of GetToken() calls waiting for the token refresh in flight.
+  // Concurrent calls share a single refresh, whose result completes all of
+  // them. Protected by AuthData::future_impl.mutex(), since copying a Promise
+  // acquires it anyway.
+  std::vector<Promise<std::string>> token_refresh_waiters;
+
   // Synchronization primative for tracking sate of FederatedAuth futures.
   Mutex provider_mutex;
 
@@ -198,6 +213,14 @@ const int kMinutesPerTokenRefresh = 58;
 const int kMsPerTokenRefresh =
     kMinutesPerTokenRefresh * internal::kMillisecondsPerMinute;
 
+// GetToken() refreshes tokens that expire within 5 minutes, so the refresh
+// thread refreshes them a minute before that, sparing callers the wait.
+const int kMinutesTokenRefreshBeforeExpiry = 6;
+
+// Minimum time between refreshes by the refresh thread, e.g. after a refresh
+// failed.
+const int kMsMinTokenRefreshInterval = internal::kMillisecondsPerMinute;
+
 void InitializeUserDataPersist(AuthData* auth_data);
 void DestroyUserDataPersist(AuthData* auth_data);
 void LoadFinishTriggerListeners(AuthData* auth_data);
@@ -17,6 +17,7 @@
 #include <fstream>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "app/rest/transport_builder.h"
 #include "app/rest/util.h"
@@ -838,21 +839,42 @@ Future<std::string> User::GetTokenInternal(const bool force_refresh,
     return promise.future();
   }
 
-  const auto callback =
-      [](AuthDataHandle<std::string, rest::Request>* const handle) {
+  // Wait for the refresh in flight if there is one, rather than sending
+  // another request for a new token.
+  auto auth_impl = static_cast<AuthImpl*>(auth_data_->auth_impl);
+  {
+    MutexLock lock(auth_data_->future_impl.mutex());
+    auth_impl->token_refresh_waiters.push_back(promise);
+    if (auth_impl->token_refresh_waiters.size() > 1) {
+      return promise.future();
+    }
+  }
+
+  auto scheduler_callback = NewCallback(
+      [](AuthData* callback_auth_data) {
         const GetTokenResult get_token_result =
-            EnsureFreshToken(handle->auth_data, true);
-        if (!get_token_result.IsValid()) {
-          FailPromise(&handle->promise, get_token_result.error());
-          return;
+            EnsureFreshToken(callback_auth_data, true);
+
+        // Calls made while the request was in flight share its result.
+        auto callback_auth_impl =
+            static_cast<AuthImpl*>(callback_auth_data->auth_impl);
+        std::vector<Promise<std::string>> waiters;
+        {
+          MutexLock lock(callback_auth_data->future_impl.mutex());
+          waiters.swap(callback_auth_impl->token_refresh_waiters);
         }
+        for (auto& waiter : waiters) {
+          if (get_token_result.IsValid()) {
+            waiter.CompleteWithResult(get_token_result.token());
+          } else {
+            FailPromise(&waiter, get_token_result.error());
+          }
+        }
+      },
+      auth_data_);
+  auth_impl->scheduler_.Schedule(scheduler_callback);
 
-        handle->promise.CompleteWithResult(get_token_result.token());
-      };
-
-  // Note: request is deliberately null because EnsureFreshToken will create it.
-  return CallAsync(auth_data_, promise, std::unique_ptr<rest::Request>(),
-                   callback);
+  return promise.future();
 }
 
 Future<void> User::Delete() {
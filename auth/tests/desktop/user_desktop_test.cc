@@ -14,13 +14,19 @@
 
 #include "auth/src/desktop/user_desktop.h"
 
+#include <cstring>
+#include <ctime>
+
 #include "app/rest/transport_builder.h"
 #include "app/rest/transport_curl.h"
 #include "app/rest/transport_mock.h"
 #include "app/src/include/firebase/app.h"
 #include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/semaphore.h"
+#include "app/src/time.h"
 #include "app/tests/include/firebase/app_for_testing.h"
 #include "auth/src/desktop/auth_desktop.h"
+#include "auth/src/desktop/user_view.h"
 #include "auth/src/include/firebase/auth.h"
 #include "auth/src/include/firebase/auth/user.h"
 #include "auth/tests/desktop/fakes.h"
@@ -246,6 +252,37 @@ bool WaitOnLoadPersistence(AuthData* auth_data) {
   return load_finished;
 }
 
+const char* const kSecureTokenUrl =
+    "https://securetoken.googleapis.com/v1/token";
+
+// Requests sent to the SecureToken API by SecureTokenTransport.
+Mutex g_secure_token_requests_mutex;
+int g_secure_token_requests = 0;
+// Posted when SecureTokenTransport receives a request, which it then holds
+// until g_secure_token_response_allowed is posted.
+Semaphore g_secure_token_request_received(0);
+Semaphore g_secure_token_response_allowed(0);
+
+// TransportMock that counts the requests sent to the SecureToken API and
+// holds each of them until the test allows a response.
+class SecureTokenTransport : public rest::TransportMock {
+ public:
+  void PerformInternal(
+      rest::Request* request, rest::Response* response,
+      flatbuffers::unique_ptr<rest::Controller>* controller_out) override {
+    if (request->options().url.compare(0, strlen(kSecureTokenUrl),
+                                       kSecureTokenUrl) == 0) {
+      {
+        MutexLock lock(g_secure_token_requests_mutex);
+        g_secure_token_requests++;
+      }
+      g_secure_token_request_received.Post();
+      g_secure_token_response_allowed.Wait();
+    }
+    rest::TransportMock::PerformInternal(request, response, controller_out);
+  }
+};
+
 }  // namespace
 
 class UserDesktopTest : public ::testing::Test {
@@ -307,6 +344,22 @@ class UserDesktopTest : public ::testing::Test {
     firebase::testing::cppsdk::ConfigReset();
   }
 
+  // Sets when the access token of the current user expires, in seconds since
+  // the epoch.
+  void SetAccessTokenExpirationDate(int64_t expiration_date) {
+    UserView::Writer user = UserView::GetWriter(firebase_auth_->auth_data_);
+    ASSERT_TRUE(user.IsValid());
+    user->access_token_expiration_date = expiration_date;
+  }
+
+  // Returns how long the token refresh thread waits before refreshing the
+  // token of the current user.
+  int64_t MsUntilRefresh() {
+    auto auth_impl =
+        static_cast<AuthImpl*>(firebase_auth_->auth_data_->auth_impl);
+    return auth_impl->token_refresh_thread.MsUntilRefresh();
+  }
+
   Future<SignInResult> ProcessLinkWithProviderFlow(
       FederatedOAuthProvider* provider, OAuthProviderTestHandler* handler,
       bool trigger_link) {
@@ -382,6 +435,65 @@ TEST_F(UserDesktopTest, TestGetToken) {
   EXPECT_EQ("new idtoken123", new_token);
 }
 
+TEST_F(UserDesktopTest, TestGetTokenConcurrentRefreshes) {
+  rest::SetTransportBuilder([]() -> flatbuffers::unique_ptr<rest::Transport> {
+    return flatbuffers::unique_ptr<rest::Transport>(new SecureTokenTransport());
+  });
+  {
+    MutexLock lock(g_secure_token_requests_mutex);
+    g_secure_token_requests = 0;
+  }
+  const auto api_url = std::string(kSecureTokenUrl) + "?key=" + API_KEY;
+  InitializeConfigWithAFake(
+      api_url,
+      FakeSuccessfulResponse("\"access_token\": \"new accesstoken123\","
+                             "\"expires_in\": \"3600\","
+                             "\"token_type\": \"Bearer\","
+                             "\"refresh_token\": \"new refreshtoken123\","
+                             "\"id_token\": \"new idtoken123\","
+                             "\"user_id\": \"localid123\","
+                             "\"project_id\": \"53101460582\""));
+
+  id_token_listener.ExpectChanges(1);
+  auth_state_listener.ExpectChanges(0);
+
+  // Calls made while a refresh is in flight all get its token, without
+  // sending another request.
+  Future<std::string> first = firebase_user_->GetToken(true);
+  g_secure_token_request_received.Wait();
+  Future<std::string> second = firebase_user_->GetToken(true);
+  EXPECT_EQ(kFutureStatusPending, second.status());
+  g_secure_token_response_allowed.Post();
+  EXPECT_EQ("new idtoken123", WaitForFuture(first));
+  EXPECT_EQ("new idtoken123", WaitForFuture(second));
+  {
+    MutexLock lock(g_secure_token_requests_mutex);
+    EXPECT_EQ(1, g_secure_token_requests);
+  }
+}
+
+TEST_F(UserDesktopTest, TestTokenRefreshedBeforeExpiry) {
+  const int64_t kToleranceMs = 10 * internal::kMillisecondsPerSecond;
+
+  // A token that expires in 10 minutes is refreshed 6 minutes before it
+  // expires.
+  SetAccessTokenExpirationDate(std::time(nullptr) + 10 * 60);
+  int64_t ms_until_refresh = MsUntilRefresh();
+  EXPECT_LE(ms_until_refresh, 4 * internal::kMillisecondsPerMinute);
+  EXPECT_GT(ms_until_refresh,
+            4 * internal::kMillisecondsPerMinute - kToleranceMs);
+
+  // A token that expires within 6 minutes is refreshed right away.
+  SetAccessTokenExpirationDate(std::time(nullptr) + 5 * 60);
+  EXPECT_LE(MsUntilRefresh(), 0);
+
+  // Otherwise the token is refreshed kMsPerTokenRefresh after it was fetched.
+  SetAccessTokenExpirationDate(std::time(nullptr) + 24 * 60 * 60);
+  ms_until_refresh = MsUntilRefresh();
+  EXPECT_LE(ms_until_refresh, kMsPerTokenRefresh);
+  EXPECT_GT(ms_until_refresh, kMsPerTokenRefresh - kToleranceMs);
+}
+
 TEST_F(UserDesktopTest, TestDelete) {
   InitializeConfigWithAFake(
       GetUrlForApi(API_KEY, "deleteAccount"),
@@ -20,10 +20,12 @@ include(CMakeParseArguments)
 #   DEPENDS libraries...
 #   INCLUDES include directories...
 #   DEFINES definitions...
+#   [MANUAL]
 # )
 #
 # Defines a new test executable target with the given target name, sources, and
-# dependencies.  Implicitly adds DEPENDS on gtest and gtest_main.
+# dependencies.  Implicitly adds DEPENDS on gtest and gtest_main.  MANUAL builds
+# the executable without adding it to ctest, e.g. for benchmarks run by hand.
 function(firebase_cpp_cc_test name)
   if (ANDROID OR IOS)
     return()
@@ -31,7 +33,7 @@ function(firebase_cpp_cc_test name)
 
   set(multi DEPENDS SOURCES INCLUDES DEFINES)
   # Parse the arguments into cc_test_SOURCES, ..._DEPENDS, etc.
-  cmake_parse_arguments(cc_test "" "" "${multi}" ${ARGN})
+  cmake_parse_arguments(cc_test "MANUAL" "" "${multi}" ${ARGN})
 
   list(APPEND cc_test_DEPENDS gmock gtest gtest_main)
 
@@ -44,7 +46,9 @@ function(firebase_cpp_cc_test name)
   endif()
 
   add_executable(${name} ${cc_test_SOURCES})
-  add_test(${name} ${name})
+  if(NOT cc_test_MANUAL)
+    add_test(${name} ${name})
+  endif()
   target_include_directories(${name}
     PRIVATE
       ${FIREBASE_SOURCE_DIR}
@@ -71,6 +71,12 @@ class DatabaseInternal {
 
   void SetPersistenceEnabled(bool enabled) const;
 
+  // Not supported on Android, all the work is done by the Java SDK.
+  static void set_scheduler_pool_size(size_t /*size*/) {}
+
+  // Not supported on Android, all the work is done by the Java SDK.
+  void set_write_batching(int /*window_ms*/, size_t /*max_writes*/) {}
+
   // Set the logging verbosity.
   // kLogLevelDebug and kLogLevelVerbose are interpreted as the same level by
   // the Android implementation.
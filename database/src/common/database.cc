@@ -196,6 +196,14 @@ void Database::set_persistence_enabled(bool enabled) {
   if (internal_) internal_->SetPersistenceEnabled(enabled);
 }
 
+void Database::set_scheduler_pool_size(size_t size) {
+  DatabaseInternal::set_scheduler_pool_size(size);
+}
+
+void Database::set_write_batching(int window_ms, size_t max_writes) {
+  if (internal_) internal_->set_write_batching(window_ms, max_writes);
+}
+
 void Database::set_log_level(LogLevel log_level) {
   if (internal_) internal_->set_log_level(log_level);
 }
@@ -14,9 +14,13 @@
 
 #include "database/src/desktop/connection/connection.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <sstream>
 #include <string>
+#include <utility>
 
 #include "app/src/assert.h"
 #include "app/src/log.h"
@@ -32,6 +36,8 @@ namespace connection {
 const int Connection::kKeepAliveTimeoutMs = 45 * 1000;  // 45 seconds
 const int Connection::kConnectTimeoutMs = 30 * 1000;    // 30 seconds
 const int Connection::kMaxFrameSize = 16384;
+const size_t Connection::kMaxRetainedSendBufferSize = 1024 * 1024;
+const size_t Connection::kMaxIncomingBufferReserve = 1024 * 1024;
 
 const char* const Connection::kRequestType = "t";
 const char* const Connection::kRequestTypeData = "d";
@@ -143,32 +149,52 @@ void Connection::Send(const Variant& message, bool is_sensitive) {
     return;
   }
 
-  // Wrap into Firebase wire protocol Data Message format
-  Variant request = Variant::EmptyMap();
-  request.map()[kRequestType] = kRequestTypeData;
-  request.map()[kRequestPayload] = message;
-
-  std::string to_send = util::VariantToJson(request);
+  // Wrap into Firebase wire protocol Data Message format. The envelope is
+  // written directly into the reused send buffer rather than copying the
+  // message into a new Variant.
+  send_buffer_.clear();
+  send_buffer_.append("{\"");
+  send_buffer_.append(kRequestType);
+  send_buffer_.append("\":\"");
+  send_buffer_.append(kRequestTypeData);
+  send_buffer_.append("\",\"");
+  send_buffer_.append(kRequestPayload);
+  send_buffer_.append("\":");
+  if (!util::AppendVariantToJson(message, &send_buffer_)) {
+    logger_->LogError("%s Unable to convert message to JSON",
+                      log_id_.c_str());
+    return;
+  }
+  send_buffer_.push_back('}');
   logger_->LogDebug("%s Sending data: %s", log_id_.c_str(),
-                    is_sensitive ? "(contents hidden)" : to_send.c_str());
+                    is_sensitive ? "(contents hidden)" : send_buffer_.c_str());
 
   // Split info frames if the length is larger than kMaxFrameSize
-  int num_of_frame = to_send.length() / kMaxFrameSize + 1;
+  size_t length = send_buffer_.length();
+  int num_of_frame = static_cast<int>(length / kMaxFrameSize + 1);
   if (num_of_frame > 1) {
     logger_->LogDebug("%s Split data into %d frames (size: %d)",
-                      log_id_.c_str(), num_of_frame, to_send.length());
+                      log_id_.c_str(), num_of_frame, static_cast<int>(length));
 
     // Send number of frames
-    std::stringstream frame_size_str;
-    frame_size_str << num_of_frame;
-    client_->Send(frame_size_str.str().c_str());
-
-    // Send individual frame
-    for (int i = 0; i < to_send.length(); i += kMaxFrameSize) {
-      client_->Send(to_send.substr(i, kMaxFrameSize).c_str());
+    char frame_count[16];
+    int frame_count_length =
+        snprintf(frame_count, sizeof(frame_count), "%d", num_of_frame);
+    client_->Send(frame_count, frame_count_length);
+
+    // Send individual frames straight from the buffer.
+    const char* data = send_buffer_.data();
+    for (size_t i = 0; i < length; i += kMaxFrameSize) {
+      client_->Send(data + i, (std::min)(length - i,
+                                         static_cast<size_t>(kMaxFrameSize)));
     }
   } else {
-    client_->Send(to_send.c_str());
+    client_->Send(send_buffer_.data(), length);
+  }
+
+  // Don't hold on to memory used by an unusually large message.
+  if (send_buffer_.capacity() > kMaxRetainedSendBufferSize) {
+    std::string().swap(send_buffer_);
   }
 }
 
@@ -191,18 +217,18 @@ void Connection::OnOpen() {
             auto connection = lock.GetReference();
             if (connection != nullptr && connection->client_ &&
                 connection->state_ == kStateReady) {
-              connection->client_->Send("0");
+              connection->client_->Send("0", 1);
             }
           }),
       kKeepAliveTimeoutMs, kKeepAliveTimeoutMs);
 }
 
-void Connection::OnMessage(const char* msg) {
+void Connection::OnMessage(std::string&& msg) {
   SAFE_REFERENCE_RETURN_VOID_IF_INVALID(ConnectionRefLock, lock, safe_this_);
 
   logger_->LogDebug("%s websocket message received", log_id_.c_str());
 
-  HandleIncomingFrame(msg);
+  HandleIncomingFrame(std::move(msg));
 }
 
 void Connection::OnClose() {
@@ -243,7 +269,7 @@ void Connection::OnError(const WebSocketClientErrorData& error_data) {
       }));
 }
 
-void Connection::HandleIncomingFrame(const char* msg) {
+void Connection::HandleIncomingFrame(std::string&& frame) {
   if (state_ == kStateDisconnected) {
     return;
   }
@@ -253,24 +279,37 @@ void Connection::HandleIncomingFrame(const char* msg) {
   // message is a number, this indicate how many frames to be expected in the
   // future.
   if (expected_incoming_frames_ > 0) {
-    // Add msg to buffer
-    incoming_buffer_ << msg;
+    // Frames other than the last one are the same size, so reserve the size
+    // of the whole message when the first frame arrives. The frame count
+    // comes from the server, so cap the reservation and let larger messages
+    // grow the buffer as their frames arrive.
+    if (incoming_buffer_.empty()) {
+      incoming_buffer_.reserve(
+          std::min(frame.size() * expected_incoming_frames_,
+                   kMaxIncomingBufferReserve));
+    }
+    // Add frame to buffer
+    incoming_buffer_.append(frame);
     --expected_incoming_frames_;
 
     logger_->LogDebug("%s Received a frame (length: %d), %d more to come",
-                      log_id_.c_str(), strlen(msg), expected_incoming_frames_);
+                      log_id_.c_str(), static_cast<int>(frame.size()),
+                      expected_incoming_frames_);
 
-    // If buffer is complete, process it
+    // If buffer is complete, process it.  Move the message out of the buffer
+    // so its memory is released once processed.
     if (expected_incoming_frames_ == 0) {
-      ProcessMessage(incoming_buffer_.str().c_str());
+      std::string message;
+      message.swap(incoming_buffer_);
+      ProcessMessage(message);
     }
   } else {
     uint32_t num_of_frame = 0;
     // The server is only supposed to send up to 9999 frames (i.e. length
     // <= 4), but that isn't being enforced currently.  So allowing larger frame
     // counts (length <= 6).
-    if (std::strlen(msg) <= 6) {
-      int32_t parse_value = strtol(msg, nullptr, 10);  // NOLINT
+    if (frame.size() <= 6) {
+      int32_t parse_value = strtol(frame.c_str(), nullptr, 10);  // NOLINT
       if (parse_value > 0) {
         num_of_frame = parse_value;
       }
@@ -282,18 +321,19 @@ void Connection::HandleIncomingFrame(const char* msg) {
 
       // Start the buffer
       expected_incoming_frames_ = num_of_frame;
-      incoming_buffer_.str("");
+      incoming_buffer_.clear();
     } else {
       // Process it
-      ProcessMessage(msg);
+      ProcessMessage(frame);
     }
   }
 }
 
-void Connection::ProcessMessage(const char* message) {
-  Variant message_data = util::JsonToVariant(message);
+void Connection::ProcessMessage(const std::string& message) {
+  Variant message_data =
+      util::JsonToVariant(message.c_str(), message.size());
   logger_->LogDebug("%s ProcessMessage (length: %d)", log_id_.c_str(),
-                    strlen(message));
+                    static_cast<int>(message.size()));
 
   FIREBASE_DEV_ASSERT(!message_data.is_null());
 
@@ -15,7 +15,7 @@
 #ifndef FIREBASE_DATABASE_SRC_DESKTOP_CONNECTION_CONNECTION_H_
 #define FIREBASE_DATABASE_SRC_DESKTOP_CONNECTION_CONNECTION_H_
 
-#include <sstream>
+#include <string>
 
 #include "app/memory/atomic.h"
 #include "app/memory/unique_ptr.h"
@@ -100,7 +100,7 @@ class Connection : public WebSocketClientEventHandler {
 
   // BEGIN WebSocketClientEventHandler
   void OnOpen() override;
-  void OnMessage(const char* msg) override;
+  void OnMessage(std::string&& msg) override;
   void OnClose() override;
   void OnError(const WebSocketClientErrorData& error_data) override;
   // END WebSocketClientEventHandler
@@ -125,10 +125,10 @@ class Connection : public WebSocketClientEventHandler {
   };
 
   // Combine incoming frames into one message, if the message is too large
-  void HandleIncomingFrame(const char* msg);
+  void HandleIncomingFrame(std::string&& frame);
 
   // Parse the message into data message or control message
-  void ProcessMessage(const char* message);
+  void ProcessMessage(const std::string& message);
 
   // Forward the data message to higher-level
   void OnDataMessage(const Variant& data);
@@ -158,6 +158,12 @@ class Connection : public WebSocketClientEventHandler {
   // Maximum size of a frame for outgoing message
   static const int kMaxFrameSize;
 
+  // Largest capacity kept by send_buffer_ between messages
+  static const size_t kMaxRetainedSendBufferSize;
+
+  // Largest capacity reserved up front for a message split into frames
+  static const size_t kMaxIncomingBufferReserve;
+
   // Wire protocol keys and values
   static const char* const kRequestType;
   static const char* const kRequestTypeData;
@@ -211,8 +217,12 @@ class Connection : public WebSocketClientEventHandler {
   // to access in scheduler thread.
   scheduler::RequestHandle keep_alive_handler_;
 
-  // Incoming message buffer
-  std::stringstream incoming_buffer_;
+  // Buffer reused to serialize outgoing messages.  Only safe to access in
+  // scheduler thread.
+  std::string send_buffer_;
+
+  // Buffer to combine the frames of a message split into multiple frames.
+  std::string incoming_buffer_;
   uint32_t expected_incoming_frames_;
 
   Logger* logger_;
@@ -15,6 +15,7 @@
 #include "database/src/desktop/connection/persistent_connection.h"
 
 #include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "app/src/app_common.h"
@@ -116,6 +117,9 @@ PersistentConnection::PersistentConnection(
       force_auth_refresh_(false),
       next_listen_id_(0),
       next_write_id_(0),
+      write_batch_window_ms_(0),
+      write_batch_max_size_(0),
+      next_write_batch_id_(0),
       logger_(logger) {
   FIREBASE_DEV_ASSERT(app);
   FIREBASE_DEV_ASSERT(scheduler);
@@ -304,6 +308,11 @@ void PersistentConnection::OnDisconnect(Connection::DisconnectReason reason) {
   realtime_.reset(nullptr);
 
   request_map_.clear();
+  sent_write_batches_.clear();
+
+  // Writes not sent yet are sent again once connected.
+  if (write_batch_flush_handle_.IsValid()) write_batch_flush_handle_.Cancel();
+  write_batch_.Clear();
 
   // TODO(chkuang): Implement Idle Check
   // this.hasOnDisconnects = false;
@@ -413,7 +422,18 @@ void PersistentConnection::Merge(const Path& path, const Variant& data,
   PutInternal(kRequestActionMerge, path, data, nullptr, Move(response));
 }
 
+void PersistentConnection::SetWriteBatching(int window_ms,
+                                            size_t max_writes) {
+  FlushWriteBatch();
+  write_batch_window_ms_ = window_ms;
+  write_batch_max_size_ = max_writes;
+}
+
 void PersistentConnection::PurgeOutstandingWrites(Error error) {
+  // Purge writes waiting to be sent together
+  if (write_batch_flush_handle_.IsValid()) write_batch_flush_handle_.Cancel();
+  write_batch_.Clear();
+
   // Purge outstanding put requests
   for (auto& put : outstanding_puts_) {
     TriggerResponse(put.second->response, error, GetErrorMessage(error));
@@ -930,7 +950,7 @@ void PersistentConnection::PutInternal(const char* action, const Path& path,
       MakeUnique<OutstandingPut>(action, request, response);
 
   if (CanSendWrites()) {
-    SendPut(write_id);
+    BatchPut(write_id);
   }
 }
 
@@ -946,6 +966,100 @@ void PersistentConnection::SendPut(uint64_t write_id) {
                 &PersistentConnection::HandlePutResponse, write_id);
 }
 
+void PersistentConnection::BatchPut(uint64_t write_id) {
+  FIREBASE_DEV_ASSERT(CanSendWrites());
+
+  auto it_put = outstanding_puts_.find(write_id);
+  FIREBASE_DEV_ASSERT(it_put != outstanding_puts_.end());
+
+  const OutstandingPut& put = *it_put->second;
+  const auto& request = put.data.map();
+  if (write_batch_window_ms_ <= 0 || write_batch_max_size_ <= 1 ||
+      request.find(kRequestDataHash) != request.end()) {
+    // Send the pending writes first to keep the writes in order.
+    FlushWriteBatch();
+    SendPut(write_id);
+    return;
+  }
+
+  Path path(request.find(kRequestPath)->second.string_value());
+  const Variant& data = request.find(kRequestDataPayload)->second;
+  bool is_merge = put.action == kRequestActionMerge;
+  if (!write_batch_.Add(write_id, path, data, is_merge)) {
+    FlushWriteBatch();
+    if (!write_batch_.Add(write_id, path, data, is_merge)) {
+      SendPut(write_id);
+      return;
+    }
+  }
+
+  if (write_batch_.size() >= write_batch_max_size_) {
+    FlushWriteBatch();
+  } else if (write_batch_.size() == 1) {
+    write_batch_flush_handle_ = scheduler_->Schedule(
+        new callback::CallbackValue1<ThisRef>(
+            safe_this_,
+            [](ThisRef ref) {
+              ThisRefLock lock(&ref);
+              auto* connection = lock.GetReference();
+              if (!connection) return;
+              // This request is running, cancelling it would deadlock.
+              connection->write_batch_flush_handle_ =
+                  scheduler::RequestHandle();
+              connection->FlushWriteBatch();
+            }),
+        write_batch_window_ms_);
+  }
+}
+
+void PersistentConnection::FlushWriteBatch() {
+  if (write_batch_flush_handle_.IsValid()) write_batch_flush_handle_.Cancel();
+  if (write_batch_.empty()) return;
+
+  if (write_batch_.size() == 1) {
+    SendPut(write_batch_.write_ids().front());
+    write_batch_.Clear();
+    return;
+  }
+
+  Path path;
+  Variant update;
+  write_batch_.GetUpdate(&path, &update);
+  Variant request = Variant::EmptyMap();
+  request.map()[kRequestPath] = path.str();
+  request.map()[kRequestDataPayload] = update;
+
+  uint64_t batch_id = next_write_batch_id_++;
+  for (uint64_t write_id : write_batch_.write_ids()) {
+    auto it_put = outstanding_puts_.find(write_id);
+    FIREBASE_DEV_ASSERT(it_put != outstanding_puts_.end());
+    it_put->second->MarkSent();
+  }
+  sent_write_batches_[batch_id] = write_batch_.write_ids();
+  logger_->LogDebug("%s Sending %d writes as one update", log_id_.c_str(),
+                    static_cast<int>(write_batch_.size()));
+  write_batch_.Clear();
+
+  SendSensitive(kRequestActionMerge, false, request, ResponsePtr(),
+                &PersistentConnection::HandleWriteBatchResponse, batch_id);
+}
+
+void PersistentConnection::HandleWriteBatchResponse(const Variant& message,
+                                                    const ResponsePtr& response,
+                                                    uint64_t batch_id) {
+  auto it_batch = sent_write_batches_.find(batch_id);
+  if (it_batch == sent_write_batches_.end()) return;
+  std::vector<uint64_t> write_ids = Move(it_batch->second);
+  sent_write_batches_.erase(it_batch);
+
+  for (uint64_t write_id : write_ids) {
+    auto it_put = outstanding_puts_.find(write_id);
+    if (it_put == outstanding_puts_.end()) continue;
+    ResponsePtr put_response = it_put->second->response;
+    HandlePutResponse(message, put_response, write_id);
+  }
+}
+
 void PersistentConnection::HandlePutResponse(const Variant& message,
                                              const ResponsePtr& response,
                                              uint64_t outstanding_id) {
@@ -1022,6 +1136,14 @@ void PersistentConnection::SendSensitive(const char* action, bool sensitive,
                                          uint64_t outstanding_id) {
   FIREBASE_DEV_ASSERT(realtime_);
 
+  // Send the writes waiting to be batched before any other request, so that
+  // they are not reordered past it, e.g. sent under the credentials of a later
+  // auth request.
+  if (strcmp(action, kRequestActionPut) != 0 &&
+      strcmp(action, kRequestActionMerge) != 0) {
+    FlushWriteBatch();
+  }
+
   // Varient only accept int64_t
   int64_t rn = ++next_request_id_;
   Variant request = Variant::EmptyMap();
@@ -1049,8 +1171,9 @@ void PersistentConnection::RestoreOutstandingRequests() {
 
   // Restore puts
   for (auto& it_put : outstanding_puts_) {
-    SendPut(it_put.first);
+    BatchPut(it_put.first);
   }
+  FlushWriteBatch();
 
   // Restore disconnect operations
   while (!outstanding_ondisconnects_.empty()) {
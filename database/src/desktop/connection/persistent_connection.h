@@ -35,6 +35,7 @@
 #include "database/src/common/query_spec.h"
 #include "database/src/desktop/connection/connection.h"
 #include "database/src/desktop/connection/host_info.h"
+#include "database/src/desktop/connection/write_batch.h"
 #include "database/src/desktop/core/tag.h"
 #include "database/src/include/firebase/database/common.h"
 
@@ -153,6 +154,15 @@ class PersistentConnection : public ConnectionEventHandler {
   // This should only be called from scheduler thread.
   void Merge(const Path& path, const Variant& data, ResponsePtr response);
 
+  // Combine the puts and merges issued within window_ms of the first one, up
+  // to max_writes of them, into a single update when the locations they change
+  // do not overlap.  The response of each write is still triggered, but the
+  // writes combined into an update succeed or fail together, ex. if security
+  // rules reject one of them.  Compare-and-put requests are never combined.
+  // Disabled when window_ms is 0, which is the default.
+  // This should only be called from scheduler thread.
+  void SetWriteBatching(int window_ms, size_t max_writes);
+
   // Purge all outstanding Put/Merge/OnDisconnectPut/OnDisconnectMerge requests.
   // All response callback will be triggered with the given error code.
   // This should only be called from scheduler thread.
@@ -384,6 +394,19 @@ class PersistentConnection : public ConnectionEventHandler {
 
   void SendPut(uint64_t write_id);
 
+  // Add the write to write_batch_ if write batching is enabled and the write
+  // can be combined.  Otherwise, send the pending batch and then the write.
+  void BatchPut(uint64_t write_id);
+
+  // Send the writes in write_batch_ as a single update.
+  void FlushWriteBatch();
+
+  // Trigger the response of every write in the update sent by
+  // FlushWriteBatch().
+  void HandleWriteBatchResponse(const Variant& message,
+                                const ResponsePtr& response,
+                                uint64_t batch_id);
+
   void HandlePutResponse(const Variant& message, const ResponsePtr& response,
                          uint64_t outstanding_id);
 
@@ -566,6 +589,22 @@ class PersistentConnection : public ConnectionEventHandler {
   // Next write id for put requests
   uint64_t next_write_id_;
 
+  // Write batching options.  See SetWriteBatching().
+  int write_batch_window_ms_;
+  size_t write_batch_max_size_;
+
+  // Writes waiting to be sent together, and the request to send them once
+  // the window ends.
+  WriteBatch write_batch_;
+  scheduler::RequestHandle write_batch_flush_handle_;
+
+  // Ids of the writes combined into each update waiting for a response, by
+  // batch id.
+  std::map<uint64_t, std::vector<uint64_t>> sent_write_batches_;
+
+  // Next batch id for combined updates
+  uint64_t next_write_batch_id_;
+
   Logger* logger_;
 };
 
@@ -23,16 +23,26 @@ namespace database {
 namespace internal {
 namespace connection {
 
+static WebSocketClientFactory g_web_socket_client_factory = nullptr;
+
 UniquePtr<WebSocketClientInterface> CreateWebSocketClient(
     const HostInfo& info, WebSocketClientEventHandler* delegate,
     const char* opt_last_session_id, Logger* logger,
     scheduler::Scheduler* scheduler, const std::string& app_check_token) {
+  if (g_web_socket_client_factory) {
+    return g_web_socket_client_factory(info, delegate, opt_last_session_id,
+                                       logger, scheduler, app_check_token);
+  }
   // Currently we use uWebSockets implementation.
   std::string uri = info.GetConnectionUrl(opt_last_session_id);
   return MakeUnique<WebSocketClientImpl>(uri, info.user_agent(), logger,
                                          scheduler, app_check_token, delegate);
 }
 
+void SetWebSocketClientFactory(WebSocketClientFactory factory) {
+  g_web_socket_client_factory = factory;
+}
+
 }  // namespace connection
 }  // namespace internal
 }  // namespace database
@@ -35,6 +35,17 @@ UniquePtr<WebSocketClientInterface> CreateWebSocketClient(
     const char* opt_last_session_id, Logger* logger,
     scheduler::Scheduler* scheduler, const std::string& app_check_token);
 
+// Function with the signature of CreateWebSocketClient().
+typedef UniquePtr<WebSocketClientInterface> (*WebSocketClientFactory)(
+    const HostInfo& info, WebSocketClientEventHandler* delegate,
+    const char* opt_last_session_id, Logger* logger,
+    scheduler::Scheduler* scheduler, const std::string& app_check_token);
+
+// Make CreateWebSocketClient() call the given factory instead of creating a
+// uWebSockets client, or restore the default if factory is nullptr.  Use this
+// for testing, to stub the connection to the server.
+void SetWebSocketClientFactory(WebSocketClientFactory factory);
+
 }  // namespace connection
 }  // namespace internal
 }  // namespace database
@@ -16,13 +16,12 @@
 
 #include <cassert>
 #include <map>
+#include <utility>
 
 #include "app/src/app_common.h"
 #include "app/src/assert.h"
 #include "app/src/include/firebase/app.h"
-#include "app/src/include/firebase/internal/mutex.h"
 #include "app/src/log.h"
-#include "app/src/thread.h"
 
 namespace firebase {
 namespace database {
@@ -35,65 +34,30 @@ WebSocketClientImpl::WebSocketClientImpl(
     WebSocketClientEventHandler* handler /*=nullptr*/)
     : uri_(uri),
       handler_(handler),
-      thread_(nullptr),
-      hub_(),
-      keep_loop_alive_(nullptr),
-      process_queue_async_(nullptr),
-      callback_queue_(),
-      callback_queue_mutex_(Mutex::kModeNonRecursive),
+      event_loop_(nullptr),
       is_destructing_(0),
       websocket_(nullptr),
+      outgoing_messages_(),
+      is_flush_scheduled_(false),
+      outgoing_mutex_(Mutex::kModeNonRecursive),
+      sending_messages_(),
+      is_connecting_(false),
+      closed_(0),
       user_agent_(user_agent),
       logger_(logger),
       scheduler_(scheduler),
       safe_this_(this),
       app_check_token_(app_check_token) {
-  // Bind callback function
-  hub_.onError(WebSocketClientImpl::OnError);
-  hub_.onConnection(WebSocketClientImpl::OnConnection);
-  hub_.onMessage(WebSocketClientImpl::OnMessage);
-  hub_.onDisconnection(WebSocketClientImpl::OnDisconnection);
-
-  // Create a async object to keep the loop alive and close all async handler
-  // during destruction.
-  keep_loop_alive_ = new uS::Async(hub_.getLoop());
-  keep_loop_alive_->setData(this);
-  keep_loop_alive_->start([](uS::Async* async) {
-    assert(async);
-    assert(async->getData());
-
-    WebSocketClientImpl* client =
-        static_cast<WebSocketClientImpl*>(async->getData());
-
-    // Close all async process
-    if (client) {
-      client->CloseSync();
-
-      client->keep_loop_alive_->close();
-      client->keep_loop_alive_ = nullptr;
-      client->process_queue_async_->close();
-      client->process_queue_async_ = nullptr;
-    }
-  });
-
-  // Initiate async handler to process callback queue.  The callback will only
-  // be triggered after process_queue_async_->send().
-  process_queue_async_ = new uS::Async(hub_.getLoop());
-  process_queue_async_->setData(this);
-  process_queue_async_->start(ProcessCallbackQueue);
-
-  // Start the event loop
-  thread_ = MakeUnique<Thread>(EventLoopRoutine, this);
+  event_loop_ = WebSocketEventLoop::Acquire(InitHub);
 }
 
-void WebSocketClientImpl::EventLoopRoutine(void* data) {
-  assert(data != nullptr);
-  WebSocketClientImpl* client = static_cast<WebSocketClientImpl*>(data);
-  Logger* logger = client->logger_;
-
-  logger->LogDebug("=== uWebSockets Event Loop Start ===");
-  client->hub_.run();
-  logger->LogDebug("=== uWebSockets Event Loop End ===");
+void WebSocketClientImpl::InitHub(uWS::Hub* hub) {
+  // Bind callback function.  The websocket or the connection request carries
+  // the client it belongs to as user data.
+  hub->onError(WebSocketClientImpl::OnError);
+  hub->onConnection(WebSocketClientImpl::OnConnection);
+  hub->onMessage(WebSocketClientImpl::OnMessage);
+  hub->onDisconnection(WebSocketClientImpl::OnDisconnection);
 }
 
 WebSocketClientImpl::~WebSocketClientImpl() {
@@ -103,22 +67,24 @@ WebSocketClientImpl::~WebSocketClientImpl() {
 
   is_destructing_.store(1);
 
-  // Remove the handler to keep event loop alive
-  if (keep_loop_alive_ != nullptr) {
-    keep_loop_alive_->send();
-  }
-
-  // Wait for the thread to end.
-  if (thread_) {
-    thread_->Join();
-    thread_.reset(nullptr);
-  }
+  // Close the websocket, then wait until the hub no longer refers to this
+  // client.  The event loop keeps running for the other clients.
+  ScheduleOnce(
+      [](WebSocketClientImpl* client, int, const std::string&) {
+        client->CloseSync();
+        client->NotifyIfClosed();
+      },
+      0, "");
+  closed_.Wait();
 
   handler_ = nullptr;
 
   // websocket_ should be cleared now or OnDisconnection() probably is not
   // called properly.
   assert(websocket_ == nullptr);
+
+  WebSocketEventLoop::Release();
+  event_loop_ = nullptr;
 }
 
 void WebSocketClientImpl::Connect(int timeout_ms) {
@@ -132,7 +98,9 @@ void WebSocketClientImpl::Connect(int timeout_ms) {
           if (!client->app_check_token_.empty()) {
             headers["X-Firebase-AppCheck"] = client->app_check_token_;
           }
-          client->hub_.connect(client->uri_, client, headers, timeout_ms);
+          client->is_connecting_ = true;
+          client->event_loop_->hub()->connect(client->uri_, client, headers,
+                                              timeout_ms);
         } else {
           logger->LogWarning("websocket has already been connected to %s",
                              client->uri_.c_str());
@@ -153,20 +121,42 @@ void WebSocketClientImpl::CloseSync() {
   }
 }
 
-void WebSocketClientImpl::Send(const char* msg) {
-  assert(msg != nullptr);
+void WebSocketClientImpl::NotifyIfClosed() {
+  if (is_destructing_.load() > 0 && websocket_ == nullptr && !is_connecting_) {
+    closed_.Post();
+  }
+}
 
-  ScheduleOnce(
-      [](WebSocketClientImpl* client, int, const std::string& msg) {
-        Logger* logger = client->logger_;
-        if (client->IsWebSocketAvailable()) {
-          client->websocket_->send(msg.c_str());
-        } else {
-          logger->LogWarning(
-              "Cannot send message.  websocket is not available");
-        }
-      },
-      0, msg);
+void WebSocketClientImpl::Send(const char* data, size_t length) {
+  assert(data != nullptr);
+
+  MutexLock lock(outgoing_mutex_);
+  outgoing_messages_.emplace_back(data, length);
+  if (!is_flush_scheduled_) {
+    is_flush_scheduled_ = true;
+    ScheduleOnce([](WebSocketClientImpl* client, int,
+                    const std::string&) { client->FlushOutgoingMessages(); },
+                 0, "");
+  }
+}
+
+void WebSocketClientImpl::FlushOutgoingMessages() {
+  {
+    MutexLock lock(outgoing_mutex_);
+    sending_messages_.swap(outgoing_messages_);
+    is_flush_scheduled_ = false;
+  }
+
+  if (IsWebSocketAvailable()) {
+    for (const std::string& message : sending_messages_) {
+      websocket_->send(message.data(), message.size(), uWS::OpCode::TEXT);
+    }
+  } else {
+    logger_->LogWarning(
+        "Cannot send %d message(s).  websocket is not available",
+        static_cast<int>(sending_messages_.size()));
+  }
+  sending_messages_.clear();
 }
 
 void WebSocketClientImpl::RefreshAppCheckToken(const std::string& token) {
@@ -178,6 +168,8 @@ void WebSocketClientImpl::OnError(void* data) {
   WebSocketClientImpl* client = static_cast<WebSocketClientImpl*>(data);
   Logger* logger = client->logger_;
 
+  client->is_connecting_ = false;
+
   if (client->handler_) {
     // TODO(b/71873743): Modify uWebSockets to provide more context, ex. reasons
     WebSocketClientErrorData error(client->uri_.c_str());
@@ -186,6 +178,9 @@ void WebSocketClientImpl::OnError(void* data) {
 
   logger->LogDebug("Error occurred while establishing connection to %s",
                    client->uri_.c_str());
+
+  // Must be the last use of client, since it may be deleted right after.
+  client->NotifyIfClosed();
 }
 
 void WebSocketClientImpl::OnConnection(ClientWebSocket* ws,
@@ -195,12 +190,13 @@ void WebSocketClientImpl::OnConnection(ClientWebSocket* ws,
   WebSocketClientImpl* client =
       static_cast<WebSocketClientImpl*>(ws->getUserData());
 
-  // There should be only one connection per client.  However, hub_ can have
+  // There should be only one connection per client.  However, the hub can have
   // multiple connnections at a time, and current implementation does not
   // prevent Connect() from  being called when another connection is
   // establishing. Use assert for now to prevent this from happening.
   assert(client->websocket_ == nullptr);
   client->websocket_ = ws;
+  client->is_connecting_ = false;
 
   if (client->handler_) {
     client->scheduler_->Schedule(new callback::CallbackValue1<ClientRef>(
@@ -230,15 +226,14 @@ void WebSocketClientImpl::OnMessage(ClientWebSocket* ws, char* message,
       static_cast<WebSocketClientImpl*>(ws->getUserData());
 
   if (client->handler_) {
-    std::string message_string(message, length);
+    IncomingMessage incoming(client->safe_this_, message, length);
     client->scheduler_->Schedule(
-        new callback::CallbackValue2<ClientRef, std::string>(
-            client->safe_this_, message_string,
-            [](ClientRef client_ref, std::string msg) {
-              ClientRefLock lock(&client_ref);
+        new callback::CallbackMoveValue1<IncomingMessage>(
+            std::move(incoming), [](IncomingMessage* incoming) {
+              ClientRefLock lock(&incoming->client_ref);
               auto client = lock.GetReference();
               if (client != nullptr && client->handler_ != nullptr) {
-                client->handler_->OnMessage(msg.c_str());
+                client->handler_->OnMessage(std::move(incoming->message));
               }
             }));
   }
@@ -264,33 +259,19 @@ void WebSocketClientImpl::OnDisconnection(ClientWebSocket* ws, int code,
           }
         }));
   }
+
+  // Must be the last use of client, since it may be deleted right after.
+  client->NotifyIfClosed();
 }
 
 void WebSocketClientImpl::ScheduleOnce(Callback cb, int int_value,
                                        const std::string& string_value) {
   assert(cb != nullptr);
 
-  MutexLock lock(callback_queue_mutex_);
-  callback_queue_.push(CallbackData(cb, this, int_value, string_value));
-
-  // Signal the event loop to trigger the async callback.
-  process_queue_async_->send();
-}
-
-void WebSocketClientImpl::ProcessCallbackQueue(uS::Async* async) {
-  assert(async);
-  assert(async->getData());
-
-  WebSocketClientImpl* client =
-      static_cast<WebSocketClientImpl*>(async->getData());
-
-  MutexLock lock(client->callback_queue_mutex_);
-  while (!client->callback_queue_.empty()) {
-    auto& callback_data = client->callback_queue_.front();
-    callback_data.callback(callback_data.client, callback_data.int_value,
-                           callback_data.string_value);
-    client->callback_queue_.pop();
-  }
+  WebSocketClientImpl* client = this;
+  event_loop_->Post([cb, client, int_value, string_value]() {
+    cb(client, int_value, string_value);
+  });
 }
 
 bool WebSocketClientImpl::IsWebSocketAvailable() const {
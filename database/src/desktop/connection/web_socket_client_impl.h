@@ -15,17 +15,17 @@
 #ifndef FIREBASE_DATABASE_SRC_DESKTOP_CONNECTION_WEB_SOCKET_CLIENT_IMPL_H_
 #define FIREBASE_DATABASE_SRC_DESKTOP_CONNECTION_WEB_SOCKET_CLIENT_IMPL_H_
 
-#include <queue>
 #include <string>
+#include <vector>
 
 #include "app/memory/atomic.h"
-#include "app/memory/unique_ptr.h"
 #include "app/src/include/firebase/internal/mutex.h"
 #include "app/src/logger.h"
 #include "app/src/safe_reference.h"
 #include "app/src/scheduler.h"
-#include "app/src/thread.h"
+#include "app/src/semaphore.h"
 #include "database/src/desktop/connection/web_socket_client_interface.h"
+#include "database/src/desktop/connection/web_socket_event_loop.h"
 #include "uWebSockets/src/uWS.h"
 
 namespace firebase {
@@ -33,6 +33,8 @@ namespace database {
 namespace internal {
 namespace connection {
 
+// Websocket client running on the event loop shared by all the clients of the
+// process.  See WebSocketEventLoop.
 class WebSocketClientImpl : public WebSocketClientInterface {
  public:
   WebSocketClientImpl(const std::string& uri, const std::string& user_agent,
@@ -48,7 +50,7 @@ class WebSocketClientImpl : public WebSocketClientInterface {
   // BEGIN WebSocketClientInterface
   void Connect(int timeout_ms) override;
   void Close() override;
-  void Send(const char* msg) override;
+  void Send(const char* data, size_t length) override;
   // END WebSocketClientInterface
 
   // Refresh the stored App Check token being used by the connection.
@@ -62,6 +64,9 @@ class WebSocketClientImpl : public WebSocketClientInterface {
   typedef void (*Callback)(WebSocketClientImpl* client, int int_value,
                            const std::string& string_value);
 
+  // Bind the callbacks below to the hub of the shared event loop.
+  static void InitHub(uWS::Hub* hub);
+
   // Callback for hub_ when connection error occurs
   static void OnError(void* data);
 
@@ -76,21 +81,23 @@ class WebSocketClientImpl : public WebSocketClientInterface {
   static void OnDisconnection(ClientWebSocket* ws, int code, char* message,
                               size_t length);
 
-  // The thread routine to host the event loop of hub_
-  static void EventLoopRoutine(void* data);
-
   // Synchronously request to close the websocket.  Should only be called in
   // evnet loop thread.
   void CloseSync();
 
+  // Signal closed_ once this client is being destroyed and has neither a
+  // websocket nor a pending connection left.  Only call this in event loop.
+  void NotifyIfClosed();
+
   // Schedule an async callback to be trigger in the next iteration of the event
   // loop.  This call is thread-safe and is to prevent multiple threads fighting
   // for the same resource, such as websocket_
   void ScheduleOnce(Callback cb, int int_value,
                     const std::string& string_value);
 
-  // Process callback queue in event loop thread
-  static void ProcessCallbackQueue(uS::Async* async);
+  // Send all the messages in outgoing_messages_.  Only call this in event
+  // loop.
+  void FlushOutgoingMessages();
 
   // Check if the websocket is available and not closed.
   // Only call this in event loop.
@@ -103,46 +110,9 @@ class WebSocketClientImpl : public WebSocketClientInterface {
   // The event handler for connection events.
   WebSocketClientEventHandler* handler_;
 
-  // The thread to host the event loop of hub_
-  UniquePtr<Thread> thread_;
-
-  // The access point for uWebSockets which contains event loops and
-  // different sockets.
-  uWS::Hub hub_;
-
-  // The handler to keep the event loop of hub_ alive even there is no
-  // connection at all.  Otherwise the loop would stop when there is nothing to
-  // handle anymore.  Also used to asynchronously close all async handles and
-  // WebSocket connection in destructor.
-  uS::Async* keep_loop_alive_;
-
-  // Async handler to process callback queue in event look thread.
-  uS::Async* process_queue_async_;
-
-  // A blob of callback data which is added to callback queue and triggered in
-  // the event loop thread.  The callback member is called with a reference to
-  // the client, int_value and string_value stored in this data structure.
-  struct CallbackData {
-    explicit CallbackData(Callback c, WebSocketClientImpl* ws_client, int i,
-                          const std::string& str)
-        : callback(c), client(ws_client), int_value(i), string_value(str) {}
-
-    Callback callback;
-
-    WebSocketClientImpl* client;
-
-    // Generic purposed int value.  Used as timeout in this case.
-    int int_value;
-
-    // Generic purposed string value.  Used as message to send in this case.
-    std::string string_value;
-  };
-
-  // A queue of callback to be triggered in event loop thread.
-  std::queue<CallbackData> callback_queue_;
-
-  // Mutex to guard callback_queue_
-  Mutex callback_queue_mutex_;
+  // The event loop shared with the other clients, hosting the websocket.
+  // Acquired in constructor and released in destructor.
+  WebSocketEventLoop* event_loop_;
 
   // Flagged when this object starts to be destructed.  This helps the other
   // thread to handle situation accordingly, ex. if the connection is
@@ -156,6 +126,27 @@ class WebSocketClientImpl : public WebSocketClientInterface {
   // connection.  Should only be used in the event loop.  Not thread safe
   ClientWebSocket* websocket_;
 
+  // Messages waiting to be sent.  Send() only schedules a task to flush them
+  // when there is none pending, so messages sent in a burst are written
+  // together in one iteration of the event loop.
+  std::vector<std::string> outgoing_messages_;
+  bool is_flush_scheduled_;
+
+  // Mutex to guard outgoing_messages_ and is_flush_scheduled_
+  Mutex outgoing_mutex_;
+
+  // Messages being written by FlushOutgoingMessages().  Kept to reuse its
+  // memory.  Should only be used in the event loop.
+  std::vector<std::string> sending_messages_;
+
+  // Whether a connection request is waiting for OnConnection() or OnError().
+  // Should only be used in the event loop.
+  bool is_connecting_;
+
+  // Signaled in the event loop when this client is being destroyed and the
+  // hub no longer refers to it.  The destructor waits for it.
+  Semaphore closed_;
+
   // User agent used when opening the connection.
   std::string user_agent_;
 
@@ -174,6 +165,16 @@ class WebSocketClientImpl : public WebSocketClientInterface {
       ClientRefLock;
   ClientRef safe_this_;
 
+  // A message received from the server.  It is copied out of the buffer of
+  // uWebSockets once, then moved to the scheduler thread and the handler.
+  struct IncomingMessage {
+    IncomingMessage(const ClientRef& ref, const char* data, size_t length)
+        : client_ref(ref), message(data, length) {}
+
+    ClientRef client_ref;
+    std::string message;
+  };
+
   friend class PersistentConnectionTest;
 };
 
@@ -35,8 +35,8 @@ class WebSocketClientInterface {
   // Request to close established connection
   virtual void Close() = 0;
 
-  // Request to send message to the connected server
-  virtual void Send(const char* msg) = 0;
+  // Request to send a message of the given length to the connected server
+  virtual void Send(const char* data, size_t length) = 0;
 };
 
 // Context when OnError occurs.  Currently only contains the uri.
@@ -59,8 +59,9 @@ class WebSocketClientEventHandler {
   // Called when the connection is established
   virtual void OnOpen() = 0;
 
-  // Called when a message from the server is received
-  virtual void OnMessage(const char* msg) = 0;
+  // Called when a message from the server is received.  The handler may take
+  // the content of msg by moving from it, to avoid copying large messages.
+  virtual void OnMessage(std::string&& msg) = 0;
 
   // Called when the connection is closed
   virtual void OnClose() = 0;
@@ -0,0 +1,145 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "database/src/desktop/connection/web_socket_event_loop.h"
+
+#include <cassert>
+#include <utility>
+
+#include "app/src/log.h"
+
+namespace firebase {
+namespace database {
+namespace internal {
+namespace connection {
+
+// Guards g_event_loop and g_event_loop_ref_count.
+static Mutex g_event_loop_mutex;  // NOLINT
+static WebSocketEventLoop* g_event_loop = nullptr;
+static int g_event_loop_ref_count = 0;
+
+WebSocketEventLoop* WebSocketEventLoop::Acquire(HubInitializer init_hub) {
+  MutexLock lock(g_event_loop_mutex);
+  if (g_event_loop_ref_count++ == 0) {
+    assert(g_event_loop == nullptr);
+    g_event_loop = new WebSocketEventLoop(init_hub);
+  }
+  return g_event_loop;
+}
+
+void WebSocketEventLoop::Release() {
+  MutexLock lock(g_event_loop_mutex);
+  assert(g_event_loop_ref_count > 0);
+  if (--g_event_loop_ref_count == 0) {
+    // Waits for the event loop to end while holding the lock, so a client
+    // acquiring the loop meanwhile starts a new one afterwards.
+    delete g_event_loop;
+    g_event_loop = nullptr;
+  }
+}
+
+WebSocketEventLoop::WebSocketEventLoop(HubInitializer init_hub)
+    : hub_(),
+      keep_loop_alive_(nullptr),
+      process_tasks_async_(nullptr),
+      tasks_(),
+      tasks_mutex_(Mutex::kModeNonRecursive),
+      thread_(nullptr) {
+  init_hub(&hub_);
+
+  // Create a async object to keep the loop alive and close all async handler
+  // when the loop stops.
+  keep_loop_alive_ = new uS::Async(hub_.getLoop());
+  keep_loop_alive_->setData(this);
+  keep_loop_alive_->start([](uS::Async* async) {
+    assert(async);
+    assert(async->getData());
+
+    WebSocketEventLoop* event_loop =
+        static_cast<WebSocketEventLoop*>(async->getData());
+
+    // Close all async process
+    if (event_loop) {
+      event_loop->keep_loop_alive_->close();
+      event_loop->keep_loop_alive_ = nullptr;
+      event_loop->process_tasks_async_->close();
+      event_loop->process_tasks_async_ = nullptr;
+    }
+  });
+
+  // Initiate async handler to process tasks.  The callback will only be
+  // triggered after process_tasks_async_->send().
+  process_tasks_async_ = new uS::Async(hub_.getLoop());
+  process_tasks_async_->setData(this);
+  process_tasks_async_->start(ProcessTasks);
+
+  // Start the event loop
+  thread_ = MakeUnique<Thread>(EventLoopRoutine, this);
+}
+
+WebSocketEventLoop::~WebSocketEventLoop() {
+  // Remove the handler to keep event loop alive
+  if (keep_loop_alive_ != nullptr) {
+    keep_loop_alive_->send();
+  }
+
+  // Wait for the thread to end.
+  if (thread_) {
+    thread_->Join();
+    thread_.reset(nullptr);
+  }
+}
+
+void WebSocketEventLoop::EventLoopRoutine(void* data) {
+  assert(data != nullptr);
+  WebSocketEventLoop* event_loop = static_cast<WebSocketEventLoop*>(data);
+
+  LogDebug("=== uWebSockets Event Loop Start ===");
+  event_loop->hub_.run();
+  LogDebug("=== uWebSockets Event Loop End ===");
+}
+
+void WebSocketEventLoop::Post(Task task) {
+  assert(task);
+
+  MutexLock lock(tasks_mutex_);
+  tasks_.push_back(std::move(task));
+
+  // Signal the event loop to trigger the async callback.
+  process_tasks_async_->send();
+}
+
+void WebSocketEventLoop::ProcessTasks(uS::Async* async) {
+  assert(async);
+  assert(async->getData());
+
+  WebSocketEventLoop* event_loop =
+      static_cast<WebSocketEventLoop*>(async->getData());
+
+  // Take the tasks out of the queue before running them, so the tasks can post
+  // more tasks and other threads are not blocked meanwhile.
+  std::vector<Task> tasks;
+  {
+    MutexLock lock(event_loop->tasks_mutex_);
+    tasks.swap(event_loop->tasks_);
+  }
+  for (Task& task : tasks) {
+    task();
+  }
+}
+
+}  // namespace connection
+}  // namespace internal
+}  // namespace database
+}  // namespace firebase
@@ -0,0 +1,100 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_DATABASE_SRC_DESKTOP_CONNECTION_WEB_SOCKET_EVENT_LOOP_H_
+#define FIREBASE_DATABASE_SRC_DESKTOP_CONNECTION_WEB_SOCKET_EVENT_LOOP_H_
+
+#include <functional>
+#include <vector>
+
+#include "app/memory/unique_ptr.h"
+#include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/thread.h"
+#include "uWebSockets/src/uWS.h"
+
+namespace firebase {
+namespace database {
+namespace internal {
+namespace connection {
+
+// Event loop shared by all websocket clients of the process.
+//
+// A single thread runs one uWebSockets hub, which multiplexes the websockets
+// of every client.  The loop is started when the first client acquires it and
+// stopped when the last client releases it.
+class WebSocketEventLoop {
+ public:
+  typedef void (*HubInitializer)(uWS::Hub* hub);
+  typedef std::function<void()> Task;
+
+  // Return the shared event loop, starting it if no client holds it.
+  //
+  // `init_hub` is called before the loop starts, to bind the handlers of the
+  // hub.  Every client of the loop must pass the same function.
+  static WebSocketEventLoop* Acquire(HubInitializer init_hub);
+
+  // Release the shared event loop.  The last release stops the loop and
+  // waits for its thread to end, so every websocket of the caller should be
+  // closed by then.
+  static void Release();
+
+  // Run the task in the next iteration of the event loop.  Thread-safe.
+  void Post(Task task);
+
+  // The hub hosting all the websockets.  Should only be used in the event
+  // loop.
+  uWS::Hub* hub() { return &hub_; }
+
+ private:
+  explicit WebSocketEventLoop(HubInitializer init_hub);
+  ~WebSocketEventLoop();
+
+  // WebSocketEventLoop is neither copyable nor movable.
+  WebSocketEventLoop(const WebSocketEventLoop&) = delete;
+  WebSocketEventLoop& operator=(const WebSocketEventLoop&) = delete;
+
+  // The thread routine to host the event loop of hub_
+  static void EventLoopRoutine(void* data);
+
+  // Run the tasks posted so far in event loop thread.
+  static void ProcessTasks(uS::Async* async);
+
+  // The access point for uWebSockets which contains event loops and
+  // different sockets.
+  uWS::Hub hub_;
+
+  // The handler to keep the event loop of hub_ alive even there is no
+  // connection at all.  Otherwise the loop would stop when there is nothing to
+  // handle anymore.  Also used to close all async handles when the loop stops.
+  uS::Async* keep_loop_alive_;
+
+  // Async handler to process tasks_ in event loop thread.
+  uS::Async* process_tasks_async_;
+
+  // Tasks to run in event loop thread.
+  std::vector<Task> tasks_;
+
+  // Mutex to guard tasks_
+  Mutex tasks_mutex_;
+
+  // The thread to host the event loop of hub_
+  UniquePtr<Thread> thread_;
+};
+
+}  // namespace connection
+}  // namespace internal
+}  // namespace database
+}  // namespace firebase
+
+#endif  // FIREBASE_DATABASE_SRC_DESKTOP_CONNECTION_WEB_SOCKET_EVENT_LOOP_H_
@@ -0,0 +1,116 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "database/src/desktop/connection/write_batch.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "app/src/assert.h"
+
+namespace firebase {
+namespace database {
+namespace internal {
+namespace connection {
+
+bool WriteBatch::Add(uint64_t write_id, const Path& path, const Variant& data,
+                     bool is_merge) {
+  std::vector<Entry> new_entries;
+  std::vector<std::string> directories = path.GetDirectories();
+  if (is_merge) {
+    if (!data.is_map()) return false;
+    for (const auto& child : data.map()) {
+      if (!child.first.is_string()) return false;
+      std::vector<std::string> child_directories =
+          Path(child.first.string_value()).GetDirectories();
+      if (child_directories.empty()) return false;
+      Entry entry;
+      entry.directories = directories;
+      entry.directories.insert(entry.directories.end(),
+                               child_directories.begin(),
+                               child_directories.end());
+      entry.value = child.second;
+      new_entries.push_back(std::move(entry));
+    }
+  } else {
+    Entry entry;
+    entry.directories = std::move(directories);
+    entry.value = data;
+    new_entries.push_back(std::move(entry));
+  }
+  // Leave writes without any location to change, such as an empty merge, to
+  // be sent on their own.
+  if (new_entries.empty()) return false;
+
+  for (size_t i = 0; i < new_entries.size(); ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      if (Overlaps(new_entries[i].directories, new_entries[j].directories)) {
+        return false;
+      }
+    }
+    for (const Entry& entry : entries_) {
+      if (Overlaps(new_entries[i].directories, entry.directories)) {
+        return false;
+      }
+    }
+  }
+
+  write_ids_.push_back(write_id);
+  for (Entry& entry : new_entries) {
+    entries_.push_back(std::move(entry));
+  }
+  return true;
+}
+
+void WriteBatch::GetUpdate(Path* path, Variant* update) const {
+  FIREBASE_DEV_ASSERT(entries_.size() >= 2);
+
+  // Send the update to the deepest location containing all the entries.
+  // Since the entries do not overlap, it is above every one of them.
+  const std::vector<std::string>& first = entries_.front().directories;
+  size_t common_length = first.size();
+  for (const Entry& entry : entries_) {
+    size_t length = (std::min)(common_length, entry.directories.size());
+    common_length = std::mismatch(first.begin(), first.begin() + length,
+                                  entry.directories.begin())
+                        .first -
+                    first.begin();
+  }
+
+  *path = Path(std::vector<std::string>(first.begin(),
+                                        first.begin() + common_length));
+  *update = Variant::EmptyMap();
+  for (const Entry& entry : entries_) {
+    FIREBASE_DEV_ASSERT(entry.directories.size() > common_length);
+    Path relative_path(std::vector<std::string>(
+        entry.directories.begin() + common_length, entry.directories.end()));
+    update->map()[relative_path.str()] = entry.value;
+  }
+}
+
+void WriteBatch::Clear() {
+  write_ids_.clear();
+  entries_.clear();
+}
+
+bool WriteBatch::Overlaps(const std::vector<std::string>& a,
+                          const std::vector<std::string>& b) {
+  size_t length = (std::min)(a.size(), b.size());
+  return std::equal(a.begin(), a.begin() + length, b.begin());
+}
+
+}  // namespace connection
+}  // namespace internal
+}  // namespace database
+}  // namespace firebase
@@ -0,0 +1,82 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_DATABASE_SRC_DESKTOP_CONNECTION_WRITE_BATCH_H_
+#define FIREBASE_DATABASE_SRC_DESKTOP_CONNECTION_WRITE_BATCH_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "app/src/include/firebase/variant.h"
+#include "app/src/path.h"
+
+namespace firebase {
+namespace database {
+namespace internal {
+namespace connection {
+
+// Combines writes into a single multi-path update.
+//
+// Writes are only combined when the locations they change do not overlap, so
+// the order in which the server applies them does not matter and the update
+// has the same effect as sending the writes one by one.
+class WriteBatch {
+ public:
+  WriteBatch() {}
+
+  // Add a put of `data` at `path`, or a merge of the children of `data` at
+  // `path` if `is_merge` is true.
+  //
+  // Returns false, leaving the batch unchanged, if the write changes a
+  // location overlapping one changed by the batch.  The batch should then be
+  // sent before the write.
+  bool Add(uint64_t write_id, const Path& path, const Variant& data,
+           bool is_merge);
+
+  // Returns the path and the data of a merge request equivalent to the writes
+  // in the batch.  Should only be called when the batch contains at least two
+  // writes.
+  void GetUpdate(Path* path, Variant* update) const;
+
+  // Ids of the writes in the batch, in the order they were added.
+  const std::vector<uint64_t>& write_ids() const { return write_ids_; }
+
+  bool empty() const { return write_ids_.empty(); }
+  size_t size() const { return write_ids_.size(); }
+
+  void Clear();
+
+ private:
+  // A location changed by the batch, and its new value.
+  struct Entry {
+    std::vector<std::string> directories;
+    Variant value;
+  };
+
+  // Returns true if one of the paths is an ancestor of, or the same as, the
+  // other.
+  static bool Overlaps(const std::vector<std::string>& a,
+                       const std::vector<std::string>& b);
+
+  std::vector<uint64_t> write_ids_;
+  std::vector<Entry> entries_;
+};
+
+}  // namespace connection
+}  // namespace internal
+}  // namespace database
+}  // namespace firebase
+
+#endif  // FIREBASE_DATABASE_SRC_DESKTOP_CONNECTION_WRITE_BATCH_H_
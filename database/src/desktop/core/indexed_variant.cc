@@ -14,8 +14,8 @@
 
 #include "database/src/desktop/core/indexed_variant.h"
 
-#include <algorithm>
 #include <cassert>
+#include <utility>
 
 #include "app/src/assert.h"
 #include "app/src/include/firebase/variant.h"
@@ -28,49 +28,43 @@ namespace database {
 namespace internal {
 
 IndexedVariant::IndexedVariant()
-    : variant_(), query_params_(), index_(QueryParamsLesser(&query_params_)) {
-  EnsureIndexed();
-}
+    : IndexedVariant(Variant(), std::make_shared<QueryParams>()) {}
 
 IndexedVariant::IndexedVariant(const Variant& variant)
-    : variant_(variant),
-      query_params_(),
-      index_(QueryParamsLesser(&query_params_)) {
-  EnsureIndexed();
-}
+    : IndexedVariant(variant, std::make_shared<QueryParams>()) {}
 
 IndexedVariant::IndexedVariant(const Variant& variant,
                                const QueryParams& query_params)
-    : variant_(variant),
-      query_params_(query_params),
-      index_(QueryParamsLesser(&query_params_)) {
-  EnsureIndexed();
+    : IndexedVariant(variant, std::make_shared<QueryParams>(query_params)) {}
+
+IndexedVariant::IndexedVariant(
+    const Variant& variant,
+    const std::shared_ptr<const QueryParams>& query_params)
+    : query_params_(query_params) {
+  EnsureIndexed(variant);
 }
 
 IndexedVariant::IndexedVariant(const IndexedVariant& other)
     : variant_(other.variant_),
       query_params_(other.query_params_),
-      index_(QueryParamsLesser(&query_params_)) {
-  EnsureIndexed();
-}
+      index_(other.index_) {}
 
 IndexedVariant& IndexedVariant::operator=(const IndexedVariant& other) {
   variant_ = other.variant_;
   query_params_ = other.query_params_;
-  index_ = Index(QueryParamsLesser(&query_params_));
-  EnsureIndexed();
+  index_ = other.index_;
   return *this;
 }
 
 const char* IndexedVariant::GetPredecessorChildName(
     const std::string& child_key, const Variant& child_value) const {
   Variant key = child_key.c_str();
-  auto iter = index_.find(std::make_pair(key, child_value));
+  auto iter = index_->find(std::make_pair(key, child_value));
 
-  if (iter == index_.end()) {
+  if (iter == index_->end()) {
     return nullptr;
   }
-  if (iter == index_.begin()) {
+  if (iter == index_->begin()) {
     return nullptr;
   }
 
@@ -86,21 +80,27 @@ const char* IndexedVariant::GetPredecessorChildName(
 
 IndexedVariant::Index::const_iterator IndexedVariant::Find(
     const Variant& key) const {
-  return std::find_if(index_.begin(), index_.end(),
-                      [&key](const Index::value_type& element) {
-                        return key == element.first;
-                      });
+  // Look up the value in the map first so the index can be searched by its
+  // ordering instead of scanning every element.
+  if (!variant_->is_map()) {
+    return index_->end();
+  }
+  auto entry = variant_->map().find(key);
+  if (entry == variant_->map().end()) {
+    return index_->end();
+  }
+  return index_->find(std::make_pair(entry->first, entry->second));
 }
 
 const Variant* IndexedVariant::GetOrderByVariant(const Variant& key,
                                                  const Variant& value) {
-  switch (query_params_.order_by) {
+  switch (query_params_->order_by) {
     case QueryParams::kOrderByPriority: {
       return &GetVariantPriority(value);
     }
     case QueryParams::kOrderByChild: {
       if (value.is_map()) {
-        auto iter = value.map().find(query_params_.order_by_child);
+        auto iter = value.map().find(query_params_->order_by_child);
         if (iter != value.map().end()) {
           return GetVariantValue(&iter->second);
         }
@@ -136,33 +136,110 @@ static bool IsDefinedOn(const Variant& variant, const QueryParams& params) {
   }
 }
 
-void IndexedVariant::EnsureIndexed() {
+void IndexedVariant::EnsureIndexed(Variant variant) {
+  std::shared_ptr<Index> index =
+      std::make_shared<Index>(QueryParamsLesser(query_params_.get()));
+
   // If this isn't a map, there's no index to build.
-  if (!variant_.is_map()) {
-    return;
+  if (variant.is_map()) {
+    PruneNulls(&variant);
+
+    for (const auto& entry : variant.map()) {
+      if (entry.first.is_string() && entry.first.string_value()[0] == '.') {
+        // Do not index pseudo-keys.
+        continue;
+      }
+      index->insert(entry);
+    }
   }
 
-  PruneNulls(&variant_);
+  variant_ = std::make_shared<Variant>(std::move(variant));
+  index_ = std::move(index);
+}
 
-  for (const auto& entry : variant_.map()) {
-    if (entry.first.is_string() && entry.first.string_value()[0] == '.') {
-      // Do not index pseudo-keys.
-      continue;
-    }
-    index_.insert(entry);
+Variant* IndexedVariant::mutable_variant() {
+  if (variant_.use_count() > 1) {
+    variant_ = std::make_shared<Variant>(*variant_);
+  }
+  return variant_.get();
+}
+
+IndexedVariant::Index* IndexedVariant::mutable_index() {
+  if (index_.use_count() > 1) {
+    index_ = std::make_shared<Index>(*index_);
   }
+  return index_.get();
+}
+
+IndexedVariant IndexedVariant::UpdateChild(const std::string& key,
+                                           const Variant& child) const& {
+  return IndexedVariant(*this).UpdateChild(key, child);
 }
 
 IndexedVariant IndexedVariant::UpdateChild(const std::string& key,
-                                           const Variant& child) const {
-  Variant result = variant_;
-  VariantUpdateChild(&result, key, child);
-  return IndexedVariant(result, query_params_);
+                                           const Variant& child) && {
+  // Updating a leaf, a pseudo-key or a deep path can change the shape of the
+  // whole variant, so rebuild the index from scratch.
+  if (!variant_->is_map() || VariantIsLeaf(*variant_) || key.empty() ||
+      key[0] == '.' || key.find('/') != std::string::npos) {
+    Variant result = *variant_;
+    VariantUpdateChild(&result, key, child);
+    return IndexedVariant(result, query_params_);
+  }
+
+  // Otherwise only the entry for this child changes. Remove its old entry from
+  // the index and insert the new one, which avoids re-sorting every other
+  // child.
+  Variant new_child = child;
+  PruneNulls(&new_child);
+
+  Variant key_variant(key);
+  auto& map = mutable_variant()->map();
+  Index* index = mutable_index();
+  auto old_entry = map.find(key_variant);
+  if (old_entry != map.end()) {
+    index->erase(std::make_pair(old_entry->first, old_entry->second));
+  }
+
+  if (VariantIsEmpty(new_child)) {
+    if (old_entry != map.end()) {
+      map.erase(old_entry);
+    }
+    if (VariantIsEmpty(*variant_)) {
+      return IndexedVariant(Variant::Null(), query_params_);
+    }
+  } else if (old_entry != map.end()) {
+    old_entry->second = new_child;
+    index->insert(std::make_pair(key_variant, new_child));
+  } else {
+    map.insert(std::make_pair(key_variant, new_child));
+    index->insert(std::make_pair(key_variant, new_child));
+  }
+  return std::move(*this);
+}
+
+IndexedVariant IndexedVariant::UpdatePriority(const Variant& priority) const& {
+  return IndexedVariant(*this).UpdatePriority(priority);
 }
 
-IndexedVariant IndexedVariant::UpdatePriority(const Variant& priority) const {
-  return IndexedVariant(CombineValueAndPriority(variant_, priority),
-                        query_params_);
+IndexedVariant IndexedVariant::UpdatePriority(const Variant& priority) && {
+  // Removing the priority of a leaf unwraps its value from the map.
+  bool remove_priority = VariantIsEmpty(*variant_) || VariantIsEmpty(priority);
+  if (!variant_->is_map() ||
+      (remove_priority && variant_->map().count(Variant(kValueKey)))) {
+    return IndexedVariant(CombineValueAndPriority(*variant_, priority),
+                          query_params_);
+  }
+
+  // Changing the priority only touches the ".priority" pseudo-key, so the
+  // children and their order remain the same.
+  auto& map = mutable_variant()->map();
+  if (remove_priority) {
+    map.erase(Variant(kPriorityKey));
+  } else {
+    map[Variant(kPriorityKey)] = priority;
+  }
+  return std::move(*this);
 }
 
 Optional<std::pair<Variant, Variant>> IndexedVariant::GetFirstChild() const {
@@ -186,6 +263,10 @@ Optional<std::pair<Variant, Variant>> IndexedVariant::GetLastChild() const {
 }
 
 bool operator==(const IndexedVariant& lhs, const IndexedVariant& rhs) {
+  if (&lhs.variant() == &rhs.variant() &&
+      &lhs.query_params() == &rhs.query_params()) {
+    return true;
+  }
   return lhs.variant() == rhs.variant() &&
          lhs.query_params() == rhs.query_params();
 }
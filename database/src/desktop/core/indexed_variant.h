@@ -15,6 +15,7 @@
 #ifndef FIREBASE_DATABASE_SRC_DESKTOP_CORE_INDEXED_VARIANT_H_
 #define FIREBASE_DATABASE_SRC_DESKTOP_CORE_INDEXED_VARIANT_H_
 
+#include <memory>
 #include <set>
 
 #include "app/src/include/firebase/variant.h"
@@ -30,6 +31,17 @@ class IndexedVariantGetOrderByVariantTest;
 // Represents a Variant together with an index. The index and variant are
 // updated in unison. The index representes the order elements of a variant map
 // should be in according to the QueryParams's ordering.
+//
+// IndexedVariants are immutable, so the variant, index and query params are
+// shared between copies. This makes copying an IndexedVariant (e.g. between
+// the local and server caches of a ViewCache) cheap, and lets UpdateChild and
+// UpdatePriority patch the existing index rather than rebuilding it.
+//
+// The variant and index are copied on write: UpdateChild and UpdatePriority
+// copy them when another IndexedVariant shares them, and otherwise update them
+// in place when called on an IndexedVariant that is about to be discarded,
+// e.g. `snap = std::move(snap).UpdateChild(key, child)`. IndexedVariants are
+// only used on the thread of their Repo, so the reference counts are exact.
 class IndexedVariant {
  public:
   typedef std::set<std::pair<const Variant, const Variant>, QueryParamsLesser>
@@ -41,11 +53,13 @@ class IndexedVariant {
 
   IndexedVariant(const IndexedVariant& other);
   IndexedVariant& operator=(const IndexedVariant& other);
+  IndexedVariant(IndexedVariant&& other) = default;
+  IndexedVariant& operator=(IndexedVariant&& other) = default;
 
-  const QueryParams& query_params() const { return query_params_; }
-  const Variant& variant() const { return variant_; }
+  const QueryParams& query_params() const { return *query_params_; }
+  const Variant& variant() const { return *variant_; }
 
-  const Index& index() const { return index_; }
+  const Index& index() const { return *index_; }
 
   // Find an element in the index.
   Index::const_iterator Find(const Variant& key) const;
@@ -66,10 +80,16 @@ class IndexedVariant {
   // Set the value of the child give by 'key' to 'child'.
   // If this variant is not a map, it will be converted into one in the process.
   IndexedVariant UpdateChild(const std::string& key,
-                             const Variant& child) const;
+                             const Variant& child) const&;
+  // As above, reusing the variant and index of this IndexedVariant when they
+  // are not shared. Only the entry for the child is then updated, in O(log n).
+  IndexedVariant UpdateChild(const std::string& key, const Variant& child) &&;
 
   // Updates the priority of this indexed variant to the given value.
-  IndexedVariant UpdatePriority(const Variant& priority) const;
+  IndexedVariant UpdatePriority(const Variant& priority) const&;
+  // As above, reusing the variant of this IndexedVariant when it is not
+  // shared.
+  IndexedVariant UpdatePriority(const Variant& priority) &&;
 
   // Gets the first child in the indexed variant, if one is present. If this is
   // a leaf node, an empty Optional is returned
@@ -80,7 +100,16 @@ class IndexedVariant {
   Optional<std::pair<Variant, Variant>> GetLastChild() const;
 
  private:
-  void EnsureIndexed();
+  IndexedVariant(const Variant& variant,
+                 const std::shared_ptr<const QueryParams>& query_params);
+
+  // Prune nulls from the given variant and build its index.
+  void EnsureIndexed(Variant variant);
+
+  // Return the variant or the index for modification, copying it first if it
+  // is shared with another IndexedVariant.
+  Variant* mutable_variant();
+  Index* mutable_index();
 
   // Return the variant to use when using OrderBy on this element.
   // This function does NOT prune the priority from the result if it is a map
@@ -99,16 +128,16 @@ class IndexedVariant {
   // map, it doesn't organize the map's elements accoring to the QueryParams.
   // That's why we keep a separate Index that is ordered by the parameters in
   // the QueryParams for when the elements need to be iterated over in order.
-  Variant variant_;
+  std::shared_ptr<Variant> variant_;
 
-  // The query params that contains the ordering rules.
-  QueryParams query_params_;
+  // The query params that contains the ordering rules. Every IndexedVariant
+  // derived from another through UpdateChild or UpdatePriority shares the same
+  // query params, as the comparator of each index points to them.
+  std::shared_ptr<const QueryParams> query_params_;
 
-  // An ordered set of key/value pairs. This set uses pointers to Variants that
-  // point directly into the variant_ map, so it is dangrous to change elements
-  // of the variant_ map as it may invalidate these pointers. All updates should
-  // be funneled through UpdateChild or UpdatePriority.
-  Index index_;
+  // An ordered set of key/value pairs. Shared with copies and with results of
+  // UpdatePriority, which does not change the children.
+  std::shared_ptr<Index> index_;
 
   friend class IndexedVariantGetOrderByVariantTest;
 };
@@ -50,9 +50,61 @@ using callback::NewCallback;
 namespace database {
 namespace internal {
 
+// A scheduler shared by Repos, along with the number of Repos assigned to it.
+struct SchedulerPoolEntry {
+  scheduler::Scheduler* scheduler;
+  int repo_count;
+};
+
+// Guards g_scheduler_pool and g_scheduler_pool_size.
 static Mutex g_scheduler_mutex;  // NOLINT
-static int g_scheduler_ref_count = 0;
-scheduler::Scheduler* Repo::s_scheduler_;
+static std::vector<SchedulerPoolEntry>* g_scheduler_pool = nullptr;
+static size_t g_scheduler_pool_size = 1;
+
+void Repo::SetSchedulerPoolSize(size_t size) {
+  MutexLock lock(g_scheduler_mutex);
+  g_scheduler_pool_size = size > 0 ? size : 1;
+}
+
+scheduler::Scheduler* Repo::AcquireScheduler() {
+  MutexLock lock(g_scheduler_mutex);
+  if (g_scheduler_pool == nullptr) {
+    g_scheduler_pool = new std::vector<SchedulerPoolEntry>();
+  }
+  SchedulerPoolEntry* entry = nullptr;
+  if (g_scheduler_pool->size() < g_scheduler_pool_size) {
+    g_scheduler_pool->push_back(
+        SchedulerPoolEntry{new scheduler::Scheduler(), 0});
+    entry = &g_scheduler_pool->back();
+  } else {
+    for (auto& candidate : *g_scheduler_pool) {
+      if (entry == nullptr || candidate.repo_count < entry->repo_count) {
+        entry = &candidate;
+      }
+    }
+  }
+  entry->repo_count++;
+  return entry->scheduler;
+}
+
+void Repo::ReleaseScheduler(scheduler::Scheduler* scheduler) {
+  MutexLock lock(g_scheduler_mutex);
+  if (g_scheduler_pool == nullptr) return;
+  int total_repo_count = 0;
+  for (auto& entry : *g_scheduler_pool) {
+    if (entry.scheduler == scheduler && entry.repo_count > 0) {
+      entry.repo_count--;
+    }
+    total_repo_count += entry.repo_count;
+  }
+  if (total_repo_count == 0) {
+    for (auto& entry : *g_scheduler_pool) {
+      delete entry.scheduler;
+    }
+    delete g_scheduler_pool;
+    g_scheduler_pool = nullptr;
+  }
+}
 
 // Transaction Response class to pass to PersistentConnection.
 // This is used to capture all the data to use when ResponseCallback is
@@ -85,6 +137,7 @@ class TransactionResponse : public connection::Response {
 Repo::Repo(App* app, DatabaseInternal* database, const char* url,
            Logger* logger, bool persistence_enabled)
     : database_(database),
+      scheduler_(nullptr),
       host_info_(),
       persistence_enabled_(persistence_enabled),
       connection_(),
@@ -102,16 +155,12 @@ Repo::Repo(App* app, DatabaseInternal* database, const char* url,
                                     parser.secure);
   url_ = host_info_.ToString();
 
-  {
-    MutexLock lock(g_scheduler_mutex);
-    g_scheduler_ref_count++;
-    if (s_scheduler_ == nullptr) s_scheduler_ = new scheduler::Scheduler();
-  }
+  scheduler_ = AcquireScheduler();
 
   connection_.reset(new connection::PersistentConnection(
-      app, host_info_, this, s_scheduler_, logger_));
+      app, host_info_, this, scheduler_, logger_));
   // Kick off any expensive additional initialization
-  s_scheduler_->Schedule(NewCallback(
+  scheduler_->Schedule(NewCallback(
       [](ThisRef ref) {
         ThisRefLock lock(&ref);
         if (lock.GetReference() != nullptr) {
@@ -129,13 +178,17 @@ Repo::~Repo() {
   // while the SyncTree is being torn down.
   safe_this_.ClearReference();
   connection_.reset(nullptr);
-  {
-    MutexLock lock(g_scheduler_mutex);
-    if (g_scheduler_ref_count) g_scheduler_ref_count--;
-    if (g_scheduler_ref_count == 0) {
-      delete s_scheduler_;
-      s_scheduler_ = nullptr;
-    }
+  if (scheduler_ != nullptr) {
+    scheduler::SchedulerStats stats = scheduler_->GetStats();
+    logger_->LogDebug(
+        "Scheduler of %s ran %llu requests, max queue depth %llu, max "
+        "latency %llu ms, total run time %llu ms",
+        url_.c_str(), static_cast<unsigned long long>(stats.triggered_count),
+        static_cast<unsigned long long>(stats.max_queue_depth),
+        static_cast<unsigned long long>(stats.max_latency_ms),
+        static_cast<unsigned long long>(stats.total_run_time_ms));
+    ReleaseScheduler(scheduler_);
+    scheduler_ = nullptr;
   }
 
   // Remove the App Check token listener
@@ -218,7 +271,7 @@ void Repo::OnDisconnectSetValue(const SafeFutureHandle<void>& handle,
         response->MarkComplete();
       });
 
-  Repo::scheduler().Schedule(NewCallback(
+  scheduler_->Schedule(NewCallback(
       [](ThisRef ref, connection::ResponsePtr ptr) {
         ThisRefLock lock(&ref);
         if (lock.GetReference() != nullptr) {
@@ -247,7 +300,7 @@ void Repo::OnDisconnectCancel(const SafeFutureHandle<void>& handle,
         response->MarkComplete();
       });
 
-  Repo::scheduler().Schedule(NewCallback(
+  scheduler_->Schedule(NewCallback(
       [](ThisRef ref, connection::ResponsePtr ptr) {
         ThisRefLock lock(&ref);
         if (lock.GetReference() != nullptr) {
@@ -284,7 +337,7 @@ void Repo::OnDisconnectUpdate(const SafeFutureHandle<void>& handle,
         response->MarkComplete();
       });
 
-  Repo::scheduler().Schedule(NewCallback(
+  scheduler_->Schedule(NewCallback(
       [](ThisRef ref, connection::ResponsePtr ptr) {
         ThisRefLock lock(&ref);
         if (lock.GetReference() != nullptr) {
@@ -1107,7 +1160,7 @@ void Repo::RerunTransactionQueue(const std::vector<TransactionDataPtr>& queue,
       // Removing a callback can trigger pruning which can muck with
       // merged_data/visible_data (as it prunes data). So defer removing the
       // callback until later.
-      Repo::scheduler().Schedule(NewCallback(
+      scheduler_->Schedule(NewCallback(
           [](Repo* repo, TransactionDataPtr transaction) {
             repo->RemoveEventCallback(transaction->outstanding_listener.get(),
                                       QuerySpec(transaction->path));
@@ -22,6 +22,7 @@
 #include "app/src/path.h"
 #include "app/src/reference_counted_future_impl.h"
 #include "app/src/safe_reference.h"
+#include "app/src/scheduler.h"
 #include "database/src/desktop/connection/persistent_connection.h"
 #include "database/src/desktop/core/event_registration.h"
 #include "database/src/desktop/core/sparse_snapshot_tree.h"
@@ -108,7 +109,20 @@ class Repo : public connection::PersistentConnectionEventHandler {
 
   const std::string& url() const { return url_; }
 
-  static scheduler::Scheduler& scheduler() { return *s_scheduler_; }
+  // The scheduler that runs all work for this Repo, in order.
+  scheduler::Scheduler& scheduler() { return *scheduler_; }
+
+  // Statistics of the scheduler this Repo runs on. As a scheduler may be
+  // shared with other Repos, this also covers their work.
+  scheduler::SchedulerStats GetSchedulerStats() {
+    return scheduler_ ? scheduler_->GetStats() : scheduler::SchedulerStats();
+  }
+
+  // Set the number of scheduler threads shared by all Repos. Each Repo is
+  // assigned to the least busy scheduler when it is created, so its work still
+  // runs in order while different Repos can run in parallel. Only affects
+  // Repos created afterwards. Defaults to 1, i.e. every Repo shares a thread.
+  static void SetSchedulerPoolSize(size_t size);
 
   ThisRef& this_ref() { return safe_this_; }
 
@@ -166,10 +180,18 @@ class Repo : public connection::PersistentConnectionEventHandler {
 
   SparseSnapshotTree on_disconnect_;
 
-  // The scheduler shared with every DatabaseInternal. It is designed to
-  // out-live any class which is using it, so that it is safe to use even in
-  // destructor.
-  static scheduler::Scheduler* s_scheduler_;
+  // Assign this Repo to a scheduler from the pool shared with every
+  // DatabaseInternal, creating the scheduler if needed.
+  static scheduler::Scheduler* AcquireScheduler();
+
+  // Unassign this Repo from its scheduler. The pool is destroyed with the last
+  // Repo.
+  static void ReleaseScheduler(scheduler::Scheduler* scheduler);
+
+  // The scheduler this Repo is assigned to. The schedulers in the pool are
+  // designed to out-live any class which is using them, so that it is safe to
+  // use even in destructor.
+  scheduler::Scheduler* scheduler_;
 
   // Caches information about the connection to the host.
   connection::HostInfo host_info_;
@@ -15,6 +15,8 @@
 #include "database/src/desktop/core/write_tree.h"
 
 #include <algorithm>
+#include <string>
+#include <utility>
 
 #include "app/src/assert.h"
 #include "database/src/desktop/core/compound_write.h"
@@ -39,6 +41,7 @@ void WriteTree::AddOverwrite(const Path& path, const Variant& snap,
   FIREBASE_DEV_ASSERT(write_id > last_write_id_);
   all_writes_.push_back(
       UserWriteRecord(write_id, path, snap, visibility == kOverwriteVisible));
+  AddWriteToIndex(write_id, path);
   if (visibility == kOverwriteVisible) {
     visible_writes_.AddWriteInline(path, snap);
   }
@@ -51,17 +54,14 @@ void WriteTree::AddMerge(const Path& path,
   // Stacking an older write on top of newer ones.
   FIREBASE_DEV_ASSERT(write_id > last_write_id_);
   all_writes_.push_back(UserWriteRecord(write_id, path, changed_children));
+  AddWriteToIndex(write_id, path);
   visible_writes_.AddWritesInline(path, changed_children);
   last_write_id_ = write_id;
 }
 
 UserWriteRecord* WriteTree::GetWrite(WriteId write_id) {
-  for (UserWriteRecord& record : all_writes_) {
-    if (record.write_id == write_id) {
-      return &record;
-    }
-  }
-  return nullptr;
+  auto iter = FindWrite(write_id);
+  return iter != all_writes_.end() ? &*iter : nullptr;
 }
 
 std::vector<UserWriteRecord> WriteTree::PurgeAllWrites() {
@@ -69,30 +69,30 @@ std::vector<UserWriteRecord> WriteTree::PurgeAllWrites() {
   // Reset everything.
   visible_writes_ = CompoundWrite();
   all_writes_.clear();
+  writes_by_path_ = Tree<std::vector<WriteId>>();
   return purged_writes;
 }
 
 bool WriteTree::RemoveWrite(WriteId write_id) {
-  UserWriteRecord write_to_remove;
-  std::vector<UserWriteRecord>::iterator iter;
-  for (iter = all_writes_.begin(); iter != all_writes_.end(); ++iter) {
-    if (iter->write_id == write_id) {
-      write_to_remove = *iter;
-      break;
-    }
-  }
+  auto iter = FindWrite(write_id);
   FIREBASE_DEV_ASSERT_MESSAGE(iter != all_writes_.end(),
                               "remove_write called with nonexistent write_id");
-
-  iter = all_writes_.erase(iter);
+  UserWriteRecord write_to_remove = std::move(*iter);
+  all_writes_.erase(iter);
+  RemoveWriteFromIndex(write_id, write_to_remove.path);
 
   bool removed_write_was_visible = write_to_remove.visible;
   bool removed_write_overlaps_with_other_writes = false;
 
-  for (auto i = all_writes_.rbegin(); i != all_writes_.rend(); ++i) {
-    UserWriteRecord& current_write = *i;
+  // Only the writes above or below the removed write can shadow it or overlap
+  // with it.
+  std::vector<const UserWriteRecord*> overlapping_writes =
+      GetWritesOverlappingPath(write_to_remove.path);
+  for (auto i = overlapping_writes.rbegin(); i != overlapping_writes.rend();
+       ++i) {
+    const UserWriteRecord& current_write = **i;
     if (current_write.visible) {
-      if (i.base() >= iter &&
+      if (current_write.write_id > write_id &&
           RecordContainsPath(current_write, write_to_remove.path)) {
         // The removed write was completely shadowed by a subsequent write.
         removed_write_was_visible = false;
@@ -203,9 +203,16 @@ Optional<Variant> WriteTree::CalcCompleteEventCache(
           }
           return false;
         };
+        // Only layer the writes which can change the data at tree_path,
+        // rather than going through every pending write.
+        CompoundWrite merge_at_path;
+        for (const UserWriteRecord* write :
+             GetWritesOverlappingPath(tree_path)) {
+          if (filter(*write, &filter_userdata)) {
+            LayerWrite(*write, tree_path, &merge_at_path);
+          }
+        }
         Variant layered_cache;
-        CompoundWrite merge_at_path = LayerTree(
-            all_writes_, filter, (void*)(&filter_userdata), tree_path);
         layered_cache = complete_server_cache != nullptr
                             ? *complete_server_cache
                             : Variant();
@@ -379,6 +386,90 @@ void WriteTree::ResetTree() {
   }
 }
 
+std::vector<UserWriteRecord>::iterator WriteTree::FindWrite(WriteId write_id) {
+  // all_writes_ is sorted by WriteId, since every new write must have a
+  // higher WriteId than the previous ones.
+  auto iter = std::lower_bound(
+      all_writes_.begin(), all_writes_.end(), write_id,
+      [](const UserWriteRecord& record, WriteId id) {
+        return record.write_id < id;
+      });
+  if (iter != all_writes_.end() && iter->write_id == write_id) {
+    return iter;
+  }
+  return all_writes_.end();
+}
+
+std::vector<const UserWriteRecord*> WriteTree::GetWritesOverlappingPath(
+    const Path& path) const {
+  std::vector<WriteId> write_ids;
+  auto add_write_ids = [&write_ids](const std::vector<WriteId>& ids) {
+    write_ids.insert(write_ids.end(), ids.begin(), ids.end());
+  };
+
+  // Collect the writes above the path...
+  const Tree<std::vector<WriteId>>* subtree = &writes_by_path_;
+  for (const std::string& directory : path.GetDirectories()) {
+    if (subtree->value().has_value()) {
+      add_write_ids(subtree->value().value());
+    }
+    subtree = subtree->GetChild(directory);
+    if (subtree == nullptr) break;
+  }
+  // ...and the writes at or below it.
+  if (subtree != nullptr) {
+    subtree->CallOnEach(Path(),
+                        [&](const Path&, const std::vector<WriteId>& ids) {
+                          add_write_ids(ids);
+                        });
+  }
+
+  std::sort(write_ids.begin(), write_ids.end());
+  std::vector<const UserWriteRecord*> writes;
+  writes.reserve(write_ids.size());
+  auto iter = all_writes_.begin();
+  for (WriteId write_id : write_ids) {
+    iter = std::lower_bound(iter, all_writes_.end(), write_id,
+                            [](const UserWriteRecord& record, WriteId id) {
+                              return record.write_id < id;
+                            });
+    FIREBASE_DEV_ASSERT(iter != all_writes_.end() &&
+                        iter->write_id == write_id);
+    writes.push_back(&*iter);
+  }
+  return writes;
+}
+
+void WriteTree::AddWriteToIndex(WriteId write_id, const Path& path) {
+  Optional<std::vector<WriteId>>& write_ids =
+      writes_by_path_.GetOrMakeSubtree(path)->value();
+  if (!write_ids.has_value()) {
+    write_ids = std::vector<WriteId>();
+  }
+  write_ids->push_back(write_id);
+}
+
+void WriteTree::RemoveWriteFromIndex(WriteId write_id, const Path& path) {
+  Tree<std::vector<WriteId>>* subtree = writes_by_path_.GetChild(path);
+  FIREBASE_DEV_ASSERT(subtree != nullptr && subtree->value().has_value());
+  std::vector<WriteId>& write_ids = subtree->value().value();
+  write_ids.erase(std::remove(write_ids.begin(), write_ids.end(), write_id),
+                  write_ids.end());
+  if (!write_ids.empty()) return;
+  subtree->value().reset();
+
+  // Prune the locations left without writes, starting from the deepest one.
+  std::vector<std::string> directories = path.GetDirectories();
+  while (!directories.empty()) {
+    std::string key = directories.back();
+    directories.pop_back();
+    Tree<std::vector<WriteId>>* parent =
+        writes_by_path_.GetChild(Path(directories));
+    if (!parent->GetChild(key)->IsEmpty()) break;
+    parent->children().erase(key);
+  }
+}
+
 CompoundWrite WriteTree::LayerTree(const std::vector<UserWriteRecord>& writes,
                                    WriteTree::UserWriteRecordPredicateFn filter,
                                    void* filter_userdata,
@@ -391,48 +482,46 @@ CompoundWrite WriteTree::LayerTree(const std::vector<UserWriteRecord>& writes,
     // b) not be relevant to a transaction (separate branch), so again will
     // not affect the data for that transaction
     if (filter(write, filter_userdata)) {
-      Path write_path = write.path;
-      if (write.is_overwrite) {
-        if (tree_root.IsParent(write_path)) {
-          Optional<Path> relative_path =
-              Path::GetRelative(tree_root, write_path);
-          compound_write =
-              compound_write.AddWrite(*relative_path, write.overwrite);
-        } else if (write_path.IsParent(tree_root)) {
-          compound_write = compound_write.AddWrite(
-              Path(),
-              VariantGetChild(&write.overwrite,
-                              *Path::GetRelative(write_path, tree_root)));
-        } else {
-          // There is no overlap between root path and write path, ignore
-          // write
-        }
+      LayerWrite(write, tree_root, &compound_write);
+    }
+  }
+  return compound_write;
+}
+
+void WriteTree::LayerWrite(const UserWriteRecord& write, const Path& tree_root,
+                           CompoundWrite* compound_write) {
+  const Path& write_path = write.path;
+  if (write.is_overwrite) {
+    if (tree_root.IsParent(write_path)) {
+      Optional<Path> relative_path = Path::GetRelative(tree_root, write_path);
+      *compound_write =
+          compound_write->AddWrite(*relative_path, write.overwrite);
+    } else if (write_path.IsParent(tree_root)) {
+      *compound_write = compound_write->AddWrite(
+          Path(), VariantGetChild(&write.overwrite,
+                                  *Path::GetRelative(write_path, tree_root)));
+    } else {
+      // There is no overlap between root path and write path, ignore write
+    }
+  } else {
+    if (tree_root.IsParent(write_path)) {
+      Optional<Path> relative_path = Path::GetRelative(tree_root, write_path);
+      *compound_write = compound_write->AddWrites(*relative_path, write.merge);
+    } else if (write_path.IsParent(tree_root)) {
+      Optional<Path> relative_path = Path::GetRelative(write_path, tree_root);
+      if (relative_path->empty()) {
+        *compound_write = compound_write->AddWrites(Path(), write.merge);
       } else {
-        if (tree_root.IsParent(write_path)) {
-          Optional<Path> relative_path =
-              Path::GetRelative(tree_root, write_path);
-          compound_write =
-              compound_write.AddWrites(*relative_path, write.merge);
-        } else if (write_path.IsParent(tree_root)) {
-          Optional<Path> relative_path =
-              Path::GetRelative(write_path, tree_root);
-          if (relative_path->empty()) {
-            compound_write = compound_write.AddWrites(Path(), write.merge);
-          } else {
-            Optional<Variant> deep_node =
-                write.merge.GetCompleteVariant(*relative_path);
-            if (deep_node.has_value()) {
-              compound_write = compound_write.AddWrite(Path(), deep_node);
-            }
-          }
-        } else {
-          // There is no overlap between root path and write path, ignore
-          // write
+        Optional<Variant> deep_node =
+            write.merge.GetCompleteVariant(*relative_path);
+        if (deep_node.has_value()) {
+          *compound_write = compound_write->AddWrite(Path(), deep_node);
         }
       }
+    } else {
+      // There is no overlap between root path and write path, ignore write
     }
   }
-  return compound_write;
 }
 
 WriteTreeRef::WriteTreeRef(const Path& path, WriteTree* write_tree)
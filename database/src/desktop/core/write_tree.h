@@ -23,6 +23,7 @@
 #include "app/src/optional.h"
 #include "app/src/path.h"
 #include "database/src/desktop/core/compound_write.h"
+#include "database/src/desktop/core/tree.h"
 #include "database/src/desktop/persistence/persistence_storage_engine.h"
 #include "database/src/desktop/view/view_cache.h"
 
@@ -118,7 +119,11 @@ class WriteTree {
   // calculate the result of merging them with underlying server data (to create
   // "event cache" data). Pending writes are added with AddOverwrite() and
   // AddMerge(), and removed with RemoveWrite().
-  WriteTree() : visible_writes_(), all_writes_(), last_write_id_(-1L) {}
+  WriteTree()
+      : visible_writes_(),
+        all_writes_(),
+        writes_by_path_(),
+        last_write_id_(-1L) {}
 
   virtual ~WriteTree() {}
 
@@ -223,6 +228,23 @@ class WriteTree {
   // event snapshots
   void ResetTree();
 
+  // Returns the position of the write with the given WriteId in all_writes_,
+  // or all_writes_.end() if there is no such write.
+  std::vector<UserWriteRecord>::iterator FindWrite(WriteId write_id);
+
+  // Returns the writes at, above or below the given path, in the order they
+  // were added. These are the only writes that can change the data at the
+  // path.
+  std::vector<const UserWriteRecord*> GetWritesOverlappingPath(
+      const Path& path) const;
+
+  // Add the WriteId of a write to writes_by_path_.
+  void AddWriteToIndex(WriteId write_id, const Path& path);
+
+  // Remove the WriteId of a write from writes_by_path_, along with any
+  // location left without writes.
+  void RemoveWriteFromIndex(WriteId write_id, const Path& path);
+
   typedef bool (*UserWriteRecordPredicateFn)(const UserWriteRecord& record,
                                              void* userdata);
 
@@ -232,6 +254,11 @@ class WriteTree {
                                  UserWriteRecordPredicateFn filter,
                                  void* userdata, const Path& tree_root);
 
+  // Static method. Add the part of the write that overlaps the given path to
+  // a merge at that path.
+  static void LayerWrite(const UserWriteRecord& write, const Path& tree_root,
+                         CompoundWrite* compound_write);
+
   // A tree tracking the result of applying all visible writes. This does not
   // include transactions with apply_locally=false or writes that are completely
   // shadowed by other writes.
@@ -243,6 +270,11 @@ class WriteTree {
   // transactions).
   std::vector<UserWriteRecord> all_writes_;
 
+  // The WriteIds of all pending writes, indexed by the path of each write.
+  // Used to find the writes overlapping a path without going through all of
+  // them.
+  Tree<std::vector<WriteId>> writes_by_path_;
+
   // The last WriteId seen by the tree through AddOverwrite or AddMerge. The
   // The WriteId passed to these functions should always be larger than the last
   // one seen.
@@ -137,7 +137,7 @@ DatabaseReference DatabaseInternal::GetReferenceFromUrl(const char* url) {
 
 void DatabaseInternal::GoOffline() {
   EnsureRepo();
-  Repo::scheduler().Schedule(NewCallback(
+  repo_->scheduler().Schedule(NewCallback(
       [](Repo::ThisRef ref) {
         Repo::ThisRefLock lock(&ref);
         if (lock.GetReference() != nullptr) {
@@ -149,7 +149,7 @@ void DatabaseInternal::GoOffline() {
 
 void DatabaseInternal::GoOnline() {
   EnsureRepo();
-  Repo::scheduler().Schedule(NewCallback(
+  repo_->scheduler().Schedule(NewCallback(
       [](Repo::ThisRef ref) {
         Repo::ThisRefLock lock(&ref);
         if (lock.GetReference() != nullptr) {
@@ -161,7 +161,7 @@ void DatabaseInternal::GoOnline() {
 
 void DatabaseInternal::PurgeOutstandingWrites() {
   EnsureRepo();
-  Repo::scheduler().Schedule(NewCallback(
+  repo_->scheduler().Schedule(NewCallback(
       [](Repo::ThisRef ref) {
         Repo::ThisRefLock lock(&ref);
         if (lock.GetReference() != nullptr) {
@@ -187,6 +187,28 @@ void DatabaseInternal::SetPersistenceEnabled(bool enabled) {
   }
 }
 
+void DatabaseInternal::set_scheduler_pool_size(size_t size) {
+  Repo::SetSchedulerPoolSize(size);
+}
+
+scheduler::SchedulerStats DatabaseInternal::GetSchedulerStats() {
+  EnsureRepo();
+  return repo_->GetSchedulerStats();
+}
+
+void DatabaseInternal::set_write_batching(int window_ms, size_t max_writes) {
+  EnsureRepo();
+  repo_->scheduler().Schedule(NewCallback(
+      [](Repo::ThisRef ref, int window_ms, size_t max_writes) {
+        Repo::ThisRefLock lock(&ref);
+        if (lock.GetReference() != nullptr) {
+          lock.GetReference()->connection()->SetWriteBatching(window_ms,
+                                                              max_writes);
+        }
+      },
+      repo_->this_ref(), window_ms, max_writes));
+}
+
 void DatabaseInternal::set_log_level(LogLevel log_level) {
   logger_.SetLogLevel(log_level);
 }
@@ -93,6 +93,18 @@ class DatabaseInternal {
 
   void SetPersistenceEnabled(bool enabled);
 
+  // Set the number of schedulers shared by all Repos created afterwards, in
+  // every DatabaseInternal of the process.
+  static void set_scheduler_pool_size(size_t size);
+
+  // Statistics of the scheduler this database runs its work on.
+  scheduler::SchedulerStats GetSchedulerStats();
+
+  // Combine the writes issued within window_ms of each other, up to
+  // max_writes of them, into a single update.  See
+  // PersistentConnection::SetWriteBatching().
+  void set_write_batching(int window_ms, size_t max_writes);
+
   // Set the logging verbosity.
   void set_log_level(LogLevel log_level);
 
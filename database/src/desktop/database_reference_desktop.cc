@@ -123,7 +123,7 @@ Future<void> DatabaseReferenceInternal::RemoveValue() {
   SafeFutureHandle<void> handle =
       ref_future()->SafeAlloc<void>(kDatabaseReferenceFnRemoveValue);
 
-  Repo::scheduler().Schedule(NewCallback(
+  database_->repo()->scheduler().Schedule(NewCallback(
       [](Repo* repo, Path path, ReferenceCountedFutureImpl* api,
          SafeFutureHandle<void> handle) {
         repo->SetValue(path, Variant::Null(), api, handle);
@@ -143,7 +143,7 @@ Future<DataSnapshot> DatabaseReferenceInternal::RunTransaction(
   SafeFutureHandle<DataSnapshot> handle = ref_future()->SafeAlloc<DataSnapshot>(
       kDatabaseReferenceFnRunTransaction, DataSnapshot(nullptr));
 
-  Repo::scheduler().Schedule(NewCallback(
+  database_->repo()->scheduler().Schedule(NewCallback(
       [](Repo* repo, Path path, DoTransactionWithContext transaction_function,
          void* context, void (*delete_context)(void*),
          bool trigger_local_events, ReferenceCountedFutureImpl* api,
@@ -173,7 +173,7 @@ Future<void> DatabaseReferenceInternal::SetPriority(const Variant& priority) {
     ref_future()->Complete(handle, kErrorInvalidVariantType,
                            kErrorMsgInvalidVariantForPriority);
   } else {
-    Repo::scheduler().Schedule(NewCallback(
+    database_->repo()->scheduler().Schedule(NewCallback(
         [](Repo* repo, Path path, Variant priority,
            ReferenceCountedFutureImpl* api, SafeFutureHandle<void> handle) {
           ConvertVectorToMap(&priority);
@@ -197,7 +197,7 @@ Future<void> DatabaseReferenceInternal::SetValue(const Variant& value) {
     ref_future()->Complete(handle, kErrorConflictingOperationInProgress,
                            kErrorMsgConflictSetValue);
   } else {
-    Repo::scheduler().Schedule(NewCallback(
+    database_->repo()->scheduler().Schedule(NewCallback(
         [](Repo* repo, Path path, Variant value,
            ReferenceCountedFutureImpl* api, SafeFutureHandle<void> handle) {
           ConvertVectorToMap(&value);
@@ -244,7 +244,7 @@ Future<void> DatabaseReferenceInternal::SetValueAndPriority(
           std::make_pair(kVirtualChildKeyValue, value),
           std::make_pair(kVirtualChildKeyPriority, priority)};
     }
-    Repo::scheduler().Schedule(NewCallback(
+    database_->repo()->scheduler().Schedule(NewCallback(
         [](Repo* repo, Path path, Variant value_priority,
            ReferenceCountedFutureImpl* api, SafeFutureHandle<void> handle) {
           ConvertVectorToMap(&value_priority);
@@ -268,7 +268,7 @@ Future<void> DatabaseReferenceInternal::UpdateChildren(const Variant& values) {
     ref_future()->Complete(handle, kErrorInvalidVariantType,
                            kErrorMsgInvalidVariantForUpdateChildren);
   } else {
-    Repo::scheduler().Schedule(NewCallback(
+    database_->repo()->scheduler().Schedule(NewCallback(
         [](Repo* repo, Path path, Variant values,
            ReferenceCountedFutureImpl* api, SafeFutureHandle<void> handle) {
           ConvertVectorToMap(&values);
@@ -216,7 +216,7 @@ void QueryInternal::AddEventRegistration(
     UniquePtr<EventRegistration> registration, void* listener_ptr) {
   database_->AddEventRegistration(query_spec_, listener_ptr,
                                   registration.get());
-  Repo::scheduler().Schedule(NewCallback(
+  database_->repo()->scheduler().Schedule(NewCallback(
       [](Repo::ThisRef ref, UniquePtr<EventRegistration> registration) {
         Repo::ThisRefLock lock(&ref);
         if (lock.GetReference() != nullptr) {
@@ -239,7 +239,7 @@ void QueryInternal::RemoveEventRegistration(void* listener_ptr,
     registration->set_status(EventRegistration::kRemoved);
   }
 
-  Repo::scheduler().Schedule(NewCallback(
+  database_->repo()->scheduler().Schedule(NewCallback(
       [](Repo::ThisRef ref, void* listener_ptr, QuerySpec query_spec) {
         Repo::ThisRefLock lock(&ref);
         if (lock.GetReference() != nullptr) {
@@ -283,7 +283,7 @@ DatabaseReferenceInternal* QueryInternal::GetReference() {
 }
 
 void QueryInternal::SetKeepSynchronized(bool keep_synchronized) {
-  Repo::scheduler().Schedule(NewCallback(
+  database_->repo()->scheduler().Schedule(NewCallback(
       [](Repo::ThisRef ref, QuerySpec query_spec, bool keep_synchronized) {
         Repo::ThisRefLock lock(&ref);
         if (lock.GetReference() != nullptr) {
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -748,7 +749,7 @@ const std::string& GetBase64SHA1(const std::string& input,
   return *output;
 }
 
-void AppendHashRepAsDouble(std::stringstream* ss, double value) {
+void AppendHashRepAsDouble(std::string* output, double value) {
   uint64_t bits;
   memcpy(&bits, &value, sizeof(value));
 
@@ -757,16 +758,17 @@ void AppendHashRepAsDouble(std::stringstream* ss, double value) {
     uint8_t byteValue = static_cast<uint8_t>((bits >> (8 * i)) & 0xff);
     uint8_t high = ((byteValue >> 4) & 0xf);
     uint8_t low = (byteValue & 0xf);
-    *ss << static_cast<char>(high < 10 ? '0' + high : 'a' + high - 10);
-    *ss << static_cast<char>(low < 10 ? '0' + low : 'a' + low - 10);
+    output->push_back(
+        static_cast<char>(high < 10 ? '0' + high : 'a' + high - 10));
+    output->push_back(
+        static_cast<char>(low < 10 ? '0' + low : 'a' + low - 10));
   }
 }
 
 // Private function to serialize a fundamental typed Variant to a hash
 // representation format.
-void AppendHashRepAsFundamental(std::stringstream* ss, const Variant& data) {
+void AppendHashRepAsFundamental(std::string* output, const Variant& data) {
   assert(data.is_fundamental_type());
-  assert(ss != nullptr);
 
   switch (data.type()) {
     case Variant::kTypeNull:
@@ -774,23 +776,23 @@ void AppendHashRepAsFundamental(std::stringstream* ss, const Variant& data) {
       break;
     case Variant::kTypeStaticString:
     case Variant::kTypeMutableString: {
-      *ss << "string:";
+      output->append("string:");
       // Note: Use HashVersion.V1 since ChildrenNode only support V1
       //       HashVersion.V2 would convert '\\' to "\\\\" and '"' to "\\\""
       //       and is used for CompoundHash
-      *ss << data.string_value();
+      output->append(data.string_value());
     } break;
     case Variant::kTypeBool:
-      *ss << "boolean:" << (data.bool_value() ? "true" : "false");
+      output->append(data.bool_value() ? "boolean:true" : "boolean:false");
       break;
     case Variant::kTypeDouble:
-      *ss << "number:";
-      AppendHashRepAsDouble(ss, data.double_value());
+      output->append("number:");
+      AppendHashRepAsDouble(output, data.double_value());
       break;
     case Variant::kTypeInt64:
-      *ss << "number:";
+      output->append("number:");
       // This conversion is agreed in all platforms, including the server
-      AppendHashRepAsDouble(ss, static_cast<double>(data.int64_value()));
+      AppendHashRepAsDouble(output, static_cast<double>(data.int64_value()));
       break;
     default:
       break;
@@ -870,8 +872,12 @@ int ChildKeyCompareTo(const Variant& left, const Variant& right) {
   }
 }
 
+// Private function to hash a node into output, appending nothing if the node
+// is empty. Returns true if a hash was appended.
+bool AppendHash(const Variant& data, std::string* output);
+
 // Private function to serialize all child nodes
-void ProcessChildNodes(std::stringstream* ss,
+void ProcessChildNodes(std::string* output,
                        std::vector<NodeSortingData>* nodes, bool saw_priority) {
   // If any node has priority, sort using priority.
   if (saw_priority) {
@@ -886,19 +892,26 @@ void ProcessChildNodes(std::stringstream* ss,
               });
   }
 
-  // Serialize each child with its key and its hashed value
+  // Serialize each child with its key and its hashed value. The hash is
+  // written straight after the key and dropped again if the child is empty.
   for (auto& node : *nodes) {
-    std::string hash;
-    if (!GetHash(*node.second, &hash).empty()) {
-      *ss << ':' << node.first->string_value() << ':' << hash;
+    size_t rollback_size = output->size();
+    output->push_back(':');
+    output->append(node.first->string_value());
+    output->push_back(':');
+    if (!AppendHash(*node.second, output)) {
+      output->resize(rollback_size);
     }
   }
 }
 
-// Private function to process node with children, such as map and list
-void AppendHashRepAsContainer(std::stringstream* ss, const Variant& data) {
+// Private function to process node with children, such as map and list.
+// If skip_priority is set, the ".priority" entry of a map is not serialized as
+// a child.
+void AppendHashRepAsContainer(std::string* output, const Variant& data,
+                              bool skip_priority) {
   assert(data.is_container_type());
-  assert(ss != nullptr);
+  assert(output != nullptr);
 
   std::vector<NodeSortingData> nodes;
 
@@ -908,84 +921,100 @@ void AppendHashRepAsContainer(std::stringstream* ss, const Variant& data) {
     // This is to avoid making copies of Variant from data.
     std::vector<Variant> index_variants;
     index_variants.reserve(data.vector().size());
+    nodes.reserve(data.vector().size());
     bool saw_priority = false;
     for (int i = 0; i < data.vector().size(); ++i) {
-      std::stringstream index_stream;
-      index_stream << i;
-      index_variants.push_back(index_stream.str());
+      index_variants.push_back(std::to_string(i));
       nodes.push_back(NodeSortingData(&index_variants[i], &data.vector()[i]));
       saw_priority =
           saw_priority || !GetVariantPriority(data.vector()[i]).is_null();
     }
-    ProcessChildNodes(ss, &nodes, saw_priority);
+    ProcessChildNodes(output, &nodes, saw_priority);
   } else if (data.is_map()) {
+    nodes.reserve(data.map().size());
     bool saw_priority = false;
     for (auto& it_child : data.map()) {
+      if (skip_priority && it_child.first.is_string() &&
+          strcmp(it_child.first.string_value(), kPriorityKey) == 0) {
+        continue;
+      }
       nodes.push_back(NodeSortingData(&it_child.first, &it_child.second));
       saw_priority =
           saw_priority || !GetVariantPriority(it_child.second).is_null();
     }
-    ProcessChildNodes(ss, &nodes, saw_priority);
+    ProcessChildNodes(output, &nodes, saw_priority);
   }
 }
 
 // Private function to determine if the container typed Variant actually has
 // children nodes or just a LeafNode with priority.
 // If a map typed Variant contains ".priority", serialize the priority first.
-void CheckHashRepAsContainer(std::stringstream* ss, const Variant& data) {
+void CheckHashRepAsContainer(std::string* output, const Variant& data) {
   assert(data.is_container_type());
-  assert(ss != nullptr);
+  assert(output != nullptr);
   if (data.is_map()) {
     auto& map = data.map();
     auto priority_iter = map.find(kPriorityKey);
     if (priority_iter != map.end()) {
       auto& priority = priority_iter->second;
       assert(priority.is_fundamental_type());
-      *ss << "priority:";
-      AppendHashRepAsFundamental(ss, priority);
-      *ss << ":";
-
-      // Determine if this Variant just a LeafNode with priority.
-      Variant prune = data;
-      PrunePriorities(&prune, false);
-      if (prune.is_fundamental_type()) {
-        AppendHashRepAsFundamental(ss, prune);
+      output->append("priority:");
+      AppendHashRepAsFundamental(output, priority);
+      output->push_back(':');
+
+      // Determine if this Variant just a LeafNode with priority. This is
+      // equivalent to serializing the Variant after PrunePriorities(), without
+      // copying it.
+      auto value_iter = map.find(kValueKey);
+      if (value_iter == map.end()) {
+        AppendHashRepAsContainer(output, data, true);
+      } else if (value_iter->second.is_fundamental_type()) {
+        AppendHashRepAsFundamental(output, value_iter->second);
       } else {
-        AppendHashRepAsContainer(ss, prune);
+        AppendHashRepAsContainer(output, value_iter->second, false);
       }
     } else {
-      AppendHashRepAsContainer(ss, data);
+      AppendHashRepAsContainer(output, data, false);
     }
   } else {
-    AppendHashRepAsContainer(ss, data);
+    AppendHashRepAsContainer(output, data, false);
   }
 }
 
-const std::string& GetHashRepresentation(const Variant& data,
-                                         std::string* output) {
-  assert(output != nullptr);
+// Private function to append the hash representation of data to output.
+void AppendHashRepresentation(const Variant& data, std::string* output) {
   assert(data.is_container_type() || data.is_fundamental_type());
 
-  std::stringstream ss;
-
   if (data.is_fundamental_type()) {
-    AppendHashRepAsFundamental(&ss, data);
+    AppendHashRepAsFundamental(output, data);
   } else {
-    CheckHashRepAsContainer(&ss, data);
+    CheckHashRepAsContainer(output, data);
   }
+}
 
-  *output = ss.str();
+bool AppendHash(const Variant& data, std::string* output) {
+  // Each node is hashed exactly once, bottom up: a parent's representation
+  // only contains the hashes of its children, never their representations.
+  std::string hash_rep;
+  AppendHashRepresentation(data, &hash_rep);
+  if (hash_rep.empty()) return false;
+  std::string base64_encoded;
+  output->append(GetBase64SHA1(hash_rep, &base64_encoded));
+  return true;
+}
+
+const std::string& GetHashRepresentation(const Variant& data,
+                                         std::string* output) {
+  assert(output != nullptr);
+  output->clear();
+  AppendHashRepresentation(data, output);
   return *output;
 }
 
 const std::string& GetHash(const Variant& data, std::string* output) {
   assert(output != nullptr);
-
-  std::string hash_rep;
-  GetHashRepresentation(data, &hash_rep);
-  std::string base64_encoded;
-
-  *output = hash_rep.empty() ? "" : GetBase64SHA1(hash_rep, &base64_encoded);
+  output->clear();
+  AppendHash(data, output);
   return *output;
 }
 
@@ -14,6 +14,8 @@
 
 #include "database/src/desktop/view/indexed_filter.h"
 
+#include <utility>
+
 #include "app/src/assert.h"
 #include "app/src/path.h"
 #include "database/src/common/query_spec.h"
@@ -27,7 +29,7 @@ namespace internal {
 IndexedFilter::~IndexedFilter() {}
 
 IndexedVariant IndexedFilter::UpdateChild(
-    const IndexedVariant& indexed_variant, const std::string& key,
+    IndexedVariant indexed_variant, const std::string& key,
     const Variant& new_child, const Path& affected_path,
     const CompleteChildSource* source,
     ChildChangeAccumulator* opt_change_accumulator) const {
@@ -69,12 +71,12 @@ IndexedVariant IndexedFilter::UpdateChild(
     return indexed_variant;
   } else {
     // Make sure the variant is indexed.
-    return indexed_variant.UpdateChild(key, new_child);
+    return std::move(indexed_variant).UpdateChild(key, new_child);
   }
 }
 
 IndexedVariant IndexedFilter::UpdateFullVariant(
-    const IndexedVariant& old_snap, const IndexedVariant& new_snap,
+    const IndexedVariant& old_snap, IndexedVariant new_snap,
     ChildChangeAccumulator* opt_change_accumulator) const {
   FIREBASE_DEV_ASSERT_MESSAGE(
       new_snap.query_params().order_by == query_params().order_by,
@@ -127,11 +129,11 @@ IndexedVariant IndexedFilter::UpdateFullVariant(
 }
 
 IndexedVariant IndexedFilter::UpdatePriority(
-    const IndexedVariant& old_snap, const Variant& new_priority) const {
+    IndexedVariant old_snap, const Variant& new_priority) const {
   if (old_snap.variant().is_null()) {
     return old_snap;
   } else {
-    return old_snap.UpdatePriority(new_priority);
+    return std::move(old_snap).UpdatePriority(new_priority);
   }
 }
 
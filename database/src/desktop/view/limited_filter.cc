@@ -14,6 +14,8 @@
 
 #include "database/src/desktop/view/limited_filter.h"
 
+#include <utility>
+
 #include "app/src/assert.h"
 #include "app/src/path.h"
 #include "database/src/common/query_spec.h"
@@ -35,7 +37,7 @@ LimitedFilter::LimitedFilter(const QueryParams& params)
 LimitedFilter::~LimitedFilter() {}
 
 IndexedVariant LimitedFilter::UpdateChild(
-    const IndexedVariant& indexed_variant, const std::string& key,
+    IndexedVariant indexed_variant, const std::string& key,
     const Variant& new_child, const Path& affected_path,
     const CompleteChildSource* source,
     ChildChangeAccumulator* opt_change_accumulator) const {
@@ -54,11 +56,11 @@ IndexedVariant LimitedFilter::UpdateChild(
                          : 0;
   if (size < limit_) {
     return ranged_filter_->GetIndexedFilter()->UpdateChild(
-        indexed_variant, key, variant, affected_path, source,
+        std::move(indexed_variant), key, variant, affected_path, source,
         opt_change_accumulator);
   } else {
-    return FullLimitUpdateChild(indexed_variant, key, variant, source,
-                                opt_change_accumulator);
+    return FullLimitUpdateChild(std::move(indexed_variant), key, variant,
+                                source, opt_change_accumulator);
   }
 }
 
@@ -82,15 +84,15 @@ IndexedVariant UpdateFullVariantHelper(
     if (in_range) {
       count++;
     } else {
-      filtered =
-          filtered.UpdateChild(next.first.string_value(), Variant::Null());
+      filtered = std::move(filtered).UpdateChild(next.first.string_value(),
+                                                 Variant::Null());
     }
   }
   return filtered;
 }
 
 IndexedVariant LimitedFilter::UpdateFullVariant(
-    const IndexedVariant& old_snap, const IndexedVariant& new_snap,
+    const IndexedVariant& old_snap, IndexedVariant new_snap,
     ChildChangeAccumulator* opt_change_accumulator) const {
   IndexedVariant filtered;
   if (VariantIsLeaf(new_snap.variant()) || VariantIsEmpty(new_snap.variant())) {
@@ -102,22 +104,22 @@ IndexedVariant LimitedFilter::UpdateFullVariant(
     filtered = new_snap.UpdatePriority(Variant::Null());
     if (reverse_) {
       filtered = UpdateFullVariantHelper(
-          filtered, limit_, new_snap.index().rbegin(), new_snap.index().rend(),
-          ranged_filter_->end_post(), ranged_filter_->start_post(), -1,
-          query_params());
+          std::move(filtered), limit_, new_snap.index().rbegin(),
+          new_snap.index().rend(), ranged_filter_->end_post(),
+          ranged_filter_->start_post(), -1, query_params());
     } else {
       filtered = UpdateFullVariantHelper(
-          filtered, limit_, new_snap.index().begin(), new_snap.index().end(),
-          ranged_filter_->start_post(), ranged_filter_->end_post(), 1,
-          query_params());
+          std::move(filtered), limit_, new_snap.index().begin(),
+          new_snap.index().end(), ranged_filter_->start_post(),
+          ranged_filter_->end_post(), 1, query_params());
     }
   }
   return ranged_filter_->GetIndexedFilter()->UpdateFullVariant(
-      old_snap, filtered, opt_change_accumulator);
+      old_snap, std::move(filtered), opt_change_accumulator);
 }
 
 IndexedVariant LimitedFilter::UpdatePriority(
-    const IndexedVariant& old_snap, const Variant& new_priority) const {
+    IndexedVariant old_snap, const Variant& new_priority) const {
   return old_snap;
 }
 
@@ -128,7 +130,7 @@ const VariantFilter* LimitedFilter::GetIndexedFilter() const {
 bool LimitedFilter::FiltersVariants() const { return true; }
 
 IndexedVariant LimitedFilter::FullLimitUpdateChild(
-    const IndexedVariant& old_indexed, const std::string& child_key,
+    IndexedVariant old_indexed, const std::string& child_key,
     const Variant& child_snap, const CompleteChildSource* source,
     ChildChangeAccumulator* opt_change_accumulator) const {
   std::pair<Variant, Variant> new_child_node(child_key, child_snap);
@@ -168,14 +170,14 @@ IndexedVariant LimitedFilter::FullLimitUpdateChild(
             ChildChangedChange(child_key, child_snap, *old_child_snap),
             opt_change_accumulator);
       }
-      return old_indexed.UpdateChild(child_key, child_snap);
+      return std::move(old_indexed).UpdateChild(child_key, child_snap);
     } else {
       if (opt_change_accumulator) {
         TrackChildChange(ChildRemovedChange(child_key, *old_child_snap),
                          opt_change_accumulator);
       }
       IndexedVariant new_indexed =
-          old_indexed.UpdateChild(child_key, Variant::Null());
+          std::move(old_indexed).UpdateChild(child_key, Variant::Null());
       bool next_child_in_range =
           next_child.has_value() && ranged_filter_->Matches(*next_child);
       if (next_child_in_range) {
@@ -184,8 +186,8 @@ IndexedVariant LimitedFilter::FullLimitUpdateChild(
                                             next_child->second),
                            opt_change_accumulator);
         }
-        return new_indexed.UpdateChild(next_child->first.string_value(),
-                                       next_child->second);
+        return std::move(new_indexed).UpdateChild(
+            next_child->first.string_value(), next_child->second);
       } else {
         return new_indexed;
       }
@@ -203,7 +205,8 @@ IndexedVariant LimitedFilter::FullLimitUpdateChild(
         TrackChildChange(ChildAddedChange(child_key, child_snap),
                          opt_change_accumulator);
       }
-      return old_indexed.UpdateChild(child_key, child_snap)
+      return std::move(old_indexed)
+          .UpdateChild(child_key, child_snap)
           .UpdateChild(window_boundary->first.string_value(), Variant::Null());
     } else {
       return old_indexed;
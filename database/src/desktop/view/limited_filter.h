@@ -36,16 +36,16 @@ class LimitedFilter : public VariantFilter {
   ~LimitedFilter() override;
 
   IndexedVariant UpdateChild(
-      const IndexedVariant& indexed_variant, const std::string& key,
+      IndexedVariant indexed_variant, const std::string& key,
       const Variant& new_child, const Path& affected_path,
       const CompleteChildSource* source,
       ChildChangeAccumulator* opt_change_accumulator) const override;
 
   IndexedVariant UpdateFullVariant(
-      const IndexedVariant& old_snap, const IndexedVariant& new_snap,
+      const IndexedVariant& old_snap, IndexedVariant new_snap,
       ChildChangeAccumulator* opt_change_accumulator) const override;
 
-  IndexedVariant UpdatePriority(const IndexedVariant& old_snap,
+  IndexedVariant UpdatePriority(IndexedVariant old_snap,
                                 const Variant& new_priority) const override;
 
   const VariantFilter* GetIndexedFilter() const override;
@@ -54,7 +54,7 @@ class LimitedFilter : public VariantFilter {
 
  private:
   IndexedVariant FullLimitUpdateChild(
-      const IndexedVariant& old_indexed, const std::string& childKey,
+      IndexedVariant old_indexed, const std::string& childKey,
       const Variant& childSnap, const CompleteChildSource* source,
       ChildChangeAccumulator* opt_change_accumulator) const;
 
@@ -36,18 +36,18 @@ RangedFilter::RangedFilter(const QueryParams& params)
 RangedFilter::~RangedFilter() {}
 
 IndexedVariant RangedFilter::UpdateChild(
-    const IndexedVariant& indexed_variant, const std::string& key,
+    IndexedVariant indexed_variant, const std::string& key,
     const Variant& new_child, const Path& affected_path,
     const CompleteChildSource* source,
     ChildChangeAccumulator* opt_change_accumulator) const {
   const Variant& variant = Matches(key, new_child) ? new_child : kNullVariant;
-  return indexed_filter_->UpdateChild(indexed_variant, key, variant,
-                                      affected_path, source,
+  return indexed_filter_->UpdateChild(std::move(indexed_variant), key,
+                                      variant, affected_path, source,
                                       opt_change_accumulator);
 }
 
 IndexedVariant RangedFilter::UpdateFullVariant(
-    const IndexedVariant& old_snap, const IndexedVariant& new_snap,
+    const IndexedVariant& old_snap, IndexedVariant new_snap,
     ChildChangeAccumulator* opt_change_accumulator) const {
   IndexedVariant filtered;
   if (VariantIsLeaf(new_snap.variant())) {
@@ -60,17 +60,17 @@ IndexedVariant RangedFilter::UpdateFullVariant(
     if (new_snap.variant().is_map()) {
       for (const auto& child : new_snap.variant().map()) {
         if (!Matches(child)) {
-          filtered = filtered.UpdateChild(child.first.AsString().string_value(),
-                                          Variant::Null());
+          filtered = std::move(filtered).UpdateChild(
+              child.first.AsString().string_value(), Variant::Null());
         }
       }
     }
   }
-  return indexed_filter_->UpdateFullVariant(old_snap, filtered,
+  return indexed_filter_->UpdateFullVariant(old_snap, std::move(filtered),
                                             opt_change_accumulator);
 }
 
-IndexedVariant RangedFilter::UpdatePriority(const IndexedVariant& old_snap,
+IndexedVariant RangedFilter::UpdatePriority(IndexedVariant old_snap,
                                             const Variant& new_priority) const {
   // Don't support priorities on queries.
   return old_snap;
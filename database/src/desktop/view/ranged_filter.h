@@ -39,16 +39,16 @@ class RangedFilter : public VariantFilter {
   ~RangedFilter() override;
 
   IndexedVariant UpdateChild(
-      const IndexedVariant& indexed_variant, const std::string& key,
+      IndexedVariant indexed_variant, const std::string& key,
       const Variant& new_child, const Path& affected_path,
       const CompleteChildSource* source,
       ChildChangeAccumulator* opt_change_accumulator) const override;
 
   IndexedVariant UpdateFullVariant(
-      const IndexedVariant& old_snap, const IndexedVariant& new_snap,
+      const IndexedVariant& old_snap, IndexedVariant new_snap,
       ChildChangeAccumulator* opt_change_accumulator) const override;
 
-  IndexedVariant UpdatePriority(const IndexedVariant& old_snap,
+  IndexedVariant UpdatePriority(IndexedVariant old_snap,
                                 const Variant& new_priority) const override;
 
   const VariantFilter* GetIndexedFilter() const override;
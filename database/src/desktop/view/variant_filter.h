@@ -59,8 +59,10 @@ class VariantFilter {
 
   // Update a single complete child in the snap. If the child equals the old
   // child in the snap, this is a no-op. The method expects an indexed snap.
+  // The snaps being updated are taken by value, so a caller that moves its
+  // snap in has it updated in place rather than copied.
   virtual IndexedVariant UpdateChild(
-      const IndexedVariant& indexed_variant, const std::string& key,
+      IndexedVariant indexed_variant, const std::string& key,
       const Variant& new_child, const Path& affected_path,
       const CompleteChildSource* source,
       ChildChangeAccumulator* opt_change_accumulator) const = 0;
@@ -68,11 +70,11 @@ class VariantFilter {
   // Update a variant in full and output any resulting change from this
   // complete update.
   virtual IndexedVariant UpdateFullVariant(
-      const IndexedVariant& old_snap, const IndexedVariant& new_snap,
+      const IndexedVariant& old_snap, IndexedVariant new_snap,
       ChildChangeAccumulator* opt_change_accumulator) const = 0;
 
   // Update the priority of the root variant
-  virtual IndexedVariant UpdatePriority(const IndexedVariant& old_snap,
+  virtual IndexedVariant UpdatePriority(IndexedVariant old_snap,
                                         const Variant& new_priority) const = 0;
 
   // Returns true if children might be filtered due to query criteria.
@@ -15,6 +15,7 @@
 #include "database/src/desktop/view/view_processor.h"
 
 #include <algorithm>
+#include <utility>
 #include <vector>
 
 #include "app/src/assert.h"
@@ -205,8 +206,8 @@ ViewCache ViewProcessor::RevertUserWrite(
           view_cache.server_snap().variant());
     }
     IndexedVariant indexed_node(*new_node, filter_->query_params());
-    new_local_cache =
-        filter_->UpdateFullVariant(old_event_cache, indexed_node, accumulator);
+    new_local_cache = filter_->UpdateFullVariant(
+        old_event_cache, std::move(indexed_node), accumulator);
   } else {
     Optional<Variant> new_child =
         writes_cache.CalcCompleteChild(child_key, view_cache.server_snap());
@@ -240,8 +241,8 @@ ViewCache ViewProcessor::RevertUserWrite(
           view_cache.GetCompleteServerSnap());
       if (complete.has_value() && VariantIsLeaf(*complete)) {
         IndexedVariant indexed_node(*complete, filter_->query_params());
-        new_local_cache = filter_->UpdateFullVariant(new_local_cache,
-                                                     indexed_node, accumulator);
+        new_local_cache = filter_->UpdateFullVariant(
+            new_local_cache, std::move(indexed_node), accumulator);
       }
     }
   }
@@ -308,7 +309,8 @@ ViewCache ViewProcessor::GenerateEventCacheAfterServerEvent(
     IndexedVariant indexed_node(*node_with_local_writes,
                                 filter_->query_params());
     new_local_cache = filter_->UpdateFullVariant(
-        view_cache.local_snap().indexed_variant(), indexed_node, accumulator);
+        view_cache.local_snap().indexed_variant(), std::move(indexed_node),
+        accumulator);
   } else {
     std::vector<std::string> directories = change_path.GetDirectories();
     std::string child_key = directories.front();
@@ -402,7 +404,8 @@ ViewCache ViewProcessor::ApplyServerOverwrite(
     IndexedVariant new_server_node =
         old_server_snap.indexed_variant().UpdateChild(child_key, new_child);
     new_server_cache = server_filter->UpdateFullVariant(
-        old_server_snap.indexed_variant(), new_server_node, nullptr);
+        old_server_snap.indexed_variant(), std::move(new_server_node),
+        nullptr);
   } else {
     Path child_key = change_path.FrontDirectory();
     if (!old_server_snap.IsCompleteForPath(change_path) &&
@@ -455,7 +458,7 @@ ViewCache ViewProcessor::ApplyUserOverwrite(
     // If the path is empty, we can just apply the overwrite directly.
     IndexedVariant new_indexed(changed_snap, filter_->query_params());
     IndexedVariant new_local_cache = filter_->UpdateFullVariant(
-        old_view_cache.local_snap().indexed_variant(), new_indexed,
+        old_view_cache.local_snap().indexed_variant(), std::move(new_indexed),
         accumulator);
     new_view_cache = old_view_cache.UpdateLocalSnap(new_local_cache, true,
                                                     filter_->FiltersVariants());
@@ -163,6 +163,39 @@ class Database {
   /// (disk) storage, or false to discard pending writes when the app exists.
   void set_persistence_enabled(bool enabled);
 
+  /// @brief Sets how many worker threads are shared by all Database instances
+  /// in the process.
+  ///
+  /// Each Database instance runs all of its work in order on one worker
+  /// thread. With more than one thread, every new instance is assigned to the
+  /// least busy thread, so that several databases can make progress in
+  /// parallel.
+  ///
+  /// @note The pool is global to the process, for all Apps. An instance is
+  /// assigned its thread when it creates its first DatabaseReference, so call
+  /// this before any instance does that for the size to apply to all of them.
+  /// Instances which already have a thread keep it. This only has an effect on
+  /// desktop.
+  ///
+  /// @param[in] size Number of worker threads, by default 1.
+  static void set_scheduler_pool_size(size_t size);
+
+  /// @brief Sets whether nearby writes are sent to the server together.
+  ///
+  /// When enabled, the SetValue() and UpdateChildren() calls made within
+  /// window_ms of each other are sent to the server as a single update, as
+  /// long as the locations they change do not overlap. This reduces the number
+  /// of round trips when writing many small values. The Future of each write
+  /// still completes on its own, but the writes sent together succeed or fail
+  /// together, for example when security rules reject one of them.
+  ///
+  /// @note This only has an effect on desktop.
+  ///
+  /// @param[in] window_ms How long to wait for more writes after the first
+  /// one, in milliseconds. 0, the default, disables write batching.
+  /// @param[in] max_writes The maximum number of writes sent together.
+  void set_write_batching(int window_ms, size_t max_writes);
+
   /// Set the log verbosity of this Database instance.
   ///
   /// The log filtering is cumulative with Firebase App. That is, this library's
@@ -89,6 +89,12 @@ class DatabaseInternal {
   // Sets whether pending write data will persist between application exits.
   void SetPersistenceEnabled(bool enabled);
 
+  // Not supported on iOS, all the work is done by the Objective-C SDK.
+  static void set_scheduler_pool_size(size_t /*size*/) {}
+
+  // Not supported on iOS, all the work is done by the Objective-C SDK.
+  void set_write_batching(int /*window_ms*/, size_t /*max_writes*/) {}
+
   // Set the logging verbosity.
   // The iOS implementation only enables logging for kLogLevelVerbose &
   // kLogLevelDebug, logging is disabled in for all other levels.
@@ -0,0 +1,448 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "database/src/desktop/connection/persistent_connection.h"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "app/memory/shared_ptr.h"
+#include "app/memory/unique_ptr.h"
+#include "app/src/function_registry.h"
+#include "app/src/include/firebase/app.h"
+#include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/logger.h"
+#include "app/src/scheduler.h"
+#include "app/src/semaphore.h"
+#include "app/src/time.h"
+#include "app/src/variant_util.h"
+#include "app/tests/include/firebase/app_for_testing.h"
+#include "database/src/desktop/connection/util_connection.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace database {
+namespace internal {
+namespace connection {
+namespace {
+
+using ::testing::NiceMock;
+
+// Completes the handshake of every connection as soon as it is opened, and
+// records the requests the client sends.  All the calls to the clients'
+// event handlers are made from the scheduler thread, like WebSocketClientImpl
+// does.
+class FakeServer {
+ public:
+  explicit FakeServer(scheduler::Scheduler* scheduler)
+      : scheduler_(scheduler), current_client_(nullptr), connection_count_(0) {}
+
+  void AddClient(WebSocketClientInterface* client,
+                 WebSocketClientEventHandler* handler) {
+    MutexLock lock(mutex_);
+    handlers_[client] = handler;
+  }
+
+  void RemoveClient(WebSocketClientInterface* client) {
+    MutexLock lock(mutex_);
+    handlers_.erase(client);
+    if (current_client_ == client) current_client_ = nullptr;
+  }
+
+  void Connect(WebSocketClientInterface* client) {
+    {
+      MutexLock lock(mutex_);
+      current_client_ = client;
+      ++connection_count_;
+    }
+    scheduler_->Schedule([this, client]() {
+      WebSocketClientEventHandler* handler = GetHandler(client);
+      if (!handler) return;
+      handler->OnOpen();
+      handler->OnMessage(
+          "{\"t\":\"c\",\"d\":{\"t\":\"h\",\"d\":{\"ts\":0,\"v\":\"5\","
+          "\"h\":\"fake-server\",\"s\":\"session\"}}}");
+    });
+  }
+
+  void Receive(const char* data, size_t length) {
+    Variant message = util::JsonToVariant(data, length);
+    // Ignore keep-alive messages.
+    if (!message.is_map()) return;
+    MutexLock lock(mutex_);
+    requests_.push_back(message.map()["d"]);
+  }
+
+  // Returns the requests received so far with the given action.
+  std::vector<Variant> GetRequests(const std::string& action) {
+    MutexLock lock(mutex_);
+    std::vector<Variant> requests;
+    for (const Variant& request : requests_) {
+      if (request.map().find("a")->second.string_value() == action) {
+        requests.push_back(request);
+      }
+    }
+    return requests;
+  }
+
+  // Returns the actions of the requests received so far, in order.
+  std::vector<std::string> GetActions() {
+    MutexLock lock(mutex_);
+    std::vector<std::string> actions;
+    for (const Variant& request : requests_) {
+      actions.push_back(request.map().find("a")->second.string_value());
+    }
+    return actions;
+  }
+
+  // Waits until count requests with the given action have been received.
+  bool WaitForRequests(const std::string& action, size_t count) {
+    for (int i = 0; i < 500; ++i) {
+      if (GetRequests(action).size() >= count) return true;
+      firebase::internal::Sleep(10);
+    }
+    return false;
+  }
+
+  // Sends the response to the given request, and waits for it to be handled.
+  void Respond(const Variant& request, const std::string& status) {
+    Variant body = Variant::EmptyMap();
+    body.map()["s"] = status;
+    body.map()["d"] = "";
+    Variant data = Variant::EmptyMap();
+    data.map()["r"] = request.map().find("r")->second;
+    data.map()["b"] = body;
+    Variant message = Variant::EmptyMap();
+    message.map()["t"] = "d";
+    message.map()["d"] = data;
+    std::string json = util::VariantToJson(message);
+    RunOnCurrentClient([&json](WebSocketClientEventHandler* handler) {
+      handler->OnMessage(std::string(json));
+    });
+  }
+
+  // Drops the current connection, and waits for the client to handle it.
+  void Disconnect() {
+    RunOnCurrentClient(
+        [](WebSocketClientEventHandler* handler) { handler->OnClose(); });
+  }
+
+  int connection_count() {
+    MutexLock lock(mutex_);
+    return connection_count_;
+  }
+
+ private:
+  WebSocketClientEventHandler* GetHandler(WebSocketClientInterface* client) {
+    MutexLock lock(mutex_);
+    auto it = handlers_.find(client);
+    return it != handlers_.end() ? it->second : nullptr;
+  }
+
+  void RunOnCurrentClient(
+      const std::function<void(WebSocketClientEventHandler*)>& function) {
+    Semaphore done(0);
+    scheduler_->Schedule([this, &function, &done]() {
+      WebSocketClientInterface* client;
+      {
+        MutexLock lock(mutex_);
+        client = current_client_;
+      }
+      WebSocketClientEventHandler* handler = GetHandler(client);
+      if (handler) function(handler);
+      done.Post();
+    });
+    done.Wait();
+  }
+
+  scheduler::Scheduler* scheduler_;
+  Mutex mutex_;
+  std::map<WebSocketClientInterface*, WebSocketClientEventHandler*> handlers_;
+  WebSocketClientInterface* current_client_;
+  int connection_count_;
+  std::vector<Variant> requests_;
+};
+
+FakeServer* g_fake_server = nullptr;
+
+class FakeWebSocketClient : public WebSocketClientInterface {
+ public:
+  explicit FakeWebSocketClient(WebSocketClientEventHandler* handler) {
+    g_fake_server->AddClient(this, handler);
+  }
+  ~FakeWebSocketClient() override { g_fake_server->RemoveClient(this); }
+
+  void Connect(int timeout_ms) override { g_fake_server->Connect(this); }
+  void Close() override { g_fake_server->RemoveClient(this); }
+  void Send(const char* data, size_t length) override {
+    g_fake_server->Receive(data, length);
+  }
+};
+
+UniquePtr<WebSocketClientInterface> CreateFakeWebSocketClient(
+    const HostInfo& info, WebSocketClientEventHandler* delegate,
+    const char* opt_last_session_id, Logger* logger,
+    scheduler::Scheduler* scheduler, const std::string& app_check_token) {
+  return MakeUnique<FakeWebSocketClient>(delegate);
+}
+
+class MockPersistentConnectionEventHandler
+    : public PersistentConnectionEventHandler {
+ public:
+  MOCK_METHOD(void, OnConnect, (), (override));
+  MOCK_METHOD(void, OnDisconnect, (), (override));
+  MOCK_METHOD(void, OnAuthStatus, (bool auth_ok), (override));
+  MOCK_METHOD(void, OnServerInfoUpdate,
+              ((const std::map<Variant, Variant>& updates)), (override));
+  MOCK_METHOD(void, OnDataUpdate,
+              (const Path& path, const Variant& payload_data, bool is_merge,
+               const Tag& tag),
+              (override));
+};
+
+// Records whether PersistentConnection triggered the response.
+class WriteResponse : public Response {
+ public:
+  WriteResponse() : Response(OnResponse), triggered(false) {}
+
+  bool triggered;
+
+ private:
+  static void OnResponse(const ResponsePtr& response) {
+    static_cast<WriteResponse*>(response.get())->triggered = true;
+  }
+};
+
+// The auth token returned to PersistentConnection.
+std::string g_auth_token;  // NOLINT
+
+bool GetCurrentToken(App* app, void* /*unused*/, void* out) {
+  *static_cast<std::string*>(out) = g_auth_token;
+  return true;
+}
+
+const Variant& GetField(const Variant& variant, const char* key) {
+  return variant.map().find(key)->second;
+}
+
+class PersistentConnectionTest : public ::testing::Test {
+ protected:
+  PersistentConnectionTest() : logger_(&system_logger_) {}
+
+  void SetUp() override {
+    app_ = testing::CreateApp();
+    g_auth_token.clear();
+    app_->function_registry()->RegisterFunction(
+        ::firebase::internal::FnAuthGetCurrentToken, GetCurrentToken);
+    g_fake_server = new FakeServer(&scheduler_);
+    SetWebSocketClientFactory(CreateFakeWebSocketClient);
+    connection_ = new PersistentConnection(
+        app_, HostInfo("fake-server", "fake", true), &event_handler_,
+        &scheduler_, &logger_);
+    connection_->ScheduleInitialize();
+    // The client sends its stats once connected.
+    ASSERT_TRUE(g_fake_server->WaitForRequests("s", 1));
+  }
+
+  void TearDown() override {
+    RunOnScheduler([this]() { delete connection_; });
+    SetWebSocketClientFactory(nullptr);
+    delete g_fake_server;
+    g_fake_server = nullptr;
+    delete app_;
+  }
+
+  void RunOnScheduler(const std::function<void()>& function) {
+    Semaphore done(0);
+    scheduler_.Schedule([&function, &done]() {
+      function();
+      done.Post();
+    });
+    done.Wait();
+  }
+
+  void Put(const char* path, const Variant& data,
+           const SharedPtr<WriteResponse>& response) {
+    RunOnScheduler([this, path, &data, &response]() {
+      connection_->Put(Path(path), data, response);
+    });
+  }
+
+  App* app_;
+  SystemLogger system_logger_;
+  Logger logger_;
+  scheduler::Scheduler scheduler_;
+  NiceMock<MockPersistentConnectionEventHandler> event_handler_;
+  PersistentConnection* connection_;
+};
+
+TEST_F(PersistentConnectionTest, WritesWithinWindowAreSentAsOneUpdate) {
+  auto alice = MakeShared<WriteResponse>();
+  auto bob = MakeShared<WriteResponse>();
+  RunOnScheduler([this]() { connection_->SetWriteBatching(100, 10); });
+  Put("users/alice", Variant("alice"), alice);
+  Put("users/bob", Variant("bob"), bob);
+
+  ASSERT_TRUE(g_fake_server->WaitForRequests("m", 1));
+  std::vector<Variant> updates = g_fake_server->GetRequests("m");
+  ASSERT_EQ(updates.size(), 1u);
+  const Variant& body = GetField(updates[0], "b");
+  EXPECT_EQ(GetField(body, "p"), Variant("users"));
+  EXPECT_EQ(GetField(body, "d"),
+            Variant(std::map<Variant, Variant>{{"alice", "alice"},
+                                               {"bob", "bob"}}));
+  EXPECT_TRUE(g_fake_server->GetRequests("p").empty());
+  EXPECT_FALSE(alice->triggered);
+  EXPECT_FALSE(bob->triggered);
+}
+
+TEST_F(PersistentConnectionTest, UpdateIsSentOnceMaxWritesIsReached) {
+  auto alice = MakeShared<WriteResponse>();
+  auto bob = MakeShared<WriteResponse>();
+  // The window is far longer than the test waits for requests.
+  RunOnScheduler([this]() { connection_->SetWriteBatching(60000, 2); });
+  Put("users/alice", Variant("alice"), alice);
+  Put("users/bob", Variant("bob"), bob);
+
+  ASSERT_TRUE(g_fake_server->WaitForRequests("m", 1));
+  EXPECT_TRUE(g_fake_server->GetRequests("p").empty());
+}
+
+TEST_F(PersistentConnectionTest, OverlappingWritesAreSentSeparately) {
+  auto user = MakeShared<WriteResponse>();
+  auto name = MakeShared<WriteResponse>();
+  RunOnScheduler([this]() { connection_->SetWriteBatching(100, 10); });
+  Put("users/alice", Variant::EmptyMap(), user);
+  Put("users/alice/name", Variant("alice"), name);
+
+  ASSERT_TRUE(g_fake_server->WaitForRequests("p", 2));
+  std::vector<Variant> puts = g_fake_server->GetRequests("p");
+  EXPECT_EQ(GetField(GetField(puts[0], "b"), "p"), Variant("users/alice"));
+  EXPECT_EQ(GetField(GetField(puts[1], "b"), "p"),
+            Variant("users/alice/name"));
+  EXPECT_TRUE(g_fake_server->GetRequests("m").empty());
+}
+
+TEST_F(PersistentConnectionTest, UpdateResponseTriggersEachWrite) {
+  auto alice = MakeShared<WriteResponse>();
+  auto bob = MakeShared<WriteResponse>();
+  RunOnScheduler([this]() { connection_->SetWriteBatching(100, 10); });
+  Put("users/alice", Variant("alice"), alice);
+  Put("users/bob", Variant("bob"), bob);
+  ASSERT_TRUE(g_fake_server->WaitForRequests("m", 1));
+
+  g_fake_server->Respond(g_fake_server->GetRequests("m")[0], "ok");
+  EXPECT_TRUE(alice->triggered);
+  EXPECT_FALSE(alice->HasError());
+  EXPECT_TRUE(bob->triggered);
+  EXPECT_FALSE(bob->HasError());
+}
+
+TEST_F(PersistentConnectionTest, FailedUpdateFailsEachWrite) {
+  auto alice = MakeShared<WriteResponse>();
+  auto bob = MakeShared<WriteResponse>();
+  RunOnScheduler([this]() { connection_->SetWriteBatching(100, 10); });
+  Put("users/alice", Variant("alice"), alice);
+  Put("users/bob", Variant("bob"), bob);
+  ASSERT_TRUE(g_fake_server->WaitForRequests("m", 1));
+
+  g_fake_server->Respond(g_fake_server->GetRequests("m")[0],
+                         "permission_denied");
+  EXPECT_TRUE(alice->triggered);
+  EXPECT_EQ(alice->GetErrorCode(), kErrorPermissionDenied);
+  EXPECT_TRUE(bob->triggered);
+  EXPECT_EQ(bob->GetErrorCode(), kErrorPermissionDenied);
+}
+
+TEST_F(PersistentConnectionTest, QueuedWritesAreSentAfterReconnecting) {
+  auto alice = MakeShared<WriteResponse>();
+  auto bob = MakeShared<WriteResponse>();
+  RunOnScheduler([this]() { connection_->SetWriteBatching(60000, 10); });
+  Put("users/alice", Variant("alice"), alice);
+  Put("users/bob", Variant("bob"), bob);
+  EXPECT_TRUE(g_fake_server->GetRequests("m").empty());
+
+  // The connection drops while the writes wait for the window to end.  They
+  // are sent together as soon as the client is connected again.
+  g_fake_server->Disconnect();
+  ASSERT_TRUE(g_fake_server->WaitForRequests("m", 1));
+  EXPECT_EQ(g_fake_server->connection_count(), 2);
+  EXPECT_TRUE(g_fake_server->GetRequests("p").empty());
+
+  g_fake_server->Respond(g_fake_server->GetRequests("m")[0], "ok");
+  EXPECT_TRUE(alice->triggered);
+  EXPECT_TRUE(bob->triggered);
+}
+
+TEST_F(PersistentConnectionTest, SentUpdateIsResentAfterReconnecting) {
+  auto alice = MakeShared<WriteResponse>();
+  auto bob = MakeShared<WriteResponse>();
+  RunOnScheduler([this]() { connection_->SetWriteBatching(100, 10); });
+  Put("users/alice", Variant("alice"), alice);
+  Put("users/bob", Variant("bob"), bob);
+  ASSERT_TRUE(g_fake_server->WaitForRequests("m", 1));
+
+  // The connection drops before the response is received.
+  g_fake_server->Disconnect();
+  ASSERT_TRUE(g_fake_server->WaitForRequests("m", 2));
+  EXPECT_FALSE(alice->triggered);
+  EXPECT_FALSE(bob->triggered);
+
+  g_fake_server->Respond(g_fake_server->GetRequests("m")[1], "ok");
+  EXPECT_TRUE(alice->triggered);
+  EXPECT_TRUE(bob->triggered);
+}
+
+TEST_F(PersistentConnectionTest, QueuedWritesAreSentBeforeAuth) {
+  auto alice = MakeShared<WriteResponse>();
+  auto bob = MakeShared<WriteResponse>();
+  auto carol = MakeShared<WriteResponse>();
+  RunOnScheduler([this]() { connection_->SetWriteBatching(60000, 10); });
+  Put("users/alice", Variant("alice"), alice);
+  Put("users/bob", Variant("bob"), bob);
+
+  // The token changes while the writes wait for the window to end.  They must
+  // reach the server before the new token does.
+  RunOnScheduler([]() { g_auth_token = "new-token"; });
+  Put("users/carol", Variant("carol"), carol);
+
+  ASSERT_TRUE(g_fake_server->WaitForRequests("auth", 1));
+  EXPECT_THAT(g_fake_server->GetActions(),
+              ::testing::ElementsAre("s", "m", "auth"));
+}
+
+TEST_F(PersistentConnectionTest, QueuedWritesAreSentBeforeOnDisconnect) {
+  auto alice = MakeShared<WriteResponse>();
+  auto bob = MakeShared<WriteResponse>();
+  auto on_disconnect = MakeShared<WriteResponse>();
+  RunOnScheduler([this]() { connection_->SetWriteBatching(60000, 10); });
+  Put("users/alice", Variant("alice"), alice);
+  Put("users/bob", Variant("bob"), bob);
+  RunOnScheduler([this, &on_disconnect]() {
+    connection_->OnDisconnectCancel(Path("users/alice"), on_disconnect);
+  });
+
+  ASSERT_TRUE(g_fake_server->WaitForRequests("oc", 1));
+  EXPECT_THAT(g_fake_server->GetActions(),
+              ::testing::ElementsAre("s", "m", "oc"));
+}
+
+}  // namespace
+}  // namespace connection
+}  // namespace internal
+}  // namespace database
+}  // namespace firebase
@@ -14,7 +14,13 @@
 
 #include "database/src/desktop/connection/web_socket_client_impl.h"
 
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "app/src/semaphore.h"
+#include "database/tests/desktop/test/web_socket_echo_server.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -23,124 +29,6 @@ namespace database {
 namespace internal {
 namespace connection {
 
-// Simple WebSocket based Echo Server using third_party/uWebSockets
-// It has some quirk. Ex. hub_ needs a handler (async_) to wake the loop before
-// closing it or the event loop will never stop.
-class TestWebSocketEchoServer {
- public:
-  explicit TestWebSocketEchoServer(int port)
-      : port_(port), run_(false), thread_(nullptr), keep_alive_(nullptr) {
-    hub_.onMessage([](uWS::WebSocket<uWS::SERVER>* ws, char* message,
-                      size_t length, uWS::OpCode opCode) {
-      // Echo back immediately
-      ws->send(message, length, opCode);
-    });
-    hub_.onConnection(
-        [](uWS::WebSocket<uWS::SERVER>* ws, uWS::HttpRequest request) {
-          LogDebug("[Server] Received connection from (%s) %s port: %d",
-                   ws->getAddress().family, ws->getAddress().address,
-                   ws->getAddress().port);
-        });
-    hub_.onDisconnection([](uWS::WebSocket<uWS::SERVER>* ws, int code,
-                            char* message, size_t length) {
-      LogDebug("[Server] Disconnected from (%s) %s port: %d",
-               ws->getAddress().family, ws->getAddress().address,
-               ws->getAddress().port);
-    });
-  }
-
-  ~TestWebSocketEchoServer() { Stop(); }
-
-  void Start() {
-    keep_alive_ = new uS::Async(hub_.getLoop());
-    keep_alive_->setData(this);
-    keep_alive_->start([](uS::Async* async) {
-      TestWebSocketEchoServer* server =
-          static_cast<TestWebSocketEchoServer*>(async->getData());
-      assert(server != nullptr);
-      // close ths group in event loop thread
-      server->hub_.getDefaultGroup<uWS::SERVER>().close();
-      async->close();
-    });
-
-    run_ = true;
-    thread_ = new std::thread([this]() {
-      auto listen = [&](int port) {
-        if (hub_.listen(port)) {
-          LogDebug("[Server] Starts to listen to port %d", port);
-          return true;
-        } else {
-          LogDebug("[Server] Cannot listen to port %d", port);
-          return false;
-        }
-      };
-
-      if (port_ == 0) {
-        int attempts = 1000;
-        int port = 0;
-        bool res = false;
-
-        do {
-          --attempts;
-          port = 10000 + (rand() % 55000);  // NOLINT
-          res = listen(port);
-        } while (run_ == true && res == false && attempts != 0);
-
-        if (res) {
-          port_ = port;
-          hub_.run();  // Blocks until done
-        } else if (attempts == 0) {
-          LogError("Failed to find free port after 1000 attempts");
-        }
-      } else {
-        if (listen(port_) == true) {
-          hub_.run();  // Blocks until done
-        } else {
-          LogWarning("[Server] Cannot listen to port %d", port_.load());
-        }
-      }
-
-      run_ = false;
-    });
-  }
-
-  void Stop() {
-    run_ = false;
-
-    if (keep_alive_) {
-      keep_alive_->send();
-      keep_alive_ = nullptr;
-    }
-
-    if (thread_ != nullptr) {
-      thread_->join();
-      delete thread_;
-      thread_ = nullptr;
-    }
-  }
-
-  int GetPort(bool waitForPort = false) const {
-    while (waitForPort == true && run_ == true && port_ == 0) {
-      firebase::internal::Sleep(10);
-    }
-
-    return port_;
-  }
-
- private:
-  std::atomic<int> port_;
-  std::atomic<bool> run_;  // Is the listen thread started and running
-  uWS::Hub hub_;
-  std::thread* thread_;
-  uS::Async* keep_alive_;
-};
-
-std::string GetLocalHostUri(int port) {
-  std::stringstream ss;
-  ss << "ws://localhost:" << port;
-  return ss.str();
-}
-
 class TestClientEventHandler : public WebSocketClientEventHandler {
  public:
   explicit TestClientEventHandler(Semaphore* s)
@@ -157,9 +45,9 @@ class TestClientEventHandler : public WebSocketClientEventHandler {
     semaphore_->Post();
   }
 
-  void OnMessage(const char* msg) override {
+  void OnMessage(std::string&& msg) override {
     is_msg_received_ = true;
-    msg_received_ = msg;
+    msg_received_ = std::move(msg);
     semaphore_->Post();
   }
 
@@ -209,7 +97,7 @@ TEST(WebSocketClientImpl, Test1) {
 
   // Send a message and wait for the response
   EXPECT_TRUE(semaphore.TryWait());
-  ws_client.Send("Hello World");
+  ws_client.Send("Hello World", strlen("Hello World"));
   semaphore.Wait();
   semaphore.Post();
   EXPECT_TRUE(handler.is_msg_received_ && !handler.is_error_);
@@ -226,6 +114,95 @@ TEST(WebSocketClientImpl, Test1) {
   server.Stop();
 }
 
+// Test if messages sent in a burst are all delivered, in order.
+TEST(WebSocketClientImpl, TestSendBurst) {
+  // Launch a local echo server
+  TestWebSocketEchoServer server(0);
+  server.Start();
+
+  auto uri = GetLocalHostUri(server.GetPort(true));
+
+  Semaphore semaphore(0);
+  TestClientEventHandler handler(&semaphore);
+  Logger logger(nullptr);
+  scheduler::Scheduler scheduler;
+  WebSocketClientImpl ws_client(uri.c_str(), "", &logger, &scheduler, "",
+                                &handler);
+
+  ws_client.Connect(5000);
+  semaphore.Wait();
+  EXPECT_TRUE(handler.is_connected_ && !handler.is_error_);
+
+  // Send the messages without waiting for the responses
+  const int kMessageCount = 100;
+  for (int i = 0; i < kMessageCount; ++i) {
+    std::string message = std::to_string(i);
+    ws_client.Send(message.data(), message.size());
+  }
+  for (int i = 0; i < kMessageCount; ++i) semaphore.Wait();
+  EXPECT_TRUE(handler.is_msg_received_ && !handler.is_error_);
+  EXPECT_EQ(std::to_string(kMessageCount - 1), handler.msg_received_);
+
+  ws_client.Close();
+  semaphore.Wait();
+  EXPECT_TRUE(handler.is_closed_ && !handler.is_error_);
+
+  // Stop the server
+  server.Stop();
+}
+
+// Test if multiple clients sharing the event loop can be connected at the same
+// time, and if each client receives its own messages.
+TEST(WebSocketClientImpl, TestMultipleClients) {
+  // Launch a local echo server
+  TestWebSocketEchoServer server(0);
+  server.Start();
+
+  auto uri = GetLocalHostUri(server.GetPort(true));
+
+  const int kClientCount = 8;
+  Semaphore semaphore(0);
+  Logger logger(nullptr);
+  scheduler::Scheduler scheduler;
+  std::vector<std::unique_ptr<TestClientEventHandler>> handlers;
+  std::vector<std::unique_ptr<WebSocketClientImpl>> ws_clients;
+  for (int i = 0; i < kClientCount; ++i) {
+    handlers.emplace_back(new TestClientEventHandler(&semaphore));
+    ws_clients.emplace_back(new WebSocketClientImpl(
+        uri.c_str(), "", &logger, &scheduler, "", handlers.back().get()));
+  }
+
+  // Connect all the clients to local server
+  for (auto& ws_client : ws_clients) ws_client->Connect(5000);
+  for (int i = 0; i < kClientCount; ++i) semaphore.Wait();
+  for (auto& handler : handlers) {
+    EXPECT_TRUE(handler->is_connected_ && !handler->is_error_);
+  }
+
+  // Send a different message from each client and wait for the responses
+  for (int i = 0; i < kClientCount; ++i) {
+    std::string message = "Hello " + std::to_string(i);
+    ws_clients[i]->Send(message.data(), message.size());
+  }
+  for (int i = 0; i < kClientCount; ++i) semaphore.Wait();
+  for (int i = 0; i < kClientCount; ++i) {
+    EXPECT_TRUE(handlers[i]->is_msg_received_);
+    EXPECT_EQ("Hello " + std::to_string(i), handlers[i]->msg_received_);
+  }
+
+  // Close the connections
+  for (auto& ws_client : ws_clients) ws_client->Close();
+  for (int i = 0; i < kClientCount; ++i) semaphore.Wait();
+  for (auto& handler : handlers) {
+    EXPECT_TRUE(handler->is_closed_ && !handler->is_error_);
+  }
+
+  ws_clients.clear();
+
+  // Stop the server
+  server.Stop();
+}
+
 // Test if it is safe to create the client and destroy it immediately.
 // This is to test if the destructor can properly end the event loop.
 // Otherwise, it would block forever and timeout
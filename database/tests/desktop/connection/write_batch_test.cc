@@ -0,0 +1,109 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "database/src/desktop/connection/write_batch.h"
+
+#include <map>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace database {
+namespace internal {
+namespace connection {
+
+using ::testing::ElementsAre;
+
+TEST(WriteBatchTest, Empty) {
+  WriteBatch batch;
+  EXPECT_TRUE(batch.empty());
+  EXPECT_EQ(batch.size(), 0u);
+  EXPECT_THAT(batch.write_ids(), ElementsAre());
+}
+
+TEST(WriteBatchTest, CombinePuts) {
+  WriteBatch batch;
+  EXPECT_TRUE(batch.Add(1, Path("users/alice/score"), Variant(10), false));
+  EXPECT_TRUE(batch.Add(2, Path("users/bob"), Variant("bob"), false));
+  EXPECT_TRUE(batch.Add(3, Path("users/alice/name"), Variant::Null(), false));
+  EXPECT_THAT(batch.write_ids(), ElementsAre(1, 2, 3));
+
+  Path path;
+  Variant update;
+  batch.GetUpdate(&path, &update);
+  EXPECT_EQ(path, Path("users"));
+  EXPECT_EQ(update, Variant(std::map<Variant, Variant>{
+                        {"alice/score", 10},
+                        {"bob", "bob"},
+                        {"alice/name", Variant::Null()},
+                    }));
+}
+
+TEST(WriteBatchTest, CombineMerges) {
+  WriteBatch batch;
+  EXPECT_TRUE(batch.Add(
+      1, Path("a/b"),
+      Variant(std::map<Variant, Variant>{{"c", 1}, {"d/e", 2}}), true));
+  EXPECT_TRUE(batch.Add(2, Path("x"), Variant(3), false));
+
+  Path path;
+  Variant update;
+  batch.GetUpdate(&path, &update);
+  EXPECT_EQ(path, Path());
+  EXPECT_EQ(update, Variant(std::map<Variant, Variant>{
+                        {"a/b/c", 1},
+                        {"a/b/d/e", 2},
+                        {"x", 3},
+                    }));
+}
+
+TEST(WriteBatchTest, RejectOverlappingWrites) {
+  WriteBatch batch;
+  EXPECT_TRUE(batch.Add(1, Path("a/b"), Variant(1), false));
+
+  // Same location, ancestor and descendant.
+  EXPECT_FALSE(batch.Add(2, Path("a/b"), Variant(2), false));
+  EXPECT_FALSE(batch.Add(3, Path("a"), Variant(3), false));
+  EXPECT_FALSE(batch.Add(4, Path("a/b/c"), Variant(4), false));
+  EXPECT_FALSE(batch.Add(
+      5, Path("a"), Variant(std::map<Variant, Variant>{{"b/c", 5}}), true));
+
+  // Sharing a prefix of a key does not overlap.
+  EXPECT_TRUE(batch.Add(6, Path("a/bc"), Variant(6), false));
+  EXPECT_THAT(batch.write_ids(), ElementsAre(1, 6));
+}
+
+TEST(WriteBatchTest, RejectWritesWithoutLocation) {
+  WriteBatch batch;
+  EXPECT_FALSE(batch.Add(1, Path("a"), Variant::EmptyMap(), true));
+  EXPECT_FALSE(batch.Add(
+      2, Path("a"), Variant(std::map<Variant, Variant>{{"b", 1}, {"b/c", 2}}),
+      true));
+  EXPECT_TRUE(batch.empty());
+}
+
+TEST(WriteBatchTest, Clear) {
+  WriteBatch batch;
+  EXPECT_TRUE(batch.Add(1, Path("a"), Variant(1), false));
+  batch.Clear();
+  EXPECT_TRUE(batch.empty());
+  EXPECT_TRUE(batch.Add(2, Path("a"), Variant(2), false));
+  EXPECT_THAT(batch.write_ids(), ElementsAre(2));
+}
+
+}  // namespace connection
+}  // namespace internal
+}  // namespace database
+}  // namespace firebase
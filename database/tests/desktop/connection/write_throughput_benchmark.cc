@@ -0,0 +1,147 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Write throughput benchmark.  It is built with the tests but not run by
+// ctest; run it by hand to compare write batching settings.
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "app/memory/shared_ptr.h"
+#include "app/src/include/firebase/app.h"
+#include "app/src/log.h"
+#include "app/src/logger.h"
+#include "app/src/scheduler.h"
+#include "app/src/semaphore.h"
+#include "app/src/time.h"
+#include "app/tests/include/firebase/app_for_testing.h"
+#include "database/src/desktop/connection/host_info.h"
+#include "database/src/desktop/connection/persistent_connection.h"
+#include "database/tests/desktop/test/web_socket_echo_server.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace database {
+namespace internal {
+namespace connection {
+namespace {
+
+class ConnectedEventHandler : public PersistentConnectionEventHandler {
+ public:
+  ConnectedEventHandler() : connected(0) {}
+
+  void OnConnect() override { connected.Post(); }
+  void OnDisconnect() override {}
+  void OnAuthStatus(bool auth_ok) override {}
+  void OnServerInfoUpdate(
+      const std::map<Variant, Variant>& updates) override {}
+  void OnDataUpdate(const Path& path, const Variant& payload_data,
+                    bool is_merge, const Tag& tag) override {}
+
+  Semaphore connected;
+};
+
+// Posts a semaphore each time PersistentConnection triggers the response.
+class CountingResponse : public Response {
+ public:
+  CountingResponse() : Response(OnResponse), done(0), error_count(0) {}
+
+  Semaphore done;
+  int error_count;
+
+ private:
+  static void OnResponse(const ResponsePtr& response) {
+    CountingResponse* self = static_cast<CountingResponse*>(response.get());
+    if (self->HasError()) ++self->error_count;
+    self->done.Post();
+  }
+};
+
+// Writes sent in each pass of the benchmark.
+const int kWriteCount = 10000;
+// How long to wait for the connection or for the next write to complete
+// before giving up.
+const int kTimeoutMs = 10000;
+
+// Measures the sustained write throughput of PersistentConnection against a
+// local server, with one request per write and with write batching.  The rates
+// are logged; the test only checks that every write completes.
+TEST(WriteThroughputBenchmark, Put) {
+  // Launch a local server answering the requests
+  TestWebSocketEchoServer server(0, true);
+  server.Start();
+
+  std::string host = "localhost:" + std::to_string(server.GetPort(true));
+  App* app = testing::CreateApp();
+  SystemLogger system_logger;
+  Logger logger(&system_logger);
+  scheduler::Scheduler scheduler;
+
+  // Batching window in milliseconds and maximum writes per batch.  A window of
+  // 0 sends each write on its own.
+  const int kBatching[][2] = {{0, 0}, {5, 100}};
+  for (const auto& batching : kBatching) {
+    ConnectedEventHandler handler;
+    PersistentConnection* connection =
+        new PersistentConnection(app, HostInfo(host.c_str(), "fake", false),
+                                 &handler, &scheduler, &logger);
+    connection->ScheduleInitialize();
+    bool completed = handler.connected.TimedWait(kTimeoutMs);
+
+    SharedPtr<CountingResponse> response = MakeShared<CountingResponse>();
+    uint64_t start = firebase::internal::GetTimestamp();
+    if (completed) {
+      scheduler.Schedule([connection, &batching, &response]() {
+        connection->SetWriteBatching(batching[0], batching[1]);
+        for (int i = 0; i < kWriteCount; ++i) {
+          connection->Put(Path("benchmark/" + std::to_string(i)), Variant(i),
+                          response);
+        }
+      });
+      for (int i = 0; i < kWriteCount && completed; ++i) {
+        completed = response->done.TimedWait(kTimeoutMs);
+      }
+    }
+    uint64_t elapsed_ms = firebase::internal::GetTimestamp() - start;
+
+    Semaphore deleted(0);
+    scheduler.Schedule([connection, &deleted]() {
+      delete connection;
+      deleted.Post();
+    });
+    deleted.Wait();
+
+    ASSERT_TRUE(completed) << "Timed out (batching window: " << batching[0]
+                           << " ms, max writes: " << batching[1] << ")";
+    EXPECT_EQ(response->error_count, 0);
+    LogInfo("%d writes (batching window: %d ms, max writes: %d) in %d ms: "
+            "%.0f writes/s",
+            kWriteCount, batching[0], batching[1],
+            static_cast<int>(elapsed_ms),
+            kWriteCount * 1000.0 / (elapsed_ms > 0 ? elapsed_ms : 1));
+  }
+
+  delete app;
+
+  // Stop the server
+  server.Stop();
+}
+
+}  // namespace
+}  // namespace connection
+}  // namespace internal
+}  // namespace database
+}  // namespace firebase
@@ -16,6 +16,7 @@
 
 #include <fstream>
 #include <sstream>
+#include <utility>
 
 #include "app/memory/unique_ptr.h"
 #include "app/src/variant_util.h"
@@ -532,6 +533,113 @@ TEST(IndexedVariant, UpdatePriorityTest) {
   EXPECT_EQ(result.variant(), expected);
 }
 
+TEST(IndexedVariant, UpdateChildKeepsIndexOrdered) {
+  Variant variant = std::map<Variant, Variant>{
+      std::make_pair("aaa", 400),
+      std::make_pair("bbb", 300),
+      std::make_pair("ccc", 200),
+      std::make_pair("ddd", 100),
+  };
+  QueryParams params;
+  params.order_by = QueryParams::kOrderByValue;
+  IndexedVariant indexed_variant(variant, params);
+
+  IndexedVariant result = indexed_variant.UpdateChild("aaa", 50)
+                              .UpdateChild("ccc", Variant::Null())
+                              .UpdateChild("eee", 250)
+                              .UpdateChild("fff", Variant::EmptyMap());
+
+  // The incrementally updated index must match an index built from scratch.
+  IndexedVariant expected(std::map<Variant, Variant>{
+                              std::make_pair("aaa", 50),
+                              std::make_pair("bbb", 300),
+                              std::make_pair("ddd", 100),
+                              std::make_pair("eee", 250),
+                          },
+                          params);
+  EXPECT_EQ(result, expected);
+  EXPECT_THAT(std::vector<IndexedVariant::Index::value_type>(
+                  result.index().begin(), result.index().end()),
+              Eq(std::vector<IndexedVariant::Index::value_type>(
+                  expected.index().begin(), expected.index().end())));
+  EXPECT_EQ(result.Find("ccc"), result.index().end());
+  EXPECT_EQ(result.Find("eee")->second, Variant(250));
+
+  // The original is left untouched.
+  EXPECT_EQ(indexed_variant.variant(), variant);
+  EXPECT_EQ(indexed_variant.index().size(), 4u);
+  EXPECT_EQ(indexed_variant.GetFirstChild()->first, Variant("ddd"));
+
+  // Removing the last child turns the variant back into null.
+  IndexedVariant single(std::map<Variant, Variant>{std::make_pair("aaa", 1)},
+                        params);
+  EXPECT_TRUE(single.UpdateChild("aaa", Variant::Null()).variant().is_null());
+}
+
+TEST(IndexedVariant, CopiesShareData) {
+  Variant variant = std::map<Variant, Variant>{
+      std::make_pair("aaa", 100),
+      std::make_pair("bbb", 200),
+  };
+  IndexedVariant indexed_variant(variant);
+  IndexedVariant copy(indexed_variant);
+  EXPECT_EQ(&copy.variant(), &indexed_variant.variant());
+  EXPECT_EQ(&copy.index(), &indexed_variant.index());
+
+  // Changing the priority does not change the children, so the index is
+  // shared with the result.
+  IndexedVariant prioritized = indexed_variant.UpdatePriority(1234);
+  EXPECT_EQ(&prioritized.index(), &indexed_variant.index());
+  EXPECT_EQ(prioritized.variant().map().at(".priority"), Variant(1234));
+}
+
+TEST(IndexedVariant, UpdateInPlaceWhenNotShared) {
+  Variant variant = std::map<Variant, Variant>{
+      std::make_pair("aaa", 100),
+      std::make_pair("bbb", 200),
+  };
+  QueryParams params;
+  params.order_by = QueryParams::kOrderByValue;
+  IndexedVariant indexed_variant(variant, params);
+  const Variant* variant_address = &indexed_variant.variant();
+  const IndexedVariant::Index* index_address = &indexed_variant.index();
+
+  // Nothing else shares the data, so it is updated in place.
+  indexed_variant = std::move(indexed_variant).UpdateChild("ccc", 50);
+  indexed_variant = std::move(indexed_variant).UpdateChild("aaa", 300);
+  indexed_variant = std::move(indexed_variant).UpdatePriority(1234);
+  EXPECT_EQ(&indexed_variant.variant(), variant_address);
+  EXPECT_EQ(&indexed_variant.index(), index_address);
+  EXPECT_EQ(indexed_variant,
+            IndexedVariant(std::map<Variant, Variant>{
+                               std::make_pair("aaa", 300),
+                               std::make_pair("bbb", 200),
+                               std::make_pair("ccc", 50),
+                               std::make_pair(".priority", 1234),
+                           },
+                           params));
+  EXPECT_EQ(indexed_variant.GetFirstChild()->first, Variant("ccc"));
+  EXPECT_EQ(indexed_variant.GetLastChild()->first, Variant("aaa"));
+
+  // A copy shares the data, so updating it leaves the copy untouched.
+  IndexedVariant copy(indexed_variant);
+  indexed_variant = std::move(indexed_variant).UpdateChild("ccc", 400);
+  EXPECT_NE(&indexed_variant.variant(), &copy.variant());
+  EXPECT_NE(&indexed_variant.index(), &copy.index());
+  EXPECT_EQ(copy.variant().map().at("ccc"), Variant(50));
+  EXPECT_EQ(copy.GetFirstChild()->first, Variant("ccc"));
+  EXPECT_EQ(indexed_variant.variant().map().at("ccc"), Variant(400));
+  EXPECT_EQ(indexed_variant.GetLastChild()->first, Variant("ccc"));
+
+  // Removing the priority of a leaf unwraps its value.
+  IndexedVariant leaf(std::map<Variant, Variant>{
+      std::make_pair(".value", 1),
+      std::make_pair(".priority", 2),
+  });
+  EXPECT_EQ(std::move(leaf).UpdatePriority(Variant::Null()).variant(),
+            Variant(1));
+}
+
 TEST(IndexedVariant, GetFirstAndLastChildByPriority) {
   QueryParams params;
   params.order_by = QueryParams::kOrderByPriority;
@@ -156,6 +156,42 @@ TEST(WriteTreeDeathTest, RemoveWrite) {
   EXPECT_DEATH(write_tree.RemoveWrite(200), DEATHTEST_SIGABRT);
 }
 
+TEST(WriteTree, RemoveWrite_OverlappingWrites) {
+  WriteTree write_tree;
+  write_tree.AddOverwrite(Path("test/path"), Variant("parent"), 100,
+                          kOverwriteVisible);
+  write_tree.AddOverwrite(Path("test/path/child"), Variant("child"), 101,
+                          kOverwriteVisible);
+  write_tree.AddOverwrite(Path("test/other"), Variant("other"), 102,
+                          kOverwriteVisible);
+  write_tree.AddOverwrite(Path("test/path/child"), Variant("shadow"), 103,
+                          kOverwriteVisible);
+
+  // Removing a write shadowed by a later write returns false.
+  EXPECT_FALSE(write_tree.RemoveWrite(101));
+  EXPECT_EQ(*write_tree.GetCompleteWriteData(Path("test/path/child")),
+            "shadow");
+
+  // Removing a write overlapping with other writes returns true.
+  EXPECT_TRUE(write_tree.RemoveWrite(100));
+  EXPECT_FALSE(write_tree.GetCompleteWriteData(Path("test/path")).has_value());
+  EXPECT_EQ(*write_tree.GetCompleteWriteData(Path("test/path/child")),
+            "shadow");
+
+  EXPECT_TRUE(write_tree.RemoveWrite(103));
+  EXPECT_FALSE(
+      write_tree.GetCompleteWriteData(Path("test/path/child")).has_value());
+  EXPECT_EQ(*write_tree.GetCompleteWriteData(Path("test/other")), "other");
+
+  // A location left without writes can be written again.
+  write_tree.AddOverwrite(Path("test/path/child"), Variant("new"), 104,
+                          kOverwriteVisible);
+  EXPECT_EQ(*write_tree.GetCompleteWriteData(Path("test/path/child")), "new");
+  EXPECT_TRUE(write_tree.RemoveWrite(104));
+  EXPECT_TRUE(write_tree.RemoveWrite(102));
+  EXPECT_FALSE(write_tree.GetCompleteWriteData(Path("test")).has_value());
+}
+
 TEST(WriteTree, GetCompleteWriteData) {
   WriteTree write_tree;
   const std::map<Path, Variant>& merge{
@@ -370,6 +406,40 @@ TEST(WriteTree, CalcCompleteEventCache_HasExcludes_NoHiddenWritesAndMergeData) {
   EXPECT_EQ(*result, expected_result);
 }
 
+TEST(WriteTree, CalcCompleteEventCache_HasExcludes_OnlyOverlappingWrites) {
+  WriteTree write_tree;
+  Path tree_path("test/ccc");
+  Variant complete_server_cache(std::map<Variant, Variant>{
+      std::make_pair("ggg", 7),
+  });
+  std::vector<WriteId> write_ids_to_exclude{105};
+  write_tree.AddOverwrite(Path("test"),
+                          Variant(std::map<Variant, Variant>{
+                              std::make_pair("ccc",
+                                             std::map<Variant, Variant>{
+                                                 std::make_pair("ddd", 1),
+                                             }),
+                          }),
+                          100, kOverwriteVisible);
+  write_tree.AddOverwrite(Path("test/bbb"), 2, 101, kOverwriteVisible);
+  write_tree.AddOverwrite(Path("test/ccc/eee"), 3, 102, kOverwriteVisible);
+  write_tree.AddOverwrite(Path("test/cc"), 4, 103, kOverwriteVisible);
+  write_tree.AddOverwrite(Path("test/ccc/ddd"), 5, 104, kOverwriteInvisible);
+  write_tree.AddOverwrite(Path("test/ccc/fff"), 6, 105, kOverwriteVisible);
+
+  Optional<Variant> result = write_tree.CalcCompleteEventCache(
+      tree_path, &complete_server_cache, write_ids_to_exclude,
+      kIncludeHiddenWrites);
+
+  Variant expected_result(std::map<Variant, Variant>{
+      std::make_pair("ddd", 5),
+      std::make_pair("eee", 3),
+  });
+
+  EXPECT_TRUE(result.has_value());
+  EXPECT_EQ(*result, expected_result);
+}
+
 TEST(WriteTree, CalcCompleteEventChildren_WithTopLevelSet) {
   WriteTree write_tree;
   Path tree_path("test/ccc");
@@ -0,0 +1,85 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "database/src/desktop/database_desktop.h"
+
+#include "app/src/include/firebase/app.h"
+#include "app/src/semaphore.h"
+#include "app/tests/include/firebase/app_for_testing.h"
+#include "database/src/desktop/core/repo.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace database {
+namespace internal {
+namespace {
+
+const char kApiKey[] = "MyFakeApiKey";
+const char kDatabaseUrl[] = "https://abc-xyz-123.firebaseio.com";
+const char kFirstUrl[] = "https://first-xyz-123.firebaseio.com";
+const char kSecondUrl[] = "https://second-xyz-123.firebaseio.com";
+const char kThirdUrl[] = "https://third-xyz-123.firebaseio.com";
+
+class DatabaseDesktopTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    AppOptions options = testing::MockAppOptions();
+    options.set_database_url(kDatabaseUrl);
+    options.set_api_key(kApiKey);
+    app_ = testing::CreateApp(options);
+  }
+
+  void TearDown() override {
+    Repo::SetSchedulerPoolSize(1);
+    delete app_;
+  }
+
+ protected:
+  App* app_;
+};
+
+TEST_F(DatabaseDesktopTest, ReposShareOneSchedulerByDefault) {
+  DatabaseInternal first(app_, kFirstUrl);
+  DatabaseInternal second(app_, kSecondUrl);
+  first.GetReference();
+  second.GetReference();
+
+  EXPECT_EQ(&first.repo()->scheduler(), &second.repo()->scheduler());
+}
+
+TEST_F(DatabaseDesktopTest, ReposAreSpreadAcrossSchedulerPool) {
+  DatabaseInternal first(app_, kFirstUrl);
+  DatabaseInternal second(app_, kSecondUrl);
+  DatabaseInternal third(app_, kThirdUrl);
+  DatabaseInternal::set_scheduler_pool_size(2);
+  first.GetReference();
+  second.GetReference();
+  third.GetReference();
+
+  // Each of the first two Repos gets its own scheduler, then the pool is full
+  // and the third Repo joins the least loaded one.
+  EXPECT_NE(&first.repo()->scheduler(), &second.repo()->scheduler());
+  EXPECT_EQ(&first.repo()->scheduler(), &third.repo()->scheduler());
+
+  Semaphore semaphore(0);
+  first.repo()->scheduler().Schedule([&semaphore]() { semaphore.Post(); });
+  semaphore.Wait();
+  EXPECT_GT(first.GetSchedulerStats().triggered_count, 0u);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace database
+}  // namespace firebase
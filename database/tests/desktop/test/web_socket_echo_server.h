@@ -0,0 +1,202 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_DATABASE_TESTS_DESKTOP_TEST_WEB_SOCKET_ECHO_SERVER_H_
+#define FIREBASE_DATABASE_TESTS_DESKTOP_TEST_WEB_SOCKET_ECHO_SERVER_H_
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "app/src/include/firebase/variant.h"
+#include "app/src/log.h"
+#include "app/src/time.h"
+#include "app/src/variant_util.h"
+#include "uWebSockets/src/uWS.h"
+
+namespace firebase {
+namespace database {
+namespace internal {
+namespace connection {
+
+// Returns the "ok" response to a Realtime Database request, or an empty string
+// if the message is not a request, e.g. a keep-alive message.
+inline std::string GetOkResponse(const char* message, size_t length) {
+  Variant request = util::JsonToVariant(message, length);
+  if (!request.is_map()) return std::string();
+  auto data = request.map().find("d");
+  if (data == request.map().end() || !data->second.is_map()) {
+    return std::string();
+  }
+  auto request_number = data->second.map().find("r");
+  if (request_number == data->second.map().end()) return std::string();
+
+  Variant body = Variant::EmptyMap();
+  body.map()["s"] = "ok";
+  body.map()["d"] = "";
+  Variant response_data = Variant::EmptyMap();
+  response_data.map()["r"] = request_number->second;
+  response_data.map()["b"] = body;
+  Variant response = Variant::EmptyMap();
+  response.map()["t"] = "d";
+  response.map()["d"] = response_data;
+  return util::VariantToJson(response);
+}
+
+// Simple WebSocket based Echo Server using third_party/uWebSockets
+// It has some quirk. Ex. hub_ needs a handler (async_) to wake the loop before
+// closing it or the event loop will never stop.
+// If fake_database is true, the server sends the Realtime Database handshake
+// to every new connection and answers every request with an "ok" response
+// instead of echoing it, which is enough to complete PersistentConnection
+// writes.
+class TestWebSocketEchoServer {
+ public:
+  explicit TestWebSocketEchoServer(int port, bool fake_database = false)
+      : port_(port), run_(false), thread_(nullptr), keep_alive_(nullptr) {
+    hub_.onMessage([fake_database](uWS::WebSocket<uWS::SERVER>* ws,
+                                   char* message, size_t length,
+                                   uWS::OpCode opCode) {
+      if (fake_database) {
+        std::string response = GetOkResponse(message, length);
+        if (!response.empty()) {
+          ws->send(response.data(), response.size(), uWS::OpCode::TEXT);
+        }
+        return;
+      }
+      // Echo back immediately
+      ws->send(message, length, opCode);
+    });
+    hub_.onConnection([fake_database](uWS::WebSocket<uWS::SERVER>* ws,
+                                      uWS::HttpRequest request) {
+      LogDebug("[Server] Received connection from (%s) %s port: %d",
+               ws->getAddress().family, ws->getAddress().address,
+               ws->getAddress().port);
+      if (fake_database) {
+        static const char kHandshake[] =
+            "{\"t\":\"c\",\"d\":{\"t\":\"h\",\"d\":{\"ts\":0,\"v\":\"5\","
+            "\"h\":\"localhost\",\"s\":\"session\"}}}";
+        ws->send(kHandshake, strlen(kHandshake), uWS::OpCode::TEXT);
+      }
+    });
+    hub_.onDisconnection([](uWS::WebSocket<uWS::SERVER>* ws, int code,
+                            char* message, size_t length) {
+      LogDebug("[Server] Disconnected from (%s) %s port: %d",
+               ws->getAddress().family, ws->getAddress().address,
+               ws->getAddress().port);
+    });
+  }
+
+  ~TestWebSocketEchoServer() { Stop(); }
+
+  void Start() {
+    keep_alive_ = new uS::Async(hub_.getLoop());
+    keep_alive_->setData(this);
+    keep_alive_->start([](uS::Async* async) {
+      TestWebSocketEchoServer* server =
+          static_cast<TestWebSocketEchoServer*>(async->getData());
+      assert(server != nullptr);
+      // close ths group in event loop thread
+      server->hub_.getDefaultGroup<uWS::SERVER>().close();
+      async->close();
+    });
+
+    run_ = true;
+    thread_ = new std::thread([this]() {
+      auto listen = [&](int port) {
+        if (hub_.listen(port)) {
+          LogDebug("[Server] Starts to listen to port %d", port);
+          return true;
+        } else {
+          LogDebug("[Server] Cannot listen to port %d", port);
+          return false;
+        }
+      };
+
+      if (port_ == 0) {
+        int attempts = 1000;
+        int port = 0;
+        bool res = false;
+
+        do {
+          --attempts;
+          port = 10000 + (rand() % 55000);  // NOLINT
+          res = listen(port);
+        } while (run_ == true && res == false && attempts != 0);
+
+        if (res) {
+          port_ = port;
+          hub_.run();  // Blocks until done
+        } else if (attempts == 0) {
+          LogError("Failed to find free port after 1000 attempts");
+        }
+      } else {
+        if (listen(port_) == true) {
+          hub_.run();  // Blocks until done
+        } else {
+          LogWarning("[Server] Cannot listen to port %d", port_.load());
+        }
+      }
+
+      run_ = false;
+    });
+  }
+
+  void Stop() {
+    run_ = false;
+
+    if (keep_alive_) {
+      keep_alive_->send();
+      keep_alive_ = nullptr;
+    }
+
+    if (thread_ != nullptr) {
+      thread_->join();
+      delete thread_;
+      thread_ = nullptr;
+    }
+  }
+
+  int GetPort(bool waitForPort = false) const {
+    while (waitForPort == true && run_ == true && port_ == 0) {
+      firebase::internal::Sleep(10);
+    }
+
+    return port_;
+  }
+
+ private:
+  std::atomic<int> port_;
+  std::atomic<bool> run_;  // Is the listen thread started and running
+  uWS::Hub hub_;
+  std::thread* thread_;
+  uS::Async* keep_alive_;
+};
+
+inline std::string GetLocalHostUri(int port) {
+  std::stringstream ss;
+  ss << "ws://localhost:" << port;
+  return ss.str();
+}
+
+}  // namespace connection
+}  // namespace internal
+}  // namespace database
+}  // namespace firebase
+
+#endif  // FIREBASE_DATABASE_TESTS_DESKTOP_TEST_WEB_SOCKET_ECHO_SERVER_H_
@@ -193,6 +193,62 @@ TEST(IndexedFilter, UpdateChild_RemovedValue) {
   EXPECT_THAT(change_accumulator, Pointwise(Eq(), expected_changes));
 }
 
+TEST(IndexedFilter, UpdateChild_InPlaceWhenMoved) {
+  QueryParams params;
+  params.order_by = QueryParams::kOrderByValue;
+  IndexedFilter filter(params);
+
+  IndexedVariant indexed_variant(std::map<Variant, Variant>{
+                                     std::make_pair("aaa", 100),
+                                     std::make_pair("bbb", 200),
+                                 },
+                                 params);
+  const Variant* variant_address = &indexed_variant.variant();
+  const IndexedVariant::Index* index_address = &indexed_variant.index();
+  ChildChangeAccumulator change_accumulator;
+
+  // Nothing else shares the snap, so the filter updates it in place.
+  indexed_variant =
+      filter.UpdateChild(std::move(indexed_variant), "ccc", 50, Path(),
+                         nullptr, &change_accumulator);
+  indexed_variant = filter.UpdatePriority(std::move(indexed_variant), 1234);
+  EXPECT_EQ(&indexed_variant.variant(), variant_address);
+  EXPECT_EQ(&indexed_variant.index(), index_address);
+  EXPECT_EQ(indexed_variant, IndexedVariant(std::map<Variant, Variant>{
+                                                std::make_pair("aaa", 100),
+                                                std::make_pair("bbb", 200),
+                                                std::make_pair("ccc", 50),
+                                                std::make_pair(".priority",
+                                                               1234),
+                                            },
+                                            params));
+  EXPECT_EQ(indexed_variant.GetFirstChild()->first, Variant("ccc"));
+  ChildChangeAccumulator expected_changes{
+      std::make_pair("ccc", ChildAddedChange("ccc", 50)),
+  };
+  EXPECT_THAT(change_accumulator, Pointwise(Eq(), expected_changes));
+
+  // A snap that is still shared is copied, leaving the original untouched.
+  IndexedVariant result = filter.UpdateChild(indexed_variant, "aaa", 300,
+                                             Path(), nullptr, nullptr);
+  EXPECT_NE(&result.variant(), &indexed_variant.variant());
+  EXPECT_NE(&result.index(), &indexed_variant.index());
+  EXPECT_EQ(indexed_variant.variant().map().at("aaa"), Variant(100));
+  EXPECT_EQ(result.variant().map().at("aaa"), Variant(300));
+
+  // The new snap of a full update is returned without a copy.
+  IndexedVariant new_snap(std::map<Variant, Variant>{
+                              std::make_pair("ddd", 400),
+                          },
+                          params);
+  variant_address = &new_snap.variant();
+  index_address = &new_snap.index();
+  result = filter.UpdateFullVariant(indexed_variant, std::move(new_snap),
+                                    nullptr);
+  EXPECT_EQ(&result.variant(), variant_address);
+  EXPECT_EQ(&result.index(), index_address);
+}
+
 // Disable DeathTest in Release mode because it depends on a crash
 // caused by `assert` which has no effect when NDEBUG is defined
 #ifdef NDEBUG
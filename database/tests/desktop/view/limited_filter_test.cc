@@ -68,6 +68,33 @@ TEST(LimitedFilter, UpdateChildLimitFirst) {
   }
 }
 
+TEST(LimitedFilter, UpdateChildInPlaceWhenMoved) {
+  QueryParams params;
+  params.order_by = QueryParams::kOrderByKey;
+  params.limit_first = 2;
+  LimitedFilter filter(params);
+
+  IndexedVariant snapshot(std::map<Variant, Variant>{
+                              std::make_pair("bbb", 200),
+                              std::make_pair("ccc", 300),
+                          },
+                          params);
+  const Variant* variant_address = &snapshot.variant();
+  const IndexedVariant::Index* index_address = &snapshot.index();
+
+  // Prepending a value to a full window adds it and removes the last child
+  // without copying the snapshot.
+  snapshot = filter.UpdateChild(std::move(snapshot), "aaa", 100, Path(),
+                                nullptr, nullptr);
+  EXPECT_EQ(&snapshot.variant(), variant_address);
+  EXPECT_EQ(&snapshot.index(), index_address);
+  EXPECT_EQ(snapshot, IndexedVariant(std::map<Variant, Variant>{
+                                         std::make_pair("aaa", 100),
+                                         std::make_pair("bbb", 200),
+                                     },
+                                     params));
+}
+
 TEST(LimitedFilter, UpdateChildLimitLast) {
   QueryParams params;
   params.order_by = QueryParams::kOrderByKey;
@@ -47,8 +47,10 @@ std::string NamespacedConfigData::Serialize() const {
 }
 
 void NamespacedConfigData::Deserialize(const std::string& buffer) {
-  const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.data());
-  size_t size = buffer.size();
+  Deserialize(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+}
+
+void NamespacedConfigData::Deserialize(const uint8_t* data, size_t size) {
   auto struct_map = flexbuffers::GetRoot(data, size).AsMap();
   flexbuffers::Map ns_config_map = struct_map["config_"].AsMap();
   for (int i = 0, in = ns_config_map.size(); i < in; ++i) {
@@ -140,13 +142,24 @@ std::string LayeredConfigs::Serialize() const {
 }
 
 void LayeredConfigs::Deserialize(const std::string& buffer) {
-  const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.data());
-  size_t size = buffer.size();
+  Deserialize(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+}
+
+// Deserialize `out` from a nested buffer stored as a FlexBuffers string,
+// without copying it.
+template <typename T>
+static void DeserializeNested(const flexbuffers::Reference& nested, T* out) {
+  flexbuffers::String buffer = nested.AsString();
+  out->Deserialize(reinterpret_cast<const uint8_t*>(buffer.c_str()),
+                   buffer.length());
+}
+
+void LayeredConfigs::Deserialize(const uint8_t* data, size_t size) {
   auto struct_map = flexbuffers::GetRoot(data, size).AsMap();
-  fetched.Deserialize(struct_map["fetched"].AsString().str());
-  active.Deserialize(struct_map["active"].AsString().str());
-  defaults.Deserialize(struct_map["defaults"].AsString().str());
-  metadata.Deserialize(struct_map["metadata"].AsString().str());
+  DeserializeNested(struct_map["fetched"], &fetched);
+  DeserializeNested(struct_map["active"], &active);
+  DeserializeNested(struct_map["defaults"], &defaults);
+  DeserializeNested(struct_map["metadata"], &metadata);
 }
 
 bool LayeredConfigs::operator==(const LayeredConfigs& right) const {
@@ -15,6 +15,7 @@
 #ifndef FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_CONFIG_DATA_H_
 #define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_CONFIG_DATA_H_
 
+#include <cstddef>  // for size_t
 #include <cstdint>  // for uint64_t
 #include <map>
 #include <set>
@@ -48,6 +49,8 @@ class NamespacedConfigData {
   std::string Serialize() const;
   // Deserializes a string buffer previously Serialized.
   void Deserialize(const std::string& buffer);
+  // Deserializes a buffer previously Serialized, reading it in place.
+  void Deserialize(const uint8_t* data, size_t size);
 
   // Set key/value records from `map` by `namespace`.
   void SetNamespace(const std::map<std::string, std::string>& map,
@@ -101,6 +104,9 @@ struct LayeredConfigs {
 
   std::string Serialize() const;
   void Deserialize(const std::string& buffer);
+  // Deserializes a buffer previously Serialized, e.g. a mapped file, reading
+  // the nested buffers of each layer in place rather than copying them.
+  void Deserialize(const uint8_t* data, size_t size);
 
   // For testing.
   bool operator==(const LayeredConfigs& right) const;
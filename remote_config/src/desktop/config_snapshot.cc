@@ -0,0 +1,87 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "remote_config/src/desktop/config_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace firebase {
+namespace remote_config {
+namespace internal {
+
+ConfigSnapshot::ConfigSnapshot() : slots_(1, 0) {}
+
+ConfigSnapshot::ConfigSnapshot(std::vector<ConfigSnapshotValue> values)
+    : values_(std::move(values)) {
+  std::sort(values_.begin(), values_.end(),
+            [](const ConfigSnapshotValue& a, const ConfigSnapshotValue& b) {
+              return a.key < b.key;
+            });
+  size_t slot_count = 1;
+  while (slot_count < values_.size() * 2) slot_count *= 2;
+  slots_.resize(slot_count, 0);
+  hashes_.reserve(values_.size());
+  const size_t mask = slot_count - 1;
+  for (size_t i = 0; i < values_.size(); i++) {
+    uint32_t hash = Hash(values_[i].key.c_str());
+    hashes_.push_back(hash);
+    size_t slot = hash & mask;
+    while (slots_[slot] != 0) slot = (slot + 1) & mask;
+    slots_[slot] = static_cast<uint32_t>(i + 1);
+  }
+}
+
+const ConfigSnapshotValue* ConfigSnapshot::Find(const char* key) const {
+  if (!key) return nullptr;
+  uint32_t hash = Hash(key);
+  const size_t mask = slots_.size() - 1;
+  for (size_t slot = hash & mask; slots_[slot] != 0;
+       slot = (slot + 1) & mask) {
+    size_t index = slots_[slot] - 1;
+    if (hashes_[index] == hash && values_[index].key == key) {
+      return &values_[index];
+    }
+  }
+  return nullptr;
+}
+
+void ConfigSnapshot::GetKeysByPrefix(const char* prefix,
+                                     std::vector<std::string>* keys) const {
+  size_t prefix_length = strlen(prefix);
+  auto it = std::lower_bound(
+      values_.begin(), values_.end(), prefix,
+      [](const ConfigSnapshotValue& value, const char* key) {
+        return value.key.compare(key) < 0;
+      });
+  for (; it != values_.end() && it->key.compare(0, prefix_length, prefix) == 0;
+       ++it) {
+    keys->push_back(it->key);
+  }
+}
+
+// FNV-1a.
+uint32_t ConfigSnapshot::Hash(const char* key) {
+  uint32_t hash = 2166136261u;
+  for (; *key != '\0'; ++key) {
+    hash ^= static_cast<unsigned char>(*key);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+}  // namespace internal
+}  // namespace remote_config
+}  // namespace firebase
@@ -0,0 +1,91 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_CONFIG_SNAPSHOT_H_
+#define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_CONFIG_SNAPSHOT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "remote_config/src/include/firebase/remote_config.h"
+
+namespace firebase {
+namespace remote_config {
+namespace internal {
+
+// A config value together with its conversions, parsed once when the
+// snapshot is built.
+struct ConfigSnapshotValue {
+  ConfigSnapshotValue()
+      : source(kValueSourceStaticValue),
+        is_bool(false),
+        bool_value(false),
+        is_long(false),
+        long_value(0),
+        is_double(false),
+        double_value(0.0) {}
+
+  std::string key;
+  std::string value;
+  ValueSource source;
+
+  // Whether `value` converts to each type, and the converted value.
+  bool is_bool;
+  bool bool_value;
+  bool is_long;
+  int64_t long_value;
+  bool is_double;
+  double double_value;
+};
+
+// Immutable view of the values visible to the getters: the active values,
+// falling back to the defaults.
+//
+// Lookups hash the key in place, so finding a value does not allocate.
+// A snapshot is never modified after it is built, so it can be read from
+// any thread without locking.
+class ConfigSnapshot {
+ public:
+  ConfigSnapshot();
+  explicit ConfigSnapshot(std::vector<ConfigSnapshotValue> values);
+
+  // Return the value for the key, or nullptr if there is none.
+  const ConfigSnapshotValue* Find(const char* key) const;
+
+  // Assign keys that start with `prefix` to the `keys` variable, in order.
+  void GetKeysByPrefix(const char* prefix,
+                       std::vector<std::string>* keys) const;
+
+  // All values, sorted by key.
+  const std::vector<ConfigSnapshotValue>& values() const { return values_; }
+
+ private:
+  static uint32_t Hash(const char* key);
+
+  // Values sorted by key.
+  std::vector<ConfigSnapshotValue> values_;
+  // Hash of the key of each entry of `values_`.
+  std::vector<uint32_t> hashes_;
+  // Open addressing table of indices into `values_`, plus one.  Zero marks an
+  // empty slot.  The size is a power of two, at least twice the number of
+  // values, so probing always ends at an empty slot.
+  std::vector<uint32_t> slots_;
+};
+
+}  // namespace internal
+}  // namespace remote_config
+}  // namespace firebase
+
+#endif  // FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_CONFIG_SNAPSHOT_H_
@@ -14,10 +14,10 @@
 
 #include "remote_config/src/desktop/file_manager.h"
 
+#include <cerrno>
 #include <cstdint>
-#include <fstream>
+#include <cstdio>
 #include <map>
-#include <sstream>
 #include <string>
 #include <utility>
 
@@ -26,16 +26,136 @@
 #include "remote_config/src/desktop/config_data.h"
 
 #if FIREBASE_PLATFORM_WINDOWS
+#include <windows.h>
+
 #include <codecvt>
 #include <locale>
-#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // FIREBASE_PLATFORM_WINDOWS
 
 namespace firebase {
 namespace remote_config {
 namespace internal {
 
+namespace {
+
+// Read-only mapping of a whole file into memory. Empty if the file does not
+// exist or can not be mapped.
+class MappedFile {
+ public:
+#if FIREBASE_PLATFORM_WINDOWS
+  explicit MappedFile(const std::wstring& path)
+      : data_(nullptr), size_(0) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE) return;
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+      HANDLE mapping =
+          CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping) {
+        data_ = static_cast<const uint8_t*>(
+            MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data_) size_ = static_cast<size_t>(size.QuadPart);
+        // The view keeps the mapping alive.
+        CloseHandle(mapping);
+      }
+    }
+    CloseHandle(file);
+  }
+
+  ~MappedFile() {
+    if (data_) UnmapViewOfFile(data_);
+  }
+#else
+  explicit MappedFile(const std::string& path) : data_(nullptr), size_(0) {
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) return;
+    struct stat file_stat;
+    if (fstat(file, &file_stat) == 0 && file_stat.st_size > 0) {
+      size_t size = static_cast<size_t>(file_stat.st_size);
+      void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+      if (data != MAP_FAILED) {
+        data_ = static_cast<const uint8_t*>(data);
+        size_ = size;
+      }
+    }
+    // The mapping stays valid after the file is closed.
+    close(file);
+  }
+
+  ~MappedFile() {
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+  }
+#endif  // FIREBASE_PLATFORM_WINDOWS
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* data_;
+  size_t size_;
+};
+
+// FNV-1a.
+uint64_t HashContent(const uint8_t* data, size_t size) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= data[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Write `buffer` to a new file at `path` and flush it to disk, so that it
+// can not be replaced by a partially written file after a crash.
+#if FIREBASE_PLATFORM_WINDOWS
+bool WriteFileToDisk(const std::wstring& path, const std::string& buffer) {
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  DWORD written = 0;
+  bool success =
+      WriteFile(file, buffer.data(), static_cast<DWORD>(buffer.size()),
+                &written, nullptr) &&
+      written == buffer.size() && FlushFileBuffers(file);
+  CloseHandle(file);
+  return success;
+}
+#else
+bool WriteFileToDisk(const std::string& path, const std::string& buffer) {
+  int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (file < 0) return false;
+  const char* data = buffer.data();
+  size_t remaining = buffer.size();
+  while (remaining > 0) {
+    ssize_t written = write(file, data, remaining);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      close(file);
+      return false;
+    }
+    data += written;
+    remaining -= static_cast<size_t>(written);
+  }
+  bool success = fsync(file) == 0;
+  return close(file) == 0 && success;
+}
+#endif  // FIREBASE_PLATFORM_WINDOWS
+
+}  // namespace
+
 RemoteConfigFileManager::RemoteConfigFileManager(const std::string& filename,
-                                                 const firebase::App& app) {
+                                                 const firebase::App& app)
+    : saved_size_(0), saved_hash_(0), has_saved_content_(false) {
   std::string app_data_prefix =
       std::string(app.options().package_name()) + "/" + app.name();
   std::string file_path =
@@ -49,18 +169,46 @@ RemoteConfigFileManager::RemoteConfigFileManager(const std::string& filename,
 #endif
 }
 
-bool RemoteConfigFileManager::Load(LayeredConfigs* configs) const {
-  std::fstream input(file_path_, std::ios::in | std::ios::binary);
-  std::stringstream ss;
-  ss << input.rdbuf();
-  configs->Deserialize(ss.str());
+bool RemoteConfigFileManager::Load(LayeredConfigs* configs) {
+  MappedFile file(file_path_);
+  if (file.size() == 0) return false;
+  configs->Deserialize(file.data(), file.size());
+  saved_size_ = file.size();
+  saved_hash_ = HashContent(file.data(), file.size());
+  has_saved_content_ = true;
   return true;
 }
 
-bool RemoteConfigFileManager::Save(const LayeredConfigs& configs) const {
-  std::string buffer = configs.Serialize();
-  std::fstream output(file_path_, std::ios::out | std::ios::binary);
-  output.write(buffer.c_str(), buffer.size());
+bool RemoteConfigFileManager::Save(const LayeredConfigs& configs) {
+  return Save(configs.Serialize());
+}
+
+bool RemoteConfigFileManager::Save(const std::string& buffer) {
+  uint64_t hash = HashContent(reinterpret_cast<const uint8_t*>(buffer.data()),
+                              buffer.size());
+  if (has_saved_content_ && buffer.size() == saved_size_ &&
+      hash == saved_hash_) {
+    return true;
+  }
+
+#if FIREBASE_PLATFORM_WINDOWS
+  std::wstring temp_path = file_path_ + L".tmp";
+#else
+  std::string temp_path = file_path_ + ".tmp";
+#endif
+  if (!WriteFileToDisk(temp_path, buffer)) return false;
+#if FIREBASE_PLATFORM_WINDOWS
+  bool replaced = MoveFileExW(temp_path.c_str(), file_path_.c_str(),
+                              MOVEFILE_REPLACE_EXISTING |
+                                  MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  bool replaced = rename(temp_path.c_str(), file_path_.c_str()) == 0;
+#endif
+  if (!replaced) return false;
+
+  saved_size_ = buffer.size();
+  saved_hash_ = hash;
+  has_saved_content_ = true;
   return true;
 }
 
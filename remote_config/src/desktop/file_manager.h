@@ -15,6 +15,8 @@
 #ifndef FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_FILE_MANAGER_H_
 #define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_FILE_MANAGER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 #include "app/src/include/firebase/app.h"
@@ -33,10 +35,20 @@ class RemoteConfigFileManager {
                           const firebase::App& app);
 
   // Load `configs` from file. Will return `true` if success.
-  bool Load(LayeredConfigs* configs) const;
+  //
+  // The file is mapped into memory and decoded in place.
+  bool Load(LayeredConfigs* configs);
 
   // Save `configs` to file. Will return `true` if success.
-  bool Save(const LayeredConfigs& configs) const;
+  bool Save(const LayeredConfigs& configs);
+
+  // Save configs serialized with `LayeredConfigs::Serialize()` to file. Will
+  // return `true` if success.
+  //
+  // The file is not written if it already has this content. Otherwise the
+  // content is written and flushed to disk in a temporary file that then
+  // replaces the file, so the file is never left partially written.
+  bool Save(const std::string& buffer);
 
  private:
   // Path to file with data. On Windows, use a UTF-16 path string.
@@ -45,6 +57,12 @@ class RemoteConfigFileManager {
 #else
   std::string file_path_;
 #endif
+
+  // Size and hash of the file content as last loaded or saved, used to skip
+  // saves that would not change the file.
+  size_t saved_size_;
+  uint64_t saved_hash_;
+  bool has_saved_content_;
 };
 
 }  // namespace internal
@@ -56,8 +56,10 @@ std::string RemoteConfigMetadata::Serialize() const {
 }
 
 void RemoteConfigMetadata::Deserialize(const std::string& buffer) {
-  const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.data());
-  size_t size = buffer.size();
+  Deserialize(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+}
+
+void RemoteConfigMetadata::Deserialize(const uint8_t* data, size_t size) {
   auto struct_map = flexbuffers::GetRoot(data, size).AsMap();
 
   flexbuffers::Map info = struct_map["info"].AsMap();
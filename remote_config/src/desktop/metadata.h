@@ -15,6 +15,8 @@
 #ifndef FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_METADATA_H_
 #define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_METADATA_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <string>
 
@@ -44,6 +46,8 @@ class RemoteConfigMetadata {
 
   std::string Serialize() const;
   void Deserialize(const std::string& buffer);
+  // Deserializes a buffer previously Serialized, reading it in place.
+  void Deserialize(const uint8_t* data, size_t size);
 
   const ConfigInfo& info() const { return info_; }
   void set_info(const ConfigInfo& info) { info_ = info; }
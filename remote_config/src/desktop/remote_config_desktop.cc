@@ -22,6 +22,7 @@
 #include <sstream>
 #include <string>
 #include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "app/src/callback.h"
@@ -99,6 +100,10 @@ RemoteConfigInternal::~RemoteConfigInternal() {
 
 void RemoteConfigInternal::InternalInit() {
   file_manager_.Load(&configs_);
+  {
+    MutexLock lock(internal_mutex_);
+    PublishSnapshot();
+  }
   AsyncSaveToFile();
   initialized_ = true;
 }
@@ -228,12 +233,14 @@ ConfigSettings RemoteConfigInternal::GetConfigSettings() {
 void RemoteConfigInternal::AsyncSaveToFile() {
   save_thread_ = std::thread([this]() {
     while (save_channel_.Get()) {
-      LayeredConfigs copy;
+      // Serializing is cheaper than copying every map of `configs_`, and the
+      // file manager skips the write if the content did not change.
+      std::string buffer;
       {
         MutexLock lock(internal_mutex_);
-        copy = configs_;
+        buffer = configs_.Serialize();
       }
-      file_manager_.Save(copy);
+      file_manager_.Save(buffer);
     }
   });
 }
@@ -310,6 +317,7 @@ void RemoteConfigInternal::SetDefaults(
   {
     MutexLock lock(internal_mutex_);
     configs_.defaults.SetNamespace(defaults_map, kDefaultNamespace);
+    PublishSnapshot();
   }
   save_channel_.Put();
 }
@@ -331,30 +339,48 @@ void RemoteConfigInternal::SetConfigSetting(ConfigSetting setting,
   save_channel_.Put();
 }
 
-bool RemoteConfigInternal::CheckValueInActiveAndDefault(const char* key,
-                                                        ValueInfo* info,
-                                                        std::string* value) {
-  return CheckValueInConfig(configs_.active, kValueSourceRemoteValue, key, info,
-                            value) ||
-         CheckValueInConfig(configs_.defaults, kValueSourceDefaultValue, key,
-                            info, value);
+void RemoteConfigInternal::PublishSnapshot() {
+  std::set<std::string> keys;
+  configs_.active.GetKeysByPrefix("", kDefaultNamespace, &keys);
+  configs_.defaults.GetKeysByPrefix("", kDefaultNamespace, &keys);
+
+  std::vector<ConfigSnapshotValue> values(keys.size());
+  auto value = values.begin();
+  for (const std::string& key : keys) {
+    value->key = key;
+    if (configs_.active.HasValue(key, kDefaultNamespace)) {
+      value->value = configs_.active.GetValue(key, kDefaultNamespace);
+      value->source = kValueSourceRemoteValue;
+    } else {
+      value->value = configs_.defaults.GetValue(key, kDefaultNamespace);
+      value->source = kValueSourceDefaultValue;
+    }
+    value->is_bool = ConvertToBool(value->value, &value->bool_value);
+    value->is_long = ConvertToLong(value->value, &value->long_value);
+    value->is_double = ConvertToDouble(value->value, &value->double_value);
+    ++value;
+  }
+  std::atomic_store(&snapshot_, std::shared_ptr<const ConfigSnapshot>(
+                                    new ConfigSnapshot(std::move(values))));
 }
 
-bool RemoteConfigInternal::CheckValueInConfig(
-    const NamespacedConfigData& config, ValueSource source, const char* key,
-    ValueInfo* info, std::string* value) {
-  if (!key) return false;
+std::shared_ptr<const ConfigSnapshot> RemoteConfigInternal::GetSnapshot()
+    const {
+  return std::atomic_load(&snapshot_);
+}
 
-  {
-    MutexLock lock(internal_mutex_);
-    if (!config.HasValue(key, kDefaultNamespace)) {
-      return false;
+const ConfigSnapshotValue* RemoteConfigInternal::FindValue(
+    const ConfigSnapshot& snapshot, const char* key, ValueInfo* info) {
+  const ConfigSnapshotValue* value = snapshot.Find(key);
+  if (info) {
+    if (value) {
+      info->source = value->source;
+    } else {
+      info->source = kValueSourceStaticValue;
+      info->conversion_successful = true;
     }
-    *value = config.GetValue(key, kDefaultNamespace);
   }
-
-  if (info) info->source = source;
-  return true;
+  return value;
 }
 
 bool RemoteConfigInternal::IsBoolTrue(const std::string& str) {
@@ -405,34 +431,21 @@ bool RemoteConfigInternal::ConvertToBool(const std::string& from, bool* out) {
 }
 
 bool RemoteConfigInternal::GetBoolean(const char* key, ValueInfo* info) {
-  std::string value;
-  if (!CheckValueInActiveAndDefault(key, info, &value)) {
-    if (info) {
-      info->source = kValueSourceStaticValue;
-      info->conversion_successful = true;
-    }
-    return kDefaultValueForBool;
-  }
+  std::shared_ptr<const ConfigSnapshot> snapshot = GetSnapshot();
+  const ConfigSnapshotValue* value = FindValue(*snapshot, key, info);
+  if (!value) return kDefaultValueForBool;
 
-  bool bool_value;
-  bool conversion_successful = ConvertToBool(value, &bool_value);
-
-  if (info) info->conversion_successful = conversion_successful;
-  return bool_value;
+  if (info) info->conversion_successful = value->is_bool;
+  return value->is_bool ? value->bool_value : kDefaultValueForBool;
 }
 
 std::string RemoteConfigInternal::GetString(const char* key, ValueInfo* info) {
-  std::string value;
-  if (!CheckValueInActiveAndDefault(key, info, &value)) {
-    if (info) {
-      info->source = kValueSourceStaticValue;
-      info->conversion_successful = true;
-    }
-    return kDefaultValueForString;
-  }
+  std::shared_ptr<const ConfigSnapshot> snapshot = GetSnapshot();
+  const ConfigSnapshotValue* value = FindValue(*snapshot, key, info);
+  if (!value) return kDefaultValueForString;
 
   if (info) info->conversion_successful = true;
-  return value;
+  return value->value;
 }
 
 bool RemoteConfigInternal::ConvertToLong(const std::string& from,
@@ -450,19 +463,12 @@ bool RemoteConfigInternal::ConvertToLong(const std::string& from,
 }
 
 int64_t RemoteConfigInternal::GetLong(const char* key, ValueInfo* info) {
-  std::string value;
-  if (!CheckValueInActiveAndDefault(key, info, &value)) {
-    if (info) {
-      info->source = kValueSourceStaticValue;
-      info->conversion_successful = true;
-    }
-    return kDefaultValueForLong;
-  }
+  std::shared_ptr<const ConfigSnapshot> snapshot = GetSnapshot();
+  const ConfigSnapshotValue* value = FindValue(*snapshot, key, info);
+  if (!value) return kDefaultValueForLong;
 
-  int64_t long_value = kDefaultValueForLong;
-  bool conversion_successful = ConvertToLong(value, &long_value);
-  if (info) info->conversion_successful = conversion_successful;
-  return long_value;
+  if (info) info->conversion_successful = value->is_long;
+  return value->long_value;
 }
 
 bool RemoteConfigInternal::ConvertToDouble(const std::string& from,
@@ -480,40 +486,22 @@ bool RemoteConfigInternal::ConvertToDouble(const std::string& from,
 }
 
 double RemoteConfigInternal::GetDouble(const char* key, ValueInfo* info) {
-  std::string value;
-  if (!CheckValueInActiveAndDefault(key, info, &value)) {
-    if (info) {
-      info->source = kValueSourceStaticValue;
-      info->conversion_successful = true;
-    }
-    return kDefaultValueForDouble;
-  }
+  std::shared_ptr<const ConfigSnapshot> snapshot = GetSnapshot();
+  const ConfigSnapshotValue* value = FindValue(*snapshot, key, info);
+  if (!value) return kDefaultValueForDouble;
 
-  double double_value = kDefaultValueForDouble;
-  bool conversion_successful = ConvertToDouble(value, &double_value);
-
-  if (info) info->conversion_successful = conversion_successful;
-  return double_value;
+  if (info) info->conversion_successful = value->is_double;
+  return value->double_value;
 }
 
 std::vector<unsigned char> RemoteConfigInternal::GetData(const char* key,
                                                          ValueInfo* info) {
-  std::string value;
-  if (!CheckValueInActiveAndDefault(key, info, &value)) {
-    if (info) {
-      info->source = kValueSourceStaticValue;
-      info->conversion_successful = true;
-    }
-    return kDefaultValueForData;
-  }
-
-  std::vector<unsigned char> data_value;
-  data_value.reserve(value.size());
-  for (const char& ch : value)
-    data_value.push_back(static_cast<unsigned char>(ch));
+  std::shared_ptr<const ConfigSnapshot> snapshot = GetSnapshot();
+  const ConfigSnapshotValue* value = FindValue(*snapshot, key, info);
+  if (!value) return kDefaultValueForData;
 
   if (info) info->conversion_successful = true;
-  return data_value;
+  return std::vector<unsigned char>(value->value.begin(), value->value.end());
 }
 
 std::vector<std::string> RemoteConfigInternal::GetKeys() {
@@ -522,14 +510,10 @@ std::vector<std::string> RemoteConfigInternal::GetKeys() {
 
 std::vector<std::string> RemoteConfigInternal::GetKeysByPrefix(
     const char* prefix) {
-  if (prefix == nullptr) return std::vector<std::string>();
-  std::set<std::string> unique_keys;
-  {
-    MutexLock lock(internal_mutex_);
-    configs_.active.GetKeysByPrefix(prefix, kDefaultNamespace, &unique_keys);
-    configs_.defaults.GetKeysByPrefix(prefix, kDefaultNamespace, &unique_keys);
-  }
-  return std::vector<std::string>(unique_keys.begin(), unique_keys.end());
+  std::vector<std::string> keys;
+  if (prefix == nullptr) return keys;
+  GetSnapshot()->GetKeysByPrefix(prefix, &keys);
+  return keys;
 }
 
 // String -> Variant
@@ -557,11 +541,19 @@ Variant RemoteConfigInternal::StringToVariant(const std::string& from) {
 
 std::map<std::string, Variant> RemoteConfigInternal::GetAll() {
   std::map<std::string, Variant> result;
-  for (const std::string& key : GetKeys()) {
-    std::string value =
-        GetString(key.c_str(), static_cast<ValueInfo*>(nullptr));
-
-    result[key] = StringToVariant(value);
+  std::shared_ptr<const ConfigSnapshot> snapshot = GetSnapshot();
+  // Use the conversions cached in the snapshot, in the order used by
+  // `StringToVariant`.
+  for (const ConfigSnapshotValue& value : snapshot->values()) {
+    if (value.is_long) {
+      result[value.key] = Variant(value.long_value);
+    } else if (value.is_double) {
+      result[value.key] = Variant(value.double_value);
+    } else if (value.is_bool) {
+      result[value.key] = Variant(value.bool_value);
+    } else {
+      result[value.key] = Variant::FromMutableString(value.value);
+    }
   }
   return result;
 }
@@ -573,6 +565,7 @@ bool RemoteConfigInternal::ActivateFetched() {
     if (configs_.fetched.timestamp() <= configs_.active.timestamp())
       return false;
     configs_.active = configs_.fetched;
+    PublishSnapshot();
   }
   save_channel_.Put();
   return true;
@@ -16,6 +16,7 @@
 #define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_REMOTE_CONFIG_DESKTOP_H_
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <thread>  // NOLINT
 
@@ -27,6 +28,7 @@
 #include "firebase/app.h"
 #include "firebase/future.h"
 #include "remote_config/src/desktop/config_data.h"
+#include "remote_config/src/desktop/config_snapshot.h"
 #include "remote_config/src/desktop/file_manager.h"
 #include "remote_config/src/desktop/notification_channel.h"
 #include "remote_config/src/desktop/rest.h"
@@ -159,20 +161,22 @@ class RemoteConfigInternal {
   // Set default values to `configs_.defaults` holder.
   void SetDefaults(const std::map<std::string, std::string>& defaults_map);
 
-  // Returns true and assigns the found record to the `value` if the `active` or
-  // `defaults` holders contains a record for the key.
-  //
-  // Assign `info->source` If info is not nullptr.
-  bool CheckValueInActiveAndDefault(const char* key, ValueInfo* info,
-                                    std::string* value);
+  // Rebuild the snapshot read by the getters from the `active` and `defaults`
+  // holders and publish it.  Call with `internal_mutex_` held after changing
+  // either holder.
+  void PublishSnapshot();
+
+  // Returns the snapshot the getters currently read from.
+  std::shared_ptr<const ConfigSnapshot> GetSnapshot() const;
 
-  // Returns true and assigns the found record to the `value` if the `holder`
-  // contains a record for the key.
+  // Returns the record for the key from the `snapshot`, or nullptr if it has
+  // none.
   //
-  // Assign `info->source` If info is not nullptr.
-  bool CheckValueInConfig(const NamespacedConfigData& config,
-                          ValueSource source, const char* key, ValueInfo* info,
-                          std::string* value);
+  // Assign `info->source` If info is not nullptr. If there is no record, also
+  // assign `info->conversion_successful`, since the static value is used.
+  static const ConfigSnapshotValue* FindValue(const ConfigSnapshot& snapshot,
+                                              const char* key,
+                                              ValueInfo* info);
 
   void FetchInternal();
 
@@ -217,6 +221,11 @@ class RemoteConfigInternal {
 
   mutable Mutex internal_mutex_;
 
+  // Active values falling back to defaults, with their conversions. Replaced
+  // atomically by `PublishSnapshot()`, so getters read it without locking
+  // `internal_mutex_`.
+  std::shared_ptr<const ConfigSnapshot> snapshot_;
+
   // Handle calls from Futures that the API returns.
   ReferenceCountedFutureImpl future_impl_;
 
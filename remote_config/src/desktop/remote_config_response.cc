@@ -90,8 +90,9 @@ Variant RemoteConfigResponse::GetEntries() { return entries_; }
 // Mark the response completed for both header and body.
 void RemoteConfigResponse::MarkCompleted() {
   ResponseJson::MarkCompleted();
-  if (GetBody()[0] == '\0') {
-    // If the body of response flatbuffer is empty, early out.
+  if (GetBody()[0] == '\0' || !parser_) {
+    // If the body of response flatbuffer is empty or could not be parsed,
+    // early out.
     return;
   }
   const flatbuffers::FlatBufferBuilder& builder = parser_->builder_;
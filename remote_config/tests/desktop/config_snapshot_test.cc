@@ -0,0 +1,99 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "remote_config/src/desktop/config_snapshot.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace remote_config {
+namespace internal {
+
+static ConfigSnapshotValue MakeValue(const std::string& key,
+                                     const std::string& value) {
+  ConfigSnapshotValue result;
+  result.key = key;
+  result.value = value;
+  result.source = kValueSourceRemoteValue;
+  return result;
+}
+
+TEST(ConfigSnapshotTest, Empty) {
+  ConfigSnapshot snapshot;
+  EXPECT_EQ(snapshot.Find("key"), nullptr);
+  EXPECT_EQ(snapshot.Find(""), nullptr);
+  EXPECT_EQ(snapshot.Find(nullptr), nullptr);
+
+  std::vector<std::string> keys;
+  snapshot.GetKeysByPrefix("", &keys);
+  EXPECT_THAT(keys, ::testing::IsEmpty());
+}
+
+TEST(ConfigSnapshotTest, Find) {
+  std::vector<ConfigSnapshotValue> values;
+  for (int i = 0; i < 100; i++) {
+    values.push_back(
+        MakeValue("key" + std::to_string(i), "value" + std::to_string(i)));
+  }
+  ConfigSnapshot snapshot(values);
+
+  for (int i = 0; i < 100; i++) {
+    std::string key = "key" + std::to_string(i);
+    const ConfigSnapshotValue* value = snapshot.Find(key.c_str());
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(value->key, key);
+    EXPECT_EQ(value->value, "value" + std::to_string(i));
+  }
+  EXPECT_EQ(snapshot.Find("key100"), nullptr);
+  EXPECT_EQ(snapshot.Find("key"), nullptr);
+  EXPECT_EQ(snapshot.Find(""), nullptr);
+}
+
+TEST(ConfigSnapshotTest, ValuesSortedByKey) {
+  ConfigSnapshot snapshot(std::vector<ConfigSnapshotValue>{
+      MakeValue("b", "2"), MakeValue("c", "3"), MakeValue("a", "1")});
+
+  ASSERT_EQ(snapshot.values().size(), 3u);
+  EXPECT_EQ(snapshot.values()[0].key, "a");
+  EXPECT_EQ(snapshot.values()[1].key, "b");
+  EXPECT_EQ(snapshot.values()[2].key, "c");
+}
+
+TEST(ConfigSnapshotTest, GetKeysByPrefix) {
+  ConfigSnapshot snapshot(std::vector<ConfigSnapshotValue>{
+      MakeValue("key_data", ""), MakeValue("key_double", ""),
+      MakeValue("key_bool", ""), MakeValue("other", ""),
+      MakeValue("key", "")});
+
+  std::vector<std::string> keys;
+  snapshot.GetKeysByPrefix("", &keys);
+  EXPECT_THAT(keys, ::testing::ElementsAre("key", "key_bool", "key_data",
+                                           "key_double", "other"));
+  keys.clear();
+
+  snapshot.GetKeysByPrefix("key_d", &keys);
+  EXPECT_THAT(keys, ::testing::ElementsAre("key_data", "key_double"));
+  keys.clear();
+
+  snapshot.GetKeysByPrefix("some_prefix", &keys);
+  EXPECT_THAT(keys, ::testing::IsEmpty());
+}
+
+}  // namespace internal
+}  // namespace remote_config
+}  // namespace firebase
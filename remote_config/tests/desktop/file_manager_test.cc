@@ -61,6 +61,36 @@ TEST(RemoteConfigFileManagerTest, SaveAndLoadSuccess) {
   EXPECT_EQ(configs, new_configs);
 }
 
+TEST(RemoteConfigFileManagerTest, LoadMissingFile) {
+  RemoteConfigFileManager file_manager(
+      file::JoinPath(FLAGS_test_tmpdir, "not_found_file"));
+  LayeredConfigs configs;
+  EXPECT_FALSE(file_manager.Load(&configs));
+  EXPECT_EQ(configs, LayeredConfigs());
+}
+
+TEST(RemoteConfigFileManagerTest, SaveReplacesContent) {
+  std::string file_path =
+      file::JoinPath(FLAGS_test_tmpdir, "remote_config_data_replaced");
+
+  RemoteConfigFileManager file_manager(file_path);
+  LayeredConfigs configs;
+  configs.active = NamespacedConfigData(
+      NamespaceKeyValueMap({{"namespace1", {{"key1", "value1"}}}}), 1234567);
+  EXPECT_TRUE(file_manager.Save(configs));
+  // Saving the same content again does not need to write the file.
+  EXPECT_TRUE(file_manager.Save(configs.Serialize()));
+
+  configs.active = NamespacedConfigData(
+      NamespaceKeyValueMap({{"namespace1", {{"key1", "value2"}}}}), 5555555);
+  EXPECT_TRUE(file_manager.Save(configs));
+
+  RemoteConfigFileManager other_file_manager(file_path);
+  LayeredConfigs new_configs;
+  EXPECT_TRUE(other_file_manager.Load(&new_configs));
+  EXPECT_EQ(configs, new_configs);
+}
+
 }  // namespace internal
 }  // namespace remote_config
 }  // namespace firebase
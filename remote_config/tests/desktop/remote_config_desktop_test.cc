@@ -329,6 +329,25 @@ TEST_F(RemoteConfigDesktopTest, ActivateFetched) {
     EXPECT_TRUE(instance_->ActivateFetched());
     EXPECT_EQ(instance_->configs_.fetched, instance_->configs_.active);
   }
+  {
+    SetUpInstance();
+    instance_->configs_.fetched = NamespacedConfigData(
+        NamespaceKeyValueMap({{RemoteConfigInternal::kDefaultNamespace,
+                               {{"key_long", "77"}, {"key_new", "1.5"}}}}),
+        9999999999);
+
+    // The getters read the activated values only after activating.
+    EXPECT_EQ(instance_->GetLong("key_long", nullptr), 55555);
+    EXPECT_EQ(instance_->GetDouble("key_new", nullptr), 0.0);
+    EXPECT_TRUE(instance_->ActivateFetched());
+    ValueInfo info;
+    EXPECT_EQ(instance_->GetLong("key_long", &info), 77);
+    EXPECT_TRUE(info.conversion_successful);
+    EXPECT_EQ(info.source, kValueSourceRemoteValue);
+    EXPECT_EQ(instance_->GetDouble("key_new", nullptr), 1.5);
+    EXPECT_EQ(instance_->GetString("key_string", &info), "");
+    EXPECT_EQ(info.source, kValueSourceStaticValue);
+  }
 }
 
 TEST_F(RemoteConfigDesktopTest, Fetch) {
@@ -95,6 +95,10 @@ class StorageInternal {
   // if a failure occurs.
   void set_max_operation_retry_time(double max_transfer_retry_seconds);
 
+  // Not supported on Android, downloads are done by the Java SDK.
+  int max_parallel_downloads() const { return 1; }
+  void set_max_parallel_downloads(int /*max_parallel_downloads*/) {}
+
   // Convert an error code obtained from a Java StorageException into a C++
   // Error enum.
   Error ErrorFromJavaErrorCode(jint java_error_code) const;
@@ -226,5 +226,13 @@ void Storage::set_max_operation_retry_time(double max_transfer_retry_seconds) {
     return internal_->set_max_operation_retry_time(max_transfer_retry_seconds);
 }
 
+int Storage::max_parallel_downloads() {
+  return internal_ ? internal_->max_parallel_downloads() : 1;
+}
+
+void Storage::set_max_parallel_downloads(int max_parallel_downloads) {
+  if (internal_) internal_->set_max_parallel_downloads(max_parallel_downloads);
+}
+
 }  // namespace storage
 }  // namespace firebase
@@ -21,6 +21,117 @@ namespace firebase {
 namespace storage {
 namespace internal {
 
+TransferController::TransferController()
+    : paused_(false),
+      cancelled_(false),
+      complete_(false),
+      bytes_transferred_(0),
+      total_byte_count_(-1) {}
+
+void TransferController::SetRequest(int id, const Controller& controller) {
+  Controller request = controller;
+  bool paused;
+  bool cancelled;
+  {
+    MutexLock lock(mutex_);
+    if (complete_) return;
+    requests_[id] = request;
+    paused = paused_;
+    cancelled = cancelled_;
+  }
+  if (cancelled) {
+    request.Cancel();
+  } else if (paused) {
+    request.Pause();
+  }
+}
+
+void TransferController::RemoveRequest(int id) {
+  UpdateProgress();
+  MutexLock lock(mutex_);
+  requests_.erase(id);
+}
+
+void TransferController::Complete() {
+  UpdateProgress();
+  MutexLock lock(mutex_);
+  complete_ = true;
+  requests_.clear();
+}
+
+bool TransferController::Pause() {
+  {
+    MutexLock lock(mutex_);
+    if (complete_ || cancelled_ || paused_) return false;
+    paused_ = true;
+  }
+  for (auto& request : GetRequests()) request.second.Pause();
+  return true;
+}
+
+bool TransferController::Resume() {
+  {
+    MutexLock lock(mutex_);
+    if (complete_ || !paused_) return false;
+    paused_ = false;
+  }
+  for (auto& request : GetRequests()) request.second.Resume();
+  return true;
+}
+
+bool TransferController::Cancel() {
+  {
+    MutexLock lock(mutex_);
+    if (complete_ || cancelled_) return false;
+    cancelled_ = true;
+  }
+  for (auto& request : GetRequests()) request.second.Cancel();
+  return true;
+}
+
+bool TransferController::is_paused() const {
+  MutexLock lock(mutex_);
+  return paused_ && !complete_;
+}
+
+int64_t TransferController::bytes_transferred() {
+  UpdateProgress();
+  MutexLock lock(mutex_);
+  return bytes_transferred_;
+}
+
+int64_t TransferController::total_byte_count() {
+  UpdateProgress();
+  MutexLock lock(mutex_);
+  return total_byte_count_;
+}
+
+bool TransferController::is_valid() const {
+  MutexLock lock(mutex_);
+  return !complete_;
+}
+
+std::map<int, Controller> TransferController::GetRequests() const {
+  MutexLock lock(mutex_);
+  return requests_;
+}
+
+void TransferController::UpdateProgress() {
+  // Requests report the progress of the whole transfer, so keep the largest.
+  int64_t transferred = -1;
+  int64_t total = -1;
+  for (auto& request : GetRequests()) {
+    if (!request.second.is_valid()) continue;
+    int64_t request_transferred = request.second.bytes_transferred();
+    int64_t request_total = request.second.total_byte_count();
+    if (request_transferred > transferred) transferred = request_transferred;
+    if (request_total > total) total = request_total;
+  }
+  MutexLock lock(mutex_);
+  if (transferred > bytes_transferred_) bytes_transferred_ = transferred;
+  if (total > total_byte_count_) total_byte_count_ = total;
+}
+
 ControllerInternal::ControllerInternal() : operation_(nullptr) {}
 
 ControllerInternal::~ControllerInternal() {
@@ -35,7 +146,11 @@ ControllerInternal::ControllerInternal(const ControllerInternal& other)
 ControllerInternal& ControllerInternal::operator=(
     const ControllerInternal& other) {
   MutexLock lock(other.mutex_);
-  Initialize(other.reference_, other.operation_);
+  if (other.transfer_) {
+    InitializeTransfer(other.reference_, other.transfer_);
+  } else {
+    Initialize(other.reference_, other.operation_);
+  }
   bytes_transferred_ = other.bytes_transferred_;
   total_byte_count_ = other.total_byte_count_;
   return *this;
@@ -44,24 +159,28 @@ ControllerInternal& ControllerInternal::operator=(
 // Pauses the operation currently in progress.
 bool ControllerInternal::Pause() {
   MutexLock lock(mutex_);
+  if (transfer_) return transfer_->Pause();
   return operation_ && operation_->Pause();
 }
 
 // Resumes the operation that is paused.
 bool ControllerInternal::Resume() {
   MutexLock lock(mutex_);
+  if (transfer_) return transfer_->Resume();
   return operation_ && operation_->Resume();
 }
 
 // Cancels the operation currently in progress.
 bool ControllerInternal::Cancel() {
   MutexLock lock(mutex_);
+  if (transfer_) return transfer_->Cancel();
   return operation_ && operation_->Cancel();
 }
 
 // Returns true if the operation is paused.
 bool ControllerInternal::is_paused() const {
   MutexLock lock(mutex_);
+  if (transfer_) return transfer_->is_paused();
   return operation_ && operation_->is_paused();
 }
 
@@ -89,6 +208,7 @@ StorageReferenceInternal* ControllerInternal::GetReference() const {
 
 bool ControllerInternal::is_valid() {
   MutexLock lock(mutex_);
+  if (transfer_) return transfer_->is_valid();
   return operation_ != nullptr;
 }
 
@@ -98,6 +218,7 @@ void ControllerInternal::Initialize(const StorageReference& reference,
   bytes_transferred_ = 0;
   total_byte_count_ = -1;
   reference_ = reference;
+  transfer_.reset();
   if (operation_) operation_->cleanup().UnregisterObject(this);
   operation_ = operation;
   if (operation_) {
@@ -106,16 +227,40 @@ void ControllerInternal::Initialize(const StorageReference& reference,
   }
 }
 
+void ControllerInternal::InitializeTransfer(
+    const StorageReference& reference,
+    std::shared_ptr<TransferController> transfer) {
+  MutexLock lock(mutex_);
+  Initialize(reference, nullptr);
+  transfer_ = transfer;
+}
+
+void ControllerInternal::BindTransfer(
+    Controller* controller, const StorageReference& reference,
+    std::shared_ptr<TransferController> transfer) {
+  if (controller && controller->internal_) {
+    controller->internal_->InitializeTransfer(reference, transfer);
+  }
+}
+
 void ControllerInternal::UpdateFromOperation(int64_t* transferred,
                                              int64_t* total) {
   MutexLock lock(mutex_);
   int64_t new_value = bytes_transferred_;
-  if (operation_) new_value = operation_->bytes_transferred();
+  if (transfer_) {
+    new_value = transfer_->bytes_transferred();
+  } else if (operation_) {
+    new_value = operation_->bytes_transferred();
+  }
   if (new_value > 0 && new_value != bytes_transferred_) {
     bytes_transferred_ = new_value;
   }
   new_value = total_byte_count_;
-  if (operation_) new_value = operation_->total_byte_count();
+  if (transfer_) {
+    new_value = transfer_->total_byte_count();
+  } else if (operation_) {
+    new_value = operation_->total_byte_count();
+  }
   if (new_value > 0 && new_value != total_byte_count_) {
     total_byte_count_ = new_value;
   }
@@ -17,6 +17,9 @@
 
 #include <stdint.h>
 
+#include <map>
+#include <memory>
+
 #include "app/memory/unique_ptr.h"
 #include "app/rest/controller_curl.h"
 #include "app/rest/request_binary.h"
@@ -24,6 +27,7 @@
 #include "app/rest/transport_builder.h"
 #include "app/src/include/firebase/internal/mutex.h"
 #include "storage/src/desktop/rest_operation.h"
+#include "storage/src/include/firebase/storage/controller.h"
 #include "storage/src/include/firebase/storage/storage_reference.h"
 
 namespace firebase {
@@ -32,6 +36,64 @@ namespace internal {
 
 class RestOperation;
 
+// Controls a transfer that is sent as several requests, such as a resumable
+// upload or a parallel download.  The caller's Controller is bound to this
+// object once, before the transfer starts, and this object forwards to the
+// operations of the requests in flight.  A pause or cancellation is also
+// applied to requests started later.
+class TransferController {
+ public:
+  TransferController();
+
+  // Track the request with the given id, controlled by controller.  The
+  // request is paused or cancelled straight away if the transfer is.
+  void SetRequest(int id, const Controller& controller);
+
+  // Stop tracking the request with the given id.
+  void RemoveRequest(int id);
+
+  // Stop tracking all requests once the transfer is complete.
+  void Complete();
+
+  // Pauses the requests in flight and those started later.
+  bool Pause();
+
+  // Resumes the transfer if it is paused.
+  bool Resume();
+
+  // Cancels the requests in flight and those started later.
+  bool Cancel();
+
+  // Returns true if the transfer is paused.
+  bool is_paused() const;
+
+  // Returns the number of bytes transferred so far.
+  int64_t bytes_transferred();
+
+  // Returns the total bytes to be transferred.
+  int64_t total_byte_count();
+
+  // Returns true until the transfer is complete.
+  bool is_valid() const;
+
+ private:
+  // Copies the controllers of the requests in flight, so they are not used
+  // while mutex_ is held.
+  std::map<int, Controller> GetRequests() const;
+
+  // Update the progress from the requests in flight.
+  void UpdateProgress();
+
+  // Guards all members.
+  mutable Mutex mutex_;
+  std::map<int, Controller> requests_;
+  bool paused_;
+  bool cancelled_;
+  bool complete_;
+  int64_t bytes_transferred_;
+  int64_t total_byte_count_;
+};
+
 class ControllerInternal {
  public:
   ControllerInternal();
@@ -74,6 +136,16 @@ class ControllerInternal {
   // registers for cleanup on RestOperation::cleanup().
   void Initialize(const StorageReference& reference, RestOperation* operation);
 
+  // Initialize to control a transfer sent as several requests.
+  void InitializeTransfer(const StorageReference& reference,
+                          std::shared_ptr<TransferController> transfer);
+
+  // Bind controller, if not null, to transfer.  Transfers call this before
+  // they start, so the caller's Controller is not written to afterwards.
+  static void BindTransfer(Controller* controller,
+                           const StorageReference& reference,
+                           std::shared_ptr<TransferController> transfer);
+
  private:
   // Update the internal state from the operation optionally returning
   // the current transfer state.
@@ -83,10 +155,12 @@ class ControllerInternal {
   static void RemoveRestOperationReference(void* object);
 
  private:
-  // Guards reference_ and operation_.
+  // Guards reference_, operation_ and transfer_.
   mutable Mutex mutex_;
   StorageReference reference_;
   RestOperation* operation_;
+  // Transfer controlled instead of operation_, or null.
+  std::shared_ptr<TransferController> transfer_;
   int64_t bytes_transferred_;
   int64_t total_byte_count_;
 };
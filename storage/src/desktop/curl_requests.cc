@@ -190,6 +190,36 @@ void EmptyResponse::MarkCompleted() {
   BlockingResponse::NotifyComplete();
 }
 
+UploadSessionResponse::UploadSessionResponse(
+    SafeFutureHandle<void> handle, ReferenceCountedFutureImpl* ref_future)
+    : BlockingResponse(handle.get(), ref_future) {}
+
+bool UploadSessionResponse::ProcessBody(const char* buffer, size_t length) {
+  buffer_ += std::string(buffer, length);
+  NotifyProgress();
+  return true;
+}
+
+void UploadSessionResponse::MarkCompleted() {
+  BlockingResponse::MarkCompleted();
+  SafeFutureHandle<void> handle(handle_);
+  if (status() == rest::util::HttpSuccess ||
+      status() == rest::util::HttpNoContent) {
+    ref_future_->Complete(handle, kErrorNone);
+  } else {
+    StorageNetworkError response;
+    if (response.Parse(buffer_.c_str())) {
+      ref_future_->Complete(handle, HttpToErrorCode(status()),
+                            response.error_message().c_str());
+    } else {
+      ref_future_->Complete(handle, HttpToErrorCode(status()),
+                            kInvalidJsonResponse);
+    }
+  }
+  NotifyProgress();
+  BlockingResponse::NotifyComplete();
+}
+
 GetFileResponse::GetFileResponse(const char* filename,
                                  SafeFutureHandle<size_t> handle,
                                  ReferenceCountedFutureImpl* ref_future)
@@ -241,6 +271,75 @@ void GetFileResponse::MarkCompleted() {
   BlockingResponse::NotifyComplete();
 }
 
+GetFileRangeResponse::GetFileRangeResponse(
+    const char* filename, size_t offset,
+    std::shared_ptr<TransferProgress> progress,
+    SafeFutureHandle<size_t> handle, ReferenceCountedFutureImpl* ref_future)
+    : BlockingResponse(handle.get(), ref_future),
+      filename_(filename),
+      offset_(offset),
+      progress_(progress),
+      bytes_written_(0) {}
+
+bool GetFileRangeResponse::HasRangeData() {
+  // A server that ignores the Range header returns the whole object, which
+  // is only usable if the range starts at the beginning of the object.
+  return status() == rest::util::HttpPartialContent ||
+         (status() == rest::util::HttpSuccess && offset_ == 0);
+}
+
+bool GetFileRangeResponse::ProcessBody(const char* buffer, size_t length) {
+  if (HasRangeData()) {
+    if (!file_.is_open()) {
+      // The file is created before the download starts, open it without
+      // truncating so other ranges are preserved.
+      file_.open(filename_, std::ios::in | std::ios::out | std::ios::binary);
+      if (!file_.is_open()) return false;
+      file_.seekp(offset_);
+    }
+    file_.write(buffer, length);
+    if (!file_.good()) return false;
+    bytes_written_ += length;
+    if (progress_) progress_->add_bytes_transferred(length);
+  } else if (status() != rest::util::HttpSuccess) {
+    // Keep the error response so it can be parsed later.
+    error_buffer_.append(buffer, length);
+  }
+  NotifyProgress();
+  return true;
+}
+
+void GetFileRangeResponse::MarkCompleted() {
+  BlockingResponse::MarkCompleted();
+  SafeFutureHandle<size_t> future_handle_with_size(handle_);
+  file_.close();
+  if (HasRangeData()) {
+    ref_future_->CompleteWithResult(future_handle_with_size, kErrorNone,
+                                    bytes_written_);
+  } else if (status() == rest::util::HttpRangeNotSatisfiable && offset_ == 0) {
+    // No range of an empty object can be satisfied.
+    ref_future_->CompleteWithResult(future_handle_with_size, kErrorNone,
+                                    bytes_written_);
+  } else if (status() == rest::util::HttpSuccess) {
+    ref_future_->CompleteWithResult(future_handle_with_size, kErrorUnknown,
+                                    "Range requests are not supported.",
+                                    bytes_written_);
+  } else {
+    StorageNetworkError response;
+    if (response.Parse(error_buffer_.c_str())) {
+      ref_future_->CompleteWithResult(
+          future_handle_with_size, HttpToErrorCode(status()),
+          response.error_message().c_str(), bytes_written_);
+    } else {
+      ref_future_->CompleteWithResult(future_handle_with_size,
+                                      HttpToErrorCode(status()),
+                                      kInvalidJsonResponse, bytes_written_);
+    }
+  }
+  NotifyProgress();
+  BlockingResponse::NotifyComplete();
+}
+
 ReturnedMetadataResponse::ReturnedMetadataResponse(
     SafeFutureHandle<Metadata> handle, ReferenceCountedFutureImpl* ref_future,
     const StorageReference& storage_reference)
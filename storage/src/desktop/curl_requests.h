@@ -15,7 +15,11 @@
 #ifndef FIREBASE_STORAGE_SRC_DESKTOP_CURL_REQUESTS_H_
 #define FIREBASE_STORAGE_SRC_DESKTOP_CURL_REQUESTS_H_
 
+#include <stdint.h>
+
+#include <atomic>
 #include <fstream>
+#include <memory>
 
 #include "app/rest/request_binary.h"
 #include "app/rest/request_file.h"
@@ -142,6 +146,32 @@ class RequestFile : public rest::RequestFile {
   FIREBASE_STORAGE_REQUEST_CLASS_BODY(rest::RequestFile);
 };
 
+// Reads a range of a file.
+class RequestFileRange : public RequestFile {
+ public:
+  RequestFileRange(const char* filename, size_t offset, size_t size)
+      : RequestFile(filename, offset), size_(size), remaining_(size) {}
+
+  size_t GetPostFieldsSize() const override {
+    return IsFileOpen() ? size_ : 0;
+  }
+
+  size_t ReadBody(char* buffer, size_t length, bool* abort) override {
+    if (length > remaining_) length = remaining_;
+    if (!length) {
+      *abort = false;
+      return 0;
+    }
+    size_t read_size = RequestFile::ReadBody(buffer, length, abort);
+    remaining_ -= read_size;
+    return read_size;
+  }
+
+ private:
+  size_t size_;
+  size_t remaining_;
+};
+
 // TODO(b/68854714): merge with the blocking response in query_desktop.
 // b/68854714
 class BlockingResponse : public rest::Response {
@@ -201,6 +231,21 @@ class EmptyResponse : public BlockingResponse {
   std::string buffer_;
 };
 
+// Response class for the requests of a resumable upload session, which
+// succeed without returning data.  The session state is reported in the
+// X-Goog-Upload-* headers of the response.
+class UploadSessionResponse : public BlockingResponse {
+ public:
+  UploadSessionResponse(SafeFutureHandle<void> handle,
+                        ReferenceCountedFutureImpl* ref_future);
+  bool ProcessBody(const char* buffer, size_t length) override;
+  void MarkCompleted() override;
+
+ private:
+  // Holds error messages, if any.
+  std::string buffer_;
+};
+
 // Response class for downloading a storage resource into memory, via CURL.
 class GetBytesResponse : public BlockingResponse {
  public:
@@ -233,6 +278,49 @@ class GetFileResponse : public BlockingResponse {
   size_t bytes_written_;
 };
 
+// Progress of a transfer that is split across several concurrent requests.
+class TransferProgress {
+ public:
+  TransferProgress() : bytes_transferred_(0), total_byte_count_(-1) {}
+
+  int64_t bytes_transferred() const { return bytes_transferred_; }
+  void add_bytes_transferred(int64_t bytes) { bytes_transferred_ += bytes; }
+
+  // Size of the whole transfer, or -1 if it is not known yet.
+  int64_t total_byte_count() const { return total_byte_count_; }
+  void set_total_byte_count(int64_t size) { total_byte_count_ = size; }
+
+ private:
+  std::atomic<int64_t> bytes_transferred_;
+  std::atomic<int64_t> total_byte_count_;
+};
+
+// Response for downloading a byte range of a storage resource into an existing
+// file, at the offset of the range, so ranges can be written in any order.
+class GetFileRangeResponse : public BlockingResponse {
+ public:
+  GetFileRangeResponse(const char* filename, size_t offset,
+                       std::shared_ptr<TransferProgress> progress,
+                       SafeFutureHandle<size_t> handle,
+                       ReferenceCountedFutureImpl* ref_future);
+  bool ProcessBody(const char* buffer, size_t length) override;
+  void MarkCompleted() override;
+
+  // Number of bytes written to the file.
+  size_t bytes_written() const { return bytes_written_; }
+
+ private:
+  // Whether the response holds data for the requested range.
+  bool HasRangeData();
+
+  std::string filename_;
+  size_t offset_;
+  std::shared_ptr<TransferProgress> progress_;
+  std::string error_buffer_;
+  std::fstream file_;
+  size_t bytes_written_;
+};
+
 // Response for any operation that returns a blob of text that we need
 // to interpret as metadata.
 class ReturnedMetadataResponse : public BlockingResponse {
@@ -0,0 +1,277 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/parallel_download.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <string>
+
+#include "app/rest/util.h"
+#include "app/src/time.h"
+#include "storage/src/desktop/storage_desktop.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+static const char kRangeHeader[] = "Range";
+static const char kContentRangeHeader[] = "Content-Range";
+
+ParallelDownload::ParallelDownload(StorageReferenceInternal* reference,
+                                   const std::string& path,
+                                   ReferenceCountedFutureImpl* future_api,
+                                   SafeFutureHandle<size_t> handle,
+                                   Listener* listener)
+    : reference_(new StorageReferenceInternal(*reference)),
+      storage_(reference->storage_internal()),
+      path_(path),
+      final_future_api_(future_api),
+      final_handle_(handle),
+      listener_(listener),
+      controller_(new TransferController()),
+      progress_(new TransferProgress()),
+      size_(-1),
+      next_range_(0),
+      pending_count_(0),
+      listener_range_(-1),
+      failed_(false),
+      error_(kErrorNone),
+      end_time_ms_(0),
+      sleep_time_ms_(kInitialSleepTimeMillis) {
+  ResetRetryDeadline();
+}
+
+void ParallelDownload::Start(StorageReferenceInternal* reference,
+                             const std::string& path,
+                             ReferenceCountedFutureImpl* future_api,
+                             SafeFutureHandle<size_t> handle,
+                             Listener* listener, Controller* controller_out) {
+  // Create the file up front, since each range opens it to write at its own
+  // offset.  Writing in binary mode prevents Windows from converting
+  // characters such as "\n" to "\r\n".
+  {
+    std::fstream file(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!file.is_open()) {
+      future_api->Complete(handle, kErrorUnknown, "Could not open file.");
+      return;
+    }
+  }
+  std::shared_ptr<ParallelDownload> download(
+      new ParallelDownload(reference, path, future_api, handle, listener));
+  ControllerInternal::BindTransfer(controller_out,
+                                   download->reference_->AsStorageReference(),
+                                   download->controller_);
+  // The size of the object is not known until the first range completes.
+  download->ranges_.emplace_back(
+      0, download->storage_->download_range_size());
+  download->next_range_ = 1;
+  download->pending_count_ = 1;
+  download->storage_->PrefetchAppCheckToken(
+      [download]() { download->SendRange(0); });
+}
+
+bool ParallelDownload::ParseContentRangeSize(const char* content_range,
+                                             int64_t* size) {
+  if (!content_range) return false;
+  const char* size_string = strchr(content_range, '/');
+  if (!size_string || *(++size_string) == '\0') return false;
+  char* end;
+  long long parsed_size = strtoll(size_string, &end, 10);  // NOLINT
+  if (*end != '\0' || parsed_size < 0) return false;
+  *size = static_cast<int64_t>(parsed_size);
+  return true;
+}
+
+void ParallelDownload::SendRange(size_t index) {
+  Range& range = ranges_[index];
+  auto* future_api = reference_->future();
+  auto handle =
+      future_api->SafeAlloc<size_t>(kStorageReferenceFnDownloadRangeInternal);
+  size_t first_byte = range.offset + range.received;
+  std::string range_header = "bytes=" + std::to_string(first_byte) + "-" +
+                             std::to_string(range.offset + range.size - 1);
+  storage::internal::Request* request = new storage::internal::Request();
+  reference_->PrepareRequestBlocking(
+      request, reference_->storageUri_.AsHttpUrl().c_str(), rest::util::kGet);
+  request->add_header(kRangeHeader, range_header.c_str());
+  GetFileRangeResponse* response = new GetFileRangeResponse(
+      path_.c_str(), first_byte, progress_, handle, future_api);
+
+  // A listener can only be attached to one request at a time.
+  Listener* listener = nullptr;
+  if (listener_range_ < 0) {
+    listener_range_ = static_cast<int>(index);
+    listener = listener_;
+  }
+
+  // Read the response when the future completes, since the response is
+  // deleted afterwards, then continue on the scheduler rather than the
+  // transport thread.
+  std::shared_ptr<ParallelDownload> self = shared_from_this();
+  FutureBase future(future_api, handle.get());
+  future.OnCompletion([self, index, response](const FutureBase& completed) {
+    RangeResult result;
+    result.future = completed;
+    result.http_status = response->status();
+    result.bytes_written = response->bytes_written();
+    const char* content_range = response->GetHeader(kContentRangeHeader);
+    if (content_range) result.content_range = content_range;
+    self->storage_->ScheduleRequest(
+        [self, index, result]() { self->OnRangeComplete(index, result); });
+  });
+  reference_->RestCall(request, request->notifier(), response, handle.get(),
+                       listener, &range.controller, 0, -1, progress_);
+  controller_->SetRequest(static_cast<int>(index), range.controller);
+}
+
+void ParallelDownload::OnRangeComplete(size_t index,
+                                       const RangeResult& result) {
+  Range& range = ranges_[index];
+  pending_count_--;
+  controller_->RemoveRequest(static_cast<int>(index));
+  if (listener_range_ == static_cast<int>(index)) listener_range_ = -1;
+  range.received += result.bytes_written;
+  if (result.bytes_written) ResetRetryDeadline();
+
+  if (!failed_) {
+    if (result.future.error() != kErrorNone) {
+      RetryOrFail(index, result);
+    } else {
+      if (size_ < 0) AddRanges(result);
+      if (!failed_ && range.received < range.size) {
+        // The connection closed before the whole range was received.
+        RetryOrFail(index, result);
+      }
+      SendPendingRanges();
+    }
+  }
+  CompleteIfDone();
+}
+
+void ParallelDownload::AddRanges(const RangeResult& first_result) {
+  Range& first = ranges_[0];
+  if (first_result.http_status != rest::util::HttpPartialContent) {
+    // The response contained the whole object.
+    size_ = static_cast<int64_t>(first.received);
+    first.size = first.received;
+    progress_->set_total_byte_count(size_);
+    return;
+  }
+  int64_t size;
+  if (!ParseContentRangeSize(first_result.content_range.c_str(), &size)) {
+    Fail(kErrorUnknown, "Could not determine the size of the object.");
+    return;
+  }
+  size_ = size;
+  progress_->set_total_byte_count(size_);
+  size_t object_size = static_cast<size_t>(size_);
+  if (object_size < first.size) first.size = object_size;
+  if (object_size <= first.size) return;
+
+  // Extend the file to the size of the object so ranges can be written in
+  // any order.
+  {
+    std::fstream file(path_,
+                      std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(object_size - 1);
+    file.put('\0');
+    if (!file.good()) {
+      Fail(kErrorUnknown, "Could not write file.");
+      return;
+    }
+  }
+  size_t range_size = storage_->download_range_size();
+  for (size_t offset = first.size; offset < object_size; offset += range_size) {
+    ranges_.emplace_back(offset, object_size - offset < range_size
+                                     ? object_size - offset
+                                     : range_size);
+  }
+}
+
+void ParallelDownload::SendPendingRanges() {
+  while (!failed_ && next_range_ < ranges_.size() &&
+         pending_count_ < storage_->max_parallel_downloads()) {
+    pending_count_++;
+    SendRange(next_range_++);
+  }
+}
+
+void ParallelDownload::RetryOrFail(size_t index, const RangeResult& result) {
+  Error error = static_cast<Error>(result.future.error());
+  bool retryable =
+      error == kErrorNone ||
+      (result.future.status() == kFutureStatusComplete &&
+       error != kErrorCancelled &&
+       StorageReferenceInternal::IsRetryableFailure(result.http_status));
+  uint64_t delay = JitterRetryDelay(sleep_time_ms_);
+  if (!retryable ||
+      ::firebase::internal::GetTimestamp() + delay > end_time_ms_) {
+    if (error == kErrorNone) {
+      Fail(kErrorRetryLimitExceeded, "Download interrupted.");
+    } else {
+      Fail(error, result.future.error_message());
+    }
+    return;
+  }
+  sleep_time_ms_ = sleep_time_ms_ * 2;
+  if (sleep_time_ms_ > kMaxSleepTimeMillis) {
+    sleep_time_ms_ = kMaxSleepTimeMillis;
+  }
+  pending_count_++;
+  std::shared_ptr<ParallelDownload> self = shared_from_this();
+  storage_->ScheduleRequest(
+      [self, index]() {
+        if (self->failed_) {
+          self->pending_count_--;
+          self->CompleteIfDone();
+        } else {
+          self->SendRange(index);
+        }
+      },
+      delay);
+}
+
+void ParallelDownload::Fail(Error error, const char* error_message) {
+  if (failed_) return;
+  failed_ = true;
+  error_ = error;
+  error_message_ = error_message ? error_message : "";
+  for (Range& range : ranges_) range.controller.Cancel();
+}
+
+void ParallelDownload::CompleteIfDone() {
+  if (pending_count_ > 0) return;
+  controller_->Complete();
+  if (failed_) {
+    final_future_api_->Complete(final_handle_, error_,
+                                error_message_.c_str());
+  } else {
+    final_future_api_->CompleteWithResult(final_handle_, kErrorNone,
+                                          static_cast<size_t>(size_));
+  }
+}
+
+void ParallelDownload::ResetRetryDeadline() {
+  end_time_ms_ =
+      ::firebase::internal::GetTimestamp() +
+      static_cast<uint64_t>(storage_->max_download_retry_time() * 1000);
+  sleep_time_ms_ = kInitialSleepTimeMillis;
+}
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
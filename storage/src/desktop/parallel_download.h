@@ -0,0 +1,160 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_STORAGE_SRC_DESKTOP_PARALLEL_DOWNLOAD_H_
+#define FIREBASE_STORAGE_SRC_DESKTOP_PARALLEL_DOWNLOAD_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "app/src/include/firebase/future.h"
+#include "app/src/reference_counted_future_impl.h"
+#include "storage/src/desktop/controller_desktop.h"
+#include "storage/src/desktop/curl_requests.h"
+#include "storage/src/desktop/storage_reference_desktop.h"
+#include "storage/src/include/firebase/storage/common.h"
+#include "storage/src/include/firebase/storage/controller.h"
+#include "storage/src/include/firebase/storage/listener.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+class StorageInternal;
+
+// Downloads an object into a file as byte ranges fetched in parallel.
+//
+// The first range is requested without knowing the size of the object, and
+// its response reports the size.  If the object is larger than the first
+// range, the rest is split into ranges of download_range_size() bytes, with
+// up to max_parallel_downloads() ranges fetched at the same time.  Each range
+// is written at its offset in the file, and a range that fails in a retryable
+// way is requested again from the first byte that was not received, so only
+// missing data is fetched again.
+//
+// The caller's Listener is attached to one range at a time, but reports the
+// progress of the whole download.  The caller's Controller is bound to the
+// download before it starts and controls all ranges in flight.  Cancelling any
+// range cancels the download.
+class ParallelDownload : public std::enable_shared_from_this<ParallelDownload> {
+ public:
+  // Download the object of reference into the file at path.  The number of
+  // bytes downloaded, or the error, completes handle of future_api.
+  static void Start(StorageReferenceInternal* reference,
+                    const std::string& path,
+                    ReferenceCountedFutureImpl* future_api,
+                    SafeFutureHandle<size_t> handle, Listener* listener,
+                    Controller* controller_out);
+
+  // Parse the size of the object from the value of a Content-Range header,
+  // e.g "bytes 0-1023/4096".  Returns false if the size is not known.
+  static bool ParseContentRangeSize(const char* content_range, int64_t* size);
+
+ private:
+  // Byte range of the object.
+  struct Range {
+    Range(size_t range_offset, size_t range_size)
+        : offset(range_offset), size(range_size), received(0) {}
+
+    size_t offset;
+    size_t size;
+    // Number of bytes of the range written to the file.
+    size_t received;
+    // Controller of the request for the range.
+    Controller controller;
+  };
+
+  // The outcome of a range request, captured when its future completes since
+  // the response is deleted afterwards.
+  struct RangeResult {
+    RangeResult() : http_status(0), bytes_written(0) {}
+
+    FutureBase future;
+    int http_status;
+    size_t bytes_written;
+    // Value of the Content-Range header.
+    std::string content_range;
+  };
+
+  ParallelDownload(StorageReferenceInternal* reference, const std::string& path,
+                   ReferenceCountedFutureImpl* future_api,
+                   SafeFutureHandle<size_t> handle, Listener* listener);
+
+  // Request the data of the range at index that has not been received yet.
+  void SendRange(size_t index);
+  void OnRangeComplete(size_t index, const RangeResult& result);
+
+  // Split the object after the first range once its size is known.
+  void AddRanges(const RangeResult& first_result);
+
+  // Start ranges until the maximum number of parallel requests is reached.
+  void SendPendingRanges();
+
+  // Retry the range at index after a failure, or fail the download if the
+  // failure is not retryable or the retry deadline has passed.
+  void RetryOrFail(size_t index, const RangeResult& result);
+
+  // Stop the download, cancelling the requests of all ranges.
+  void Fail(Error error, const char* error_message);
+
+  // Complete the download once no range is pending.
+  void CompleteIfDone();
+
+  // Reset the retry deadline and delay after the download made progress.
+  void ResetRetryDeadline();
+
+  // Private copy of the reference being downloaded.
+  std::unique_ptr<StorageReferenceInternal> reference_;
+  StorageInternal* storage_;
+  std::string path_;
+
+  ReferenceCountedFutureImpl* final_future_api_;
+  SafeFutureHandle<size_t> final_handle_;
+  Listener* listener_;
+  // Controls the ranges in flight on behalf of the caller's Controller.
+  std::shared_ptr<TransferController> controller_;
+
+  // Progress of the download reported by the requests of all ranges.
+  std::shared_ptr<TransferProgress> progress_;
+  // Size of the object, or -1 until the first range completes.
+  int64_t size_;
+  // A deque is used since ranges are referenced while new ranges are added.
+  std::deque<Range> ranges_;
+  // Index of the next range to request.
+  size_t next_range_;
+  // Number of ranges being requested or waiting to be retried.
+  int pending_count_;
+  // Index of the range whose request the listener is attached to, or -1.
+  int listener_range_;
+
+  // Set once the download has failed.
+  bool failed_;
+  Error error_;
+  std::string error_message_;
+
+  // Time after which failed requests are no longer retried.  Reset whenever
+  // data is received.
+  uint64_t end_time_ms_;
+  // Delay before the next retry, before jitter is applied.
+  uint64_t sleep_time_ms_;
+};
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
+
+#endif  // FIREBASE_STORAGE_SRC_DESKTOP_PARALLEL_DOWNLOAD_H_
@@ -33,14 +33,19 @@ RestOperation::RestOperation(StorageInternal* storage_internal,
                              const StorageReference& storage_reference,
                              rest::Request* request, Notifier* request_notifier,
                              BlockingResponse* response, Listener* listener,
-                             FutureHandle handle, Controller* controller_out)
+                             FutureHandle handle, Controller* controller_out,
+                             int64_t transfer_offset, int64_t transfer_size,
+                             std::shared_ptr<TransferProgress> shared_progress)
     : storage_internal_(storage_internal),
       request_(request),
       request_notifier_(request_notifier),
       response_(response),
       listener_(nullptr),
       handle_(handle),
-      is_complete_(false) {
+      is_complete_(false),
+      transfer_offset_(transfer_offset),
+      transfer_size_(transfer_size),
+      shared_progress_(shared_progress) {
   // Notify this operation when the response reports progress and clean up if
   // the response completes.
   response_->set_update_callback(
@@ -125,12 +130,17 @@ bool RestOperation::is_paused() const {
 
 int64_t RestOperation::bytes_transferred() const {
   MutexLock lock(mutex_);
-  return rest_controller_->BytesTransferred();
+  if (shared_progress_) return shared_progress_->bytes_transferred();
+  return transfer_offset_ + rest_controller_->BytesTransferred();
 }
 
 int64_t RestOperation::total_byte_count() const {
   MutexLock lock(mutex_);
-  return rest_controller_->TransferSize();
+  if (shared_progress_ && shared_progress_->total_byte_count() >= 0) {
+    return shared_progress_->total_byte_count();
+  }
+  return transfer_size_ >= 0 ? transfer_size_
+                             : rest_controller_->TransferSize();
 }
 
 // Whether this operation is complete and can be deleted.
@@ -37,6 +37,7 @@ namespace internal {
 
 class BlockingResponse;
 class Notifier;
+class TransferProgress;
 
 // Structure containing the data we need to keep track of, (and later clean up)
 // when we spin up a new async request.
@@ -47,7 +48,9 @@ class RestOperation {
                 const StorageReference& storage_reference,
                 rest::Request* request, Notifier* request_notifier,
                 BlockingResponse* response, Listener* listener,
-                FutureHandle handle, Controller* controller_out);
+                FutureHandle handle, Controller* controller_out,
+                int64_t transfer_offset, int64_t transfer_size,
+                std::shared_ptr<TransferProgress> shared_progress);
 
  public:
   ~RestOperation();
@@ -86,14 +89,22 @@ class RestOperation {
   // object created by this method through its cleanup notifier.
   // If provided, controller_out is populated with the controller used to manage
   // the rest call.
-  static void Start(StorageInternal* storage_internal,
-                    const StorageReference& storage_reference,
-                    rest::Request* request, Notifier* request_notifier,
-                    BlockingResponse* response, Listener* listener,
-                    FutureHandle handle, Controller* controller_out) {
+  // If the request is part of a larger transfer, transfer_offset is the number
+  // of bytes transferred before it and transfer_size is the size of the whole
+  // transfer, so progress is reported for the whole transfer.  If the
+  // transfer is split across concurrent requests, shared_progress tracks the
+  // progress of all of them and overrides transfer_offset and transfer_size.
+  static void Start(
+      StorageInternal* storage_internal,
+      const StorageReference& storage_reference, rest::Request* request,
+      Notifier* request_notifier, BlockingResponse* response,
+      Listener* listener, FutureHandle handle, Controller* controller_out,
+      int64_t transfer_offset = 0, int64_t transfer_size = -1,
+      std::shared_ptr<TransferProgress> shared_progress = nullptr) {
     RestOperation* operation = new RestOperation(
         storage_internal, storage_reference, request, request_notifier,
-        response, listener, handle, controller_out);
+        response, listener, handle, controller_out, transfer_offset,
+        transfer_size, shared_progress);
     (void)operation;  // After creation the operation is owned by
                       // storage_internal.
   }
@@ -113,6 +124,12 @@ class RestOperation {
   // Storage controller that delegates to this object.
   storage::Controller controller_;
   bool is_complete_;
+  // Bytes transferred before this request and size of the whole transfer, or
+  // -1 if the transfer is this request only.
+  int64_t transfer_offset_;
+  int64_t transfer_size_;
+  // Progress of a transfer split across several requests, or null.
+  std::shared_ptr<TransferProgress> shared_progress_;
 };
 
 }  // namespace internal
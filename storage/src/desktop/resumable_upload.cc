@@ -0,0 +1,368 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/resumable_upload.h"
+
+#include <stdlib.h>
+
+#include <string>
+
+#include "app/rest/util.h"
+#include "app/src/include/firebase/variant.h"
+#include "app/src/time.h"
+#include "app/src/variant_util.h"
+#include "storage/src/desktop/curl_requests.h"
+#include "storage/src/desktop/storage_desktop.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+// Headers of the resumable upload protocol.
+static const char kUploadProtocolHeader[] = "X-Goog-Upload-Protocol";
+static const char kUploadCommandHeader[] = "X-Goog-Upload-Command";
+static const char kUploadOffsetHeader[] = "X-Goog-Upload-Offset";
+static const char kUploadUrlHeader[] = "X-Goog-Upload-URL";
+static const char kUploadStatusHeader[] = "X-Goog-Upload-Status";
+static const char kUploadSizeReceivedHeader[] = "X-Goog-Upload-Size-Received";
+static const char kUploadContentLengthHeader[] =
+    "X-Goog-Upload-Header-Content-Length";
+static const char kUploadContentTypeHeader[] =
+    "X-Goog-Upload-Header-Content-Type";
+
+// Value of the status header once the object has been stored.
+static const char kUploadStatusFinal[] = "final";
+
+ResumableUpload::ResumableUpload(
+    StorageReferenceInternal* reference, const char* buffer,
+    const std::string& path, size_t size, const std::string& content_type,
+    ReferenceCountedFutureImpl* future_api, SafeFutureHandle<Metadata> handle,
+    Listener* listener)
+    : reference_(new StorageReferenceInternal(*reference)),
+      storage_(reference->storage_internal()),
+      buffer_(buffer),
+      path_(path),
+      size_(size),
+      content_type_(content_type),
+      chunk_size_(storage_->upload_chunk_size()),
+      final_future_api_(future_api),
+      final_handle_(handle),
+      listener_(listener),
+      controller_(new TransferController()),
+      offset_(0),
+      prepared_request_(nullptr),
+      prepared_notifier_(nullptr),
+      prepared_offset_(0),
+      end_time_ms_(0),
+      sleep_time_ms_(kInitialSleepTimeMillis) {
+  ResetRetryDeadline();
+}
+
+ResumableUpload::~ResumableUpload() { delete prepared_request_; }
+
+void ResumableUpload::StartWithBuffer(StorageReferenceInternal* reference,
+                                      const void* buffer, size_t size,
+                                      const std::string& content_type,
+                                      ReferenceCountedFutureImpl* future_api,
+                                      SafeFutureHandle<Metadata> handle,
+                                      Listener* listener,
+                                      Controller* controller_out) {
+  std::shared_ptr<ResumableUpload> upload(new ResumableUpload(
+      reference, static_cast<const char*>(buffer), std::string(), size,
+      content_type, future_api, handle, listener));
+  Start(upload, controller_out);
+}
+
+void ResumableUpload::StartWithFile(StorageReferenceInternal* reference,
+                                    const std::string& path, size_t size,
+                                    const std::string& content_type,
+                                    ReferenceCountedFutureImpl* future_api,
+                                    SafeFutureHandle<Metadata> handle,
+                                    Listener* listener,
+                                    Controller* controller_out) {
+  std::shared_ptr<ResumableUpload> upload(
+      new ResumableUpload(reference, nullptr, path, size, content_type,
+                          future_api, handle, listener));
+  Start(upload, controller_out);
+}
+
+void ResumableUpload::Start(std::shared_ptr<ResumableUpload> upload,
+                            Controller* controller_out) {
+  ControllerInternal::BindTransfer(controller_out,
+                                   upload->reference_->AsStorageReference(),
+                                   upload->controller_);
+  upload->storage_->PrefetchAppCheckToken(
+      [upload]() { upload->StartSession(); });
+}
+
+void ResumableUpload::StartSession() {
+  auto* future_api = reference_->future();
+  auto handle =
+      future_api->SafeAlloc<void>(kStorageReferenceFnUploadSessionInternal);
+  storage::internal::Request* request = new storage::internal::Request();
+  reference_->PrepareRequestBlocking(
+      request, reference_->storageUri_.AsHttpUploadUrl().c_str(),
+      rest::util::kPost, "application/json");
+  request->add_header(kUploadProtocolHeader, "resumable");
+  request->add_header(kUploadCommandHeader, "start");
+  request->add_header(kUploadContentLengthHeader,
+                      std::to_string(size_).c_str());
+  Variant object_metadata = Variant::EmptyMap();
+  object_metadata.map()["name"] = reference_->storageUri_.GetPath().str();
+  if (!content_type_.empty()) {
+    request->add_header(kUploadContentTypeHeader, content_type_.c_str());
+    object_metadata.map()["contentType"] = content_type_;
+  }
+  std::string metadata_json = util::VariantToJson(object_metadata);
+  request->set_post_fields(metadata_json.c_str(), metadata_json.length());
+
+  UploadSessionResponse* response =
+      new UploadSessionResponse(handle, future_api);
+  Send(request, request->notifier(), response, handle.get(),
+       &ResumableUpload::OnSessionStarted, nullptr);
+}
+
+void ResumableUpload::OnSessionStarted(const StepResult& result) {
+  if (result.future.error() != kErrorNone) {
+    RetryOrFail(result);
+    return;
+  }
+  if (result.upload_url.empty()) {
+    Fail(kErrorUnknown, "Upload session URL missing from response.");
+    return;
+  }
+  upload_url_ = result.upload_url;
+  ResetRetryDeadline();
+  SendChunk();
+}
+
+rest::Request* ResumableUpload::CreateChunkRequest(size_t offset,
+                                                   Notifier** notifier) {
+  size_t end = chunk_end(offset);
+  rest::Request* request;
+  if (buffer_) {
+    storage::internal::RequestBinary* binary_request =
+        new storage::internal::RequestBinary(buffer_ + offset, end - offset);
+    *notifier = binary_request->notifier();
+    request = binary_request;
+  } else {
+    // Stream the chunk from the file rather than reading it into memory.
+    storage::internal::RequestFileRange* file_request =
+        new storage::internal::RequestFileRange(path_.c_str(), offset,
+                                                end - offset);
+    if (!file_request->IsFileOpen()) {
+      delete file_request;
+      return nullptr;
+    }
+    *notifier = file_request->notifier();
+    request = file_request;
+  }
+  reference_->PrepareRequestBlocking(request, upload_url_.c_str(),
+                                     rest::util::kPost);
+  request->add_header(kUploadCommandHeader,
+                      end == size_ ? "upload, finalize" : "upload");
+  request->add_header(kUploadOffsetHeader, std::to_string(offset).c_str());
+  return request;
+}
+
+void ResumableUpload::SendChunk() {
+  rest::Request* request = prepared_request_;
+  Notifier* notifier = prepared_notifier_;
+  prepared_request_ = nullptr;
+  prepared_notifier_ = nullptr;
+  if (request && prepared_offset_ != offset_) {
+    // The upload was resumed from a different offset.
+    delete request;
+    request = nullptr;
+  }
+  if (!request) request = CreateChunkRequest(offset_, &notifier);
+  if (!request) {
+    Fail(kErrorUnknown, "Could not read file.");
+    return;
+  }
+
+  auto* future_api = reference_->future();
+  if (chunk_end(offset_) == size_) {
+    // The last chunk returns the metadata of the object.
+    auto handle = future_api->SafeAlloc<Metadata>(
+        kStorageReferenceFnUploadSessionInternal);
+    ReturnedMetadataResponse* response = new ReturnedMetadataResponse(
+        handle, future_api, reference_->AsStorageReference());
+    Send(request, notifier, response, handle.get(),
+         &ResumableUpload::OnChunkSent, listener_);
+  } else {
+    auto handle =
+        future_api->SafeAlloc<void>(kStorageReferenceFnUploadSessionInternal);
+    UploadSessionResponse* response =
+        new UploadSessionResponse(handle, future_api);
+    Send(request, notifier, response, handle.get(),
+         &ResumableUpload::OnChunkSent, listener_);
+    PrepareNextChunk();
+  }
+}
+
+void ResumableUpload::PrepareNextChunk() {
+  // Prepare the request on the scheduler while the current chunk is sent.
+  std::shared_ptr<ResumableUpload> self = shared_from_this();
+  size_t next_offset = chunk_end(offset_);
+  storage_->ScheduleRequest([self, next_offset]() {
+    if (self->offset_ >= next_offset || self->prepared_request_) return;
+    self->prepared_request_ =
+        self->CreateChunkRequest(next_offset, &self->prepared_notifier_);
+    self->prepared_offset_ = next_offset;
+  });
+}
+
+void ResumableUpload::OnChunkSent(const StepResult& result) {
+  if (result.future.error() != kErrorNone) {
+    RetryOrFail(result);
+    return;
+  }
+  if (chunk_end(offset_) == size_) {
+    CompleteWithMetadata(result.future);
+    return;
+  }
+  offset_ = chunk_end(offset_);
+  ResetRetryDeadline();
+  SendChunk();
+}
+
+void ResumableUpload::QueryStatus() {
+  auto* future_api = reference_->future();
+  auto handle =
+      future_api->SafeAlloc<void>(kStorageReferenceFnUploadSessionInternal);
+  // The query has no body.  An empty binary request sends it with a zero
+  // Content-Length, rather than as a chunked body read from no buffer.
+  storage::internal::RequestBinary* request =
+      new storage::internal::RequestBinary("", 0);
+  reference_->PrepareRequestBlocking(request, upload_url_.c_str(),
+                                     rest::util::kPost);
+  request->add_header(kUploadCommandHeader, "query");
+  UploadSessionResponse* response =
+      new UploadSessionResponse(handle, future_api);
+  Send(request, request->notifier(), response, handle.get(),
+       &ResumableUpload::OnStatusQueried, nullptr);
+}
+
+void ResumableUpload::OnStatusQueried(const StepResult& result) {
+  if (result.future.error() != kErrorNone) {
+    RetryOrFail(result);
+    return;
+  }
+  if (result.upload_status == kUploadStatusFinal) {
+    // The last chunk was stored but its response was lost, so fetch the
+    // metadata it would have returned.
+    std::shared_ptr<ResumableUpload> self = shared_from_this();
+    reference_->GetMetadata().OnCompletion(
+        [self](const FutureBase& metadata_result) {
+          self->CompleteWithMetadata(metadata_result);
+        });
+    return;
+  }
+  if (result.size_received < 0 ||
+      static_cast<uint64_t>(result.size_received) > size_) {
+    Fail(kErrorUnknown, "Invalid upload status.");
+    return;
+  }
+  size_t size_received = static_cast<size_t>(result.size_received);
+  if (size_received > offset_) ResetRetryDeadline();
+  offset_ = size_received;
+  SendChunk();
+}
+
+void ResumableUpload::RetryOrFail(const StepResult& result) {
+  uint64_t delay = JitterRetryDelay(sleep_time_ms_);
+  if (result.future.status() != kFutureStatusComplete ||
+      result.future.error() == kErrorCancelled ||
+      !StorageReferenceInternal::IsRetryableFailure(result.http_status) ||
+      ::firebase::internal::GetTimestamp() + delay > end_time_ms_) {
+    Fail(result.future);
+    return;
+  }
+  sleep_time_ms_ = sleep_time_ms_ * 2;
+  if (sleep_time_ms_ > kMaxSleepTimeMillis) {
+    sleep_time_ms_ = kMaxSleepTimeMillis;
+  }
+  std::shared_ptr<ResumableUpload> self = shared_from_this();
+  storage_->ScheduleRequest(
+      [self]() {
+        if (self->upload_url_.empty()) {
+          self->StartSession();
+        } else {
+          self->QueryStatus();
+        }
+      },
+      delay);
+}
+
+void ResumableUpload::Send(rest::Request* request, Notifier* notifier,
+                           BlockingResponse* response, FutureHandle handle,
+                           StepCallback on_complete, Listener* listener) {
+  // Read the response when the future completes, since the response is
+  // deleted afterwards, then continue on the scheduler rather than the
+  // transport thread.
+  std::shared_ptr<ResumableUpload> self = shared_from_this();
+  FutureBase future(reference_->future(), handle);
+  future.OnCompletion(
+      [self, response, on_complete](const FutureBase& completed) {
+        StepResult result;
+        result.future = completed;
+        result.http_status = response->status();
+        const char* header = response->GetHeader(kUploadUrlHeader);
+        if (header) result.upload_url = header;
+        header = response->GetHeader(kUploadStatusHeader);
+        if (header) result.upload_status = header;
+        header = response->GetHeader(kUploadSizeReceivedHeader);
+        if (header) result.size_received = strtoll(header, nullptr, 10);
+        self->storage_->ScheduleRequest(
+            [self, result, on_complete]() { ((*self).*on_complete)(result); });
+      });
+  Controller request_controller;
+  reference_->RestCall(request, notifier, response, handle, listener,
+                       &request_controller, offset_, size_);
+  // Only one request of the upload is in flight at a time.
+  controller_->SetRequest(0, request_controller);
+}
+
+void ResumableUpload::ResetRetryDeadline() {
+  end_time_ms_ =
+      ::firebase::internal::GetTimestamp() +
+      static_cast<uint64_t>(storage_->max_upload_retry_time() * 1000);
+  sleep_time_ms_ = kInitialSleepTimeMillis;
+}
+
+void ResumableUpload::CompleteWithMetadata(const FutureBase& result) {
+  const Future<Metadata>& typed_result =
+      static_cast<const Future<Metadata>&>(result);
+  if (typed_result.result() != nullptr) {
+    controller_->Complete();
+    final_future_api_->CompleteWithResult(final_handle_, result.error(),
+                                          *typed_result.result());
+  } else {
+    Fail(result);
+  }
+}
+
+void ResumableUpload::Fail(const FutureBase& result) {
+  Fail(static_cast<Error>(result.error()), result.error_message());
+}
+
+void ResumableUpload::Fail(Error error, const char* error_message) {
+  controller_->Complete();
+  final_future_api_->Complete(final_handle_, error, error_message);
+}
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
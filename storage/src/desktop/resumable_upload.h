@@ -0,0 +1,186 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_STORAGE_SRC_DESKTOP_RESUMABLE_UPLOAD_H_
+#define FIREBASE_STORAGE_SRC_DESKTOP_RESUMABLE_UPLOAD_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "app/rest/request.h"
+#include "app/src/include/firebase/future.h"
+#include "app/src/reference_counted_future_impl.h"
+#include "storage/src/desktop/controller_desktop.h"
+#include "storage/src/desktop/storage_reference_desktop.h"
+#include "storage/src/include/firebase/storage/common.h"
+#include "storage/src/include/firebase/storage/controller.h"
+#include "storage/src/include/firebase/storage/listener.h"
+#include "storage/src/include/firebase/storage/metadata.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+class BlockingResponse;
+class Notifier;
+class StorageInternal;
+
+// Uploads an object with the resumable upload protocol.  The upload starts a
+// session, then sends the object in fixed size chunks.  When a request fails
+// in a retryable way, the session is queried for the number of bytes the
+// server has committed and the upload continues from there, so an interrupted
+// upload does not send the object again from the start.
+//
+// The caller's Controller is bound to the upload before it starts, and
+// controls whichever request of the upload is in flight.  The first request is
+// sent from the calling thread if the App Check token is cached.  All other
+// steps run on the storage scheduler, and the request for the next chunk is
+// prepared there while the current chunk is sent.  The upload is owned by the
+// callbacks of its pending steps and is deleted once it completes.
+class ResumableUpload : public std::enable_shared_from_this<ResumableUpload> {
+ public:
+  ~ResumableUpload();
+
+  // Upload size bytes from buffer, which must remain valid until the upload
+  // completes.  The uploaded object's metadata, or the error, completes
+  // handle of future_api.
+  static void StartWithBuffer(StorageReferenceInternal* reference,
+                              const void* buffer, size_t size,
+                              const std::string& content_type,
+                              ReferenceCountedFutureImpl* future_api,
+                              SafeFutureHandle<Metadata> handle,
+                              Listener* listener, Controller* controller_out);
+
+  // Upload the first size bytes of the file at path.
+  static void StartWithFile(StorageReferenceInternal* reference,
+                            const std::string& path, size_t size,
+                            const std::string& content_type,
+                            ReferenceCountedFutureImpl* future_api,
+                            SafeFutureHandle<Metadata> handle,
+                            Listener* listener, Controller* controller_out);
+
+ private:
+  // The outcome of a request, captured when its future completes since the
+  // response is deleted afterwards.
+  struct StepResult {
+    StepResult() : http_status(0), size_received(-1) {}
+
+    // The completed future of the request.
+    FutureBase future;
+    int http_status;
+    // Value of the X-Goog-Upload-URL header.
+    std::string upload_url;
+    // Value of the X-Goog-Upload-Status header.
+    std::string upload_status;
+    // Value of the X-Goog-Upload-Size-Received header, or -1.
+    int64_t size_received;
+  };
+
+  typedef void (ResumableUpload::*StepCallback)(const StepResult& result);
+
+  ResumableUpload(StorageReferenceInternal* reference, const char* buffer,
+                  const std::string& path, size_t size,
+                  const std::string& content_type,
+                  ReferenceCountedFutureImpl* future_api,
+                  SafeFutureHandle<Metadata> handle, Listener* listener);
+
+  // Bind the caller's controller_out to the upload and start it.
+  static void Start(std::shared_ptr<ResumableUpload> upload,
+                    Controller* controller_out);
+
+  // Send the request that starts the upload session.
+  void StartSession();
+  void OnSessionStarted(const StepResult& result);
+
+  // Send the chunk starting at offset_.
+  void SendChunk();
+  void OnChunkSent(const StepResult& result);
+
+  // Create the request for the chunk starting at offset, storing its notifier
+  // in notifier.
+  rest::Request* CreateChunkRequest(size_t offset, Notifier** notifier);
+
+  // Prepare the request for the chunk after the one being sent.
+  void PrepareNextChunk();
+
+  // Ask the server how much of the object it has committed.
+  void QueryStatus();
+  void OnStatusQueried(const StepResult& result);
+
+  // Retry after a failed request by querying the status of the session, or
+  // starting it if it does not exist yet.  Completes the upload if the
+  // failure is not retryable or the retry deadline has passed.
+  void RetryOrFail(const StepResult& result);
+
+  // Send a request of the session and call on_complete from the scheduler
+  // once handle, the future of response, completes.
+  void Send(rest::Request* request, Notifier* notifier,
+            BlockingResponse* response, FutureHandle handle,
+            StepCallback on_complete, Listener* listener);
+
+  // Reset the retry deadline and delay after the upload made progress.
+  void ResetRetryDeadline();
+
+  // Complete the upload with the metadata returned by the final request.
+  void CompleteWithMetadata(const FutureBase& result);
+
+  // Complete the upload with the error of a failed request.
+  void Fail(const FutureBase& result);
+  void Fail(Error error, const char* error_message);
+
+  size_t chunk_end(size_t offset) const {
+    return offset + chunk_size_ < size_ ? offset + chunk_size_ : size_;
+  }
+
+  // Private copy of the reference being uploaded to, so the upload does not
+  // depend on the lifetime of the caller's reference.
+  std::unique_ptr<StorageReferenceInternal> reference_;
+  StorageInternal* storage_;
+  // Data to upload: either buffer_ or the file at path_.
+  const char* buffer_;
+  std::string path_;
+  size_t size_;
+  std::string content_type_;
+  size_t chunk_size_;
+
+  ReferenceCountedFutureImpl* final_future_api_;
+  SafeFutureHandle<Metadata> final_handle_;
+  Listener* listener_;
+  // Controls the request in flight on behalf of the caller's Controller.
+  std::shared_ptr<TransferController> controller_;
+
+  // Session URL returned when the session started, empty until then.
+  std::string upload_url_;
+  // Number of bytes committed by the server.
+  size_t offset_;
+
+  // Request for the chunk starting at prepared_offset_, or nullptr.
+  rest::Request* prepared_request_;
+  Notifier* prepared_notifier_;
+  size_t prepared_offset_;
+
+  // Time after which failed requests are no longer retried.  Reset whenever
+  // a chunk is committed.
+  uint64_t end_time_ms_;
+  // Delay before the next retry, before jitter is applied.
+  uint64_t sleep_time_ms_;
+};
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
+
+#endif  // FIREBASE_STORAGE_SRC_DESKTOP_RESUMABLE_UPLOAD_H_
@@ -23,6 +23,7 @@
 #include "app/src/app_common.h"
 #include "app/src/function_registry.h"
 #include "app/src/include/firebase/app.h"
+#include "app/src/time.h"
 #include "storage/src/desktop/rest_operation.h"
 #include "storage/src/desktop/storage_reference_desktop.h"
 
@@ -30,6 +31,20 @@ namespace firebase {
 namespace storage {
 namespace internal {
 
+// Resumable upload chunks must be a multiple of this size, except the last.
+static const size_t kUploadChunkGranularity = 256 * 1024;
+static const size_t kDefaultUploadChunkSize = 32 * kUploadChunkGranularity;
+// Downloads are split into ranges of this size when fetched in parallel.
+static const size_t kDefaultDownloadRangeSize = 8 * 1024 * 1024;
+// Parallel downloads are opt-in, so downloads use a single request by default.
+static const int kDefaultMaxParallelDownloads = 1;
+
+// The timeout time to wait for the App Check token.
+static const int kAppCheckTokenTimeoutMs = 10000;
+// App Check reports new tokens to its listeners, but cached tokens are also
+// refetched after this long in case a change was missed.
+static const uint64_t kMaxAppCheckTokenAgeMs = 5 * 60 * 1000;
+
 StorageInternal::StorageInternal(App* app, const char* url) {
   app_ = app;
 
@@ -45,6 +60,12 @@ StorageInternal::StorageInternal(App* app, const char* url) {
   max_download_retry_time_ = 600.0;
   max_operation_retry_time_ = 120.0;
   max_upload_retry_time_ = 600.0;
+  upload_chunk_size_ = kDefaultUploadChunkSize;
+  download_range_size_ = kDefaultDownloadRangeSize;
+  max_parallel_downloads_ = kDefaultMaxParallelDownloads;
+  app_check_listener_added_ = false;
+  app_check_token_cached_ = false;
+  app_check_token_time_ms_ = 0;
   // LINT.ThenChange(//depot/google3/java/com/google/android/gmscore/integ/\
   //            client/firebase-storage-api/src/com/google/firebase/\
   //            storage/FirebaseStorage.java,
@@ -66,6 +87,22 @@ StorageInternal::StorageInternal(App* app, const char* url) {
 }
 
 StorageInternal::~StorageInternal() {
+  {
+    MutexLock lock(app_check_mutex_);
+    if (app_check_listener_added_) {
+      app_->function_registry()->CallFunction(
+          ::firebase::internal::FnAppCheckRemoveListener, app_,
+          reinterpret_cast<void*>(OnAppCheckTokenChanged), this);
+    }
+    // Replace the completion callback of a fetch in progress, which refers to
+    // this object.
+    if (app_check_fetch_.status() == kFutureStatusPending) {
+      app_check_fetch_.OnCompletion([](const Future<std::string>&) {});
+    }
+    app_check_waiters_.clear();
+  }
+  // Stop retrying requests before tearing down the objects they use.
+  scheduler_.CancelAllAndShutdownWorkerThread();
   cleanup().CleanupAll();
   firebase::rest::CleanupTransportCurl();
   firebase::rest::util::Terminate();
@@ -93,6 +130,21 @@ StorageReferenceInternal* StorageInternal::GetReferenceFromUrl(
   return new StorageReferenceInternal(url, const_cast<StorageInternal*>(this));
 }
 
+void StorageInternal::set_upload_chunk_size(size_t upload_chunk_size) {
+  size_t chunks = (upload_chunk_size + kUploadChunkGranularity - 1) /
+                  kUploadChunkGranularity;
+  upload_chunk_size_ = (chunks ? chunks : 1) * kUploadChunkGranularity;
+}
+
+void StorageInternal::set_download_range_size(size_t download_range_size) {
+  download_range_size_ = download_range_size ? download_range_size : 1;
+}
+
+void StorageInternal::set_max_parallel_downloads(int max_parallel_downloads) {
+  max_parallel_downloads_ =
+      max_parallel_downloads > 0 ? max_parallel_downloads : 1;
+}
+
 // Returns the auth token for the current user, if there is a current user,
 // and they have a token, and auth exists as part of the app.
 // Otherwise, returns an empty string.
@@ -103,6 +155,99 @@ std::string StorageInternal::GetAuthToken() {
   return result;
 }
 
+std::string StorageInternal::GetAppCheckToken() {
+  Future<std::string> fetch;
+  {
+    MutexLock lock(app_check_mutex_);
+    AddAppCheckListener();
+    if (IsAppCheckTokenCached()) return app_check_token_;
+    // Wait for the fetch in progress, if any.
+    fetch = app_check_fetch_;
+  }
+  if (fetch.status() == kFutureStatusInvalid) {
+    bool succeeded = app_->function_registry()->CallFunction(
+        ::firebase::internal::FnAppCheckGetTokenAsync, app_, nullptr, &fetch);
+    if (!succeeded || fetch.status() == kFutureStatusInvalid) {
+      return std::string();
+    }
+  }
+  const std::string* token = fetch.Await(kAppCheckTokenTimeoutMs);
+  if (!token) return std::string();
+  CacheAppCheckToken(*token);
+  return *token;
+}
+
+void StorageInternal::PrefetchAppCheckToken(std::function<void()> on_ready) {
+  Future<std::string> fetch;
+  {
+    MutexLock lock(app_check_mutex_);
+    AddAppCheckListener();
+    if (!IsAppCheckTokenCached()) {
+      app_check_waiters_.push_back(on_ready);
+      if (app_check_fetch_.status() != kFutureStatusInvalid) return;
+      bool succeeded = app_->function_registry()->CallFunction(
+          ::firebase::internal::FnAppCheckGetTokenAsync, app_, nullptr,
+          &app_check_fetch_);
+      if (succeeded && app_check_fetch_.status() != kFutureStatusInvalid) {
+        fetch = app_check_fetch_;
+      } else {
+        // App Check is not used, so there is nothing to wait for.
+        app_check_fetch_ = Future<std::string>();
+        app_check_waiters_.clear();
+      }
+    }
+  }
+  if (fetch.status() == kFutureStatusInvalid) {
+    on_ready();
+    return;
+  }
+  fetch.OnCompletion([this](const Future<std::string>& result) {
+    if (result.result()) CacheAppCheckToken(*result.result());
+    std::vector<std::function<void()>> waiters;
+    {
+      MutexLock lock(app_check_mutex_);
+      app_check_fetch_ = Future<std::string>();
+      waiters.swap(app_check_waiters_);
+    }
+    // Continue on the scheduler rather than the App Check thread.
+    for (auto& waiter : waiters) scheduler_.Schedule(waiter);
+  });
+}
+
+void StorageInternal::ScheduleRequest(std::function<void()> send_request,
+                                      uint64_t delay_ms) {
+  scheduler_.Schedule(
+      [this, send_request]() { PrefetchAppCheckToken(send_request); },
+      delay_ms);
+}
+
+void StorageInternal::AddAppCheckListener() {
+  if (app_check_listener_added_) return;
+  app_check_listener_added_ = app_->function_registry()->CallFunction(
+      ::firebase::internal::FnAppCheckAddListener, app_,
+      reinterpret_cast<void*>(OnAppCheckTokenChanged), this);
+}
+
+bool StorageInternal::IsAppCheckTokenCached() {
+  return app_check_token_cached_ &&
+         ::firebase::internal::GetTimestamp() - app_check_token_time_ms_ <
+             kMaxAppCheckTokenAgeMs;
+}
+
+void StorageInternal::CacheAppCheckToken(const std::string& token) {
+  MutexLock lock(app_check_mutex_);
+  // Without the listener there is no way to know when the token changes.
+  if (!app_check_listener_added_) return;
+  app_check_token_ = token;
+  app_check_token_cached_ = true;
+  app_check_token_time_ms_ = ::firebase::internal::GetTimestamp();
+}
+
+void StorageInternal::OnAppCheckTokenChanged(const std::string& token,
+                                             void* context) {
+  static_cast<StorageInternal*>(context)->CacheAppCheckToken(token);
+}
+
 // Add an operation to the list of outstanding operations.
 void StorageInternal::AddOperation(RestOperation* operation) {
   MutexLock lock(operations_mutex_);
@@ -15,11 +15,16 @@
 #ifndef FIREBASE_STORAGE_SRC_DESKTOP_STORAGE_DESKTOP_H_
 #define FIREBASE_STORAGE_SRC_DESKTOP_STORAGE_DESKTOP_H_
 
+#include <stdint.h>
+
+#include <functional>
 #include <string>
 #include <vector>
 
 #include "app/src/future_manager.h"
+#include "app/src/include/firebase/future.h"
 #include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/scheduler.h"
 #include "storage/src/desktop/storage_path.h"
 #include "storage/src/desktop/storage_reference_desktop.h"
 #include "storage/src/include/firebase/storage/common.h"
@@ -79,6 +84,25 @@ class StorageInternal {
     max_operation_retry_time_ = max_operation_retry_time;
   }
 
+  // Returns the size in bytes of the chunks of resumable uploads.  Larger
+  // uploads are sent in chunks of this size, smaller ones in one request.
+  size_t upload_chunk_size() { return upload_chunk_size_; }
+
+  // Sets the size of the chunks of resumable uploads.  The size is rounded up
+  // to a multiple of 256 KiB, as required by the upload protocol.
+  void set_upload_chunk_size(size_t upload_chunk_size);
+
+  // Returns the size in bytes of the ranges downloads are split into.
+  size_t download_range_size() { return download_range_size_; }
+
+  void set_download_range_size(size_t download_range_size);
+
+  // Returns the maximum number of ranges of a download fetched at the same
+  // time.  If 1, the default, downloads are fetched with a single request.
+  int max_parallel_downloads() { return max_parallel_downloads_; }
+
+  void set_max_parallel_downloads(int max_parallel_downloads);
+
   // Whether this object was successfully initialized by the constructor.
   bool initialized() const { return app_ != nullptr; }
 
@@ -91,6 +115,22 @@ class StorageInternal {
   // registry.  If not available, it returns an empty string.
   std::string GetAuthToken();
 
+  // Returns the App Check token, or an empty string if App Check is not used.
+  // Blocks while the token is fetched unless it is cached, see
+  // PrefetchAppCheckToken().
+  std::string GetAppCheckToken();
+
+  // Calls on_ready once GetAppCheckToken() can return without blocking.  If
+  // the token is cached, on_ready is called immediately, otherwise it is
+  // called from the scheduler once the token has been fetched.  Requests
+  // waiting for the token share a single fetch.
+  void PrefetchAppCheckToken(std::function<void()> on_ready);
+
+  // Runs send_request, which prepares and sends a request, on the scheduler
+  // after delay_ms once the App Check token is available.
+  void ScheduleRequest(std::function<void()> send_request,
+                       uint64_t delay_ms = 0);
+
   // Get the user agent to send with storage requests.
   const std::string& user_agent() const { return user_agent_; }
 
@@ -99,10 +139,27 @@ class StorageInternal {
   // Remove an operation from the list of outstanding operations.
   void RemoveOperation(RestOperation* operation);
 
+  // Scheduler used to retry failed requests and complete their futures.
+  scheduler::Scheduler& scheduler() { return scheduler_; }
+
  private:
   // Clean up completed operations.
   void CleanupCompletedOperations();
 
+  // Register for App Check token changes, if not registered yet.  Tokens are
+  // only cached while registered.  Requires app_check_mutex_.
+  void AddAppCheckListener();
+
+  // Returns whether the cached App Check token can be used.  Requires
+  // app_check_mutex_.
+  bool IsAppCheckTokenCached();
+
+  // Cache a token fetched from App Check.
+  void CacheAppCheckToken(const std::string& token);
+
+  // Called by App Check when the token changes.
+  static void OnAppCheckTokenChanged(const std::string& token, void* context);
+
  private:
   App* app_;
 
@@ -113,12 +170,27 @@ class StorageInternal {
   double max_download_retry_time_;
   double max_operation_retry_time_;
   double max_upload_retry_time_;
+  size_t upload_chunk_size_;
+  size_t download_range_size_;
+  int max_parallel_downloads_;
   StoragePath root_;
 
   CleanupNotifier cleanup_;
   std::string user_agent_;
   Mutex operations_mutex_;
   std::vector<RestOperation*> operations_;
+  scheduler::Scheduler scheduler_;
+
+  // Guards the App Check state below.
+  Mutex app_check_mutex_;
+  bool app_check_listener_added_;
+  bool app_check_token_cached_;
+  std::string app_check_token_;
+  // Time the cached token was received, in milliseconds.
+  uint64_t app_check_token_time_ms_;
+  // Fetch of the token in progress, shared by all waiting requests.
+  Future<std::string> app_check_fetch_;
+  std::vector<std::function<void()>> app_check_waiters_;
 };
 
 }  // namespace internal
@@ -39,6 +39,18 @@ const size_t kBucketStartStringLength = FIREBASE_STRLEN(kBucketStartString);
 const char kBucketEndString[] = "/o/";
 const size_t kBucketEndStringLength = FIREBASE_STRLEN(kBucketEndString);
 
+// Can be set in tests to send requests to a local server, such as
+// "http://localhost:8080", instead of the storage backend.
+const char* g_storage_endpoint_for_testing = nullptr;
+
+// Returns the URL that the URLs of the objects in a bucket start with.
+static std::string BucketUrlPrefix() {
+  if (g_storage_endpoint_for_testing != nullptr) {
+    return std::string(g_storage_endpoint_for_testing) + "/v0/b/";
+  }
+  return std::string(kHttpsScheme) + kBucketStartString;
+}
+
 StoragePath::StoragePath(const std::string& path) {
   bucket_ = "";
   path_ = Path("");
@@ -104,14 +116,23 @@ std::string StoragePath::AsHttpUrl() const {
 std::string StoragePath::AsHttpMetadataUrl() const {
   // Construct the URL.  Final format is:
   // https://[projectname].googleapis.com/v0/b/[bucket]/o/[path and/or object]
-  std::string result = kHttpsScheme;
-  result += kBucketStartString;
+  std::string result = BucketUrlPrefix();
   result += bucket_;
   result += kBucketEndString;
   result += rest::util::EncodeUrl(path_.str());
   return result;
 }
 
+std::string StoragePath::AsHttpUploadUrl() const {
+  // Construct the URL.  Final format is:
+  // https://[projectname].googleapis.com/v0/b/[bucket]/o?name=[path]
+  std::string result = BucketUrlPrefix();
+  result += bucket_;
+  result += "/o?name=";
+  result += rest::util::EncodeUrl(path_.str());
+  return result;
+}
+
 }  // namespace internal
 }  // namespace storage
 }  // namespace firebase
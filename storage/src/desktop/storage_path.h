@@ -76,6 +76,9 @@ class StoragePath {
   // Returns the path as a HTTP URL to the metadata for the asset.
   std::string AsHttpMetadataUrl() const;
 
+  // Returns the HTTP URL used to start a resumable upload of the asset.
+  std::string AsHttpUploadUrl() const;
+
   // Check to see if the path has been initialized correctly.
   bool IsValid() const { return !bucket_.empty(); }
 
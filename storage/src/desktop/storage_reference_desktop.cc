@@ -14,10 +14,9 @@
 
 #include "storage/src/desktop/storage_reference_desktop.h"
 
-#include <chrono>  // NOLINT
 #include <limits>
 #include <memory>
-#include <thread>  // NOLINT
+#include <random>
 
 #include "app/memory/unique_ptr.h"
 #include "app/rest/request.h"
@@ -26,12 +25,15 @@
 #include "app/rest/transport_curl.h"
 #include "app/rest/util.h"
 #include "app/src/app_common.h"
-#include "app/src/function_registry.h"
 #include "app/src/include/firebase/app.h"
+#include "app/src/include/firebase/internal/mutex.h"
 #include "app/src/thread.h"
+#include "app/src/time.h"
 #include "storage/src/common/common_internal.h"
 #include "storage/src/desktop/controller_desktop.h"
 #include "storage/src/desktop/metadata_desktop.h"
+#include "storage/src/desktop/parallel_download.h"
+#include "storage/src/desktop/resumable_upload.h"
 #include "storage/src/desktop/storage_desktop.h"
 #include "storage/src/include/firebase/storage.h"
 #include "storage/src/include/firebase/storage/common.h"
@@ -99,14 +101,15 @@ StorageReference StorageReferenceInternal::AsStorageReference() const {
 // passed in, and will delete them when the request is complete.
 // (listener and controller_out are not deleted, since they are owned by the
 // calling function, if they exist.)
-void StorageReferenceInternal::RestCall(rest::Request* request,
-                                        Notifier* request_notifier,
-                                        BlockingResponse* response,
-                                        FutureHandle handle, Listener* listener,
-                                        Controller* controller_out) {
+void StorageReferenceInternal::RestCall(
+    rest::Request* request, Notifier* request_notifier,
+    BlockingResponse* response, FutureHandle handle, Listener* listener,
+    Controller* controller_out, int64_t transfer_offset, int64_t transfer_size,
+    std::shared_ptr<TransferProgress> shared_progress) {
   RestOperation::Start(storage_, AsStorageReference(), request,
                        request_notifier, response, listener, handle,
-                       controller_out);
+                       controller_out, transfer_offset, transfer_size,
+                       shared_progress);
 }
 
 const char kFileProtocol[] = "file://";
@@ -206,18 +209,20 @@ Future<void> StorageReferenceInternal::Delete() {
   auto* future_api = future();
   auto handle = future_api->SafeAlloc<void>(kStorageReferenceFnDelete);
 
-  auto send_request_funct{[&]() -> BlockingResponse* {
-    auto* future_api = future();
-    auto handle =
-        future_api->SafeAlloc<void>(kStorageReferenceFnDeleteInternal);
-    EmptyResponse* response = new EmptyResponse(handle, future_api);
-
-    storage::internal::Request* request = new storage::internal::Request();
-    PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(), "DELETE");
-    RestCall(request, request->notifier(), response, handle.get(), nullptr,
-             nullptr);
-    return response;
-  }};
+  auto send_request_funct{
+      [](StorageReferenceInternal* ref) -> BlockingResponse* {
+        auto* future_api = ref->future();
+        auto handle =
+            future_api->SafeAlloc<void>(kStorageReferenceFnDeleteInternal);
+        EmptyResponse* response = new EmptyResponse(handle, future_api);
+
+        storage::internal::Request* request = new storage::internal::Request();
+        ref->PrepareRequestBlocking(
+            request, ref->storageUri_.AsHttpUrl().c_str(), "DELETE");
+        ref->RestCall(request, request->notifier(), response, handle.get(),
+                      nullptr, nullptr);
+        return response;
+      }};
   SendRequestWithRetry(kStorageReferenceFnDeleteInternal, send_request_funct,
                        handle, storage_->max_operation_retry_time());
   return DeleteLastResult();
@@ -228,11 +233,9 @@ Future<void> StorageReferenceInternal::DeleteLastResult() {
       future()->LastResult(kStorageReferenceFnDelete));
 }
 
-// The timeout time to wait for the App Check token.
-const int kAppCheckTokenTimeoutMs = 10000;
-
 // Handy utility function, since REST calls have similar setup and teardown.
-// Can potentially block getting Future results for the Request.
+// Blocks while fetching the App Check token unless it is cached, so callers
+// wait for StorageInternal::PrefetchAppCheckToken() first.
 void StorageReferenceInternal::PrepareRequestBlocking(
     rest::Request* request, const char* url, const char* method,
     const char* content_type) {
@@ -257,16 +260,9 @@ void StorageReferenceInternal::PrepareRequestBlocking(
   request->add_header("X-Firebase-Storage-Version",
                       storage_->user_agent().c_str());
 
-  // Use the function registry to get the App Check token.
-  Future<std::string> app_check_future;
-  bool succeeded = storage_->app()->function_registry()->CallFunction(
-      ::firebase::internal::FnAppCheckGetTokenAsync, storage_->app(), nullptr,
-      &app_check_future);
-  if (succeeded && app_check_future.status() != kFutureStatusInvalid) {
-    const std::string* token = app_check_future.Await(kAppCheckTokenTimeoutMs);
-    if (token) {
-      request->add_header("X-Firebase-AppCheck", token->c_str());
-    }
+  std::string app_check_token = storage_->GetAppCheckToken();
+  if (!app_check_token.empty()) {
+    request->add_header("X-Firebase-AppCheck", app_check_token.c_str());
   }
 }
 
@@ -276,18 +272,24 @@ Future<size_t> StorageReferenceInternal::GetFile(const char* path,
                                                  Controller* controller_out) {
   auto handle = future()->SafeAlloc<size_t>(kStorageReferenceFnGetFile);
   std::string final_path = StripProtocol(path);
+  if (storage_->max_parallel_downloads() > 1) {
+    ParallelDownload::Start(this, final_path, future(), handle, listener,
+                            controller_out);
+    return GetFileLastResult();
+  }
   auto send_request_funct{
-      [&, final_path, listener, controller_out]() -> BlockingResponse* {
-        auto* future_api = future();
+      [final_path, listener,
+       controller_out](StorageReferenceInternal* ref) -> BlockingResponse* {
+        auto* future_api = ref->future();
         auto handle =
             future_api->SafeAlloc<size_t>(kStorageReferenceFnGetFileInternal);
         storage::internal::Request* request = new storage::internal::Request();
-        PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(),
-                               rest::util::kGet);
+        ref->PrepareRequestBlocking(
+            request, ref->storageUri_.AsHttpUrl().c_str(), rest::util::kGet);
         GetFileResponse* response =
             new GetFileResponse(final_path.c_str(), handle, future_api);
-        RestCall(request, request->notifier(), response, handle.get(), listener,
-                 controller_out);
+        ref->RestCall(request, request->notifier(), response, handle.get(),
+                      listener, controller_out);
         return response;
       }};
   SendRequestWithRetry(kStorageReferenceFnGetFileInternal, send_request_funct,
@@ -307,94 +309,139 @@ Future<size_t> StorageReferenceInternal::GetBytes(void* buffer,
                                                   Listener* listener,
                                                   Controller* controller_out) {
   auto handle = future()->SafeAlloc<size_t>(kStorageReferenceFnGetBytes);
-  auto send_request_funct{[&, buffer, buffer_size, listener,
-                           controller_out]() -> BlockingResponse* {
-    auto* future_api = future();
-    auto handle =
-        future_api->SafeAlloc<size_t>(kStorageReferenceFnGetBytesInternal);
-    storage::internal::Request* request = new storage::internal::Request();
-    PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(),
-                           rest::util::kGet);
-    GetBytesResponse* response =
-        new GetBytesResponse(buffer, buffer_size, handle, future_api);
-    RestCall(request, request->notifier(), response, handle.get(), listener,
-             controller_out);
-    return response;
-  }};
+  auto send_request_funct{
+      [buffer, buffer_size, listener,
+       controller_out](StorageReferenceInternal* ref) -> BlockingResponse* {
+        auto* future_api = ref->future();
+        auto handle =
+            future_api->SafeAlloc<size_t>(kStorageReferenceFnGetBytesInternal);
+        storage::internal::Request* request = new storage::internal::Request();
+        ref->PrepareRequestBlocking(
+            request, ref->storageUri_.AsHttpUrl().c_str(), rest::util::kGet);
+        GetBytesResponse* response =
+            new GetBytesResponse(buffer, buffer_size, handle, future_api);
+        ref->RestCall(request, request->notifier(), response, handle.get(),
+                      listener, controller_out);
+        return response;
+      }};
   SendRequestWithRetry(kStorageReferenceFnGetBytesInternal, send_request_funct,
                        handle, storage_->max_download_retry_time());
   return GetBytesLastResult();
 }
 
-// Sends a rest request, and creates a separate thread to retry failures.
+template <typename FutureType>
+struct StorageReferenceInternal::RetryState {
+  // Private copy of the reference the request was made on.  Every attempt is
+  // sent through it, so retries do not depend on the lifetime of the caller's
+  // reference.
+  std::unique_ptr<StorageReferenceInternal> reference;
+  StorageReferenceFn internal_function_reference;
+  SendRequestFunct send_request_funct;
+  // Future API of the caller's reference.  It outlives that reference while
+  // final_handle is pending.
+  ReferenceCountedFutureImpl* final_future_api;
+  SafeFutureHandle<FutureType> final_handle;
+  // Time after which the request is no longer retried.
+  uint64_t end_time_ms;
+  // Delay before the next attempt, before jitter is applied.
+  uint64_t sleep_time_ms;
+};
+
+// Guards g_retry_jitter_engine.
+static Mutex g_retry_jitter_mutex;  // NOLINT
+// Seeded once, rather than reading a std::random_device for every retry.
+static std::minstd_rand* g_retry_jitter_engine = nullptr;
+
+uint64_t JitterRetryDelay(uint64_t delay_ms) {
+  MutexLock lock(g_retry_jitter_mutex);
+  if (g_retry_jitter_engine == nullptr) {
+    std::random_device random_device;
+    g_retry_jitter_engine = new std::minstd_rand(random_device());
+  }
+  std::uniform_int_distribution<uint64_t> distribution(0, delay_ms / 2);
+  return delay_ms - distribution(*g_retry_jitter_engine);
+}
+
+// Sends a rest request, and retries failures using the storage scheduler.
 template <typename FutureType>
 void StorageReferenceInternal::SendRequestWithRetry(
     StorageReferenceFn internal_function_reference,
     SendRequestFunct send_request_funct,
     SafeFutureHandle<FutureType> final_handle, double max_retry_time_seconds) {
-  BlockingResponse* first_response = send_request_funct();
-  std::thread async_retry_thread(
-      &StorageReferenceInternal::AsyncSendRequestWithRetry<FutureType>, this,
-      internal_function_reference, send_request_funct, final_handle,
-      first_response, max_retry_time_seconds);
-  async_retry_thread.detach();
+  auto state = std::make_shared<RetryState<FutureType>>();
+  state->reference.reset(new StorageReferenceInternal(*this));
+  state->internal_function_reference = internal_function_reference;
+  state->send_request_funct = send_request_funct;
+  state->final_future_api = future();
+  state->final_handle = final_handle;
+  state->end_time_ms = ::firebase::internal::GetTimestamp() +
+                       static_cast<uint64_t>(max_retry_time_seconds * 1000);
+  state->sleep_time_ms = kInitialSleepTimeMillis;
+  storage_->PrefetchAppCheckToken([state]() { SendRetryAttempt(state); });
 }
 
-const int kInitialSleepTimeMillis = 1000;
-const int kMaxSleepTimeMillis = 30000;
+template <typename FutureType>
+void StorageReferenceInternal::SendRetryAttempt(
+    std::shared_ptr<RetryState<FutureType>> state) {
+  StorageReferenceInternal* reference = state->reference.get();
+  BlockingResponse* response = state->send_request_funct(reference);
+  FutureBase internal_future =
+      reference->future()->LastResult(state->internal_function_reference);
+  if (internal_future.status() == kFutureStatusInvalid) {
+    CompleteRetry(*state, internal_future);
+    return;
+  }
+  // The response is deleted after its future completes, so it is still valid
+  // in the completion callback.
+  internal_future.OnCompletion([state, response](const FutureBase& result) {
+    OnRetryAttemptComplete(state, result, response);
+  });
+}
 
-// In a separate thread, repeatedly send Rest requests until one succeeds or a
-// maximum amount of time has passed.
 template <typename FutureType>
-void StorageReferenceInternal::AsyncSendRequestWithRetry(
-    StorageReferenceFn internal_function_reference,
-    SendRequestFunct send_request_funct,
-    SafeFutureHandle<FutureType> final_handle, BlockingResponse* response,
-    double max_retry_time_seconds) {
-  auto* future_api = future();
-  firebase::FutureBase internal_future;
-  auto end_time = std::chrono::steady_clock::now() +
-                  std::chrono::duration<double>(max_retry_time_seconds);
-  auto current_sleep_time = std::chrono::milliseconds(kInitialSleepTimeMillis);
-  auto max_sleep_time = std::chrono::milliseconds(kMaxSleepTimeMillis);
-  while (true) {
-    internal_future = future_api->LastResult(internal_function_reference);
-    // Wait for completion, then check status and error.
-    while (internal_future.status() == firebase::kFutureStatusPending) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
-    // For any request that succeeds or fails in a non-retryable way, don't
-    // bother retrying. Response can be null if the request failed to create.
-    int httpStatus = response == nullptr ? 400 : response->status();
-    if (internal_future.status() != firebase::kFutureStatusComplete ||
-        !IsRetryableFailure(httpStatus)) {
-      break;
-    }
-    // Interrupt the loop if the retry deadline has been reached
-    auto current_time = std::chrono::steady_clock::now();
-    if (current_time + current_sleep_time > end_time) {
-      break;
-    }
-    // Sleep for an exponentially increasing duration, then retry the request.
-    std::this_thread::sleep_for(current_sleep_time);
-    current_sleep_time *= 2;
-    if (current_sleep_time > max_sleep_time) {
-      current_sleep_time = max_sleep_time;
-    }
-    response = send_request_funct();
+void StorageReferenceInternal::OnRetryAttemptComplete(
+    std::shared_ptr<RetryState<FutureType>> state,
+    const FutureBase& internal_future, BlockingResponse* response) {
+  StorageInternal* storage = state->reference->storage_;
+  // For any request that succeeds or fails in a non-retryable way, don't
+  // bother retrying. Response can be null if the request failed to create.
+  int httpStatus = response == nullptr ? 400 : response->status();
+  uint64_t delay = JitterRetryDelay(state->sleep_time_ms);
+  if (internal_future.status() != firebase::kFutureStatusComplete ||
+      !IsRetryableFailure(httpStatus) ||
+      ::firebase::internal::GetTimestamp() + delay > state->end_time_ms) {
+    // Complete the final future on the scheduler thread rather than the
+    // transport thread, so completion callbacks can't stall other transfers.
+    FutureBase result = internal_future;
+    storage->scheduler().Schedule(
+        [state, result]() { CompleteRetry(*state, result); });
+    return;
+  }
+  // Retry after an exponentially increasing delay.
+  state->sleep_time_ms = state->sleep_time_ms * 2;
+  if (state->sleep_time_ms > kMaxSleepTimeMillis) {
+    state->sleep_time_ms = kMaxSleepTimeMillis;
   }
+  storage->ScheduleRequest([state]() { SendRetryAttempt(state); }, delay);
+}
+
+template <typename FutureType>
+void StorageReferenceInternal::CompleteRetry(
+    const RetryState<FutureType>& state, const FutureBase& internal_future) {
+  auto* future_api = state.final_future_api;
   // Copy from the internal future to the final future.
   Future<FutureType> typed_future =
       static_cast<const Future<FutureType>&>(internal_future);
   if (typed_future.result() != nullptr) {
     if constexpr (std::is_void<FutureType>::value) {
-      future_api->Complete(final_handle, internal_future.error());
+      future_api->Complete(state.final_handle, internal_future.error());
     } else {
-      future_api->CompleteWithResult(final_handle, internal_future.error(),
+      future_api->CompleteWithResult(state.final_handle,
+                                     internal_future.error(),
                                      *(typed_future.result()));
     }
   } else {
-    future_api->Complete(final_handle, internal_future.error(),
+    future_api->Complete(state.final_handle, internal_future.error(),
                          internal_future.error_message());
   }
 }
@@ -432,23 +479,30 @@ Future<Metadata> StorageReferenceInternal::PutBytesInternal(
   auto handle = future_api->SafeAlloc<Metadata>(kStorageReferenceFnPutBytes);
 
   std::string content_type_str = content_type ? content_type : "";
-  auto send_request_funct{[&, content_type_str, buffer, buffer_size, listener,
-                           controller_out]() -> BlockingResponse* {
-    auto* future_api = future();
-    auto handle =
-        future_api->SafeAlloc<Metadata>(kStorageReferenceFnPutBytesInternal);
-
-    storage::internal::RequestBinary* request =
-        new storage::internal::RequestBinary(static_cast<const char*>(buffer),
-                                             buffer_size);
-    PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(),
-                           rest::util::kPost, content_type_str.c_str());
-    ReturnedMetadataResponse* response =
-        new ReturnedMetadataResponse(handle, future_api, AsStorageReference());
-    RestCall(request, request->notifier(), response, handle.get(), listener,
-             controller_out);
-    return response;
-  }};
+  if (buffer_size > storage_->upload_chunk_size()) {
+    ResumableUpload::StartWithBuffer(this, buffer, buffer_size,
+                                     content_type_str, future_api, handle,
+                                     listener, controller_out);
+    return PutBytesLastResult();
+  }
+  auto send_request_funct{
+      [content_type_str, buffer, buffer_size, listener,
+       controller_out](StorageReferenceInternal* ref) -> BlockingResponse* {
+        auto* future_api = ref->future();
+        auto handle = future_api->SafeAlloc<Metadata>(
+            kStorageReferenceFnPutBytesInternal);
+        storage::internal::RequestBinary* request =
+            new storage::internal::RequestBinary(
+                static_cast<const char*>(buffer), buffer_size);
+        ref->PrepareRequestBlocking(
+            request, ref->storageUri_.AsHttpUrl().c_str(), rest::util::kPost,
+            content_type_str.c_str());
+        ReturnedMetadataResponse* response = new ReturnedMetadataResponse(
+            handle, future_api, ref->AsStorageReference());
+        ref->RestCall(request, request->notifier(), response, handle.get(),
+                      listener, controller_out);
+        return response;
+      }};
   SendRequestWithRetry(kStorageReferenceFnPutBytesInternal, send_request_funct,
                        handle, storage_->max_upload_retry_time());
   return PutBytesLastResult();
@@ -500,31 +554,41 @@ Future<Metadata> StorageReferenceInternal::PutFileInternal(
 
   std::string final_path = StripProtocol(path);
   std::string content_type_str = content_type ? content_type : "";
-  auto send_request_funct{[&, final_path, content_type_str, listener,
-                           controller_out]() -> BlockingResponse* {
-    auto* future_api = future();
-    auto handle =
-        future_api->SafeAlloc<Metadata>(kStorageReferenceFnPutFileInternal);
-
-    // Open the file, calculate the length.
-    storage::internal::RequestFile* request(
-        new storage::internal::RequestFile(final_path.c_str(), 0));
-    if (!request->IsFileOpen()) {
-      delete request;
-      future_api->Complete(handle, kErrorUnknown, "Could not read file.");
-      return nullptr;
-    } else {
-      // Everything is good.  Fire off the request.
-      ReturnedMetadataResponse* response = new ReturnedMetadataResponse(
-          handle, future_api, AsStorageReference());
-
-      PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(),
-                             rest::util::kPost, content_type_str.c_str());
-      RestCall(request, request->notifier(), response, handle.get(), listener,
-               controller_out);
-      return response;
-    }
-  }};
+  size_t file_size =
+      storage::internal::RequestFile(final_path.c_str(), 0).file_size();
+  if (file_size > storage_->upload_chunk_size()) {
+    ResumableUpload::StartWithFile(this, final_path, file_size,
+                                   content_type_str, future_api, handle,
+                                   listener, controller_out);
+    return PutFileLastResult();
+  }
+  auto send_request_funct{
+      [final_path, content_type_str, listener,
+       controller_out](StorageReferenceInternal* ref) -> BlockingResponse* {
+        auto* future_api = ref->future();
+        auto handle =
+            future_api->SafeAlloc<Metadata>(kStorageReferenceFnPutFileInternal);
+
+        // Open the file, calculate the length.
+        storage::internal::RequestFile* request(
+            new storage::internal::RequestFile(final_path.c_str(), 0));
+        if (!request->IsFileOpen()) {
+          delete request;
+          future_api->Complete(handle, kErrorUnknown, "Could not read file.");
+          return nullptr;
+        } else {
+          // Everything is good.  Fire off the request.
+          ReturnedMetadataResponse* response = new ReturnedMetadataResponse(
+              handle, future_api, ref->AsStorageReference());
+
+          ref->PrepareRequestBlocking(
+              request, ref->storageUri_.AsHttpUrl().c_str(), rest::util::kPost,
+              content_type_str.c_str());
+          ref->RestCall(request, request->notifier(), response, handle.get(),
+                        listener, controller_out);
+          return response;
+        }
+      }};
   SendRequestWithRetry(kStorageReferenceFnPutFileInternal, send_request_funct,
                        handle, storage_->max_upload_retry_time());
   return PutFileLastResult();
@@ -565,22 +629,24 @@ Future<Metadata> StorageReferenceInternal::GetMetadata() {
   auto* future_api = future();
   auto handle = future_api->SafeAlloc<Metadata>(kStorageReferenceFnGetMetadata);
 
-  auto send_request_funct{[&]() -> BlockingResponse* {
-    auto* future_api = future();
-    auto handle =
-        future_api->SafeAlloc<Metadata>(kStorageReferenceFnGetMetadataInternal);
-    ReturnedMetadataResponse* response =
-        new ReturnedMetadataResponse(handle, future_api, AsStorageReference());
+  auto send_request_funct{
+      [](StorageReferenceInternal* ref) -> BlockingResponse* {
+        auto* future_api = ref->future();
+        auto handle = future_api->SafeAlloc<Metadata>(
+            kStorageReferenceFnGetMetadataInternal);
+        ReturnedMetadataResponse* response = new ReturnedMetadataResponse(
+            handle, future_api, ref->AsStorageReference());
 
-    storage::internal::Request* request = new storage::internal::Request();
-    PrepareRequestBlocking(request, storageUri_.AsHttpMetadataUrl().c_str(),
-                           rest::util::kGet);
+        storage::internal::Request* request = new storage::internal::Request();
+        ref->PrepareRequestBlocking(
+            request, ref->storageUri_.AsHttpMetadataUrl().c_str(),
+            rest::util::kGet);
 
-    RestCall(request, request->notifier(), response, handle.get(), nullptr,
-             nullptr);
+        ref->RestCall(request, request->notifier(), response, handle.get(),
+                      nullptr, nullptr);
 
-    return response;
-  }};
+        return response;
+      }};
   SendRequestWithRetry(kStorageReferenceFnGetMetadataInternal,
                        send_request_funct, handle,
                        storage_->max_operation_retry_time());
@@ -600,25 +666,28 @@ Future<Metadata> StorageReferenceInternal::UpdateMetadata(
   auto handle =
       future_api->SafeAlloc<Metadata>(kStorageReferenceFnUpdateMetadata);
 
-  auto send_request_funct{[&, metadata]() -> BlockingResponse* {
-    auto* future_api = future();
-    auto handle = future_api->SafeAlloc<Metadata>(
-        kStorageReferenceFnUpdateMetadataInternal);
-
-    ReturnedMetadataResponse* response =
-        new ReturnedMetadataResponse(handle, future_api, AsStorageReference());
+  // Export the metadata now, as the caller's copy may be gone by the time the
+  // request is retried.
+  std::string metadata_json = metadata->internal_->ExportAsJson();
+  auto send_request_funct{
+      [metadata_json](StorageReferenceInternal* ref) -> BlockingResponse* {
+        auto* future_api = ref->future();
+        auto handle = future_api->SafeAlloc<Metadata>(
+            kStorageReferenceFnUpdateMetadataInternal);
 
-    storage::internal::Request* request = new storage::internal::Request();
-    PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(), "PATCH",
-                           "application/json");
+        ReturnedMetadataResponse* response = new ReturnedMetadataResponse(
+            handle, future_api, ref->AsStorageReference());
 
-    std::string metadata_json = metadata->internal_->ExportAsJson();
-    request->set_post_fields(metadata_json.c_str(), metadata_json.length());
+        storage::internal::Request* request = new storage::internal::Request();
+        ref->PrepareRequestBlocking(
+            request, ref->storageUri_.AsHttpUrl().c_str(), "PATCH",
+            "application/json");
+        request->set_post_fields(metadata_json.c_str(), metadata_json.length());
 
-    RestCall(request, request->notifier(), response, handle.get(), nullptr,
-             nullptr);
-    return response;
-  }};
+        ref->RestCall(request, request->notifier(), response, handle.get(),
+                      nullptr, nullptr);
+        return response;
+      }};
 
   SendRequestWithRetry(kStorageReferenceFnUpdateMetadataInternal,
                        send_request_funct, handle,
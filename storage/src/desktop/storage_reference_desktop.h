@@ -15,6 +15,8 @@
 #ifndef FIREBASE_STORAGE_SRC_DESKTOP_STORAGE_REFERENCE_DESKTOP_H_
 #define FIREBASE_STORAGE_SRC_DESKTOP_STORAGE_REFERENCE_DESKTOP_H_
 
+#include <functional>
+#include <memory>
 #include <string>
 
 #include "app/src/include/firebase/app.h"
@@ -44,12 +46,26 @@ enum StorageReferenceFn {
   kStorageReferenceFnPutBytesInternal,
   kStorageReferenceFnPutFile,
   kStorageReferenceFnPutFileInternal,
+  kStorageReferenceFnUploadSessionInternal,
+  kStorageReferenceFnDownloadRangeInternal,
   kStorageReferenceFnCount,
 };
 
 class BlockingResponse;
 class MetadataChainData;
 class Notifier;
+class ParallelDownload;
+class ResumableUpload;
+class TransferProgress;
+
+// Delay before the first retry of a failed request, and the limit the delay
+// doubles up to after each retry.
+const int kInitialSleepTimeMillis = 1000;
+const int kMaxSleepTimeMillis = 30000;
+
+// Returns a random delay between half and all of delay_ms, so that requests
+// that failed at the same time do not all retry at the same time.
+uint64_t JitterRetryDelay(uint64_t delay_ms);
 
 class StorageReferenceInternal {
  public:
@@ -153,21 +169,41 @@ class StorageReferenceInternal {
   StorageReference AsStorageReference() const;
 
  private:
-  // Function type that sends a Rest Request and returns the BlockingResponse.
-  typedef std::function<BlockingResponse*()> SendRequestFunct;
+  friend class ParallelDownload;
+  friend class ResumableUpload;
+
+  // Function type that sends a Rest Request for reference and returns the
+  // BlockingResponse.
+  typedef std::function<BlockingResponse*(StorageReferenceInternal* reference)>
+      SendRequestFunct;
+
+  // State of a request that is resent until it succeeds, fails in a
+  // non-retryable way or runs out of time.
+  template <typename FutureType>
+  struct RetryState;
 
+  // Sends a request, retrying failures from the storage scheduler.
   template <typename FutureType>
   void SendRequestWithRetry(StorageReferenceFn internal_function_reference,
                             SendRequestFunct send_request_funct,
                             SafeFutureHandle<FutureType> final_handle,
                             double max_retry_time_seconds);
 
+  // Sends one attempt of a retried request.
+  template <typename FutureType>
+  static void SendRetryAttempt(std::shared_ptr<RetryState<FutureType>> state);
+
+  // Called when an attempt of a retried request completes.  Either schedules
+  // the next attempt or completes the final future.
+  template <typename FutureType>
+  static void OnRetryAttemptComplete(
+      std::shared_ptr<RetryState<FutureType>> state,
+      const FutureBase& internal_future, BlockingResponse* response);
+
+  // Copies the result of the last attempt to the final future.
   template <typename FutureType>
-  void AsyncSendRequestWithRetry(StorageReferenceFn internal_function_reference,
-                                 SendRequestFunct send_request_funct,
-                                 SafeFutureHandle<FutureType> final_handle,
-                                 BlockingResponse* response,
-                                 double max_retry_time_seconds);
+  static void CompleteRetry(const RetryState<FutureType>& state,
+                            const FutureBase& internal_future);
 
   // Returns whether or not an HTTP status or future error indicates a retryable
   // failure.
@@ -183,9 +219,13 @@ class StorageReferenceInternal {
                                    Controller* controller_out,
                                    const char* content_type = nullptr);
 
+  // See RestOperation::Start() for transfer_offset, transfer_size and
+  // shared_progress.
   void RestCall(rest::Request* request, internal::Notifier* request_notifier,
                 BlockingResponse* response, FutureHandle handle,
-                Listener* listener, Controller* controller_out);
+                Listener* listener, Controller* controller_out,
+                int64_t transfer_offset = 0, int64_t transfer_size = -1,
+                std::shared_ptr<TransferProgress> shared_progress = nullptr);
 
   void PrepareRequestBlocking(rest::Request* request, const char* url,
                               const char* method,
@@ -139,6 +139,22 @@ class Storage {
   /// download if a failure occurs. Defaults to 120 seconds (2 minutes).
   void set_max_operation_retry_time(double max_transfer_retry_seconds);
 
+  /// @brief Returns the maximum number of byte ranges of a file that
+  /// StorageReference::GetFile() downloads at the same time.
+  int max_parallel_downloads();
+  /// @brief Sets the maximum number of byte ranges of a file that
+  /// StorageReference::GetFile() downloads at the same time.
+  ///
+  /// With a value above 1, large files are split into ranges that are
+  /// fetched in parallel, which can be faster when the bandwidth of a single
+  /// connection is limited.
+  ///
+  /// @note This only has an effect on desktop.
+  ///
+  /// @param[in] max_parallel_downloads Maximum number of ranges, by default 1,
+  /// which downloads each file with a single request.
+  void set_max_parallel_downloads(int max_parallel_downloads);
+
  private:
   /// @cond FIREBASE_APP_INTERNAL
   friend class Metadata;
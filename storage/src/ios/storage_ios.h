@@ -92,6 +92,10 @@ class StorageInternal {
   // if a failure occurs.
   void set_max_operation_retry_time(double max_transfer_retry_seconds);
 
+  // Not supported on iOS, downloads are done by the Objective-C SDK.
+  int max_parallel_downloads() const { return 1; }
+  void set_max_parallel_downloads(int /*max_parallel_downloads*/) {}
+
   FutureManager& future_manager() { return future_manager_; }
 
   // Whether this object was successfully initialized by the constructor.
@@ -0,0 +1,197 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/storage_desktop.h"
+
+#include <string>
+
+#include "app/src/function_registry.h"
+#include "app/src/include/firebase/app.h"
+#include "app/src/reference_counted_future_impl.h"
+#include "app/tests/include/firebase/app_for_testing.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+namespace {
+
+const char kStorageUrl[] = "gs://abc-xyz-123.appspot.com";
+
+// Callback type App Check listeners are registered with.
+typedef void (*AppCheckListenerCallback)(const std::string& token,
+                                         void* context);
+
+// Stands in for App Check in the function registry.  It counts token fetches
+// and holds on to the listener Storage registers, so that tests can change
+// the token the same way App Check does.
+class FakeAppCheck {
+ public:
+  explicit FakeAppCheck(App* app)
+      : app_(app),
+        future_api_(1),
+        token_("first-token"),
+        fetch_count_(0),
+        accept_listeners_(true),
+        listener_(nullptr),
+        listener_context_(nullptr) {
+    s_instance_ = this;
+    ::firebase::internal::FunctionRegistry* registry =
+        app_->function_registry();
+    registry->RegisterFunction(::firebase::internal::FnAppCheckGetTokenAsync,
+                               GetTokenAsync);
+    registry->RegisterFunction(::firebase::internal::FnAppCheckAddListener,
+                               AddListener);
+    registry->RegisterFunction(::firebase::internal::FnAppCheckRemoveListener,
+                               RemoveListener);
+  }
+
+  ~FakeAppCheck() {
+    ::firebase::internal::FunctionRegistry* registry =
+        app_->function_registry();
+    registry->UnregisterFunction(::firebase::internal::FnAppCheckGetTokenAsync);
+    registry->UnregisterFunction(::firebase::internal::FnAppCheckAddListener);
+    registry->UnregisterFunction(
+        ::firebase::internal::FnAppCheckRemoveListener);
+    s_instance_ = nullptr;
+  }
+
+  // Changes the token and notifies the registered listener, if any.
+  void ChangeToken(const std::string& token) {
+    token_ = token;
+    if (listener_) listener_(token_, listener_context_);
+  }
+
+  void set_accept_listeners(bool accept) { accept_listeners_ = accept; }
+  int fetch_count() const { return fetch_count_; }
+  bool has_listener() const { return listener_ != nullptr; }
+  void* listener_context() const { return listener_context_; }
+
+ private:
+  static bool GetTokenAsync(App* app, void* /*args*/, void* out) {
+    FakeAppCheck* self = s_instance_;
+    self->fetch_count_++;
+    SafeFutureHandle<std::string> handle =
+        self->future_api_.SafeAlloc<std::string>(0);
+    self->future_api_.CompleteWithResult(handle, 0, "", self->token_);
+    *static_cast<Future<std::string>*>(out) =
+        MakeFuture(&self->future_api_, handle);
+    return true;
+  }
+
+  static bool AddListener(App* app, void* callback, void* context) {
+    FakeAppCheck* self = s_instance_;
+    if (!self->accept_listeners_) return false;
+    self->listener_ = reinterpret_cast<AppCheckListenerCallback>(callback);
+    self->listener_context_ = context;
+    return true;
+  }
+
+  static bool RemoveListener(App* app, void* callback, void* context) {
+    FakeAppCheck* self = s_instance_;
+    if (self->listener_context_ != context) return false;
+    self->listener_ = nullptr;
+    self->listener_context_ = nullptr;
+    return true;
+  }
+
+  static FakeAppCheck* s_instance_;
+
+  App* app_;
+  ReferenceCountedFutureImpl future_api_;
+  std::string token_;
+  int fetch_count_;
+  bool accept_listeners_;
+  AppCheckListenerCallback listener_;
+  void* listener_context_;
+};
+
+FakeAppCheck* FakeAppCheck::s_instance_ = nullptr;
+
+class StorageDesktopTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    app_ = testing::CreateApp();
+    app_check_ = new FakeAppCheck(app_);
+  }
+
+  void TearDown() override {
+    delete app_check_;
+    delete app_;
+  }
+
+  App* app_;
+  FakeAppCheck* app_check_;
+};
+
+TEST_F(StorageDesktopTest, AppCheckTokenIsFetchedOnce) {
+  StorageInternal storage(app_, kStorageUrl);
+
+  EXPECT_EQ(storage.GetAppCheckToken(), "first-token");
+  EXPECT_EQ(storage.GetAppCheckToken(), "first-token");
+  EXPECT_EQ(app_check_->fetch_count(), 1);
+}
+
+TEST_F(StorageDesktopTest, PrefetchUsesCachedAppCheckToken) {
+  StorageInternal storage(app_, kStorageUrl);
+  storage.GetAppCheckToken();
+
+  // With the token cached, the callback runs before PrefetchAppCheckToken()
+  // returns.
+  bool ready = false;
+  storage.PrefetchAppCheckToken([&ready]() { ready = true; });
+  EXPECT_TRUE(ready);
+  EXPECT_EQ(app_check_->fetch_count(), 1);
+}
+
+TEST_F(StorageDesktopTest, AppCheckTokenChangeReplacesCachedToken) {
+  StorageInternal storage(app_, kStorageUrl);
+  EXPECT_EQ(storage.GetAppCheckToken(), "first-token");
+
+  app_check_->ChangeToken("second-token");
+  EXPECT_EQ(storage.GetAppCheckToken(), "second-token");
+
+  // An empty token, e.g. after App Check is reset, replaces the cached one as
+  // well.
+  app_check_->ChangeToken("");
+  EXPECT_EQ(storage.GetAppCheckToken(), "");
+  EXPECT_EQ(app_check_->fetch_count(), 1);
+}
+
+TEST_F(StorageDesktopTest, AppCheckTokenIsNotCachedWithoutListener) {
+  // Without a listener, token changes would go unnoticed, so every request
+  // asks App Check for the token.
+  app_check_->set_accept_listeners(false);
+  StorageInternal storage(app_, kStorageUrl);
+
+  EXPECT_EQ(storage.GetAppCheckToken(), "first-token");
+  EXPECT_EQ(storage.GetAppCheckToken(), "first-token");
+  EXPECT_EQ(app_check_->fetch_count(), 2);
+}
+
+TEST_F(StorageDesktopTest, AppCheckListenerIsRemovedWithStorage) {
+  {
+    StorageInternal storage(app_, kStorageUrl);
+    storage.GetAppCheckToken();
+    EXPECT_TRUE(app_check_->has_listener());
+    EXPECT_EQ(app_check_->listener_context(), &storage);
+  }
+  EXPECT_FALSE(app_check_->has_listener());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
@@ -23,6 +23,7 @@
 #include "gtest/gtest.h"
 #include "storage/src/desktop/controller_desktop.h"
 #include "storage/src/desktop/metadata_desktop.h"
+#include "storage/src/desktop/parallel_download.h"
 #include "storage/src/desktop/storage_path.h"
 #include "storage/src/desktop/storage_reference_desktop.h"
 #include "testing/json_util.h"
@@ -30,7 +31,9 @@
 namespace {
 
 using firebase::App;
+using firebase::storage::internal::JitterRetryDelay;
 using firebase::storage::internal::MetadataInternal;
+using firebase::storage::internal::ParallelDownload;
 using firebase::storage::internal::StorageInternal;
 using firebase::storage::internal::StoragePath;
 using firebase::storage::internal::StorageReferenceInternal;
@@ -146,6 +149,39 @@ TEST_F(StorageDesktopUtilsTests, testUrlConverter) {
                "/v0/b/Bucket/o/path1%2Fpath2%2FObject");
 }
 
+TEST_F(StorageDesktopUtilsTests, testContentRangeParser) {
+  int64_t size = -1;
+  EXPECT_TRUE(
+      ParallelDownload::ParseContentRangeSize("bytes 0-1023/4096", &size));
+  EXPECT_EQ(size, 4096);
+  EXPECT_TRUE(ParallelDownload::ParseContentRangeSize("bytes */0", &size));
+  EXPECT_EQ(size, 0);
+
+  size = -1;
+  EXPECT_FALSE(ParallelDownload::ParseContentRangeSize(nullptr, &size));
+  EXPECT_FALSE(ParallelDownload::ParseContentRangeSize("", &size));
+  EXPECT_FALSE(ParallelDownload::ParseContentRangeSize("bytes 0-1023", &size));
+  EXPECT_FALSE(
+      ParallelDownload::ParseContentRangeSize("bytes 0-1023/", &size));
+  EXPECT_FALSE(
+      ParallelDownload::ParseContentRangeSize("bytes 0-1023/*", &size));
+  EXPECT_EQ(size, -1);
+}
+
+TEST_F(StorageDesktopUtilsTests, testJitterRetryDelay) {
+  // The delay is reduced by up to half, and successive delays differ.
+  bool delays_differ = false;
+  uint64_t first_delay = JitterRetryDelay(1000);
+  for (int i = 0; i < 100; ++i) {
+    uint64_t delay = JitterRetryDelay(1000);
+    EXPECT_GE(delay, 500u);
+    EXPECT_LE(delay, 1000u);
+    if (delay != first_delay) delays_differ = true;
+  }
+  EXPECT_TRUE(delays_differ);
+  EXPECT_EQ(JitterRetryDelay(0), 0u);
+}
+
 TEST_F(StorageDesktopUtilsTests, testMetadataJsonExporter) {
   std::unique_ptr<App> app(firebase::testing::CreateApp());
   std::unique_ptr<StorageInternal> storage(
@@ -0,0 +1,718 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This is a large test that starts a local http server standing in for the
+// storage backend, and tests StorageReferenceInternal against it.
+
+#include "storage/src/desktop/storage_reference_desktop.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "app/src/include/firebase/app.h"
+#include "app/src/include/firebase/future.h"
+#include "app/tests/include/firebase/app_for_testing.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "net/http2/server/lib/public/httpserver2.h"
+#include "net/util/ports.h"
+#include "storage/src/desktop/storage_desktop.h"
+#include "storage/src/include/firebase/storage/controller.h"
+#include "storage/src/include/firebase/storage/metadata.h"
+#include "util/task/status.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+extern const char* g_storage_endpoint_for_testing;
+
+namespace {
+
+const char* kServerVersion = "Storage backend for test";
+const char kBucketUrl[] = "gs://bucket";
+const char kObjectName[] = "object";
+
+const absl::Duration kTimeout = absl::Seconds(10);
+
+// Smallest size of a resumable upload chunk.
+const size_t kChunkSize = 256 * 1024;
+// Uploads of this size are sent as 3 full chunks and a partial one.
+const size_t kUploadSize = 3 * kChunkSize + 100;
+// Size of the ranges of parallel downloads.
+const size_t kRangeSize = 1000;
+
+// Headers of the resumable upload protocol.
+const char kUploadCommandHeader[] = "X-Goog-Upload-Command";
+const char kUploadOffsetHeader[] = "X-Goog-Upload-Offset";
+const char kUploadUrlHeader[] = "X-Goog-Upload-URL";
+const char kUploadStatusHeader[] = "X-Goog-Upload-Status";
+const char kUploadSizeReceivedHeader[] = "X-Goog-Upload-Size-Received";
+
+// Path of the session URL returned when an upload starts.
+const char kUploadPath[] = "/upload";
+
+// Metadata returned for the object.
+const char kObjectMetadata[] = "{\"bucket\":\"bucket\",\"name\":\"object\"}";
+
+// Returns the value of a header of request, or an empty string.
+std::string GetInputHeader(HTTPServerRequest* request, const char* name) {
+  const std::string* value = request->input_headers()->GetHeader(name);
+  return value ? *value : std::string();
+}
+
+// A request received by the fake backend.
+struct ReceivedRequest {
+  std::string method;
+  std::string uri;
+  // Value of the X-Goog-Upload-Command header.
+  std::string upload_command;
+  // Value of the X-Goog-Upload-Offset header.
+  std::string upload_offset;
+  // Value of the Range header.
+  std::string range;
+  size_t body_size;
+};
+
+// Stands in for the storage backend, serving a single object, including byte
+// ranges of it, and accepting resumable uploads of it.
+class FakeBackend {
+ public:
+  explicit FakeBackend(const std::string& endpoint) : endpoint_(endpoint) {
+    Reset();
+  }
+
+  void Reset() {
+    absl::MutexLock lock(&mutex_);
+    failures_left_ = 0;
+    failure_status_ = 0;
+    response_delay_ = absl::ZeroDuration();
+    download_bytes_per_second_ = 0;
+    object_.clear();
+    honor_range_ = true;
+    requests_.clear();
+    uploaded_.clear();
+    upload_final_ = false;
+    upload_chunk_count_ = 0;
+    lost_chunk_response_ = -1;
+  }
+
+  // Fail the next count requests with the HTTP status.
+  void FailNextRequests(int count, int status) {
+    absl::MutexLock lock(&mutex_);
+    failures_left_ = count;
+    failure_status_ = status;
+  }
+
+  // Delay each response, so requests are still in flight while a test acts.
+  void set_response_delay(absl::Duration delay) {
+    absl::MutexLock lock(&mutex_);
+    response_delay_ = delay;
+  }
+
+  // Limit the rate at which each download response is sent, to stand in for
+  // the bandwidth of a single connection.  0, the default, means no limit.
+  void set_download_bytes_per_second(size_t bytes_per_second) {
+    absl::MutexLock lock(&mutex_);
+    download_bytes_per_second_ = bytes_per_second;
+  }
+
+  void set_object(const std::string& object) {
+    absl::MutexLock lock(&mutex_);
+    object_ = object;
+  }
+
+  // Whether to serve the byte range requested by the Range header, or ignore
+  // the header and serve the whole object.
+  void set_honor_range(bool honor_range) {
+    absl::MutexLock lock(&mutex_);
+    honor_range_ = honor_range;
+  }
+
+  // Store the upload chunk with the given index, starting from 0, but fail
+  // its response as if the connection had dropped.
+  void LoseChunkResponse(int index) {
+    absl::MutexLock lock(&mutex_);
+    lost_chunk_response_ = index;
+  }
+
+  std::vector<ReceivedRequest> requests() {
+    absl::MutexLock lock(&mutex_);
+    return requests_;
+  }
+
+  // Returns the received requests with the given upload command.
+  std::vector<ReceivedRequest> requests_with_command(const char* command) {
+    std::vector<ReceivedRequest> matching;
+    for (const ReceivedRequest& received : requests()) {
+      if (received.upload_command == command) matching.push_back(received);
+    }
+    return matching;
+  }
+
+  std::string uploaded() {
+    absl::MutexLock lock(&mutex_);
+    return uploaded_;
+  }
+
+  void HandleRequest(HTTPServerRequest* request) {
+    std::string body = request->input()->ToString();
+    absl::Duration delay;
+    int failure_status = 0;
+    {
+      absl::MutexLock lock(&mutex_);
+      requests_.push_back({std::string(request->http_method()),
+                           std::string(request->uri()),
+                           GetInputHeader(request, kUploadCommandHeader),
+                           GetInputHeader(request, kUploadOffsetHeader),
+                           GetInputHeader(request, "Range"), body.size()});
+      delay = response_delay_;
+      if (failures_left_ > 0) {
+        failures_left_--;
+        failure_status = failure_status_;
+      }
+    }
+    absl::SleepFor(delay);
+    std::string uri(request->uri());
+    if (failure_status) {
+      Reply(request, failure_status, "{}");
+    } else if (uri == kUploadPath) {
+      HandleUploadRequest(request, body);
+    } else if (request->http_method() == "DELETE") {
+      request->ReplyWithStatus(HTTPResponse::RC_NO_CONTENT);
+    } else if (request->http_method() == "POST") {
+      // Start an upload session.
+      request->output_headers()->ReplaceOrAppendHeader(kUploadUrlHeader,
+                                                       endpoint_ + kUploadPath);
+      request->output_headers()->ReplaceOrAppendHeader(kUploadStatusHeader,
+                                                       "active");
+      Reply(request, HTTPResponse::RC_REQUEST_OK, "");
+    } else if (absl::EndsWith(uri, "?alt=media")) {
+      HandleDownloadRequest(request);
+    } else {
+      Reply(request, HTTPResponse::RC_REQUEST_OK, kObjectMetadata);
+    }
+  }
+
+ private:
+  void HandleUploadRequest(HTTPServerRequest* request,
+                           const std::string& body) {
+    std::string command = GetInputHeader(request, kUploadCommandHeader);
+    absl::MutexLock lock(&mutex_);
+    if (command == "query") {
+      request->output_headers()->ReplaceOrAppendHeader(
+          kUploadStatusHeader, upload_final_ ? "final" : "active");
+      request->output_headers()->ReplaceOrAppendHeader(
+          kUploadSizeReceivedHeader, absl::StrCat(uploaded_.size()));
+      Reply(request, HTTPResponse::RC_REQUEST_OK, "");
+      return;
+    }
+    if (GetInputHeader(request, kUploadOffsetHeader) !=
+        absl::StrCat(uploaded_.size())) {
+      Reply(request, HTTPResponse::RC_BAD_REQUEST, "{}");
+      return;
+    }
+    uploaded_ += body;
+    bool finalize = command == "upload, finalize";
+    if (finalize) upload_final_ = true;
+    if (upload_chunk_count_++ == lost_chunk_response_) {
+      Reply(request, HTTPResponse::RC_SERVICE_UNAVAILABLE, "{}");
+    } else if (finalize) {
+      request->output_headers()->ReplaceOrAppendHeader(kUploadStatusHeader,
+                                                       "final");
+      Reply(request, HTTPResponse::RC_REQUEST_OK, kObjectMetadata);
+    } else {
+      request->output_headers()->ReplaceOrAppendHeader(kUploadStatusHeader,
+                                                       "active");
+      Reply(request, HTTPResponse::RC_REQUEST_OK, "");
+    }
+  }
+
+  void HandleDownloadRequest(HTTPServerRequest* request) {
+    std::string range = GetInputHeader(request, "Range");
+    int status;
+    std::string body;
+    std::string content_range;
+    absl::Duration transfer_time;
+    {
+      absl::MutexLock lock(&mutex_);
+      size_t first;
+      size_t last;
+      if (range.empty() || !honor_range_ ||
+          sscanf(range.c_str(), "bytes=%zu-%zu", &first, &last) != 2) {
+        status = HTTPResponse::RC_REQUEST_OK;
+        body = object_;
+      } else if (first >= object_.size()) {
+        status = HTTPResponse::RC_REQUESTED_RANGE_NOT_SATISFIABLE;
+        content_range = absl::StrFormat("bytes */%d", object_.size());
+      } else {
+        if (last >= object_.size()) last = object_.size() - 1;
+        status = HTTPResponse::RC_PARTIAL_CONTENT;
+        body = object_.substr(first, last - first + 1);
+        content_range =
+            absl::StrFormat("bytes %d-%d/%d", first, last, object_.size());
+      }
+      if (download_bytes_per_second_ > 0) {
+        transfer_time = absl::Seconds(static_cast<double>(body.size()) /
+                                      download_bytes_per_second_);
+      }
+    }
+    absl::SleepFor(transfer_time);
+    if (!content_range.empty()) {
+      request->output_headers()->ReplaceOrAppendHeader("Content-Range",
+                                                       content_range);
+    }
+    Reply(request, status, body);
+  }
+
+  static void Reply(HTTPServerRequest* request, int status,
+                    const std::string& body) {
+    request->output()->WriteString(body);
+    request->ReplyWithStatus(static_cast<HTTPResponse::ResponseCode>(status));
+  }
+
+  std::string endpoint_;
+  absl::Mutex mutex_;
+  int failures_left_ ABSL_GUARDED_BY(mutex_);
+  int failure_status_ ABSL_GUARDED_BY(mutex_);
+  absl::Duration response_delay_ ABSL_GUARDED_BY(mutex_);
+  size_t download_bytes_per_second_ ABSL_GUARDED_BY(mutex_);
+  std::string object_ ABSL_GUARDED_BY(mutex_);
+  bool honor_range_ ABSL_GUARDED_BY(mutex_);
+  std::vector<ReceivedRequest> requests_ ABSL_GUARDED_BY(mutex_);
+  // Data received by the upload session.
+  std::string uploaded_ ABSL_GUARDED_BY(mutex_);
+  bool upload_final_ ABSL_GUARDED_BY(mutex_);
+  int upload_chunk_count_ ABSL_GUARDED_BY(mutex_);
+  int lost_chunk_response_ ABSL_GUARDED_BY(mutex_);
+};
+
+FakeBackend* g_backend = nullptr;
+
+void UriHandler(HTTPServerRequest* request) {
+  g_backend->HandleRequest(request);
+}
+
+// Wait for the future to complete, and return whether it did.
+bool WaitForCompletion(const FutureBase& future) {
+  absl::Time deadline = absl::Now() + kTimeout;
+  while (future.status() == kFutureStatusPending) {
+    if (absl::Now() > deadline) return false;
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  return true;
+}
+
+// Returns size bytes of data that differ from chunk to chunk.
+std::string CreateTestData(size_t size) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i) data[i] = static_cast<char>('a' + i % 26);
+  return data;
+}
+
+// Returns the contents of the file at path.
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+class StorageReferenceDesktopTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite() {
+    // Start a local http server standing in for the storage backend.
+    std::string error;  // PickUnusedPort actually asks for google3 string.
+    port_ = net_util::PickUnusedPort(&error);
+    CHECK_GE(port_, 0) << error;
+    endpoint_ = new std::string(absl::StrFormat("http://localhost:%d", port_));
+    g_backend = new FakeBackend(*endpoint_);
+    std::unique_ptr<net_http2::HTTPServer2::EventModeOptions> options(
+        new net_http2::HTTPServer2::EventModeOptions());
+    options->SetVersion(kServerVersion);
+    options->SetDataVersion("data_1.0");
+    options->SetServerType("server");
+    options->AddPort(port_);
+    options->SetWindowSizesAndLatency(0, 0, true);
+    auto creation_status = net_http2::HTTPServer2::CreateEventDrivenModeServer(
+        nullptr /* event manager */, std::move(options));
+    CHECK_OK(creation_status.status());
+    server_ = creation_status.value().release();
+    ABSL_DIE_IF_NULL(server_)->RegisterHandler(
+        "*", NewPermanentCallback(&UriHandler));
+    CHECK_OK(server_->StartAcceptingRequests());
+    g_storage_endpoint_for_testing = endpoint_->c_str();
+  }
+
+  static void TearDownTestSuite() {
+    g_storage_endpoint_for_testing = nullptr;
+    delete endpoint_;
+    endpoint_ = nullptr;
+    server_->TerminateServer();
+    delete server_;
+    server_ = nullptr;
+    delete g_backend;
+    g_backend = nullptr;
+  }
+
+  void SetUp() override {
+    g_backend->Reset();
+    app_ = testing::CreateApp();
+    storage_ = new StorageInternal(app_, kBucketUrl);
+    download_path_ = ::testing::TempDir() + "/download";
+  }
+
+  void TearDown() override {
+    delete storage_;
+    delete app_;
+  }
+
+  static int32_t port_;
+  static net_http2::HTTPServer2* server_;
+  static std::string* endpoint_;
+
+  App* app_;
+  StorageInternal* storage_;
+  std::string download_path_;
+};
+
+int32_t StorageReferenceDesktopTest::port_;
+net_http2::HTTPServer2* StorageReferenceDesktopTest::server_;
+std::string* StorageReferenceDesktopTest::endpoint_;
+
+TEST_F(StorageReferenceDesktopTest, TestRetryAfterReferenceIsDeleted) {
+  g_backend->FailNextRequests(1, HTTPResponse::RC_SERVICE_UNAVAILABLE);
+  g_backend->set_response_delay(absl::Milliseconds(200));
+  StorageReferenceInternal* reference = storage_->GetReference(kObjectName);
+  Future<void> future = reference->Delete();
+  // The request and its retry outlive the reference that sent them.
+  delete reference;
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  EXPECT_EQ(2u, g_backend->requests().size());
+}
+
+TEST_F(StorageReferenceDesktopTest, TestGetBytesRetryAfterReferenceIsDeleted) {
+  g_backend->FailNextRequests(2, HTTPResponse::RC_SERVICE_UNAVAILABLE);
+  g_backend->set_object("hello");
+  char buffer[16] = {};
+  StorageReferenceInternal* reference = storage_->GetReference(kObjectName);
+  Future<size_t> future =
+      reference->GetBytes(buffer, sizeof(buffer), nullptr, nullptr);
+  delete reference;
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  ASSERT_NE(nullptr, future.result());
+  EXPECT_EQ(5u, *future.result());
+  EXPECT_STREQ("hello", buffer);
+  EXPECT_EQ(3u, g_backend->requests().size());
+}
+
+TEST_F(StorageReferenceDesktopTest, TestNonRetryableFailureIsNotRetried) {
+  g_backend->FailNextRequests(1, HTTPResponse::RC_NOT_FOUND);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Future<void> future = reference->Delete();
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorObjectNotFound, future.error());
+  EXPECT_EQ(1u, g_backend->requests().size());
+}
+
+TEST_F(StorageReferenceDesktopTest, TestResumableUploadSendsChunks) {
+  storage_->set_upload_chunk_size(kChunkSize);
+  std::string data = CreateTestData(kUploadSize);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Future<Metadata> future =
+      reference->PutBytes(data.data(), data.size(), nullptr, nullptr);
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  EXPECT_EQ(data, g_backend->uploaded());
+  EXPECT_EQ(1u, g_backend->requests_with_command("start").size());
+  std::vector<ReceivedRequest> chunks =
+      g_backend->requests_with_command("upload");
+  ASSERT_EQ(3u, chunks.size());
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    EXPECT_EQ(absl::StrCat(i * kChunkSize), chunks[i].upload_offset);
+    EXPECT_EQ(kChunkSize, chunks[i].body_size);
+  }
+  std::vector<ReceivedRequest> last_chunk =
+      g_backend->requests_with_command("upload, finalize");
+  ASSERT_EQ(1u, last_chunk.size());
+  EXPECT_EQ(absl::StrCat(3 * kChunkSize), last_chunk[0].upload_offset);
+  EXPECT_EQ(100u, last_chunk[0].body_size);
+}
+
+TEST_F(StorageReferenceDesktopTest, TestResumableUploadResumesFromOffset) {
+  storage_->set_upload_chunk_size(kChunkSize);
+  // The server stores the second chunk, but the client does not see it.
+  g_backend->LoseChunkResponse(1);
+  std::string data = CreateTestData(kUploadSize);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Future<Metadata> future =
+      reference->PutBytes(data.data(), data.size(), nullptr, nullptr);
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  EXPECT_EQ(data, g_backend->uploaded());
+  // The upload queried the committed size and continued from there, so no
+  // chunk was sent twice.
+  EXPECT_EQ(1u, g_backend->requests_with_command("query").size());
+  std::vector<ReceivedRequest> chunks =
+      g_backend->requests_with_command("upload");
+  ASSERT_EQ(3u, chunks.size());
+  EXPECT_EQ(absl::StrCat(2 * kChunkSize), chunks[2].upload_offset);
+}
+
+TEST_F(StorageReferenceDesktopTest,
+       TestResumableUploadGetsMetadataWhenLastResponseIsLost) {
+  storage_->set_upload_chunk_size(kChunkSize);
+  g_backend->LoseChunkResponse(1);
+  std::string data = CreateTestData(kChunkSize + 100);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Future<Metadata> future =
+      reference->PutBytes(data.data(), data.size(), nullptr, nullptr);
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  ASSERT_NE(nullptr, future.result());
+  EXPECT_STREQ(kObjectName, future.result()->name());
+  // The query reported the upload as final, so the metadata was fetched
+  // rather than the last chunk sent again.
+  EXPECT_EQ(1u, g_backend->requests_with_command("query").size());
+  EXPECT_EQ(1u, g_backend->requests_with_command("upload, finalize").size());
+}
+
+TEST_F(StorageReferenceDesktopTest, TestControllerCancelsLaterChunk) {
+  storage_->set_upload_chunk_size(kChunkSize);
+  g_backend->set_response_delay(absl::Milliseconds(300));
+  std::string data = CreateTestData(kUploadSize);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Controller controller;
+  Future<Metadata> future =
+      reference->PutBytes(data.data(), data.size(), nullptr, &controller);
+  EXPECT_TRUE(controller.is_valid());
+  // Wait for the second chunk to be sent, so the controller no longer
+  // controls the request that was in flight when the upload started.
+  absl::Time deadline = absl::Now() + kTimeout;
+  while (g_backend->requests_with_command("upload").size() < 2 &&
+         absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_TRUE(controller.Cancel());
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorCancelled, future.error());
+  EXPECT_FALSE(controller.is_valid());
+  EXPECT_TRUE(g_backend->requests_with_command("upload, finalize").empty());
+}
+
+TEST_F(StorageReferenceDesktopTest, TestControllerPausesAllChunks) {
+  storage_->set_upload_chunk_size(kChunkSize);
+  std::string data = CreateTestData(kUploadSize);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Controller controller;
+  Future<Metadata> future =
+      reference->PutBytes(data.data(), data.size(), nullptr, &controller);
+  EXPECT_TRUE(controller.Pause());
+  EXPECT_TRUE(controller.is_paused());
+  absl::SleepFor(absl::Milliseconds(500));
+  EXPECT_EQ(kFutureStatusPending, future.status());
+  EXPECT_TRUE(controller.Resume());
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  EXPECT_EQ(static_cast<int64_t>(kUploadSize), controller.bytes_transferred());
+  EXPECT_EQ(static_cast<int64_t>(kUploadSize), controller.total_byte_count());
+}
+
+TEST_F(StorageReferenceDesktopTest, TestUploadOutlivesController) {
+  storage_->set_upload_chunk_size(kChunkSize);
+  g_backend->set_response_delay(absl::Milliseconds(50));
+  std::string data = CreateTestData(kUploadSize);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Future<Metadata> future;
+  {
+    Controller controller;
+    future = reference->PutBytes(data.data(), data.size(), nullptr,
+                                 &controller);
+  }
+  // Later chunks must not touch the destroyed controller.
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  EXPECT_EQ(data, g_backend->uploaded());
+}
+
+TEST_F(StorageReferenceDesktopTest, TestGetFileUsesOneRequestByDefault) {
+  std::string data = CreateTestData(4 * kRangeSize + 500);
+  g_backend->set_object(data);
+  storage_->set_download_range_size(kRangeSize);
+  EXPECT_EQ(1, storage_->max_parallel_downloads());
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Future<size_t> future =
+      reference->GetFile(download_path_.c_str(), nullptr, nullptr);
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  std::vector<ReceivedRequest> requests = g_backend->requests();
+  ASSERT_EQ(1u, requests.size());
+  EXPECT_EQ("", requests[0].range);
+  EXPECT_EQ(data, ReadFile(download_path_));
+}
+
+TEST_F(StorageReferenceDesktopTest, TestGetFileSplitsObjectIntoRanges) {
+  std::string data = CreateTestData(4 * kRangeSize + 500);
+  g_backend->set_object(data);
+  storage_->set_download_range_size(kRangeSize);
+  storage_->set_max_parallel_downloads(3);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Future<size_t> future =
+      reference->GetFile(download_path_.c_str(), nullptr, nullptr);
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  ASSERT_NE(nullptr, future.result());
+  EXPECT_EQ(data.size(), *future.result());
+  EXPECT_EQ(data, ReadFile(download_path_));
+  // The first range reports the size of the object, then the rest is split
+  // into ranges, the last one ending at the end of the object.
+  std::vector<std::string> ranges;
+  for (const ReceivedRequest& received : g_backend->requests()) {
+    ranges.push_back(received.range);
+  }
+  EXPECT_THAT(ranges, ::testing::UnorderedElementsAre(
+                          "bytes=0-999", "bytes=1000-1999", "bytes=2000-2999",
+                          "bytes=3000-3999", "bytes=4000-4499"));
+  EXPECT_EQ("bytes=0-999", ranges[0]);
+}
+
+TEST_F(StorageReferenceDesktopTest, TestGetFileOfEmptyObject) {
+  // No range of an empty object can be satisfied, so the server responds
+  // with 416.
+  storage_->set_max_parallel_downloads(3);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Future<size_t> future =
+      reference->GetFile(download_path_.c_str(), nullptr, nullptr);
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  ASSERT_NE(nullptr, future.result());
+  EXPECT_EQ(0u, *future.result());
+  EXPECT_EQ(1u, g_backend->requests().size());
+  EXPECT_EQ("", ReadFile(download_path_));
+}
+
+TEST_F(StorageReferenceDesktopTest, TestGetFileWhenServerIgnoresRange) {
+  std::string data = CreateTestData(4 * kRangeSize + 500);
+  g_backend->set_object(data);
+  g_backend->set_honor_range(false);
+  storage_->set_download_range_size(kRangeSize);
+  storage_->set_max_parallel_downloads(3);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Future<size_t> future =
+      reference->GetFile(download_path_.c_str(), nullptr, nullptr);
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  // The first response held the whole object, so no other range was needed.
+  EXPECT_EQ(1u, g_backend->requests().size());
+  EXPECT_EQ(data, ReadFile(download_path_));
+}
+
+TEST_F(StorageReferenceDesktopTest, TestControllerCancelsAllRanges) {
+  g_backend->set_object(CreateTestData(10 * kRangeSize));
+  g_backend->set_response_delay(absl::Milliseconds(300));
+  storage_->set_download_range_size(kRangeSize);
+  storage_->set_max_parallel_downloads(2);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Controller controller;
+  Future<size_t> future =
+      reference->GetFile(download_path_.c_str(), nullptr, &controller);
+  EXPECT_TRUE(controller.is_valid());
+  // Wait for the ranges after the first one to be requested.
+  absl::Time deadline = absl::Now() + kTimeout;
+  while (g_backend->requests().size() < 3 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_TRUE(controller.Cancel());
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorCancelled, future.error());
+  EXPECT_FALSE(controller.is_valid());
+  EXPECT_LT(g_backend->requests().size(), 10u);
+}
+
+TEST_F(StorageReferenceDesktopTest, TestDownloadOutlivesController) {
+  std::string data = CreateTestData(10 * kRangeSize);
+  g_backend->set_object(data);
+  g_backend->set_response_delay(absl::Milliseconds(30));
+  storage_->set_download_range_size(kRangeSize);
+  storage_->set_max_parallel_downloads(2);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  Future<size_t> future;
+  {
+    Controller controller;
+    future = reference->GetFile(download_path_.c_str(), nullptr, &controller);
+  }
+  // Later ranges must not touch the destroyed controller.
+  ASSERT_TRUE(WaitForCompletion(future));
+  EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+  EXPECT_EQ(data, ReadFile(download_path_));
+}
+
+// Benchmark of GetFile with a single request and with parallel ranges, against
+// a backend that limits the bandwidth of each connection.  It is disabled by
+// default; run it with --gtest_also_run_disabled_tests.
+TEST_F(StorageReferenceDesktopTest, DISABLED_BenchmarkGetFile) {
+  const size_t kObjectSize = 16 * 1024 * 1024;
+  std::string data = CreateTestData(kObjectSize);
+  g_backend->set_object(data);
+  g_backend->set_download_bytes_per_second(8 * 1024 * 1024);
+  storage_->set_download_range_size(1024 * 1024);
+  std::unique_ptr<StorageReferenceInternal> reference(
+      storage_->GetReference(kObjectName));
+  for (int max_parallel_downloads : {1, 4, 8}) {
+    storage_->set_max_parallel_downloads(max_parallel_downloads);
+    absl::Time start = absl::Now();
+    Future<size_t> future =
+        reference->GetFile(download_path_.c_str(), nullptr, nullptr);
+    ASSERT_TRUE(WaitForCompletion(future));
+    absl::Duration elapsed = absl::Now() - start;
+    EXPECT_EQ(kErrorNone, future.error()) << future.error_message();
+    EXPECT_EQ(data, ReadFile(download_path_));
+    LOG(INFO) << "GetFile of " << kObjectSize << " bytes with up to "
+              << max_parallel_downloads << " ranges at once: " << elapsed
+              << ", "
+              << kObjectSize / absl::ToDoubleSeconds(elapsed) / (1024 * 1024)
+              << " MiB/s";
+  }
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase